@@ -20,7 +20,7 @@
 #include <alsa/asoundlib.h>
 #include "../general.h"
 #include <rthreads/rthreads.h>
-#include "../fifo_buffer.h"
+#include "../spsc_fifo.h"
 
 #define TRY_ALSA(x) if (x < 0) { \
                   goto error; \
@@ -38,11 +38,8 @@ typedef struct alsa_thread
    size_t period_size;
    snd_pcm_uframes_t period_frames;
 
-   fifo_buffer_t *buffer;
+   spsc_fifo_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
-   scond_t *cond;
-   slock_t *cond_lock;
 } alsa_thread_t;
 
 static void alsa_worker_thread(void *data)
@@ -58,12 +55,7 @@ static void alsa_worker_thread(void *data)
 
    while (!alsa->thread_dead)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_read_avail(alsa->buffer);
-      size_t fifo_size = min(alsa->period_size, avail);
-      fifo_read(alsa->buffer, buf, fifo_size);
-      scond_signal(alsa->cond);
-      slock_unlock(alsa->fifo_lock);
+      size_t fifo_size = spsc_fifo_read(alsa->buffer, buf, alsa->period_size);
 
       /* If underrun, fill rest with silence. */
       memset(buf + fifo_size, 0, alsa->period_size - fifo_size);
@@ -92,10 +84,8 @@ static void alsa_worker_thread(void *data)
    }
 
 end:
-   slock_lock(alsa->cond_lock);
    alsa->thread_dead = true;
-   scond_signal(alsa->cond);
-   slock_unlock(alsa->cond_lock);
+   spsc_fifo_wake(alsa->buffer);
    free(buf);
 }
 
@@ -129,13 +119,7 @@ static void alsa_thread_free(void *data)
          sthread_join(alsa->worker_thread);
       }
       if (alsa->buffer)
-         fifo_free(alsa->buffer);
-      if (alsa->cond)
-         scond_free(alsa->cond);
-      if (alsa->fifo_lock)
-         slock_free(alsa->fifo_lock);
-      if (alsa->cond_lock)
-         slock_free(alsa->cond_lock);
+         spsc_fifo_free(alsa->buffer);
       if (alsa->pcm)
       {
          snd_pcm_drop(alsa->pcm);
@@ -208,11 +192,10 @@ static void *alsa_thread_init(const char *device,
    snd_pcm_hw_params_free(params);
    snd_pcm_sw_params_free(sw_params);
 
-   alsa->fifo_lock = slock_new();
-   alsa->cond_lock = slock_new();
-   alsa->cond = scond_new();
-   alsa->buffer = fifo_new(alsa->buffer_size);
-   if (!alsa->fifo_lock || !alsa->cond_lock || !alsa->cond || !alsa->buffer)
+   /* The worker sleeps in snd_pcm_writei() and we only wait
+    * for it when the buffer is full, so spinning wouldn't help. */
+   alsa->buffer = spsc_fifo_new(alsa->buffer_size, 0);
+   if (!alsa->buffer)
       goto error;
 
    alsa->worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -245,37 +228,19 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
       return -1;
 
    if (alsa->nonblock)
-   {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_write_avail(alsa->buffer);
-      size_t write_amt = min(avail, size);
-      fifo_write(alsa->buffer, buf, write_amt);
-      slock_unlock(alsa->fifo_lock);
-      return write_amt;
-   }
+      return spsc_fifo_write(alsa->buffer, buf, size);
    else
    {
       size_t written = 0;
       while (written < size && !alsa->thread_dead)
       {
-         slock_lock(alsa->fifo_lock);
-         size_t avail = fifo_write_avail(alsa->buffer);
+         size_t write_amt = spsc_fifo_write(alsa->buffer,
+               (const char*)buf + written, size - written);
 
-         if (avail == 0)
-         {
-            slock_unlock(alsa->fifo_lock);
-            slock_lock(alsa->cond_lock);
-            if (!alsa->thread_dead)
-               scond_wait(alsa->cond, alsa->cond_lock);
-            slock_unlock(alsa->cond_lock);
-         }
-         else
-         {
-            size_t write_amt = min(size - written, avail);
-            fifo_write(alsa->buffer, (const char*)buf + written, write_amt);
-            slock_unlock(alsa->fifo_lock);
-            written += write_amt;
-         }
+         /* Woken early if the worker dies. */
+         if (write_amt == 0)
+            spsc_fifo_wait_write(alsa->buffer, 1);
+         written += write_amt;
       }
       return written;
    }
@@ -319,10 +284,7 @@ static size_t alsa_thread_write_avail(void *data)
 
    if (alsa->thread_dead)
       return 0;
-   slock_lock(alsa->fifo_lock);
-   size_t val = fifo_write_avail(alsa->buffer);
-   slock_unlock(alsa->fifo_lock);
-   return val;
+   return spsc_fifo_write_avail(alsa->buffer);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -17,7 +17,6 @@
 #include <rthreads/rthreads.h>
 #include "../general.h"
 #include "../performance.h"
-#include "../fifo_buffer.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -24,7 +24,23 @@
 #include <file/dir_list.h>
 #include <compat/posix_string.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #include <stdlib.h>
+#include <string.h>
+
+/* Calls timed before deciding whether a threaded chain is worth
+ * pipelining. */
+#define DSP_PIPELINE_WARMUP 64
+
+/* Roughly what waking every worker and waiting for them costs.
+ * Running the stages side by side has to save more than this. */
+#define DSP_PIPELINE_SYNC_USEC 40
+
+/* Default for threaded_max_latency in the preset. */
+#define DSP_PIPELINE_MAX_LATENCY 1024
 
 struct rarch_dsp_plug
 {
@@ -40,6 +56,41 @@ struct rarch_dsp_instance
    void *impl_data;
 };
 
+#ifdef HAVE_THREADS
+struct rarch_dsp_block
+{
+   float *samples;
+   unsigned frames;
+   unsigned capacity;
+};
+
+struct rarch_dsp_worker
+{
+   rarch_dsp_filter_t *dsp;
+   unsigned stage;
+   sthread_t *thread;
+};
+
+/* Each stage runs on its own thread, one call behind the stage
+ * before it. blocks[i] is the input of stage i, double buffered:
+ * stage i - 1 fills one half while stage i reads the other. The
+ * last entry holds the output of the chain. The caller's thread
+ * runs the first stage itself. */
+struct rarch_dsp_pipeline
+{
+   struct rarch_dsp_block (*blocks)[2];
+   struct rarch_dsp_worker *workers;
+   unsigned parity;
+
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+   unsigned generation;
+   unsigned pending;
+   bool quit;
+};
+#endif
+
 struct rarch_dsp_filter
 {
    config_file_t *conf;
@@ -49,8 +100,25 @@ struct rarch_dsp_filter
 
    struct rarch_dsp_instance *instances;
    unsigned num_instances;
+
+#ifdef HAVE_THREADS
+   /* Set from the preset's "threaded" key. Until the chain has been
+    * timed for a while, it runs in sequence as usual. */
+   bool threaded;
+   unsigned max_latency;
+   unsigned calls;
+   retro_time_t total_usec;
+   retro_time_t *stage_usec;
+   uint64_t frames;
+
+   struct rarch_dsp_pipeline *pipeline;
+#endif
 };
 
+#ifdef HAVE_THREADS
+static void dsp_pipeline_free(rarch_dsp_filter_t *dsp);
+#endif
+
 static const struct dspfilter_implementation *find_implementation(
       rarch_dsp_filter_t *dsp, const char *ident)
 {
@@ -247,6 +315,22 @@ rarch_dsp_filter_t *rarch_dsp_filter_new(
    if (!create_filter_graph(dsp, sample_rate))
       goto error;
 
+#ifdef HAVE_THREADS
+   dsp->max_latency = DSP_PIPELINE_MAX_LATENCY;
+   config_get_bool(dsp->conf, "threaded", &dsp->threaded);
+   config_get_uint(dsp->conf, "threaded_max_latency", &dsp->max_latency);
+
+   if (dsp->num_instances < 2)
+      dsp->threaded = false;
+   if (dsp->threaded)
+   {
+      dsp->stage_usec = (retro_time_t*)
+         calloc(dsp->num_instances, sizeof(*dsp->stage_usec));
+      if (!dsp->stage_usec)
+         dsp->threaded = false;
+   }
+#endif
+
    return dsp;
 
 error:
@@ -261,6 +345,12 @@ void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
    if (!dsp)
       return;
 
+#ifdef HAVE_THREADS
+   /* The workers call into the plugs, so stop them first. */
+   dsp_pipeline_free(dsp);
+   free(dsp->stage_usec);
+#endif
+
    for (i = 0; i < dsp->num_instances; i++)
    {
       if (dsp->instances[i].impl_data && dsp->instances[i].impl)
@@ -283,8 +373,8 @@ void rarch_dsp_filter_free(rarch_dsp_filter_t *dsp)
    free(dsp);
 }
 
-void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
-      struct rarch_dsp_data *data)
+static void dsp_process_serial(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data, bool timed)
 {
    unsigned i;
    struct dspfilter_output output = {0};
@@ -295,13 +385,304 @@ void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
 
    for (i = 0; i < dsp->num_instances; i++)
    {
+#ifdef HAVE_THREADS
+      retro_time_t start = timed ? rarch_get_time_usec() : 0;
+#endif
+
       input.samples = output.samples;
       input.frames  = output.frames;
       dsp->instances[i].impl->process(
             dsp->instances[i].impl_data, &output, &input);
+
+#ifdef HAVE_THREADS
+      if (timed)
+         dsp->stage_usec[i] += rarch_get_time_usec() - start;
+#endif
    }
 
    data->output        = output.samples;
    data->output_frames = output.frames;
 }
 
+#ifdef HAVE_THREADS
+static bool dsp_block_reserve(struct rarch_dsp_block *block,
+      unsigned frames)
+{
+   float *new_samples;
+
+   if (block->samples && frames <= block->capacity)
+      return true;
+
+   if (frames < 1)
+      frames = 1;
+   new_samples = (float*)realloc(block->samples,
+         frames * 2 * sizeof(float));
+   if (!new_samples)
+      return false;
+
+   block->samples  = new_samples;
+   block->capacity = frames;
+   return true;
+}
+
+static bool dsp_block_store(struct rarch_dsp_block *block,
+      const float *samples, unsigned frames)
+{
+   if (!dsp_block_reserve(block, frames))
+   {
+      block->frames = 0;
+      return false;
+   }
+
+   if (frames)
+      memcpy(block->samples, samples, frames * 2 * sizeof(float));
+   block->frames = frames;
+   return true;
+}
+
+/* Stage i reads what stage i - 1 wrote on the previous call, and
+ * writes the half of blocks[i + 1] that stage i + 1 isn't reading. */
+static void dsp_pipeline_run_stage(rarch_dsp_filter_t *dsp, unsigned i)
+{
+   struct rarch_dsp_pipeline *pipe = dsp->pipeline;
+   unsigned parity                 = pipe->parity;
+   struct rarch_dsp_block *in      = &pipe->blocks[i][i ? parity ^ 1 : parity];
+   struct rarch_dsp_block *out     = &pipe->blocks[i + 1][parity];
+   struct dspfilter_output output  = {0};
+   struct dspfilter_input input    = {0};
+
+   out->frames = 0;
+   if (!in->frames)
+      return;
+
+   input.samples = in->samples;
+   input.frames  = in->frames;
+   dsp->instances[i].impl->process(
+         dsp->instances[i].impl_data, &output, &input);
+
+   dsp_block_store(out, output.samples, output.frames);
+}
+
+static void dsp_pipeline_thread(void *data)
+{
+   struct rarch_dsp_worker *worker = (struct rarch_dsp_worker*)data;
+   struct rarch_dsp_pipeline *pipe = worker->dsp->pipeline;
+   unsigned generation             = 0;
+
+   slock_lock(pipe->lock);
+   for (;;)
+   {
+      while (pipe->generation == generation && !pipe->quit)
+         scond_wait(pipe->work_cond, pipe->lock);
+      if (pipe->quit)
+         break;
+      generation = pipe->generation;
+      slock_unlock(pipe->lock);
+
+      dsp_pipeline_run_stage(worker->dsp, worker->stage);
+
+      slock_lock(pipe->lock);
+      if (--pipe->pending == 0)
+         scond_signal(pipe->done_cond);
+   }
+   slock_unlock(pipe->lock);
+}
+
+static void dsp_pipeline_free(rarch_dsp_filter_t *dsp)
+{
+   unsigned i;
+   struct rarch_dsp_pipeline *pipe = dsp->pipeline;
+
+   if (!pipe)
+      return;
+
+   if (pipe->workers && pipe->lock)
+   {
+      slock_lock(pipe->lock);
+      pipe->quit = true;
+      scond_broadcast(pipe->work_cond);
+      slock_unlock(pipe->lock);
+
+      for (i = 1; i < dsp->num_instances; i++)
+         if (pipe->workers[i].thread)
+            sthread_join(pipe->workers[i].thread);
+   }
+
+   if (pipe->lock)
+      slock_free(pipe->lock);
+   if (pipe->work_cond)
+      scond_free(pipe->work_cond);
+   if (pipe->done_cond)
+      scond_free(pipe->done_cond);
+
+   if (pipe->blocks)
+   {
+      for (i = 0; i <= dsp->num_instances; i++)
+      {
+         free(pipe->blocks[i][0].samples);
+         free(pipe->blocks[i][1].samples);
+      }
+   }
+
+   free(pipe->blocks);
+   free(pipe->workers);
+   free(pipe);
+   dsp->pipeline = NULL;
+}
+
+static bool dsp_pipeline_init(rarch_dsp_filter_t *dsp)
+{
+   unsigned i;
+   struct rarch_dsp_pipeline *pipe = (struct rarch_dsp_pipeline*)
+      calloc(1, sizeof(*pipe));
+
+   if (!pipe)
+      return false;
+   dsp->pipeline = pipe;
+
+   pipe->blocks  = (struct rarch_dsp_block (*)[2])
+      calloc(dsp->num_instances + 1, sizeof(*pipe->blocks));
+   pipe->workers = (struct rarch_dsp_worker*)
+      calloc(dsp->num_instances, sizeof(*pipe->workers));
+   pipe->lock      = slock_new();
+   pipe->work_cond = scond_new();
+   pipe->done_cond = scond_new();
+
+   if (!pipe->blocks || !pipe->workers || !pipe->lock ||
+         !pipe->work_cond || !pipe->done_cond)
+      goto error;
+
+   /* Until the first input has made it through every stage, the
+    * last block holds nothing, but the caller still gets a real
+    * buffer to read 0 frames from. Sized for a typical call. */
+   for (i = 0; i <= dsp->num_instances; i++)
+   {
+      if (!dsp_block_reserve(&pipe->blocks[i][0], dsp->frames / dsp->calls) ||
+            !dsp_block_reserve(&pipe->blocks[i][1], dsp->frames / dsp->calls))
+         goto error;
+   }
+
+   /* Stage 0 runs on the caller's thread. */
+   for (i = 1; i < dsp->num_instances; i++)
+   {
+      pipe->workers[i].dsp    = dsp;
+      pipe->workers[i].stage  = i;
+      pipe->workers[i].thread = sthread_create(dsp_pipeline_thread,
+            &pipe->workers[i]);
+      if (!pipe->workers[i].thread)
+         goto error;
+   }
+
+   return true;
+
+error:
+   dsp_pipeline_free(dsp);
+   return false;
+}
+
+static void dsp_process_pipelined(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+   struct rarch_dsp_pipeline *pipe = dsp->pipeline;
+   struct rarch_dsp_block *out;
+
+   dsp_block_store(&pipe->blocks[0][pipe->parity],
+         data->input, data->input_frames);
+
+   slock_lock(pipe->lock);
+   pipe->pending = dsp->num_instances - 1;
+   pipe->generation++;
+   scond_broadcast(pipe->work_cond);
+   slock_unlock(pipe->lock);
+
+   dsp_pipeline_run_stage(dsp, 0);
+
+   slock_lock(pipe->lock);
+   while (pipe->pending)
+      scond_wait(pipe->done_cond, pipe->lock);
+   slock_unlock(pipe->lock);
+
+   out                 = &pipe->blocks[dsp->num_instances][pipe->parity];
+   data->output        = out->samples;
+   data->output_frames = out->frames;
+   pipe->parity ^= 1;
+}
+
+/* Pipelining pays when the stages other than the slowest one cost
+ * more than waking the workers does, there are cores to run them
+ * on, and the blocks it holds back stay under the latency limit. */
+static void dsp_pipeline_decide(rarch_dsp_filter_t *dsp)
+{
+   unsigned i;
+   retro_time_t slowest = 0;
+   retro_time_t saved;
+   unsigned latency     = (unsigned)((dsp->num_instances - 1) *
+         dsp->frames / dsp->calls);
+
+   for (i = 0; i < dsp->num_instances; i++)
+      if (dsp->stage_usec[i] > slowest)
+         slowest = dsp->stage_usec[i];
+   saved = (dsp->total_usec - slowest) / dsp->calls;
+
+   dsp->threaded = false;
+
+   if (rarch_get_cpu_cores() < 2)
+      RARCH_LOG("[DSP]: Single core, running the chain in sequence.\n");
+   else if (saved < DSP_PIPELINE_SYNC_USEC)
+      RARCH_LOG("[DSP]: Chain too cheap to pipeline (%u usec per call).\n",
+            (unsigned)(dsp->total_usec / dsp->calls));
+   else if (latency > dsp->max_latency)
+      RARCH_LOG("[DSP]: Pipelining would add %u frames of latency, limit is %u.\n",
+            latency, dsp->max_latency);
+   else if (dsp_pipeline_init(dsp))
+      RARCH_LOG("[DSP]: Pipelining %u stages, adds about %u frames of latency.\n",
+            dsp->num_instances, latency);
+}
+
+unsigned rarch_dsp_filter_latency(rarch_dsp_filter_t *dsp)
+{
+   unsigned i;
+   unsigned frames = 0;
+   struct rarch_dsp_pipeline *pipe = dsp->pipeline;
+
+   if (!pipe)
+      return 0;
+
+   /* What the stages wrote on the last call and hand on next time. */
+   for (i = 1; i < dsp->num_instances; i++)
+      frames += pipe->blocks[i][pipe->parity ^ 1].frames;
+   return frames;
+}
+#else
+unsigned rarch_dsp_filter_latency(rarch_dsp_filter_t *dsp)
+{
+   (void)dsp;
+   return 0;
+}
+#endif
+
+void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
+      struct rarch_dsp_data *data)
+{
+#ifdef HAVE_THREADS
+   if (dsp->pipeline)
+   {
+      dsp_process_pipelined(dsp, data);
+      return;
+   }
+
+   if (dsp->threaded)
+   {
+      retro_time_t start = rarch_get_time_usec();
+      dsp_process_serial(dsp, data, true);
+      dsp->total_usec += rarch_get_time_usec() - start;
+      dsp->frames     += data->input_frames;
+
+      if (++dsp->calls == DSP_PIPELINE_WARMUP)
+         dsp_pipeline_decide(dsp);
+      return;
+   }
+#endif
+
+   dsp_process_serial(dsp, data, false);
+}
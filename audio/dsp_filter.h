@@ -33,8 +33,16 @@ struct rarch_dsp_data
    unsigned output_frames;
 };
 
+/* A preset can set "threaded = true" to let long chains run each
+ * stage on its own thread. The chain is timed for a while first,
+ * and only pipelined if that pays off. A pipelined chain hands back
+ * its output one call per stage later, and 0 frames until then. */
 void rarch_dsp_filter_process(rarch_dsp_filter_t *dsp,
       struct rarch_dsp_data *data);
 
+/* Frames held back by the pipeline right now, on top of whatever
+ * the plugs buffer themselves. 0 when running in sequence. */
+unsigned rarch_dsp_filter_latency(rarch_dsp_filter_t *dsp);
+
 #endif
 
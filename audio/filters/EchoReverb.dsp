@@ -10,3 +10,10 @@ reverb_roomwidth = 0.75
 reverb_roomsize = 0.75
 reverb_damping = 1.0
 reverb_wettime = 0.3
+
+# Long chains can run each filter on its own thread. The chain is timed
+# for a moment first and only pipelined if that pays off. Every filter
+# after the first adds one block of latency; the pipeline is not used
+# if that would go over threaded_max_latency frames.
+# threaded = true
+# threaded_max_latency = 1024
@@ -85,18 +85,18 @@ static void eq_process(void *data, struct dspfilter_output *output,
       input_frames -= write_avail;
       eq->block_ptr += write_avail;
 
-      // Convolve a new block.
+      // Convolve a new block. Left and right go through as the real
+      // and imaginary parts of one transform. The filter is real in
+      // time, so the two never leak into each other.
       if (eq->block_ptr == eq->block_size)
       {
-         unsigned i, c;
+         unsigned i;
 
-         for (c = 0; c < 2; c++)
-         {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
-         }
+         fft_process_forward_complex(eq->fft, eq->fftblock,
+               (const fft_complex_t*)eq->block, 1);
+         fft_process_multiply(eq->fft, eq->fftblock, eq->fftblock, eq->filter);
+         fft_process_inverse_complex(eq->fft, (fft_complex_t*)out,
+               eq->fftblock, 1);
 
          // Overlap add method, so add in saved block now.
          for (i = 0; i < 2 * eq->block_size; i++)
@@ -278,8 +278,9 @@ end:
    free(time_filter);
 }
 
-static void *eq_init(const struct dspfilter_info *info,
-      const struct dspfilter_config *config, void *userdata)
+static void *eq_init_simd(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata,
+      enum fft_simd simd)
 {
    unsigned i;
    struct eq_data *eq = (struct eq_data*)calloc(1, sizeof(*eq));
@@ -332,7 +333,7 @@ static void *eq_init(const struct dspfilter_info *info,
 
    // Use an FFT which is twice the block size with zero-padding
    // to make circular convolution => proper convolution.
-   eq->fft = fft_new(size_log2 + 1);
+   eq->fft = fft_new_simd(size_log2 + 1, simd);
 
    if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
       goto error;
@@ -350,6 +351,24 @@ error:
    return NULL;
 }
 
+static void *eq_init(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   return eq_init_simd(info, config, userdata, FFT_SIMD_NONE);
+}
+
+static void *eq_init_sse(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   return eq_init_simd(info, config, userdata, FFT_SIMD_SSE);
+}
+
+static void *eq_init_avx(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata)
+{
+   return eq_init_simd(info, config, userdata, FFT_SIMD_AVX);
+}
+
 static const struct dspfilter_implementation eq_plug = {
    eq_init,
    eq_process,
@@ -360,13 +379,36 @@ static const struct dspfilter_implementation eq_plug = {
    "eq",
 };
 
+static const struct dspfilter_implementation eq_plug_sse = {
+   eq_init_sse,
+   eq_process,
+   eq_free,
+
+   DSPFILTER_API_VERSION,
+   "Linear-Phase FFT Equalizer (SSE)",
+   "eq",
+};
+
+static const struct dspfilter_implementation eq_plug_avx = {
+   eq_init_avx,
+   eq_process,
+   eq_free,
+
+   DSPFILTER_API_VERSION,
+   "Linear-Phase FFT Equalizer (AVX)",
+   "eq",
+};
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation eq_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+   if (mask & DSPFILTER_SIMD_AVX)
+      return &eq_plug_avx;
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &eq_plug_sse;
    return &eq_plug;
 }
 
@@ -17,6 +17,19 @@
 #include <math.h>
 #include <stdlib.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+// The AVX kernels are built with a target attribute and picked at
+// runtime, so they are there even when the plugin only assumes SSE.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+   (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#define FFT_HAVE_AVX 1
+#define FFT_AVX_TARGET __attribute__((target("avx")))
+#include <immintrin.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.1415926535897932384626433832795
 #endif
@@ -24,9 +37,18 @@
 struct fft
 {
    fft_complex_t *interleave_buffer;
-   fft_complex_t *phase_lut;
    unsigned *bitinverse_buffer;
+
+   // Twiddles for the stage with butterfly span m sit at [2 * m, 4 * m),
+   // as {cos, cos} and {-sin, sin} pairs. That way a complex multiply
+   // is two multiplies and an add with no shuffling of the twiddles.
+   // The inverse only differs in the sign of the sines.
+   float *twiddle_re;
+   float *twiddle_im_forward;
+   float *twiddle_im_inverse;
+
    unsigned size;
+   enum fft_simd simd;
 };
 
 static unsigned bitswap(unsigned x, unsigned size_log2)
@@ -46,18 +68,28 @@ static void build_bitinverse(unsigned *bitinverse, unsigned size_log2)
       bitinverse[i] = bitswap(i, size_log2);
 }
 
-static fft_complex_t exp_imag(double phase)
+static void build_twiddles(fft_t *fft)
 {
-   fft_complex_t out = { cos(phase), sin(phase) };
-   return out;
-}
+   unsigned m, j;
+   for (m = 1; m < fft->size; m <<= 1)
+   {
+      for (j = 0; j < m; j++)
+      {
+         double phase = (M_PI * j) / m;
+         float c      = cos(phase);
+         float s      = sin(phase);
+         unsigned i   = 2 * (m + j);
 
-static void build_phase_lut(fft_complex_t *out, int size)
-{
-   int i;
-   out += size;
-   for (i = -size; i <= size; i++)
-      out[i] = exp_imag((M_PI * i) / size);
+         fft->twiddle_re[i + 0] = c;
+         fft->twiddle_re[i + 1] = c;
+
+         // Forward runs with exp(-i * phase).
+         fft->twiddle_im_forward[i + 0] =  s;
+         fft->twiddle_im_forward[i + 1] = -s;
+         fft->twiddle_im_inverse[i + 0] = -s;
+         fft->twiddle_im_inverse[i + 1] =  s;
+      }
+   }
 }
 
 static void interleave_complex(const unsigned *bitinverse,
@@ -90,7 +122,18 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
-fft_t *fft_new(unsigned block_size_log2)
+static void resolve_complex(fft_complex_t *out, const fft_complex_t *in,
+      unsigned samples, float gain, unsigned step)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++, in++, out += step)
+   {
+      out->real = gain * in->real;
+      out->imag = gain * in->imag;
+   }
+}
+
+fft_t *fft_new_simd(unsigned block_size_log2, enum fft_simd simd)
 {
    fft_t *fft = (fft_t*)calloc(1, sizeof(*fft));
    if (!fft)
@@ -98,17 +141,30 @@ fft_t *fft_new(unsigned block_size_log2)
 
    unsigned size = 1 << block_size_log2;
 
-   fft->interleave_buffer = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
-   fft->bitinverse_buffer = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
-   fft->phase_lut         = (fft_complex_t*)calloc(2 * size + 1, sizeof(*fft->phase_lut));
+   fft->interleave_buffer  = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
+   fft->bitinverse_buffer  = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
+   fft->twiddle_re         = (float*)calloc(2 * size, sizeof(float));
+   fft->twiddle_im_forward = (float*)calloc(2 * size, sizeof(float));
+   fft->twiddle_im_inverse = (float*)calloc(2 * size, sizeof(float));
 
-   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->phase_lut)
+   if (!fft->interleave_buffer || !fft->bitinverse_buffer ||
+         !fft->twiddle_re || !fft->twiddle_im_forward || !fft->twiddle_im_inverse)
       goto error;
 
+#ifndef FFT_HAVE_AVX
+   if (simd == FFT_SIMD_AVX)
+      simd = FFT_SIMD_SSE;
+#endif
+#ifndef __SSE__
+   if (simd == FFT_SIMD_SSE)
+      simd = FFT_SIMD_NONE;
+#endif
+
    fft->size = size;
+   fft->simd = simd;
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
-   build_phase_lut(fft->phase_lut, size);
+   build_twiddles(fft);
    return fft;
 
 error:
@@ -116,6 +172,11 @@ error:
    return NULL;
 }
 
+fft_t *fft_new(unsigned block_size_log2)
+{
+   return fft_new_simd(block_size_log2, FFT_SIMD_NONE);
+}
+
 void fft_free(fft_t *fft)
 {
    if (!fft)
@@ -123,74 +184,232 @@ void fft_free(fft_t *fft)
 
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
-   free(fft->phase_lut);
+   free(fft->twiddle_re);
+   free(fft->twiddle_im_forward);
+   free(fft->twiddle_im_inverse);
    free(fft);
 }
 
-static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
+// Span 1 has only the trivial twiddle.
+static void fft_stage_first(fft_complex_t *buf, unsigned samples)
 {
-   mod = fft_complex_mul(mod, *b);
-   *b = fft_complex_sub(*a, mod);
-   *a = fft_complex_add(*a, mod);
+   unsigned i;
+   for (i = 0; i < samples; i += 2)
+   {
+      fft_complex_t a = buf[i];
+      fft_complex_t b = buf[i + 1];
+      buf[i]     = fft_complex_add(a, b);
+      buf[i + 1] = fft_complex_sub(a, b);
+   }
 }
 
-static void butterflies(fft_complex_t *butterfly_buf,
-      const fft_complex_t *phase_lut,
-      int phase_dir, unsigned step_size, unsigned samples)
+static void fft_stage_C(fft_complex_t *buf,
+      const float *tw_re, const float *tw_im, unsigned m, unsigned samples)
 {
    unsigned i, j;
-   for (i = 0; i < samples; i += step_size << 1)
+   tw_re += 2 * m;
+   tw_im += 2 * m;
+
+   for (i = 0; i < samples; i += m << 1)
    {
-      int phase_step = (int)samples * phase_dir / (int)step_size;
-      for (j = i; j < i + step_size; j++)
-         butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size], phase_lut[phase_step * (int)(j - i)]);
+      fft_complex_t *a = buf + i;
+      fft_complex_t *b = buf + i + m;
+
+      for (j = 0; j < m; j++)
+      {
+         fft_complex_t t = {
+            b[j].real * tw_re[2 * j + 0] + b[j].imag * tw_im[2 * j + 0],
+            b[j].imag * tw_re[2 * j + 1] + b[j].real * tw_im[2 * j + 1],
+         };
+
+         b[j] = fft_complex_sub(a[j], t);
+         a[j] = fft_complex_add(a[j], t);
+      }
    }
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+#ifdef __SSE__
+// Two butterflies at a time, so m >= 2.
+static void fft_stage_sse(fft_complex_t *buf,
+      const float *tw_re, const float *tw_im, unsigned m, unsigned samples)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   unsigned i, j;
+   tw_re += 2 * m;
+   tw_im += 2 * m;
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+   for (i = 0; i < samples; i += m << 1)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      float *a = (float*)(buf + i);
+      float *b = (float*)(buf + i + m);
+
+      for (j = 0; j < 2 * m; j += 4)
+      {
+         __m128 va = _mm_loadu_ps(a + j);
+         __m128 vb = _mm_loadu_ps(b + j);
+         __m128 sw = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+         __m128 t  = _mm_add_ps(_mm_mul_ps(vb, _mm_loadu_ps(tw_re + j)),
+               _mm_mul_ps(sw, _mm_loadu_ps(tw_im + j)));
+
+         _mm_storeu_ps(b + j, _mm_sub_ps(va, t));
+         _mm_storeu_ps(a + j, _mm_add_ps(va, t));
+      }
    }
 }
 
-void fft_process_forward(fft_t *fft,
-      fft_complex_t *out, const float *in, unsigned step)
+static void fft_multiply_sse(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples)
 {
-   unsigned step_size;
+   unsigned i;
+   const __m128 sign = _mm_set_ps(1.0f, -1.0f, 1.0f, -1.0f);
+
+   for (i = 0; i + 2 <= samples; i += 2)
+   {
+      __m128 va = _mm_loadu_ps((const float*)(a + i));
+      __m128 vb = _mm_loadu_ps((const float*)(b + i));
+      __m128 re = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 2, 0, 0));
+      __m128 im = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(3, 3, 1, 1));
+      __m128 sw = _mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 3, 0, 1));
+
+      _mm_storeu_ps((float*)(out + i), _mm_add_ps(_mm_mul_ps(va, re),
+               _mm_mul_ps(_mm_mul_ps(sw, im), sign)));
+   }
+
+   for (; i < samples; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+#endif
+
+#ifdef FFT_HAVE_AVX
+// Four butterflies at a time, so m >= 4.
+static FFT_AVX_TARGET void fft_stage_avx(fft_complex_t *buf,
+      const float *tw_re, const float *tw_im, unsigned m, unsigned samples)
+{
+   unsigned i, j;
+   tw_re += 2 * m;
+   tw_im += 2 * m;
+
+   for (i = 0; i < samples; i += m << 1)
+   {
+      float *a = (float*)(buf + i);
+      float *b = (float*)(buf + i + m);
+
+      for (j = 0; j < 2 * m; j += 8)
+      {
+         __m256 va = _mm256_loadu_ps(a + j);
+         __m256 vb = _mm256_loadu_ps(b + j);
+         __m256 sw = _mm256_permute_ps(vb, _MM_SHUFFLE(2, 3, 0, 1));
+         __m256 t  = _mm256_add_ps(_mm256_mul_ps(vb, _mm256_loadu_ps(tw_re + j)),
+               _mm256_mul_ps(sw, _mm256_loadu_ps(tw_im + j)));
+
+         _mm256_storeu_ps(b + j, _mm256_sub_ps(va, t));
+         _mm256_storeu_ps(a + j, _mm256_add_ps(va, t));
+      }
+   }
+}
+
+static FFT_AVX_TARGET void fft_multiply_avx(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples)
+{
+   unsigned i;
+
+   for (i = 0; i + 4 <= samples; i += 4)
+   {
+      __m256 va = _mm256_loadu_ps((const float*)(a + i));
+      __m256 vb = _mm256_loadu_ps((const float*)(b + i));
+      __m256 sw = _mm256_permute_ps(va, _MM_SHUFFLE(2, 3, 0, 1));
+
+      _mm256_storeu_ps((float*)(out + i), _mm256_addsub_ps(
+               _mm256_mul_ps(va, _mm256_moveldup_ps(vb)),
+               _mm256_mul_ps(sw, _mm256_movehdup_ps(vb))));
+   }
+
+   for (; i < samples; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
+}
+#endif
+
+static void butterflies(fft_t *fft, fft_complex_t *buf, const float *tw_im)
+{
+   unsigned m;
    unsigned samples = fft->size;
-   interleave_float(fft->bitinverse_buffer, out, in, samples, step);
 
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
+   if (samples < 2)
+      return;
+
+   fft_stage_first(buf, samples);
+
+   for (m = 2; m < samples; m <<= 1)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+#ifdef FFT_HAVE_AVX
+      if (fft->simd == FFT_SIMD_AVX && m >= 4)
+      {
+         fft_stage_avx(buf, fft->twiddle_re, tw_im, m, samples);
+         continue;
+      }
+#endif
+#ifdef __SSE__
+      if (fft->simd != FFT_SIMD_NONE)
+      {
+         fft_stage_sse(buf, fft->twiddle_re, tw_im, m, samples);
+         continue;
+      }
+#endif
+      fft_stage_C(buf, fft->twiddle_re, tw_im, m, samples);
    }
 }
 
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   interleave_complex(fft->bitinverse_buffer, out, in, fft->size, step);
+   butterflies(fft, out, fft->twiddle_im_forward);
+}
+
+void fft_process_forward(fft_t *fft,
+      fft_complex_t *out, const float *in, unsigned step)
+{
+   interleave_float(fft->bitinverse_buffer, out, in, fft->size, step);
+   butterflies(fft, out, fft->twiddle_im_forward);
+}
+
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
    interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer, in, samples, 1);
+   butterflies(fft, fft->interleave_buffer, fft->twiddle_im_inverse);
+   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned samples = fft->size;
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer, in, samples, 1);
+   butterflies(fft, fft->interleave_buffer, fft->twiddle_im_inverse);
+   resolve_complex(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
+
+void fft_process_multiply(fft_t *fft, fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b)
+{
+   unsigned i;
+
+#ifdef FFT_HAVE_AVX
+   if (fft->simd == FFT_SIMD_AVX)
+   {
+      fft_multiply_avx(out, a, b, fft->size);
+      return;
+   }
+#endif
+#ifdef __SSE__
+   if (fft->simd != FFT_SIMD_NONE)
    {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
+      fft_multiply_sse(out, a, b, fft->size);
+      return;
    }
+#endif
 
-   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+   for (i = 0; i < fft->size; i++)
+      out[i] = fft_complex_mul(a[i], b[i]);
 }
-
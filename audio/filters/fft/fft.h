@@ -70,8 +70,19 @@ static inline fft_complex_t fft_complex_conj(fft_complex_t a)
    return out;
 }
 
+// Which butterfly kernels an FFT runs with.
+enum fft_simd
+{
+   FFT_SIMD_NONE = 0,
+   FFT_SIMD_SSE,
+   FFT_SIMD_AVX
+};
+
 fft_t *fft_new(unsigned block_size_log2);
 
+// Falls back to a narrower kernel if this build can't do the one asked for.
+fft_t *fft_new_simd(unsigned block_size_log2, enum fft_simd simd);
+
 void fft_free(fft_t *fft);
 
 void fft_process_forward_complex(fft_t *fft,
@@ -83,6 +94,16 @@ void fft_process_forward(fft_t *fft,
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step);
 
+// Like fft_process_inverse, but keeps the imaginary part. Since a
+// stereo pair fits in one fft_complex_t, one complex transform can
+// carry both channels through a real-valued filter.
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step);
+
+// out[i] = a[i] * b[i] for a whole block. out may alias a.
+void fft_process_multiply(fft_t *fft, fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b);
+
 
 #endif
 
@@ -19,6 +19,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #ifndef M_PI
 #define M_PI		3.1415926535897932384626433832795
 #endif
@@ -43,8 +47,9 @@ enum IIRFilter {
 
 struct iir_data
 {
+   // Normalized so that a0 is 1.
    float b0, b1, b2;
-   float a0, a1, a2;
+   float a1, a2;
 
    struct
    {
@@ -72,7 +77,6 @@ static void iir_process(void *data, struct dspfilter_output *output,
    float b0 = iir->b0;
    float b1 = iir->b1;
    float b2 = iir->b2;
-   float a0 = iir->a0;
    float a1 = iir->a1;
    float a2 = iir->a2;
 
@@ -91,8 +95,8 @@ static void iir_process(void *data, struct dspfilter_output *output,
       float in_l = out[0];
       float in_r = out[1];
 
-      float l = (b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l) / a0;
-      float r = (b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r) / a0;
+      float l = b0 * in_l + b1 * xn1_l + b2 * xn2_l - a1 * yn1_l - a2 * yn2_l;
+      float r = b0 * in_r + b1 * xn1_r + b2 * xn2_r - a1 * yn1_r - a2 * yn2_r;
 
       xn2_l = xn1_l;
       xn1_l = in_l;
@@ -119,6 +123,85 @@ static void iir_process(void *data, struct dspfilter_output *output,
    iir->r.yn2 = yn2_r;
 }
 
+#ifdef __SSE__
+// The recursion runs through every frame, so rather than across
+// time this goes across channels: left and right share a register.
+// Two frames are loaded and stored at a time.
+static void iir_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i;
+   struct iir_data *iir = (struct iir_data*)data;
+
+   output->samples = input->samples;
+   output->frames  = input->frames;
+
+   float *out = output->samples;
+
+   __m128 b0 = _mm_set1_ps(iir->b0);
+   __m128 b1 = _mm_set1_ps(iir->b1);
+   __m128 b2 = _mm_set1_ps(iir->b2);
+   __m128 a1 = _mm_set1_ps(iir->a1);
+   __m128 a2 = _mm_set1_ps(iir->a2);
+
+   __m128 xn1 = _mm_set_ps(0.0f, 0.0f, iir->r.xn1, iir->l.xn1);
+   __m128 xn2 = _mm_set_ps(0.0f, 0.0f, iir->r.xn2, iir->l.xn2);
+   __m128 yn1 = _mm_set_ps(0.0f, 0.0f, iir->r.yn1, iir->l.yn1);
+   __m128 yn2 = _mm_set_ps(0.0f, 0.0f, iir->r.yn2, iir->l.yn2);
+
+   for (i = 0; i + 2 <= input->frames; i += 2, out += 4)
+   {
+      __m128 in  = _mm_loadu_ps(out);
+      __m128 in0 = in;
+      __m128 in1 = _mm_movehl_ps(in, in);
+
+      __m128 y0 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, in0),
+                  _mm_mul_ps(b1, xn1)), _mm_mul_ps(b2, xn2)),
+            _mm_add_ps(_mm_mul_ps(a1, yn1), _mm_mul_ps(a2, yn2)));
+      __m128 y1 = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, in1),
+                  _mm_mul_ps(b1, in0)), _mm_mul_ps(b2, xn1)),
+            _mm_add_ps(_mm_mul_ps(a1, y0), _mm_mul_ps(a2, yn1)));
+
+      xn2 = in0;
+      xn1 = in1;
+      yn2 = y0;
+      yn1 = y1;
+
+      _mm_storeu_ps(out, _mm_movelh_ps(y0, y1));
+   }
+
+   if (i < input->frames)
+   {
+      __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)out);
+      __m128 y  = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, in),
+                  _mm_mul_ps(b1, xn1)), _mm_mul_ps(b2, xn2)),
+            _mm_add_ps(_mm_mul_ps(a1, yn1), _mm_mul_ps(a2, yn2)));
+
+      xn2 = xn1;
+      xn1 = in;
+      yn2 = yn1;
+      yn1 = y;
+
+      _mm_storel_pi((__m64*)out, y);
+   }
+
+   float state[4][4];
+   _mm_storeu_ps(state[0], xn1);
+   _mm_storeu_ps(state[1], xn2);
+   _mm_storeu_ps(state[2], yn1);
+   _mm_storeu_ps(state[3], yn2);
+
+   iir->l.xn1 = state[0][0];
+   iir->r.xn1 = state[0][1];
+   iir->l.xn2 = state[1][0];
+   iir->r.xn2 = state[1][1];
+   iir->l.yn1 = state[2][0];
+   iir->r.yn1 = state[2][1];
+   iir->l.yn2 = state[3][0];
+   iir->r.yn2 = state[3][1];
+}
+#endif
+
 #define CHECK(x) if (!strcmp(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
 {
@@ -315,12 +398,11 @@ static void iir_filter_init(struct iir_data *iir,
          break;
    }
 
-   iir->b0 = b0;
-   iir->b1 = b1;
-   iir->b2 = b2;
-   iir->a0 = a0;
-   iir->a1 = a1;
-   iir->a2 = a2;
+   iir->b0 = b0 / a0;
+   iir->b1 = b1 / a0;
+   iir->b2 = b2 / a0;
+   iir->a1 = a1 / a0;
+   iir->a2 = a2 / a0;
 }
 
 static void *iir_init(const struct dspfilter_info *info,
@@ -355,13 +437,28 @@ static const struct dspfilter_implementation iir_plug = {
    "iir",
 };
 
+#ifdef __SSE__
+static const struct dspfilter_implementation iir_plug_sse = {
+   iir_init,
+   iir_process_sse,
+   iir_free,
+
+   DSPFILTER_API_VERSION,
+   "IIR (SSE)",
+   "iir",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation iir_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#ifdef __SSE__
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &iir_plug_sse;
+#endif
    return &iir_plug;
 }
 
@@ -19,6 +19,17 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+// Left and right run through identically tuned filters in lockstep,
+// so each filter keeps both channels interleaved in one buffer.
+
 struct comb
 {
    float *buffer;
@@ -26,22 +37,26 @@ struct comb
    unsigned bufidx;
 
    float feedback;
-   float filterstore;
+   float filterstore[2];
    float damp1, damp2;
 };
 
-static inline float comb_process(struct comb *c, float input)
+static inline void comb_process(struct comb *c, const float *input, float *output)
 {
-   float output = c->buffer[c->bufidx];
-   c->filterstore = (output * c->damp2) + (c->filterstore * c->damp1);
+   unsigned ch;
+   float *buf = c->buffer + 2 * c->bufidx;
 
-   c->buffer[c->bufidx] = input + (c->filterstore * c->feedback);
+   for (ch = 0; ch < 2; ch++)
+   {
+      float out = buf[ch];
+      c->filterstore[ch] = (out * c->damp2) + (c->filterstore[ch] * c->damp1);
+      buf[ch] = input[ch] + (c->filterstore[ch] * c->feedback);
+      output[ch] += out;
+   }
 
    c->bufidx++;
    if (c->bufidx >= c->bufsize)
       c->bufidx = 0;
-
-   return output;
 }
 
 struct allpass
@@ -52,17 +67,22 @@ struct allpass
    unsigned bufidx;
 };
 
-static inline float allpass_process(struct allpass *a, float input)
+static inline void allpass_process(struct allpass *a, float *samples)
 {
-   float bufout = a->buffer[a->bufidx];
-   float output = -input + bufout;
-   a->buffer[a->bufidx] = input + bufout * a->feedback;
+   unsigned ch;
+   float *buf = a->buffer + 2 * a->bufidx;
+
+   for (ch = 0; ch < 2; ch++)
+   {
+      float bufout = buf[ch];
+      float output = -samples[ch] + bufout;
+      buf[ch] = samples[ch] + bufout * a->feedback;
+      samples[ch] = output;
+   }
 
    a->bufidx++;
    if (a->bufidx >= a->bufsize)
       a->bufidx = 0;
-
-   return output;
 }
 
 #define numcombs 8
@@ -100,19 +120,19 @@ struct revmodel
    struct comb combL[numcombs];
    struct allpass allpassL[numallpasses];
 
-   float bufcombL1[combtuningL1];
-   float bufcombL2[combtuningL2];
-   float bufcombL3[combtuningL3];
-   float bufcombL4[combtuningL4];
-   float bufcombL5[combtuningL5];
-   float bufcombL6[combtuningL6];
-   float bufcombL7[combtuningL7];
-   float bufcombL8[combtuningL8];
+   float bufcombL1[2 * combtuningL1];
+   float bufcombL2[2 * combtuningL2];
+   float bufcombL3[2 * combtuningL3];
+   float bufcombL4[2 * combtuningL4];
+   float bufcombL5[2 * combtuningL5];
+   float bufcombL6[2 * combtuningL6];
+   float bufcombL7[2 * combtuningL7];
+   float bufcombL8[2 * combtuningL8];
 
-   float bufallpassL1[allpasstuningL1];
-   float bufallpassL2[allpasstuningL2];
-   float bufallpassL3[allpasstuningL3];
-   float bufallpassL4[allpasstuningL4];
+   float bufallpassL1[2 * allpasstuningL1];
+   float bufallpassL2[2 * allpasstuningL2];
+   float bufallpassL3[2 * allpasstuningL3];
+   float bufallpassL4[2 * allpasstuningL4];
 
    float gain;
    float roomsize, roomsize1;
@@ -123,20 +143,141 @@ struct revmodel
    float mode;
 };
 
-static float revmodel_process(struct revmodel *rev, float in)
+static void revmodel_process(struct revmodel *rev, float *frame)
 {
    int i;
-   float mono_out = 0.0f;
-   float mono_in = in;
-   float input = mono_in * rev->gain;
+   float out[2]   = { 0.0f, 0.0f };
+   float input[2] = { frame[0] * rev->gain, frame[1] * rev->gain };
+
    for (i = 0; i < numcombs; i++)
-      mono_out += comb_process(&rev->combL[i], input);
+      comb_process(&rev->combL[i], input, out);
 
    for (i = 0; i < numallpasses; i++)
-      mono_out = allpass_process(&rev->allpassL[i], mono_out);
+      allpass_process(&rev->allpassL[i], out);
+
+   frame[0] = frame[0] * rev->dry + out[0] * rev->wet1;
+   frame[1] = frame[1] * rev->dry + out[1] * rev->wet1;
+}
+
+#ifdef __SSE__
+// Frames until the first of the delay lines wraps around.
+static unsigned revmodel_frames_to_wrap(const struct revmodel *rev)
+{
+   int i;
+   unsigned frames = ~0u;
+
+   for (i = 0; i < numcombs; i++)
+      frames = min(frames, rev->combL[i].bufsize - rev->combL[i].bufidx);
+   for (i = 0; i < numallpasses; i++)
+      frames = min(frames, rev->allpassL[i].bufsize - rev->allpassL[i].bufidx);
+
+   return frames;
+}
+
+// Each comb holds a left/right pair, so two combs fill a register and
+// the eight combs take four. The allpasses are in series and only get
+// the two channels. Frames are run in stretches where no delay line
+// wraps, so the inner loop just walks pointers.
+static void revmodel_process_sse(struct revmodel *rev, float *frames,
+      unsigned num_frames)
+{
+   int i;
+   __m128 filterstore[numcombs / 2];
+   const __m128 damp1    = _mm_set1_ps(rev->combL[0].damp1);
+   const __m128 damp2    = _mm_set1_ps(rev->combL[0].damp2);
+   const __m128 feedback = _mm_set1_ps(rev->combL[0].feedback);
+   const __m128 ap_fb    = _mm_set1_ps(rev->allpassL[0].feedback);
+   const __m128 gain     = _mm_set1_ps(rev->gain);
+   const __m128 dry      = _mm_set1_ps(rev->dry);
+   const __m128 wet      = _mm_set1_ps(rev->wet1);
+
+   for (i = 0; i < numcombs / 2; i++)
+      filterstore[i] = _mm_set_ps(
+            rev->combL[2 * i + 1].filterstore[1], rev->combL[2 * i + 1].filterstore[0],
+            rev->combL[2 * i + 0].filterstore[1], rev->combL[2 * i + 0].filterstore[0]);
+
+   while (num_frames)
+   {
+      unsigned n, f;
+      float *comb[numcombs];
+      float *allpass[numallpasses];
+
+      n = min(num_frames, revmodel_frames_to_wrap(rev));
+
+      for (i = 0; i < numcombs; i++)
+         comb[i] = rev->combL[i].buffer + 2 * rev->combL[i].bufidx;
+      for (i = 0; i < numallpasses; i++)
+         allpass[i] = rev->allpassL[i].buffer + 2 * rev->allpassL[i].bufidx;
+
+      for (f = 0; f < n; f++, frames += 2)
+      {
+         __m128 in    = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)frames);
+         __m128 input = _mm_mul_ps(_mm_movelh_ps(in, in), gain);
+         __m128 out   = _mm_setzero_ps();
+
+         for (i = 0; i < numcombs / 2; i++)
+         {
+            __m128 bufout = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(),
+                     (const __m64*)comb[2 * i]), (const __m64*)comb[2 * i + 1]);
+            __m128 store;
+
+            filterstore[i] = _mm_add_ps(_mm_mul_ps(bufout, damp2),
+                  _mm_mul_ps(filterstore[i], damp1));
+            store = _mm_add_ps(input, _mm_mul_ps(filterstore[i], feedback));
+
+            _mm_storel_pi((__m64*)comb[2 * i], store);
+            _mm_storeh_pi((__m64*)comb[2 * i + 1], store);
+            comb[2 * i] += 2;
+            comb[2 * i + 1] += 2;
+
+            out = _mm_add_ps(out, bufout);
+         }
+
+         // Combs were summed in pairs; fold them into one left/right pair.
+         out = _mm_add_ps(out, _mm_movehl_ps(out, out));
+
+         for (i = 0; i < numallpasses; i++)
+         {
+            __m128 bufout = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)allpass[i]);
+            __m128 output = _mm_sub_ps(bufout, out);
+
+            _mm_storel_pi((__m64*)allpass[i],
+                  _mm_add_ps(out, _mm_mul_ps(bufout, ap_fb)));
+            allpass[i] += 2;
+            out = output;
+         }
+
+         _mm_storel_pi((__m64*)frames, _mm_add_ps(_mm_mul_ps(in, dry),
+                  _mm_mul_ps(out, wet)));
+      }
+
+      for (i = 0; i < numcombs; i++)
+      {
+         rev->combL[i].bufidx += n;
+         if (rev->combL[i].bufidx >= rev->combL[i].bufsize)
+            rev->combL[i].bufidx = 0;
+      }
+      for (i = 0; i < numallpasses; i++)
+      {
+         rev->allpassL[i].bufidx += n;
+         if (rev->allpassL[i].bufidx >= rev->allpassL[i].bufsize)
+            rev->allpassL[i].bufidx = 0;
+      }
+
+      num_frames -= n;
+   }
 
-   return mono_in * rev->dry + mono_out * rev->wet1;
+   for (i = 0; i < numcombs / 2; i++)
+   {
+      float store[4];
+      _mm_storeu_ps(store, filterstore[i]);
+      rev->combL[2 * i + 0].filterstore[0] = store[0];
+      rev->combL[2 * i + 0].filterstore[1] = store[1];
+      rev->combL[2 * i + 1].filterstore[0] = store[2];
+      rev->combL[2 * i + 1].filterstore[1] = store[3];
+   }
 }
+#endif
 
 static void revmodel_update(struct revmodel *rev)
 {
@@ -231,7 +372,7 @@ static void revmodel_init(struct revmodel *rev)
 
 struct reverb_data
 {
-   struct revmodel left, right;
+   struct revmodel rev;
 };
 
 static void reverb_free(void *data)
@@ -250,13 +391,21 @@ static void reverb_process(void *data, struct dspfilter_output *output,
    float *out = output->samples;
 
    for (i = 0; i < input->frames; i++, out += 2)
-   {
-      float in[2] = { out[0], out[1] };
+      revmodel_process(&rev->rev, out);
+}
 
-      out[0] = revmodel_process(&rev->left, in[0]);
-      out[1] = revmodel_process(&rev->right, in[1]);
-   }
+#ifdef __SSE__
+static void reverb_process_sse(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   struct reverb_data *rev = (struct reverb_data*)data;
+
+   output->samples = input->samples;
+   output->frames  = input->frames;
+
+   revmodel_process_sse(&rev->rev, output->samples, output->frames);
 }
+#endif
 
 static void *reverb_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
@@ -272,20 +421,13 @@ static void *reverb_init(const struct dspfilter_info *info,
    config->get_float(userdata, "roomwidth", &roomwidth, 0.56f);
    config->get_float(userdata, "roomsize", &roomsize, 0.56f);
 
-   revmodel_init(&rev->left);
-   revmodel_init(&rev->right);
-
-   revmodel_setdamp(&rev->left, damping);
-   revmodel_setdry(&rev->left, drytime);
-   revmodel_setwet(&rev->left, wettime);
-   revmodel_setwidth(&rev->left, roomwidth);
-   revmodel_setroomsize(&rev->left, roomsize);
+   revmodel_init(&rev->rev);
 
-   revmodel_setdamp(&rev->right, damping);
-   revmodel_setdry(&rev->right, drytime);
-   revmodel_setwet(&rev->right, wettime);
-   revmodel_setwidth(&rev->right, roomwidth);
-   revmodel_setroomsize(&rev->right, roomsize);
+   revmodel_setdamp(&rev->rev, damping);
+   revmodel_setdry(&rev->rev, drytime);
+   revmodel_setwet(&rev->rev, wettime);
+   revmodel_setwidth(&rev->rev, roomwidth);
+   revmodel_setroomsize(&rev->rev, roomsize);
 
    return rev;
 }
@@ -300,13 +442,28 @@ static const struct dspfilter_implementation reverb_plug = {
    "reverb",
 };
 
+#ifdef __SSE__
+static const struct dspfilter_implementation reverb_plug_sse = {
+   reverb_init,
+   reverb_process_sse,
+   reverb_free,
+
+   DSPFILTER_API_VERSION,
+   "Reverb (SSE)",
+   "reverb",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation reverb_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
+#ifdef __SSE__
+   if (mask & DSPFILTER_SIMD_SSE)
+      return &reverb_plug_sse;
+#endif
    return &reverb_plug;
 }
 
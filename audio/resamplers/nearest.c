@@ -7,6 +7,7 @@
 #if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
 #include "../../general.h"
 #else
+#include <stdio.h>
 /* FIXME - variadic macros not supported for MSVC 2003 */
 #define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
 #endif
@@ -49,13 +50,15 @@ static void resampler_nearest_free(void *re_)
 }
  
 static void *resampler_nearest_init(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
 {
    rarch_nearest_resampler_t *re = (rarch_nearest_resampler_t*)
       calloc(1, sizeof(rarch_nearest_resampler_t));
 
    (void)config;
    (void)mask;
+   (void)quality;
 
    if (!re)
       return NULL;
@@ -16,6 +16,8 @@
 #include "resampler.h"
 #ifdef RARCH_INTERNAL
 #include "../../performance.h"
+#else
+uint64_t rarch_get_cpu_features(void);
 #endif
 #include <file/config_file_userdata.h>
 #include <string.h>
@@ -97,11 +99,11 @@ static const rarch_resampler_t *find_resampler_driver(const char *ident)
 
 static bool resampler_append_plugs(void **re,
       const rarch_resampler_t **backend,
-      double bw_ratio)
+      enum resampler_quality quality, double bw_ratio)
 {
    resampler_simd_mask_t mask = rarch_get_cpu_features();
 
-   *re = (*backend)->init(&resampler_config, bw_ratio, mask);
+   *re = (*backend)->init(&resampler_config, bw_ratio, quality, mask);
 
    if (!*re)
       return false;
@@ -109,7 +111,7 @@ static bool resampler_append_plugs(void **re,
 }
 
 bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend,
-      const char *ident, double bw_ratio)
+      const char *ident, enum resampler_quality quality, double bw_ratio)
 {
    if (*re && *backend)
       (*backend)->free(*re);
@@ -117,7 +119,7 @@ bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend,
    *re      = NULL;
    *backend = find_resampler_driver(ident);
 
-   if (!resampler_append_plugs(re, backend, bw_ratio))
+   if (!resampler_append_plugs(re, backend, quality, bw_ratio))
       goto error;
 
    return true;
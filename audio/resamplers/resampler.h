@@ -53,7 +53,18 @@ extern "C" {
  */
 typedef unsigned resampler_simd_mask_t;
 
-#define RESAMPLER_API_VERSION 1
+#define RESAMPLER_API_VERSION 2
+
+/* Quality/speed trade-off, for resamplers that have one. */
+enum resampler_quality
+{
+   RESAMPLER_QUALITY_DONTCARE = 0,
+   RESAMPLER_QUALITY_LOWEST,
+   RESAMPLER_QUALITY_LOWER,
+   RESAMPLER_QUALITY_NORMAL,
+   RESAMPLER_QUALITY_HIGHER,
+   RESAMPLER_QUALITY_HIGHEST
+};
 
 struct resampler_data
 {
@@ -108,7 +119,8 @@ struct resampler_config
 /* Bandwidth factor. Will be < 1.0 for downsampling, > 1.0 for upsampling. 
  * Corresponds to expected resampling ratio. */
 typedef void *(*resampler_init_t)(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask);
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask);
 
 /* Frees the handle. */
 typedef void (*resampler_free_t)(void *data);
@@ -146,7 +158,7 @@ extern rarch_resampler_t nearest_resampler;
 /* Reallocs resampler. Will free previous handle before 
  * allocating a new one. If ident is NULL, first resampler will be used. */
 bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend,
-      const char *ident, double bw_ratio);
+      const char *ident, enum resampler_quality quality, double bw_ratio);
 
 /* Convenience macros.
  * freep makes sure to set handles to NULL to avoid double-free 
@@ -25,6 +25,7 @@
 #if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
 #include "../../general.h"
 #else
+#include <stdio.h>
 #define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
 #endif
 
@@ -32,6 +33,22 @@
 #include <xmmintrin.h>
 #endif
 
+/* The AVX2/FMA kernel is built with a target attribute, so it is
+ * there even when the rest of the build only assumes SSE, and
+ * picked at runtime from the SIMD mask. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+   (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+#define SINC_HAVE_AVX2 1
+#define SINC_AVX2_TARGET __attribute__((target("avx2,fma")))
+#include <immintrin.h>
+#endif
+
+enum sinc_window
+{
+   SINC_WINDOW_LANCZOS = 0,
+   SINC_WINDOW_KAISER
+};
+
 /* Rough SNR values for upsampling:
  * LOWEST: 40 dB
  * LOWER: 55 dB
@@ -39,72 +56,97 @@
  * HIGHER: 110 dB
  * HIGHEST: 140 dB
  */
+struct sinc_quality
+{
+   const char *ident;
+   enum sinc_window window;
+   double kaiser_beta;
+   double cutoff;
+   unsigned phase_bits;
+   unsigned subphase_bits;
+   bool coeff_lerp;
+   /* Only used when the frontend doesn't set audio_sinc_taps. */
+   unsigned sidelobes;
+};
+
+static const struct sinc_quality sinc_qualities[] = {
+   { "lowest",  SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, false, 2   },
+   { "lower",   SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, false, 4   },
+   { "normal",  SINC_WINDOW_KAISER,  5.5,  0.825, 8,  16, true,  8   },
+   { "higher",  SINC_WINDOW_KAISER,  10.5, 0.90,  10, 14, true,  32  },
+   { "highest", SINC_WINDOW_KAISER,  14.5, 0.962, 10, 14, true,  128 },
+};
 
-/* TODO, make all this more configurable. */
+/* Builds can still pick the tier used when the
+ * frontend doesn't ask for one. */
 #if defined(SINC_LOWEST_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 2
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_LOWEST
 #elif defined(SINC_LOWER_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 4
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_LOWER
 #elif defined(SINC_HIGHER_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 10.5
-#define CUTOFF 0.90
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 32
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_HIGHER
 #elif defined(SINC_HIGHEST_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 14.5
-#define CUTOFF 0.962
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 128
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_HIGHEST
 #else
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 5.5
-#define CUTOFF 0.825
-#define PHASE_BITS 8
-#define SUBPHASE_BITS 16
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 8
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY RESAMPLER_QUALITY_NORMAL
 #endif
 
-/* For the little amount of taps we're using,
- * SSE1 is faster than AVX for some reason.
- * AVX code is kept here though as by increasing number
- * of sinc taps, the AVX code is clearly faster than SSE1.
- */
-
-#if defined(__AVX__) && ENABLE_AVX
-#include <immintrin.h>
-#endif
-
-#define PHASES (1 << (PHASE_BITS + SUBPHASE_BITS))
-
-#define TAPS (SIDELOBES * 2)
-#define SUBPHASE_MASK ((1 << SUBPHASE_BITS) - 1)
-#define SUBPHASE_MOD (1.0f / (1 << SUBPHASE_BITS))
+/* When the nominal out/in ratio is close to phases / step, with at
+ * most SINC_POLY_MAX_PHASES phases, we resample at exactly that
+ * ratio from a filter bank with one row per phase, for as long as
+ * the requested ratio stays in a band around it.
+ *
+ * Without rate control the ratio only moves on fast forward and
+ * the like, so phases / step has to be within SINC_POLY_MAX_ERROR
+ * and the band reaches SINC_POLY_TOLERANCE either side.
+ *
+ * With rate control, the requested ratio wanders by up to
+ * audio_rate_control_delta around the nominal one as the buffer
+ * fills and drains, and the nominal one is already skewed for
+ * the display. phases / step then only has to be within
+ * SINC_POLY_DELTA_SHARE of the delta and the band reaches twice
+ * that either side.
+ * While in the band, the pitch error runs the buffer towards one
+ * side until rate control pushes the ratio out of it and the
+ * general bank takes over to correct it. Half the band has to be
+ * regained before switching back, so this doesn't flip on every
+ * call. */
+#define SINC_POLY_TOLERANCE 1e-4
+#define SINC_POLY_MAX_ERROR 1e-6
+#define SINC_POLY_DELTA_SHARE 0.25
+#define SINC_POLY_MAX_PHASES 1024
+
+typedef struct rarch_sinc_resampler rarch_sinc_resampler_t;
+
+/* Computes output frames for the current input position until
+ * time runs past the phase range, and returns how many. */
+typedef size_t (*sinc_kernel_t)(rarch_sinc_resampler_t *resamp,
+      float *out_buffer, uint32_t ratio);
+
+/* A phase table and how to index it. time counts in units of
+ * 1 / phases of an input frame. */
+struct sinc_bank
+{
+   float *phase_table;
+   uint32_t phases;
+   unsigned subphase_bits;
+   uint32_t subphase_mask;
+   float subphase_mod;
+   bool coeff_lerp;
+   sinc_kernel_t kernel;
+};
 
-typedef struct rarch_sinc_resampler
+struct rarch_sinc_resampler
 {
+   /* The bank in use, copied in flat for the kernels. */
    float *phase_table;
+   uint32_t phases;
+   unsigned subphase_bits;
+   uint32_t subphase_mask;
+   float subphase_mod;
+   bool coeff_lerp;
+   sinc_kernel_t kernel;
+
    float *buffer_l;
    float *buffer_r;
 
@@ -113,11 +155,21 @@ typedef struct rarch_sinc_resampler
    unsigned ptr;
    uint32_t time;
 
+   /* general takes any ratio, interpolating between phases.
+    * poly only does poly_phases / poly_step, with no
+    * interpolation, and has no phase table if none was found. */
+   struct sinc_bank general;
+   struct sinc_bank poly;
+   double poly_ratio;
+   double poly_tolerance;
+   uint32_t poly_step;
+   bool use_poly;
+
    /* A buffer for phase_table, buffer_l and buffer_r 
     * are created in a single calloc().
     * Ensure that we get as good cache locality as we can hope for. */
    float *main_buffer;
-} rarch_sinc_resampler_t;
+};
 
 static inline double sinc(double val)
 {
@@ -126,12 +178,6 @@ static inline double sinc(double val)
    return sin(val) / val;
 }
 
-#if defined(SINC_WINDOW_LANCZOS)
-static inline double window_function(double idx)
-{
-   return sinc(M_PI * idx);
-}
-#elif defined(SINC_WINDOW_KAISER)
 /* Modified Bessel function of first order.
  * Check Wiki for mathematical definition ... */
 static inline double besseli0(double x)
@@ -160,19 +206,21 @@ static inline double besseli0(double x)
    return sum;
 }
 
-static inline double window_function(double idx)
+static inline double window_function(const struct sinc_quality *quality,
+      double idx)
 {
-   return besseli0(SINC_WINDOW_KAISER_BETA * sqrt(1 - idx * idx));
+   if (quality->window == SINC_WINDOW_LANCZOS)
+      return sinc(M_PI * idx);
+   return besseli0(quality->kaiser_beta * sqrt(1 - idx * idx));
 }
-#else
-#error "No SINC window function defined."
-#endif
 
-static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
-      float *phase_table, int phases, int taps, bool calculate_delta)
+static void init_sinc_table(const struct sinc_quality *quality,
+      double cutoff, float *phase_table, int phases, int taps,
+      bool calculate_delta)
 {
    int i, j, p;
-   double window_mod = window_function(0.0); /* Need to normalize w(0) to 1.0. */
+   /* Need to normalize w(0) to 1.0. */
+   double window_mod = window_function(quality, 0.0);
    int stride = calculate_delta ? 2 : 1;
    double sidelobes = taps / 2.0;
 
@@ -188,7 +236,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          sinc_phase = sidelobes * window_phase;
 
          val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(quality, window_phase) / window_mod;
          phase_table[i * stride * taps + j] = val;
       }
    }
@@ -217,7 +265,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          sinc_phase = sidelobes * window_phase;
 
          val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(quality, window_phase) / window_mod;
          delta = (val - phase_table[phase * stride * taps + j]);
          phase_table[(phase * stride + 1) * taps + j] = delta;
       }
@@ -248,7 +296,40 @@ static void aligned_free__(void *ptr)
    free(p[-1]);
 }
 
-#if !(defined(__AVX__) && ENABLE_AVX) && !defined(__SSE__)
+/* Coefficients for the phase that time points at. With lerp on,
+ * each row is followed by the deltas to the next phase. */
+static inline const float *sinc_phase_row(
+      const rarch_sinc_resampler_t *resamp, uint32_t time)
+{
+   unsigned phase = time >> resamp->subphase_bits;
+   return resamp->phase_table +
+      phase * resamp->taps * (resamp->coeff_lerp ? 2 : 1);
+}
+
+static inline float sinc_subphase(const rarch_sinc_resampler_t *resamp,
+      uint32_t time)
+{
+   return (float)(time & resamp->subphase_mask) * resamp->subphase_mod;
+}
+
+/* Turns a single-frame kernel into a sinc_kernel_t. The frame
+ * function is inlined, so there is one indirect call per input
+ * frame rather than one per output frame. */
+#define SINC_KERNEL(name, frame_func) \
+static size_t name(rarch_sinc_resampler_t *resamp, \
+      float *out_buffer, uint32_t ratio) \
+{ \
+   size_t frames = 0; \
+   while (resamp->time < resamp->phases) \
+   { \
+      frame_func(resamp, out_buffer); \
+      out_buffer += 2; \
+      frames++; \
+      resamp->time += ratio; \
+   } \
+   return frames; \
+}
+
 static inline void process_sinc_C(rarch_sinc_resampler_t *resamp,
       float *out_buffer)
 {
@@ -259,119 +340,78 @@ static inline void process_sinc_C(rarch_sinc_resampler_t *resamp,
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps  = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   float delta = (float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   const float *phase_table = sinc_phase_row(resamp, resamp->time);
 
-   for (i = 0; i < taps; i++)
+   if (resamp->coeff_lerp)
    {
-#if SINC_COEFF_LERP
-      float sinc_val = phase_table[i] + delta_table[i] * delta;
-#else
-      float sinc_val = phase_table[i];
-#endif
-      sum_l         += buffer_l[i] * sinc_val;
-      sum_r         += buffer_r[i] * sinc_val;
+      const float *delta_table = phase_table + taps;
+      float delta = sinc_subphase(resamp, resamp->time);
+
+      for (i = 0; i < taps; i++)
+      {
+         float sinc_val = phase_table[i] + delta_table[i] * delta;
+         sum_l         += buffer_l[i] * sinc_val;
+         sum_r         += buffer_r[i] * sinc_val;
+      }
+   }
+   else
+   {
+      for (i = 0; i < taps; i++)
+      {
+         sum_l         += buffer_l[i] * phase_table[i];
+         sum_r         += buffer_r[i] * phase_table[i];
+      }
    }
 
    out_buffer[0] = sum_l;
    out_buffer[1] = sum_r;
 }
-#endif
 
-#if defined(__AVX__) && ENABLE_AVX
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
-{
-   unsigned i;
-   __m256 sum_l = _mm256_setzero_ps();
-   __m256 sum_r = _mm256_setzero_ps();
+SINC_KERNEL(process_sinc_C_frames, process_sinc_C)
 
-   const float *buffer_l = resamp->buffer_l + resamp->ptr;
-   const float *buffer_r = resamp->buffer_r + resamp->ptr;
-
-   unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m256 delta = _mm256_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
-
-   for (i = 0; i < taps; i += 8)
-   {
-      __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
-      __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
-
-#if SINC_COEFF_LERP
-      __m256 deltas = _mm256_load_ps(delta_table + i);
-      __m256 sinc = _mm256_add_ps(_mm256_load_ps(phase_table + i),
-            _mm256_mul_ps(deltas, delta));
-#else
-      __m256 sinc = _mm256_load_ps(phase_table + i);
-#endif
-      sum_l       = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
-      sum_r       = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
-   }
-
-   /* hadd on AVX is weird, and acts on low-lanes 
-    * and high-lanes separately. */
-   __m256 res_l = _mm256_hadd_ps(sum_l, sum_l);
-   __m256 res_r = _mm256_hadd_ps(sum_r, sum_r);
-   res_l = _mm256_hadd_ps(res_l, res_l);
-   res_r = _mm256_hadd_ps(res_r, res_r);
-   res_l = _mm256_add_ps(_mm256_permute2f128_ps(res_l, res_l, 1), res_l);
-   res_r = _mm256_add_ps(_mm256_permute2f128_ps(res_r, res_r, 1), res_r);
-
-   /* This is optimized to mov %xmmN, [mem].
-    * There doesn't seem to be any _mm256_store_ss intrinsic. */
-   _mm_store_ss(out_buffer + 0, _mm256_extractf128_ps(res_l, 0));
-   _mm_store_ss(out_buffer + 1, _mm256_extractf128_ps(res_r, 0));
-}
-#elif defined(__SSE__)
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+#if defined(__SSE__)
+static inline void process_sinc_sse(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
 {
    unsigned i;
    __m128 sum_l = _mm_setzero_ps();
    __m128 sum_r = _mm_setzero_ps();
+   __m128 sum;
 
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m128 delta = _mm_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   const float *phase_table = sinc_phase_row(resamp, resamp->time);
 
-   for (i = 0; i < taps; i += 4)
+   if (resamp->coeff_lerp)
    {
-      __m128 buf_l = _mm_loadu_ps(buffer_l + i);
-      __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+      const float *delta_table = phase_table + taps;
+      __m128 delta = _mm_set1_ps(sinc_subphase(resamp, resamp->time));
 
-#if SINC_COEFF_LERP
-      __m128 deltas = _mm_load_ps(delta_table + i);
-      __m128 _sinc = _mm_add_ps(_mm_load_ps(phase_table + i),
-            _mm_mul_ps(deltas, delta));
-#else
-      __m128 _sinc = _mm_load_ps(phase_table + i);
-#endif
-      sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
-      sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      for (i = 0; i < taps; i += 4)
+      {
+         __m128 buf_l = _mm_loadu_ps(buffer_l + i);
+         __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+
+         __m128 deltas = _mm_load_ps(delta_table + i);
+         __m128 _sinc = _mm_add_ps(_mm_load_ps(phase_table + i),
+               _mm_mul_ps(deltas, delta));
+         sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
+         sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      }
+   }
+   else
+   {
+      for (i = 0; i < taps; i += 4)
+      {
+         __m128 buf_l = _mm_loadu_ps(buffer_l + i);
+         __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+
+         __m128 _sinc = _mm_load_ps(phase_table + i);
+         sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
+         sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      }
    }
 
    /* Them annoying shuffles.
@@ -379,7 +419,7 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
     * sum_r = { r3, r2, r1, r0 }
     */
 
-   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+   sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
             _MM_SHUFFLE(1, 0, 1, 0)),
          _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
 
@@ -399,52 +439,197 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    /* movehl { X, R, X, L } == { X, R, X, R } */
    _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
 }
-#elif defined(__ARM_NEON__)
 
-#if SINC_COEFF_LERP
-#error "NEON asm does not support SINC lerp."
+SINC_KERNEL(process_sinc_sse_frames, process_sinc_sse)
 #endif
 
-/* Need to make this function pointer as Android doesn't 
- * have built-in targets for NEON and plain ARMv7a.
- */
-static void (*process_sinc_func)(rarch_sinc_resampler_t *resamp,
-      float *out_buffer);
+#ifdef SINC_HAVE_AVX2
+/* Coefficients for one output at the given time, lerped if needed. */
+static inline SINC_AVX2_TARGET __m256 sinc_coeffs_avx2(
+      const float *phase_table, unsigned taps, bool lerp,
+      __m256 delta, unsigned i)
+{
+   if (lerp)
+      return _mm256_fmadd_ps(_mm256_load_ps(phase_table + taps + i),
+            delta, _mm256_load_ps(phase_table + i));
+   return _mm256_load_ps(phase_table + i);
+}
+
+static inline SINC_AVX2_TARGET void process_sinc_avx2(
+      rarch_sinc_resampler_t *resamp, float *out_buffer, bool lerp)
+{
+   unsigned i;
+   __m256 sum;
+   unsigned taps         = resamp->taps;
+   const float *buffer_l = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r = resamp->buffer_r + resamp->ptr;
+   const float *phase    = sinc_phase_row(resamp, resamp->time);
+   __m256 delta          = _mm256_set1_ps(sinc_subphase(resamp, resamp->time));
+   __m256 sum_l          = _mm256_setzero_ps();
+   __m256 sum_r          = _mm256_setzero_ps();
+
+   for (i = 0; i < taps; i += 8)
+   {
+      __m256 sinc = sinc_coeffs_avx2(phase, taps, lerp, delta, i);
+      sum_l       = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i), sinc, sum_l);
+      sum_r       = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i), sinc, sum_r);
+   }
+
+   /* { l, r, l, r | l', r', l', r' } */
+   sum = _mm256_hadd_ps(sum_l, sum_r);
+   sum = _mm256_hadd_ps(sum, sum);
+   _mm_storel_pi((__m64*)out_buffer, _mm_add_ps(_mm256_castps256_ps128(sum),
+            _mm256_extractf128_ps(sum, 1)));
+}
+
+/* Two output frames per pass over the taps. Both use the same
+ * input window, so the history is loaded once for the pair, and
+ * the four sums fold into one register already in { L0, R0, L1,
+ * R1 } order. */
+static inline SINC_AVX2_TARGET void process_sinc_avx2_pair(
+      rarch_sinc_resampler_t *resamp, float *out_buffer,
+      uint32_t ratio, bool lerp)
+{
+   unsigned i;
+   __m256 sum;
+   unsigned taps         = resamp->taps;
+   uint32_t time1        = resamp->time + ratio;
+   const float *buffer_l = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r = resamp->buffer_r + resamp->ptr;
+   const float *phase0   = sinc_phase_row(resamp, resamp->time);
+   const float *phase1   = sinc_phase_row(resamp, time1);
+   __m256 delta0         = _mm256_set1_ps(sinc_subphase(resamp, resamp->time));
+   __m256 delta1         = _mm256_set1_ps(sinc_subphase(resamp, time1));
+   __m256 sum_l0         = _mm256_setzero_ps();
+   __m256 sum_r0         = _mm256_setzero_ps();
+   __m256 sum_l1         = _mm256_setzero_ps();
+   __m256 sum_r1         = _mm256_setzero_ps();
 
+   for (i = 0; i < taps; i += 8)
+   {
+      __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
+      __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
+      __m256 sinc0 = sinc_coeffs_avx2(phase0, taps, lerp, delta0, i);
+      __m256 sinc1 = sinc_coeffs_avx2(phase1, taps, lerp, delta1, i);
+
+      sum_l0       = _mm256_fmadd_ps(buf_l, sinc0, sum_l0);
+      sum_r0       = _mm256_fmadd_ps(buf_r, sinc0, sum_r0);
+      sum_l1       = _mm256_fmadd_ps(buf_l, sinc1, sum_l1);
+      sum_r1       = _mm256_fmadd_ps(buf_r, sinc1, sum_r1);
+   }
+
+   /* hadd works on each 128-bit half separately:
+    * { l0, r0, l1, r1 | l0', r0', l1', r1' } */
+   sum = _mm256_hadd_ps(_mm256_hadd_ps(sum_l0, sum_r0),
+         _mm256_hadd_ps(sum_l1, sum_r1));
+   _mm_storeu_ps(out_buffer, _mm_add_ps(_mm256_castps256_ps128(sum),
+            _mm256_extractf128_ps(sum, 1)));
+}
+
+static inline SINC_AVX2_TARGET size_t process_sinc_avx2_batch(
+      rarch_sinc_resampler_t *resamp, float *out_buffer,
+      uint32_t ratio, bool lerp)
+{
+   size_t frames = 0;
+
+   while (resamp->time < resamp->phases)
+   {
+      if (resamp->time + ratio < resamp->phases)
+      {
+         process_sinc_avx2_pair(resamp, out_buffer + 2 * frames, ratio, lerp);
+         frames       += 2;
+         resamp->time += 2 * ratio;
+      }
+      else
+      {
+         process_sinc_avx2(resamp, out_buffer + 2 * frames, lerp);
+         frames++;
+         resamp->time += ratio;
+      }
+   }
+
+   return frames;
+}
+
+/* Separate entry points so lerp is a constant in the loops. */
+static SINC_AVX2_TARGET size_t process_sinc_avx2_frames(
+      rarch_sinc_resampler_t *resamp, float *out_buffer, uint32_t ratio)
+{
+   return process_sinc_avx2_batch(resamp, out_buffer, ratio, false);
+}
+
+static SINC_AVX2_TARGET size_t process_sinc_avx2_lerp_frames(
+      rarch_sinc_resampler_t *resamp, float *out_buffer, uint32_t ratio)
+{
+   return process_sinc_avx2_batch(resamp, out_buffer, ratio, true);
+}
+#endif
+
+#if defined(__ARM_NEON__)
 /* Assumes that taps >= 8, and that taps is a multiple of 8. */
 void process_sinc_neon_asm(float *out, const float *left, 
       const float *right, const float *coeff, unsigned taps);
 
-static void process_sinc_neon(rarch_sinc_resampler_t *resamp,
+static inline void process_sinc_neon(rarch_sinc_resampler_t *resamp,
       float *out_buffer)
 {
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
    unsigned taps = resamp->taps;
-   const float *phase_table = resamp->phase_table + phase * taps;
+   const float *phase_table = sinc_phase_row(resamp, resamp->time);
 
    process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, taps);
 }
-#else /* Plain ol' C99 */
-#define process_sinc_func process_sinc_C
+
+SINC_KERNEL(process_sinc_neon_frames, process_sinc_neon)
 #endif
 
+/* Switches banks, keeping the position between input frames.
+ * The history is shared, so this is seamless bar rounding. */
+static void sinc_use_bank(rarch_sinc_resampler_t *re,
+      const struct sinc_bank *bank)
+{
+   re->time = (uint32_t)(((uint64_t)re->time * bank->phases +
+            re->phases / 2) / re->phases);
+
+   re->phase_table   = bank->phase_table;
+   re->phases        = bank->phases;
+   re->subphase_bits = bank->subphase_bits;
+   re->subphase_mask = bank->subphase_mask;
+   re->subphase_mod  = bank->subphase_mod;
+   re->coeff_lerp    = bank->coeff_lerp;
+   re->kernel        = bank->kernel;
+}
+
 static void resampler_sinc_process(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
 
-   uint32_t ratio = PHASES / data->ratio;
-
+   uint32_t phases, ratio;
    const float *input = data->data_in;
    float *output      = data->data_out;
-   size_t frames         = data->input_frames;
-   size_t out_frames     = 0;
+   size_t frames      = data->input_frames;
+   size_t out_frames  = 0;
+   double poly_band = re->poly_ratio * re->poly_tolerance;
+   bool use_poly = re->poly.phase_table &&
+      fabs(data->ratio - re->poly_ratio) <=
+      (re->use_poly ? poly_band : poly_band * 0.5);
+
+   if (use_poly != re->use_poly)
+   {
+      sinc_use_bank(re, use_poly ? &re->poly : &re->general);
+      re->use_poly = use_poly;
+   }
+
+   phases = re->phases;
+   ratio  = use_poly ? re->poly_step : phases / data->ratio;
 
    while (frames)
    {
-      while (frames && re->time >= PHASES)
+      size_t written;
+
+      while (frames && re->time >= phases)
       {
          /* Push in reverse to make filter more obvious. */
          if (!re->ptr)
@@ -454,17 +639,13 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
          re->buffer_l[re->ptr + re->taps] = re->buffer_l[re->ptr] = *input++;
          re->buffer_r[re->ptr + re->taps] = re->buffer_r[re->ptr] = *input++;
 
-         re->time -= PHASES;
+         re->time -= phases;
          frames--;
       }
 
-      while (re->time < PHASES)
-      {
-         process_sinc_func(re, output);
-         output += 2;
-         out_frames++;
-         re->time += ratio;
-      }
+      written     = re->kernel(re, output, ratio);
+      output     += 2 * written;
+      out_frames += written;
    }
 
    data->output_frames = out_frames;
@@ -473,16 +654,117 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
 static void resampler_sinc_free(void *re)
 {
    rarch_sinc_resampler_t *resampler = (rarch_sinc_resampler_t*)re;
-   if (resampler)
+   if (resampler && resampler->main_buffer)
       aligned_free__(resampler->main_buffer);
    free(resampler);
 }
 
+/* Below this, the per-frame reductions cost more
+ * than the wider loads save. */
+#define SINC_AVX2_MIN_TAPS 32
+
+static const char *resampler_sinc_select_kernel(struct sinc_bank *bank,
+      unsigned taps, resampler_simd_mask_t mask)
+{
+   (void)mask;
+
+#ifdef SINC_HAVE_AVX2
+   /* The AVX bit is only set once XGETBV says the OS saves the YMM
+    * registers, and the AVX2 bit doesn't cover it. There is no FMA
+    * bit in the mask, so ask the CPU directly. */
+   if ((mask & RESAMPLER_SIMD_AVX) && (mask & RESAMPLER_SIMD_AVX2) &&
+         __builtin_cpu_supports("fma") && taps >= SINC_AVX2_MIN_TAPS)
+   {
+      bank->kernel = bank->coeff_lerp ?
+         process_sinc_avx2_lerp_frames : process_sinc_avx2_frames;
+      return "AVX2/FMA";
+   }
+#endif
+#if defined(__SSE__)
+   bank->kernel = process_sinc_sse_frames;
+   return "SSE";
+#else
+#if defined(__ARM_NEON__)
+   /* The NEON asm has no lerp. */
+   if ((mask & RESAMPLER_SIMD_NEON) && !bank->coeff_lerp)
+   {
+      bank->kernel = process_sinc_neon_frames;
+      return "NEON";
+   }
+#endif
+   bank->kernel = process_sinc_C_frames;
+   return "C";
+#endif
+}
+
+static bool sinc_kernel_needs_8(sinc_kernel_t kernel)
+{
+   return kernel != process_sinc_C_frames
+#if defined(__SSE__)
+      && kernel != process_sinc_sse_frames
+#endif
+      ;
+}
+
+/* How far rate control may move the ratio, 0 if it is off. */
+static double sinc_rate_control_delta(void)
+{
+#if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
+   if (g_settings.audio.rate_control)
+      return g_settings.audio.rate_control_delta;
+#endif
+   return 0.0;
+}
+
+/* Finds phases / step within tolerance of ratio, with as few
+ * phases as possible, from the continued fraction of ratio. */
+static bool sinc_find_poly_ratio(double ratio, double tolerance,
+      uint32_t *phases, uint32_t *step)
+{
+   unsigned i;
+   double x      = ratio;
+   uint64_t h[2] = { 0, 1 };
+   uint64_t k[2] = { 1, 0 };
+
+   for (i = 0; i < 32; i++)
+   {
+      double a  = floor(x);
+      uint64_t h_next = (uint64_t)a * h[1] + h[0];
+      uint64_t k_next = (uint64_t)a * k[1] + k[0];
+
+      if (h_next > SINC_POLY_MAX_PHASES)
+         return false;
+
+      if (fabs((double)h_next / k_next - ratio) <= tolerance * ratio)
+      {
+         *phases = (uint32_t)h_next;
+         *step   = (uint32_t)k_next;
+         return true;
+      }
+
+      h[0] = h[1];
+      h[1] = h_next;
+      k[0] = k[1];
+      k[1] = k_next;
+
+      if (x - a < 1e-12)
+         return false;
+      x = 1.0 / (x - a);
+   }
+
+   return false;
+}
+
 static void *resampler_sinc_new(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      double bandwidth_mod, enum resampler_quality quality,
+      resampler_simd_mask_t mask)
 {
-   size_t phase_elems, elems;
-   double cutoff;
+   size_t phase_elems, poly_elems, elems;
+   double cutoff, poly_error;
+   double delta = sinc_rate_control_delta();
+   uint32_t poly_phases = 0;
+   const char *kernel_ident;
+   const struct sinc_quality *params;
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)
       calloc(1, sizeof(*re));
    (void)config;
@@ -490,10 +772,24 @@ static void *resampler_sinc_new(const struct resampler_config *config,
    if (!re)
       return NULL;
 
-   memset(re, 0, sizeof(*re));
+   if (quality == RESAMPLER_QUALITY_DONTCARE)
+      quality = SINC_DEFAULT_QUALITY;
+   if (quality > RESAMPLER_QUALITY_HIGHEST)
+      quality = RESAMPLER_QUALITY_HIGHEST;
+   params = &sinc_qualities[quality - RESAMPLER_QUALITY_LOWEST];
+
+   re->general.phases        = 1 << (params->phase_bits + params->subphase_bits);
+   re->general.subphase_bits = params->subphase_bits;
+   re->general.subphase_mask = (1 << params->subphase_bits) - 1;
+   re->general.subphase_mod  = 1.0f / (1 << params->subphase_bits);
+   re->general.coeff_lerp    = params->coeff_lerp;
 
-   re->taps = g_settings.audio.sinc_taps;
-   cutoff = CUTOFF;
+   re->taps = params->sidelobes * 2;
+#if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
+   if (g_settings.audio.sinc_taps)
+      re->taps = g_settings.audio.sinc_taps;
+#endif
+   cutoff = params->cutoff;
 
    /* Downsampling, must lower cutoff, and extend number of 
     * taps accordingly to keep same stopband attenuation. */
@@ -503,46 +799,75 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
    }
 
-   /* Be SIMD-friendly. */
-#if (defined(__AVX__) && ENABLE_AVX) || defined(__ARM_NEON__)
-   re->taps = (re->taps + 7) & ~7;
-#else
-   re->taps = (re->taps + 3) & ~3;
-#endif
+   if (delta > 0.0)
+   {
+      poly_error         = delta * SINC_POLY_DELTA_SHARE;
+      re->poly_tolerance = 2.0 * poly_error;
+   }
+   else
+   {
+      poly_error         = SINC_POLY_MAX_ERROR;
+      re->poly_tolerance = SINC_POLY_TOLERANCE;
+   }
 
-   phase_elems = (1 << PHASE_BITS) * re->taps;
-#if SINC_COEFF_LERP
-   phase_elems *= 2;
-#endif
-   elems = phase_elems + 4 * re->taps;
+   if (sinc_find_poly_ratio(bandwidth_mod, poly_error,
+            &poly_phases, &re->poly_step))
+   {
+      re->poly_ratio         = (double)poly_phases / re->poly_step;
+      re->poly.phases        = poly_phases;
+      re->poly.subphase_mask = 0;
+      re->poly.subphase_mod  = 0.0f;
+      re->poly.coeff_lerp    = false;
+      resampler_sinc_select_kernel(&re->poly, re->taps, mask);
+   }
+
+   kernel_ident = resampler_sinc_select_kernel(&re->general, re->taps, mask);
+
+   /* Be SIMD-friendly. */
+   if (sinc_kernel_needs_8(re->general.kernel) ||
+         (poly_phases && sinc_kernel_needs_8(re->poly.kernel)))
+      re->taps = (re->taps + 7) & ~7;
+   else
+      re->taps = (re->taps + 3) & ~3;
+
+   phase_elems = (1 << params->phase_bits) * re->taps;
+   if (re->general.coeff_lerp)
+      phase_elems *= 2;
+   poly_elems = poly_phases * re->taps;
+   elems = phase_elems + poly_elems + 4 * re->taps;
 
    re->main_buffer = (float*)
       aligned_alloc__(128, sizeof(float) * elems);
    if (!re->main_buffer)
       goto error;
+   memset(re->main_buffer, 0, sizeof(float) * elems);
 
-   re->phase_table = re->main_buffer;
-   re->buffer_l = re->main_buffer + phase_elems;
+   re->general.phase_table = re->main_buffer;
+   re->buffer_l = re->main_buffer + phase_elems + poly_elems;
    re->buffer_r = re->buffer_l + 2 * re->taps;
 
-   init_sinc_table(re, cutoff, re->phase_table,
-         1 << PHASE_BITS, re->taps, SINC_COEFF_LERP);
-
-#if defined(__AVX__) && ENABLE_AVX
-   RARCH_LOG("Sinc resampler [AVX]\n");
-#elif defined(__SSE__)
-   RARCH_LOG("Sinc resampler [SSE]\n");
-#elif defined(__ARM_NEON__)
-   process_sinc_func = mask & RESAMPLER_SIMD_NEON 
-      ? process_sinc_neon : process_sinc_C;
-   RARCH_LOG("Sinc resampler [%s]\n",
-         mask & RESAMPLER_SIMD_NEON ? "NEON" : "C");
-#else
-   RARCH_LOG("Sinc resampler [C]\n");
-#endif
+   init_sinc_table(params, cutoff, re->general.phase_table,
+         1 << params->phase_bits, re->taps, re->general.coeff_lerp);
+
+   if (poly_phases)
+   {
+      /* The same filter, sampled at exactly the phases the
+       * fixed ratio lands on. */
+      re->poly.phase_table = re->main_buffer + phase_elems;
+      init_sinc_table(params, cutoff, re->poly.phase_table,
+            poly_phases, re->taps, false);
+   }
+
+   /* Start on the general bank, with its time scale. */
+   re->phases = re->general.phases;
+   sinc_use_bank(re, &re->general);
 
-   RARCH_LOG("SINC params (%u phase bits, %u taps).\n",
-         PHASE_BITS, re->taps);
+   RARCH_LOG("Sinc resampler [%s]\n", kernel_ident);
+   RARCH_LOG("SINC params (%s quality, %u phase bits, %u taps).\n",
+         params->ident, params->phase_bits, re->taps);
+   if (poly_phases)
+      RARCH_LOG("SINC polyphase bank for %u:%u.\n",
+            (unsigned)re->poly_step, (unsigned)poly_phases);
    return re;
 
 error:
@@ -558,4 +883,3 @@ rarch_resampler_t sinc_resampler = {
    "SINC",
    "sinc"
 };
-
@@ -26,26 +26,21 @@
 #include <rthreads/rthreads.h>
 
 #include "../general.h"
-#include "../fifo_buffer.h"
+#include "../spsc_fifo.h"
 
 typedef struct sdl_audio
 {
    bool nonblock;
    bool is_paused;
 
-   slock_t *lock;
-   scond_t *cond;
-   fifo_buffer_t *buffer;
+   spsc_fifo_t *buffer;
 } sdl_audio_t;
 
 static void sdl_audio_cb(void *data, Uint8 *stream, int len)
 {
    sdl_audio_t *sdl = (sdl_audio_t*)data;
 
-   size_t avail = fifo_read_avail(sdl->buffer);
-   size_t write_size = len > (int)avail ? avail : len;
-   fifo_read(sdl->buffer, stream, write_size);
-   scond_signal(sdl->cond);
+   size_t write_size = spsc_fifo_read(sdl->buffer, stream, len);
 
    // If underrun, fill rest with silence.
    memset(stream + write_size, 0, len - write_size);
@@ -94,20 +89,15 @@ static void *sdl_audio_init(const char *device, unsigned rate, unsigned latency)
    }
    g_settings.audio.out_rate = out.freq;
 
-   sdl->lock = slock_new();
-   sdl->cond = scond_new();
-
    RARCH_LOG("SDL audio: Requested %u ms latency, got %d ms\n", latency, (int)(out.samples * 4 * 1000 / g_settings.audio.out_rate));
 
    // Create a buffer twice as big as needed and prefill the buffer.
    size_t bufsize = out.samples * 4 * sizeof(int16_t);
    void *tmp = calloc(1, bufsize);
-   sdl->buffer = fifo_new(bufsize);
-   if (tmp)
-   {
-      fifo_write(sdl->buffer, tmp, bufsize);
-      free(tmp);
-   }
+   sdl->buffer = spsc_fifo_new(bufsize, 0);
+   if (tmp && sdl->buffer)
+      spsc_fifo_write(sdl->buffer, tmp, bufsize);
+   free(tmp);
 
    SDL_PauseAudio(0);
    return sdl;
@@ -118,37 +108,21 @@ static ssize_t sdl_audio_write(void *data, const void *buf, size_t size)
    sdl_audio_t *sdl = (sdl_audio_t*)data;
 
    ssize_t ret = 0;
+   /* No SDL_LockAudio() needed, the callback
+    * only ever touches the consumer side. */
    if (sdl->nonblock)
-   {
-      SDL_LockAudio();
-      size_t avail = fifo_write_avail(sdl->buffer);
-      size_t write_amt = avail > size ? size : avail;
-      fifo_write(sdl->buffer, buf, write_amt);
-      SDL_UnlockAudio();
-      ret = write_amt;
-   }
+      ret = spsc_fifo_write(sdl->buffer, buf, size);
    else
    {
       size_t written = 0;
       while (written < size)
       {
-         SDL_LockAudio();
-         size_t avail = fifo_write_avail(sdl->buffer);
-
-         if (avail == 0)
-         {
-            SDL_UnlockAudio();
-            slock_lock(sdl->lock);
-            scond_wait(sdl->cond, sdl->lock);
-            slock_unlock(sdl->lock);
-         }
-         else
-         {
-            size_t write_amt = size - written > avail ? avail : size - written;
-            fifo_write(sdl->buffer, (const char*)buf + written, write_amt);
-            SDL_UnlockAudio();
-            written += write_amt;
-         }
+         size_t write_amt = spsc_fifo_write(sdl->buffer,
+               (const char*)buf + written, size - written);
+
+         if (write_amt == 0)
+            spsc_fifo_wait_write(sdl->buffer, 1);
+         written += write_amt;
       }
       ret = written;
    }
@@ -195,9 +169,7 @@ static void sdl_audio_free(void *data)
    sdl_audio_t *sdl = (sdl_audio_t*)data;
    if (sdl)
    {
-      fifo_free(sdl->buffer);
-      slock_free(sdl->lock);
-      scond_free(sdl->cond);
+      spsc_fifo_free(sdl->buffer);
    }
    free(sdl);
 }
@@ -0,0 +1,209 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Sinc resampler throughput for every quality tier, with the
+// baseline kernel and with AVX2/FMA where the CPU has it.
+// The AVX2 output is checked against the baseline as it goes.
+//
+// Each is run twice: at the nominal ratio, which takes the fixed
+// ratio polyphase bank, and nudged the way rate control would,
+// far enough to force the general interpolating bank.
+//
+// Usage: bench [seconds of audio per run]
+
+#include "../resamplers/resampler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static const char *quality_names[] = {
+   "dontcare", "lowest", "lower", "normal", "higher", "highest",
+};
+
+struct rate
+{
+   unsigned in_rate;
+   unsigned out_rate;
+};
+
+static const struct rate rates[] = {
+   { 32040, 48000 },
+   { 44100, 48000 },
+   { 48000, 32000 },
+};
+
+#define CHUNK_FRAMES 512
+
+// Just outside the resampler's fixed ratio band.
+#define GENERAL_NUDGE 1.0002
+
+// Resamples in audio-driver sized chunks. Returns output frames/s
+// and leaves the output in out for comparing.
+static double run_once(enum resampler_quality quality, resampler_simd_mask_t mask,
+      const struct rate *rate, double nudge, const float *in, size_t in_frames,
+      float *out, size_t *out_frames)
+{
+   size_t i;
+   double start, elapsed;
+   double nominal = (double)rate->out_rate / rate->in_rate;
+   double ratio   = nominal * nudge;
+   void *re       = sinc_resampler.init(NULL, nominal, quality, mask);
+
+   if (!re)
+      return 0.0;
+
+   *out_frames = 0;
+   start = get_time();
+   for (i = 0; i + CHUNK_FRAMES <= in_frames; i += CHUNK_FRAMES)
+   {
+      struct resampler_data data = {
+         .data_in      = in + 2 * i,
+         .data_out     = out + 2 * *out_frames,
+         .input_frames = CHUNK_FRAMES,
+         .ratio        = ratio,
+      };
+
+      sinc_resampler.process(re, &data);
+      *out_frames += data.output_frames;
+   }
+   elapsed = get_time() - start;
+
+   sinc_resampler.free(re);
+   return *out_frames / elapsed;
+}
+
+// Best of a few, a run is short enough to catch a context switch.
+static double run(enum resampler_quality quality, resampler_simd_mask_t mask,
+      const struct rate *rate, double nudge, const float *in, size_t in_frames,
+      float *out, size_t *out_frames)
+{
+   unsigned i;
+   double best = 0.0;
+
+   for (i = 0; i < 5; i++)
+      best = fmax(best, run_once(quality, mask, rate, nudge,
+               in, in_frames, out, out_frames));
+   return best;
+}
+
+/* What the sinc resampler wants to see before it picks AVX2/FMA. */
+#define AVX2_MASK (RESAMPLER_SIMD_AVX | RESAMPLER_SIMD_AVX2)
+
+static bool cpu_has_avx2(void)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   return __builtin_cpu_supports("avx") &&
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+   return false;
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned r, q;
+   bool failed    = false;
+   double seconds = argc > 1 ? strtod(argv[1], NULL) : 4.0;
+   bool avx2      = cpu_has_avx2();
+   size_t max_in  = (size_t)(48000 * seconds);
+   float *in      = calloc(2 * max_in, sizeof(float));
+   float *out     = calloc(2 * 2 * max_in + 64, sizeof(float));
+   float *ref     = calloc(2 * 2 * max_in + 64, sizeof(float));
+
+   if (!in || !out || !ref || seconds <= 0.0)
+   {
+      fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   // Two tones and a little noise, so nothing cancels out.
+   for (size_t i = 0; i < max_in; i++)
+   {
+      float noise    = (float)rand() / RAND_MAX - 0.5f;
+      in[2 * i + 0]  = 0.5f * sinf(i * 0.031f) + 0.05f * noise;
+      in[2 * i + 1]  = 0.5f * sinf(i * 0.173f) - 0.05f * noise;
+   }
+
+   printf("Output frames/s\n");
+   printf("%-13s %-8s %12s %12s %12s %12s %8s %10s\n", "rate", "quality",
+         "general", "general avx2", "poly", "poly avx2", "best", "max diff");
+
+   for (r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+   {
+      size_t in_frames = (size_t)(rates[r].in_rate * seconds);
+
+      for (q = RESAMPLER_QUALITY_LOWEST; q <= RESAMPLER_QUALITY_HIGHEST; q++)
+      {
+         char rate_str[32];
+         size_t ref_frames = 0, out_frames = 0;
+         double general, poly, best;
+         double general_avx2 = 0.0, poly_avx2 = 0.0;
+         float diff          = 0.0f;
+
+         poly    = run(q, 0, &rates[r], 1.0, in, in_frames, out, &out_frames);
+         general = run(q, 0, &rates[r], GENERAL_NUDGE,
+               in, in_frames, ref, &ref_frames);
+
+         if (avx2)
+         {
+            poly_avx2    = run(q, AVX2_MASK, &rates[r], 1.0,
+                  in, in_frames, out, &out_frames);
+            general_avx2 = run(q, AVX2_MASK, &rates[r], GENERAL_NUDGE,
+                  in, in_frames, out, &out_frames);
+
+            if (out_frames != ref_frames)
+               failed = true;
+            for (size_t i = 0; i < 2 * ref_frames && i < 2 * out_frames; i++)
+               diff = fmaxf(diff, fabsf(out[i] - ref[i]));
+            // FMA rounds differently; anything audible is a bug.
+            if (diff > 1e-4f)
+               failed = true;
+         }
+
+         best = fmax(poly, poly_avx2) / fmax(general, general_avx2);
+
+         snprintf(rate_str, sizeof(rate_str), "%u->%u",
+               rates[r].in_rate, rates[r].out_rate);
+         if (avx2)
+            printf("%-13s %-8s %12.0f %12.0f %12.0f %12.0f %7.2fx %10.2g\n",
+                  rate_str, quality_names[q], general, general_avx2,
+                  poly, poly_avx2, best, diff);
+         else
+            printf("%-13s %-8s %12.0f %12s %12.0f %12s %7.2fx %10s\n",
+                  rate_str, quality_names[q], general, "-",
+                  poly, "-", best, "-");
+      }
+   }
+
+   if (!avx2)
+      fprintf(stderr, "No AVX2/FMA on this CPU, only the baseline kernel was run.\n");
+   if (failed)
+      fprintf(stderr, "AVX2 output does not match the baseline kernel.\n");
+
+   free(in);
+   free(out);
+   free(ref);
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,308 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs every .dsp preset over synthetic audio and reports ns/frame,
+// once with the plain C paths (SIMD mask of 0) and once with what
+// this CPU supports. The two outputs are compared as they go.
+//
+// The plugins are linked in the way HAVE_FILTERS_BUILTIN does it,
+// and the graph is built the same way audio/dsp_filter.c builds it.
+//
+// Usage: dsp-bench [preset dir] [seconds of audio per run]
+
+#include "../filters/dspfilter.h"
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define SAMPLE_RATE 48000.0f
+
+// What audio_flush() hands the DSP at a time.
+#define CHUNK_FRAMES 256
+
+extern const struct dspfilter_implementation *panning_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *iir_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *echo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *phaser_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+
+static const dspfilter_get_implementation_t plugs[] = {
+   panning_dspfilter_get_implementation,
+   iir_dspfilter_get_implementation,
+   echo_dspfilter_get_implementation,
+   phaser_dspfilter_get_implementation,
+   wahwah_dspfilter_get_implementation,
+   eq_dspfilter_get_implementation,
+   chorus_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
+};
+
+static const struct dspfilter_config dspfilter_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+#define MAX_INSTANCES 8
+
+struct graph
+{
+   config_file_t *conf;
+   const struct dspfilter_implementation *impl[MAX_INSTANCES];
+   void *data[MAX_INSTANCES];
+   unsigned num;
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static dspfilter_simd_mask_t host_mask(void)
+{
+   dspfilter_simd_mask_t mask = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("sse"))
+      mask |= DSPFILTER_SIMD_SSE;
+   if (__builtin_cpu_supports("sse2"))
+      mask |= DSPFILTER_SIMD_SSE2;
+   if (__builtin_cpu_supports("avx"))
+      mask |= DSPFILTER_SIMD_AVX;
+   if (__builtin_cpu_supports("avx2"))
+      mask |= DSPFILTER_SIMD_AVX2;
+#endif
+   return mask;
+}
+
+static void graph_free(struct graph *g)
+{
+   unsigned i;
+   for (i = 0; i < g->num; i++)
+      if (g->data[i])
+         g->impl[i]->free(g->data[i]);
+   if (g->conf)
+      config_file_free(g->conf);
+   memset(g, 0, sizeof(*g));
+}
+
+static bool graph_init(struct graph *g, const char *path,
+      dspfilter_simd_mask_t mask)
+{
+   unsigned i, j, filters = 0;
+
+   memset(g, 0, sizeof(*g));
+   g->conf = config_file_new(path);
+   if (!g->conf || !config_get_uint(g->conf, "filters", &filters) ||
+         filters > MAX_INSTANCES)
+      goto error;
+
+   for (i = 0; i < filters; i++)
+   {
+      char key[64], name[64];
+      struct config_file_userdata userdata;
+      struct dspfilter_info info = { SAMPLE_RATE };
+
+      snprintf(key, sizeof(key), "filter%u", i);
+      if (!config_get_array(g->conf, key, name, sizeof(name)))
+         goto error;
+
+      for (j = 0; j < sizeof(plugs) / sizeof(plugs[0]); j++)
+      {
+         const struct dspfilter_implementation *impl = plugs[j](mask);
+         if (!strcmp(impl->short_ident, name))
+            g->impl[i] = impl;
+      }
+      if (!g->impl[i])
+         goto error;
+
+      userdata.conf      = g->conf;
+      userdata.prefix[0] = key;
+      userdata.prefix[1] = g->impl[i]->short_ident;
+
+      g->data[i] = g->impl[i]->init(&info, &dspfilter_config, &userdata);
+      g->num     = i + 1;
+      if (!g->data[i])
+         goto error;
+   }
+
+   return true;
+
+error:
+   graph_free(g);
+   return false;
+}
+
+// Runs the whole input through a fresh graph. Returns ns/frame and
+// leaves the output in out.
+static double run_once(const char *path, dspfilter_simd_mask_t mask,
+      const float *in, size_t frames, float *out, size_t *out_frames)
+{
+   size_t i;
+   struct graph g;
+   double elapsed = 0.0;
+   float work[CHUNK_FRAMES * 2];
+
+   if (!graph_init(&g, path, mask))
+      return 0.0;
+
+   *out_frames = 0;
+   for (i = 0; i + CHUNK_FRAMES <= frames; i += CHUNK_FRAMES)
+   {
+      unsigned j;
+      double start;
+      struct dspfilter_output output = {0};
+      struct dspfilter_input input   = {0};
+
+      memcpy(work, in + 2 * i, sizeof(work));
+      output.samples = work;
+      output.frames  = CHUNK_FRAMES;
+
+      start = get_time();
+      for (j = 0; j < g.num; j++)
+      {
+         input.samples = output.samples;
+         input.frames  = output.frames;
+         g.impl[j]->process(g.data[j], &output, &input);
+      }
+      elapsed += get_time() - start;
+
+      memcpy(out + 2 * *out_frames, output.samples,
+            output.frames * 2 * sizeof(float));
+      *out_frames += output.frames;
+   }
+
+   graph_free(&g);
+   return elapsed * 1000000000.0 / frames;
+}
+
+// Best of a few, a run is short enough to catch a context switch.
+static double run(const char *path, dspfilter_simd_mask_t mask,
+      const float *in, size_t frames, float *out, size_t *out_frames)
+{
+   unsigned i;
+   double best = 0.0;
+
+   for (i = 0; i < 5; i++)
+   {
+      double ns = run_once(path, mask, in, frames, out, out_frames);
+      if (ns <= 0.0)
+         return 0.0;
+      if (best == 0.0 || ns < best)
+         best = ns;
+   }
+   return best;
+}
+
+static int compare_string(const void *a, const void *b)
+{
+   return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, num_presets = 0;
+   char *presets[64];
+   bool failed         = false;
+   const char *dir     = argc > 1 ? argv[1] : "../filters";
+   double seconds      = argc > 2 ? strtod(argv[2], NULL) : 2.0;
+   size_t frames       = (size_t)(SAMPLE_RATE * seconds);
+   dspfilter_simd_mask_t mask = host_mask();
+   float *in           = (float*)calloc(2 * frames, sizeof(float));
+   float *out          = (float*)calloc(2 * frames, sizeof(float));
+   float *ref          = (float*)calloc(2 * frames, sizeof(float));
+   DIR *d              = opendir(dir);
+   struct dirent *entry;
+
+   if (!d || !in || !out || !ref || seconds <= 0.0)
+   {
+      fprintf(stderr, "Usage: %s [preset dir] [seconds]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   while ((entry = readdir(d)) && num_presets < 64)
+   {
+      const char *ext = strrchr(entry->d_name, '.');
+      if (ext && !strcmp(ext, ".dsp"))
+         presets[num_presets++] = strdup(entry->d_name);
+   }
+   closedir(d);
+   qsort(presets, num_presets, sizeof(presets[0]), compare_string);
+
+   // Two tones and a little noise, kept well inside [-1, 1].
+   for (i = 0; i < frames; i++)
+   {
+      float noise   = (float)rand() / RAND_MAX - 0.5f;
+      in[2 * i + 0] = 0.4f * sinf(i * 0.031f) + 0.05f * noise;
+      in[2 * i + 1] = 0.4f * sinf(i * 0.173f) - 0.05f * noise;
+   }
+
+   printf("ns/frame at %.0f Hz, %u frame chunks\n", SAMPLE_RATE, CHUNK_FRAMES);
+   printf("%-20s %10s %10s %8s %10s\n", "preset", "C", "SIMD", "speedup", "max diff");
+
+   for (i = 0; i < num_presets; i++)
+   {
+      char path[1024];
+      size_t j, ref_frames = 0, out_frames = 0;
+      double ns_c, ns_simd;
+      float diff = 0.0f;
+
+      snprintf(path, sizeof(path), "%s/%s", dir, presets[i]);
+
+      ns_c    = run(path, 0, in, frames, ref, &ref_frames);
+      ns_simd = run(path, mask, in, frames, out, &out_frames);
+
+      if (ns_c <= 0.0 || ns_simd <= 0.0)
+      {
+         printf("%-20s failed to load\n", presets[i]);
+         failed = true;
+         free(presets[i]);
+         continue;
+      }
+
+      if (out_frames != ref_frames)
+         failed = true;
+      for (j = 0; j < 2 * ref_frames && j < 2 * out_frames; j++)
+         diff = fmaxf(diff, fabsf(out[j] - ref[j]));
+      // The SIMD paths round differently; anything audible is a bug.
+      if (diff > 1e-4f)
+         failed = true;
+
+      printf("%-20s %10.2f %10.2f %7.2fx %10.2g\n", presets[i],
+            ns_c, ns_simd, ns_c / ns_simd, diff);
+      free(presets[i]);
+   }
+
+   if (failed)
+      fprintf(stderr, "SIMD output does not match the C paths.\n");
+
+   free(in);
+   free(out);
+   free(ref);
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -26,6 +26,10 @@
 #define RESAMPLER_IDENT "sinc"
 #endif
 
+#ifndef RESAMPLER_QUALITY
+#define RESAMPLER_QUALITY RESAMPLER_QUALITY_DONTCARE
+#endif
+
 int main(int argc, char *argv[])
 {
    srand(time(NULL));
@@ -60,7 +64,8 @@ int main(int argc, char *argv[])
 
    const rarch_resampler_t *resampler = NULL;
    void *re = NULL;
-   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, out_rate / in_rate))
+   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT,
+            RESAMPLER_QUALITY, out_rate / in_rate))
    {
       fprintf(stderr, "Failed to allocate resampler ...\n");
       return 1;
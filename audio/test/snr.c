@@ -27,6 +27,10 @@
 #define RESAMPLER_IDENT "sinc"
 #endif
 
+#ifndef RESAMPLER_QUALITY
+#define RESAMPLER_QUALITY RESAMPLER_QUALITY_DONTCARE
+#endif
+
 #undef min
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 
@@ -273,7 +277,8 @@ int main(int argc, char *argv[])
 
    void *re = NULL;
    const rarch_resampler_t *resampler = NULL;
-   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT, ratio))
+   if (!rarch_resampler_realloc(&re, &resampler, RESAMPLER_IDENT,
+            RESAMPLER_QUALITY, ratio))
       return 1;
 
    test_fft();
@@ -0,0 +1,88 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Stand-ins for what resampler.c pulls in from the frontend.
+// CPU features are real, so the tests run the same kernels the
+// frontend would on this CPU. There is no config file, so every
+// resampler option reads back its default.
+
+#include "../resamplers/resampler.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t rarch_get_cpu_features(void);
+
+uint64_t rarch_get_cpu_features(void)
+{
+   uint64_t cpu = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("sse"))
+      cpu |= RESAMPLER_SIMD_SSE;
+   if (__builtin_cpu_supports("sse2"))
+      cpu |= RESAMPLER_SIMD_SSE2;
+   if (__builtin_cpu_supports("avx"))
+      cpu |= RESAMPLER_SIMD_AVX;
+   if (__builtin_cpu_supports("avx2"))
+      cpu |= RESAMPLER_SIMD_AVX2;
+#endif
+   return cpu;
+}
+
+int config_userdata_get_float(void *userdata, const char *key_str,
+      float *value, float default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+int config_userdata_get_int(void *userdata, const char *key_str,
+      int *value, int default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+int config_userdata_get_float_array(void *userdata, const char *key_str,
+      float **values, unsigned *out_num_values,
+      const float *default_values, unsigned num_default_values)
+{
+   *values = calloc(num_default_values, sizeof(float));
+   memcpy(*values, default_values, sizeof(float) * num_default_values);
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+int config_userdata_get_int_array(void *userdata, const char *key_str,
+      int **values, unsigned *out_num_values,
+      const int *default_values, unsigned num_default_values)
+{
+   *values = calloc(num_default_values, sizeof(int));
+   memcpy(*values, default_values, sizeof(int) * num_default_values);
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+int config_userdata_get_string(void *userdata, const char *key_str,
+      char **output, const char *default_output)
+{
+   *output = strdup(default_output);
+   return 0;
+}
+
+void config_userdata_free(void *ptr)
+{
+   free(ptr);
+}
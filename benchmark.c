@@ -0,0 +1,151 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmark.h"
+#include "general.h"
+#include "performance.h"
+#include "compat/strl.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Kept out of g_extern, which is cleared after the
+ * arguments are parsed. */
+static struct
+{
+   unsigned frames;
+   bool pipelines;
+   char report_path[PATH_MAX];
+} bench;
+
+void benchmark_parse_args(int *argc, char **argv)
+{
+   int i, out = 1;
+
+   for (i = 1; i < *argc; i++)
+   {
+      if (!strcmp(argv[i], "--benchmark") && i + 1 < *argc)
+         bench.frames = strtoul(argv[++i], NULL, 0);
+      else if (!strncmp(argv[i], "--benchmark=", 12))
+         bench.frames = strtoul(argv[i] + 12, NULL, 0);
+      else if (!strcmp(argv[i], "--benchmark-pipelines"))
+         bench.pipelines = true;
+      else if (!strcmp(argv[i], "--benchmark-report") && i + 1 < *argc)
+         strlcpy(bench.report_path, argv[++i], sizeof(bench.report_path));
+      else
+         argv[out++] = argv[i];
+   }
+
+   if (out < *argc)
+   {
+      argv[out] = NULL;
+      *argc     = out;
+   }
+}
+
+bool benchmark_enabled(void)
+{
+   return bench.frames > 0;
+}
+
+void benchmark_apply_settings(void)
+{
+   if (!benchmark_enabled())
+      return;
+
+   strlcpy(g_settings.video.driver, "null", sizeof(g_settings.video.driver));
+   strlcpy(g_settings.audio.driver, "null", sizeof(g_settings.audio.driver));
+   strlcpy(g_settings.input.driver, "null", sizeof(g_settings.input.driver));
+
+   /* Nothing waits on a display or a sound card. */
+   g_settings.video.vsync                     = false;
+   g_settings.video.threaded                  = false;
+   g_settings.video.frame_delay               = 0;
+   g_settings.audio.sync                      = false;
+   g_settings.fastforward_ratio_throttle_enable = false;
+
+   /* Leave the user's config and saves alone. */
+   g_settings.config_save_on_exit = false;
+   g_settings.savestate_auto_load = false;
+   g_settings.savestate_auto_save = false;
+   g_settings.fps_show            = false;
+   g_settings.frame_pacing_show   = false;
+
+   g_extern.perfcnt_enable = true;
+
+   if (bench.pipelines)
+      return;
+
+   *g_settings.video.softfilter_plugin = '\0';
+   *g_settings.audio.dsp_plugin        = '\0';
+   g_settings.audio.enable             = false;
+   g_settings.rewind_enable            = false;
+}
+
+int benchmark_run(void)
+{
+   unsigned i, frames;
+   retro_time_t start, elapsed;
+   double seconds;
+
+   if (g_extern.libretro_dummy || !g_extern.main_is_init)
+   {
+      RARCH_ERR("Benchmark needs a core and content to run.\n");
+      return EXIT_FAILURE;
+   }
+
+   RARCH_LOG("Benchmark: running %u frames%s.\n", bench.frames,
+         bench.pipelines ? " with softfilter, DSP, resampler and rewind" : "");
+
+   rarch_perf_stage_clear();
+
+   start = rarch_get_time_usec();
+   for (frames = 0; frames < bench.frames; frames++)
+      if (rarch_main_iterate() == -1)
+         break;
+   elapsed = rarch_get_time_usec() - start;
+   seconds = elapsed / 1000000.0;
+
+   printf("Benchmark: %u frames in %.3f s, %.2f frames/s.\n",
+         frames, seconds, seconds > 0.0 ? frames / seconds : 0.0);
+   printf("%-12s %10s %10s %10s %10s %10s\n",
+         "stage", "frames", "avg usec", "p50 usec", "p99 usec", "max usec");
+
+   for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+   {
+      struct rarch_perf_stage_summary summary;
+      rarch_perf_stage_get_summary((enum rarch_perf_stage)i, &summary);
+      if (!summary.frames)
+         continue;
+
+      printf("%-12s %10llu %10lld %10lld %10lld %10lld\n", summary.ident,
+            (unsigned long long)summary.frames, (long long)summary.avg,
+            (long long)summary.p50, (long long)summary.p99,
+            (long long)summary.max);
+   }
+   fflush(stdout);
+
+   if (*bench.report_path && !rarch_perf_stage_write(bench.report_path))
+      return EXIT_FAILURE;
+
+   if (frames < bench.frames)
+   {
+      RARCH_ERR("Benchmark: content stopped after %u of %u frames.\n",
+            frames, bench.frames);
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
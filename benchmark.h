@@ -0,0 +1,57 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_BENCHMARK_H
+#define __RARCH_BENCHMARK_H
+
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Headless benchmark mode.
+ *
+ *    retroarch --benchmark <frames> [--benchmark-pipelines]
+ *          [--benchmark-report <file>] -L <core> <content>
+ *
+ * Runs the content for a fixed number of frames on the null video,
+ * audio and input drivers, unthrottled, then prints frames/s and the
+ * per-stage timings from the performance counters. Softfilter, DSP,
+ * audio (and so resampling) and rewind are off unless
+ * --benchmark-pipelines is given, in which case they run as
+ * configured. --benchmark-report also writes the stages out, as JSON
+ * or CSV going by the extension.
+ *
+ * Exits non-zero if the content couldn't be run for all frames. */
+
+/* Takes the benchmark options out of argv, so the regular
+ * parser never sees them. */
+void benchmark_parse_args(int *argc, char **argv);
+
+bool benchmark_enabled(void);
+
+/* Called after every config load, so neither the config file nor a
+ * per-game config can put a real driver back. */
+void benchmark_apply_settings(void);
+
+/* Runs the frames and prints the report. Returns the exit code. */
+int benchmark_run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -21,6 +21,7 @@
 #endif
 
 #include "general.h"
+#include "frame_pacing.h"
 #include "compat/strl.h"
 #include "compat/posix_string.h"
 #include <file/file_path.h>
@@ -190,6 +191,7 @@ static const struct cmd_map map[] = {
    { "STATE_SLOT_PLUS",        RARCH_STATE_SLOT_PLUS },
    { "STATE_SLOT_MINUS",       RARCH_STATE_SLOT_MINUS },
    { "REWIND",                 RARCH_REWIND },
+   { "MOVIE_RECORD_TOGGLE",    RARCH_MOVIE_RECORD_TOGGLE },
   // { "PAUSE_TOGGLE",           RARCH_PAUSE_TOGGLE },
   // { "FRAMEADVANCE",           RARCH_FRAMEADVANCE },
    { "RESET",                  RARCH_RESET },
@@ -246,8 +248,15 @@ static bool cmd_set_shader(const char *arg)
    return driver.video->set_shader(driver.video_data, type, arg);
 }
 
+/* "-" dumps to the log instead of a file. */
+static bool cmd_frame_pacing_dump(const char *arg)
+{
+   return frame_pacing_dump(strcmp(arg, "-") == 0 ? NULL : arg);
+}
+
 static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", cmd_set_shader, "<shader path>" },
+   { "FRAME_PACING_DUMP", cmd_frame_pacing_dump, "<path or ->" },
 };
 
 static bool command_get_arg(const char *tok,
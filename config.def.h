@@ -390,7 +390,12 @@ static const unsigned frame_delay = 0;
 /* Threaded video. Will possibly increase performance significantly 
  * at the cost of worse synchronization and latency.
  */
-//static const bool video_threaded = false;
+static const bool video_threaded = false;
+
+/* Number of threads used by CPU video filters.
+ * 0 picks one thread per CPU core.
+ */
+static const unsigned video_filter_threads = 0;
 
 /* Set to true if HW render cores should get their private context. */
 //static const bool video_shared_context = false;
@@ -658,6 +663,10 @@ static const bool allow_rotate = true;
 /* Number of taps for the sinc resampler. Higher sound better but slower. */
 static const unsigned sinc_taps = 4;
 
+/* Sinc resampler quality tier, from RESAMPLER_QUALITY_LOWEST to
+ * RESAMPLER_QUALITY_HIGHEST. DONTCARE uses the build's default. */
+static const unsigned audio_resampler_quality = RESAMPLER_QUALITY_DONTCARE;
+
 /* Will enable audio or not. */
 static const bool audio_enable = true;
 
@@ -699,6 +708,10 @@ static const bool clock_show = true;
 /* Enables displaying the current frames per second. */
 static const bool fps_show = false;
 
+/* Shows frame pacing stats on-screen: frame time percentiles,
+ * missed refreshes and where the frame time went. */
+static const bool frame_pacing_show = false;
+
 /* Show a fade-in effect at start-up. */
 static const bool fadein = false;
 
@@ -728,6 +741,10 @@ static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* How many frames apart movie recordings store a keyframe for seeking.
+ * 0 disables the keyframe index. */
+static const unsigned movie_keyframe_interval = 600;
+
 /* Pause gameplay when gameplay loses focus. */
 //static const bool pause_nonactive = false;
 
@@ -737,7 +754,7 @@ static const unsigned autosave_interval = 0;
 
 /* When being client over netplay, use keybinds for 
  * player 1 rather than player 2. */
-//static const bool netplay_client_swap_input = true;
+static const bool netplay_client_swap_input = true;
 
 /* On save state load, block SRAM from being overwritten.
  * This could potentially lead to buggy games. */
@@ -882,6 +899,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_STATE_SLOT_PLUS,          RETRO_LBL_STATE_SLOT_PLUS,      RETROK_F7,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_STATE_SLOT_MINUS,         RETRO_LBL_STATE_SLOT_MINUS,     RETROK_F6,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_REWIND,                   RETRO_LBL_REWIND,               RETROK_r,       NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_MOVIE_RECORD_TOGGLE,      RETRO_LBL_MOVIE_RECORD_TOGGLE,  RETROK_o,       NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_PAUSE_TOGGLE,             RETRO_LBL_PAUSE_TOGGLE,         RETROK_p,       NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_FRAMEADVANCE,             RETRO_LBL_FRAMEADVANCE,         RETROK_k,       NO_BTN, 0, AXIS_NONE },
    { true, RARCH_RESET,                    RETRO_LBL_RESET,                RETROK_h,       NO_BTN, 0, AXIS_NONE },
@@ -981,6 +999,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_STATE_SLOT_PLUS,          RETRO_LBL_STATE_SLOT_PLUS,      RETROK_F7,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_STATE_SLOT_MINUS,         RETRO_LBL_STATE_SLOT_MINUS,     RETROK_F6,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_REWIND,                   RETRO_LBL_REWIND,               RETROK_r,       NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_MOVIE_RECORD_TOGGLE,      RETRO_LBL_MOVIE_RECORD_TOGGLE,  RETROK_o,       NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_PAUSE_TOGGLE,             RETRO_LBL_PAUSE_TOGGLE,         RETROK_p,       NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_FRAMEADVANCE,             RETRO_LBL_FRAMEADVANCE,         RETROK_k,       NO_BTN, 0, AXIS_NONE },
    { true, RARCH_RESET,                    RETRO_LBL_RESET,                RETROK_h,       NO_BTN, 0, AXIS_NONE },
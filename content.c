@@ -187,6 +187,66 @@ error:
    RARCH_WARN("Failed ... Cannot recover save file.\n");
 }
 
+#ifdef HAVE_THREADS
+static save_queue_t *get_save_queue(void)
+{
+   if (!g_extern.save_queue)
+      g_extern.save_queue = save_queue_new();
+   return g_extern.save_queue;
+}
+
+/* Reading a file back must not race its own pending write. */
+static void flush_save_queue(void)
+{
+   if (g_extern.save_queue)
+      save_queue_flush(g_extern.save_queue);
+}
+
+static void save_state_done(const char *path, const void *data,
+      size_t size, bool success, void *userdata)
+{
+   char msg[PATH_MAX];
+
+   if (success)
+   {
+      RARCH_LOG("Saved state to \"%s\".\n", path);
+      snprintf(msg, sizeof(msg), "Saved state to \"%s\".",
+            path_basename(path));
+   }
+   else
+   {
+      RARCH_ERR("Failed to save state to \"%s\".\n", path);
+      snprintf(msg, sizeof(msg), "Failed to save state to \"%s\".",
+            path_basename(path));
+   }
+
+   msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+}
+
+/* Serializes into a pooled buffer and leaves the disk I/O to the
+ * save queue. The result is reported by save_state_done(). */
+static bool save_state_async(save_queue_t *queue, void *data,
+      const char *path, size_t size)
+{
+   if (!pretro_serialize(data, size))
+   {
+      RARCH_ERR("Failed to save state to \"%s\".\n", path);
+      save_queue_release(queue, data);
+      return false;
+   }
+
+   return save_queue_push(queue, data, size, path, save_state_done, NULL);
+}
+#endif
+
+void deinit_save_queue(void)
+{
+#ifdef HAVE_THREADS
+   save_queue_free(g_extern.save_queue);
+   g_extern.save_queue = NULL;
+#endif
+}
+
 bool save_state(const char *path)
 {
    RARCH_LOG("Saving state: \"%s\".\n", path);
@@ -194,6 +254,15 @@ bool save_state(const char *path)
    if (size == 0)
       return false;
 
+   RARCH_LOG("State size: %d bytes.\n", (int)size);
+
+#ifdef HAVE_THREADS
+   save_queue_t *queue = get_save_queue();
+   void *buf = queue ? save_queue_get_buffer(queue, size) : NULL;
+   if (buf)
+      return save_state_async(queue, buf, path, size);
+#endif
+
    void *data = malloc(size);
    if (!data)
    {
@@ -201,10 +270,9 @@ bool save_state(const char *path)
       return false;
    }
 
-   RARCH_LOG("State size: %d bytes.\n", (int)size);
    bool ret = pretro_serialize(data, size);
    if (ret)
-      ret = write_file(path, data, size);
+      ret = write_file_atomic(path, data, size);
 
    if (!ret)
       RARCH_ERR("Failed to save state to \"%s\".\n", path);
@@ -224,7 +292,13 @@ bool load_state(const char *path)
 {
    unsigned i;
    void *buf = NULL;
-   ssize_t size = read_file(path, &buf);
+   ssize_t size;
+
+#ifdef HAVE_THREADS
+   flush_save_queue();
+#endif
+
+   size = read_file(path, &buf);
 
    RARCH_LOG("Loading state: \"%s\".\n", path);
 
@@ -301,6 +375,10 @@ void load_ram_file(const char *path, int type)
    if (size == 0 || !data)
       return;
 
+#ifdef HAVE_THREADS
+   flush_save_queue();
+#endif
+
    void *buf = NULL;
    ssize_t rc = read_file(path, &buf);
    if (rc > 0)
@@ -317,14 +395,52 @@ void load_ram_file(const char *path, int type)
    free(buf);
 }
 
+#ifdef HAVE_THREADS
+static void save_ram_done(const char *path, const void *data,
+      size_t size, bool success, void *userdata)
+{
+   if (success)
+   {
+      RARCH_LOG("Saved successfully to \"%s\".\n", path);
+      return;
+   }
+
+   RARCH_ERR("Failed to save SRAM.\n");
+   msg_queue_push(g_extern.msg_queue, "Failed to save SRAM.", 1, 180);
+   RARCH_WARN("Attempting to recover ...\n");
+   dump_to_file_desperate(data, size, (unsigned)(uintptr_t)userdata);
+}
+
+/* Snapshots SRAM, since the core keeps writing to it,
+ * and leaves the disk I/O to the save queue. */
+static bool save_ram_file_async(save_queue_t *queue, const char *path,
+      int type, const void *data, size_t size)
+{
+   void *buf = save_queue_get_buffer(queue, size);
+   if (!buf)
+      return false;
+
+   memcpy(buf, data, size);
+   return save_queue_push(queue, buf, size, path, save_ram_done,
+         (void*)(uintptr_t)type);
+}
+#endif
+
 void save_ram_file(const char *path, int type)
 {
    size_t size = pretro_get_memory_size(type);
    void *data = pretro_get_memory_data(type);
 
+#ifdef HAVE_THREADS
+   save_queue_t *queue = get_save_queue();
+   if (data && size > 0 && queue &&
+         save_ram_file_async(queue, path, type, data, size))
+      return;
+#endif
+
    if (data && size > 0)
    {
-      if (!write_file(path, data, size))
+      if (!write_file_atomic(path, data, size))
       {
          RARCH_ERR("Failed to save SRAM.\n");
          RARCH_WARN("Attempting to recover ...\n");
@@ -29,11 +29,19 @@ extern "C" {
 /* Handles files related to libretro. */
 
 bool load_state(const char *path);
+
+/* With threads, the write itself goes through the save queue, and
+ * true only means the state was serialized and queued. Whether it
+ * reached the disk is reported on screen once the write finishes.
+ * Falls back to writing in place if the queue has no buffer. */
 bool save_state(const char *path);
 
 void load_ram_file(const char *path, int type);
 void save_ram_file(const char *path, int type);
 
+/* Waits for queued savestate and SRAM writes, then stops the writer. */
+void deinit_save_queue(void);
+
 bool init_content_file(void);
 
 #ifdef __cplusplus
@@ -14,6 +14,7 @@
  */
 
 #include "core_info.h"
+#include "core_info_cache.h"
 #include "general.h"
 #include <file/file_path.h>
 #include "file_ext.h"
@@ -97,16 +98,93 @@ static void core_info_list_resolve_all_firmware(
    }
 }
 
+static void core_info_resolve_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list = string_split(info->licenses, "|");
+   if (info->notes)
+      info->note_list = string_split(info->notes, "|");
+}
+
+void core_info_get_info_path(char *path, size_t size,
+      const char *core_path, const char *info_dir)
+{
+   char info_path_base[PATH_MAX];
+
+   fill_pathname_base(info_path_base, core_path, sizeof(info_path_base));
+   path_remove_extension(info_path_base);
+
+#if defined(RARCH_MOBILE) || defined(RARCH_CONSOLE)
+   char *substr = strrchr(info_path_base, '_');
+   if (substr)
+      *substr = '\0';
+#endif
+
+   strlcat(info_path_base, ".info", sizeof(info_path_base));
+   fill_pathname_join(path, info_dir, info_path_base, size);
+}
+
+/* Kept next to the config, so writing it never touches
+ * the directories it is validated against. */
+static bool core_info_get_cache_path(char *path, size_t size,
+      const char *modules_path, const char *info_path)
+{
+   char dir[PATH_MAX], other[PATH_MAX];
+
+   if (!*g_extern.config_path)
+      return false;
+
+   fill_pathname_basedir(dir, g_extern.config_path, sizeof(dir));
+
+   strlcpy(other, modules_path, sizeof(other));
+   fill_pathname_slash(other, sizeof(other));
+   if (!strcmp(dir, other))
+      return false;
+
+   strlcpy(other, info_path, sizeof(other));
+   fill_pathname_slash(other, sizeof(other));
+   if (!strcmp(dir, other))
+      return false;
+
+   fill_pathname_join(path, dir, "core_info.cache", size);
+   return true;
+}
+
 core_info_list_t *core_info_list_new(const char *modules_path)
 {
    size_t i;
+   char cache_path[PATH_MAX];
+   bool use_cache;
    core_info_t *core_info = NULL;
    core_info_list_t *core_info_list = NULL;
+   const char *info_path = (*g_settings.libretro_info_path) ?
+      g_settings.libretro_info_path : modules_path;
    struct string_list *contents = (struct string_list*)
       dir_list_new(modules_path, EXT_EXECUTABLES, false);
    if (!contents)
       return NULL;
 
+   use_cache = core_info_get_cache_path(cache_path, sizeof(cache_path),
+         modules_path, info_path);
+
+   if (use_cache && (core_info_list = core_info_cache_load(cache_path,
+               modules_path, info_path, contents)))
+   {
+      for (i = 0; i < core_info_list->count; i++)
+         core_info_resolve_lists(&core_info_list->list[i]);
+      core_info_list_resolve_all_extensions(core_info_list);
+
+      dir_list_free(contents);
+      return core_info_list;
+   }
+
    core_info_list = (core_info_list_t*)calloc(1, sizeof(*core_info_list));
    if (!core_info_list)
       goto error;
@@ -120,67 +198,38 @@ core_info_list_t *core_info_list_new(const char *modules_path)
 
    for (i = 0; i < contents->size; i++)
    {
-      char info_path_base[PATH_MAX], info_path[PATH_MAX];
+      char info_path_full[PATH_MAX];
       core_info[i].path = strdup(contents->elems[i].data);
 
       if (!core_info[i].path)
          break;
 
-      fill_pathname_base(info_path_base, contents->elems[i].data,
-            sizeof(info_path_base));
-      path_remove_extension(info_path_base);
-
-#if defined(RARCH_MOBILE) || defined(RARCH_CONSOLE)
-      char *substr = strrchr(info_path_base, '_');
-      if (substr)
-         *substr = '\0';
-#endif
-
-      strlcat(info_path_base, ".info", sizeof(info_path_base));
+      core_info_get_info_path(info_path_full, sizeof(info_path_full),
+            contents->elems[i].data, info_path);
 
-      fill_pathname_join(info_path, (*g_settings.libretro_info_path) ?
-            g_settings.libretro_info_path : modules_path,
-            info_path_base, sizeof(info_path));
-
-      core_info[i].data = config_file_new(info_path);
+      core_info[i].data = config_file_new(info_path_full);
 
       if (core_info[i].data)
       {
          unsigned count = 0;
+         core_info[i].has_info = true;
          config_get_string(core_info[i].data, "display_name",
                &core_info[i].display_name);
          config_get_string(core_info[i].data, "systemname",
                &core_info[i].systemname);
          config_get_uint(core_info[i].data, "firmware_count", &count);
          core_info[i].firmware_count = count;
-         if (config_get_string(core_info[i].data, "supported_extensions",
-                  &core_info[i].supported_extensions) &&
-               core_info[i].supported_extensions)
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-         if (config_get_string(core_info[i].data, "authors",
-                  &core_info[i].authors) &&
-               core_info[i].authors)
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-         if (config_get_string(core_info[i].data, "permissions",
-                  &core_info[i].permissions) &&
-               core_info[i].permissions)
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-         if (config_get_string(core_info[i].data, "license",
-                  &core_info[i].licenses) &&
-               core_info[i].licenses)
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
-
-         if (config_get_string(core_info[i].data, "notes",
-                  &core_info[i].notes) &&
-               core_info[i].notes)
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
+         config_get_string(core_info[i].data, "supported_extensions",
+               &core_info[i].supported_extensions);
+         config_get_string(core_info[i].data, "authors",
+               &core_info[i].authors);
+         config_get_string(core_info[i].data, "permissions",
+               &core_info[i].permissions);
+         config_get_string(core_info[i].data, "license",
+               &core_info[i].licenses);
+         config_get_string(core_info[i].data, "notes",
+               &core_info[i].notes);
+         core_info_resolve_lists(&core_info[i]);
 
          config_get_bool(core_info[i].data, "supports_no_game",
                &core_info[i].supports_no_game);
@@ -193,6 +242,10 @@ core_info_list_t *core_info_list_new(const char *modules_path)
    core_info_list_resolve_all_extensions(core_info_list);
    core_info_list_resolve_all_firmware(core_info_list);
 
+   if (use_cache && i == contents->size)
+      core_info_cache_save(cache_path, core_info_list,
+            modules_path, info_path);
+
    dir_list_free(contents);
    return core_info_list;
 
@@ -213,14 +266,24 @@ void core_info_list_free(core_info_list_t *core_info_list)
    {
       core_info_t *info = (core_info_t*)&core_info_list->list[i];
 
-      free(info->path);
-      free(info->systemname);
-      free(info->display_name);
-      free(info->supported_extensions);
-      free(info->authors);
-      free(info->permissions);
-      free(info->licenses);
-      free(info->notes);
+      if (!core_info_list->cache)
+      {
+         free(info->path);
+         free(info->systemname);
+         free(info->display_name);
+         free(info->supported_extensions);
+         free(info->authors);
+         free(info->permissions);
+         free(info->licenses);
+         free(info->notes);
+
+         for (j = 0; j < info->firmware_count; j++)
+         {
+            free(info->firmware[j].path);
+            free(info->firmware[j].desc);
+         }
+      }
+
       if (info->supported_extensions_list)
          string_list_free(info->supported_extensions_list);
       string_list_free(info->authors_list);
@@ -228,15 +291,10 @@ void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->permissions_list);
       string_list_free(info->licenses_list);
       config_file_free(info->data);
-
-      for (j = 0; j < info->firmware_count; j++)
-      {
-         free(info->firmware[j].path);
-         free(info->firmware[j].desc);
-      }
       free(info->firmware);
    }
 
+   core_info_cache_free(core_info_list->cache);
    free(core_info_list->all_ext);
    free(core_info_list->list);
    free(core_info_list);
@@ -250,7 +308,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
 
    num = 0;
    for (i = 0; i < core_info_list->count; i++)
-      num += !!core_info_list->list[i].data;
+      num += core_info_list->list[i].has_info;
    return num;
 }
 
@@ -38,6 +38,8 @@ typedef struct
 typedef struct
 {
    char *path;
+   /* Only set when the .info file was parsed, not when the
+    * info came from the core info cache. */
    config_file_t *data;
    char *display_name;
    char *systemname;
@@ -55,6 +57,8 @@ typedef struct
    core_info_firmware_t *firmware;
    size_t firmware_count;
    bool supports_no_game;
+   /* An .info file was found for this core. */
+   bool has_info;
 } core_info_t;
 
 typedef struct
@@ -62,6 +66,9 @@ typedef struct
    core_info_t *list;
    size_t count;
    char *all_ext;
+   /* If loaded from the core info cache, the strings in list
+    * point into it and are not freed one by one. */
+   void *cache;
 } core_info_list_t;
 
 core_info_list_t *core_info_list_new(const char *modules_path);
@@ -69,6 +76,10 @@ void core_info_list_free(core_info_list_t *list);
 
 size_t core_info_list_num_info_files(core_info_list_t *list);
 
+/* Path of the .info file describing the core at core_path. */
+void core_info_get_info_path(char *path, size_t size,
+      const char *core_path, const char *info_dir);
+
 bool core_info_does_support_file(const core_info_t *info,
       const char *path);
 
@@ -0,0 +1,480 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "core_info_cache.h"
+#include "file_ops.h"
+#include "hash.h"
+#include "general.h"
+#include <file/file_path.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+struct core_info_cache
+{
+#ifdef HAVE_MMAP
+   int fd;
+#endif
+   const uint8_t *data;
+   size_t size;
+};
+
+#ifdef HAVE_MMAP
+void core_info_cache_free(void *data)
+{
+   struct core_info_cache *cache = (struct core_info_cache*)data;
+   if (!cache)
+      return;
+
+   if (cache->data)
+      munmap((void*)cache->data, cache->size);
+   if (cache->fd >= 0)
+      close(cache->fd);
+   free(cache);
+}
+
+static struct core_info_cache *core_info_cache_open(const char *path)
+{
+   struct stat fds;
+   void *data;
+   struct core_info_cache *cache = (struct core_info_cache*)
+      calloc(1, sizeof(*cache));
+   if (!cache)
+      return NULL;
+
+   cache->fd = open(path, O_RDONLY);
+   if (cache->fd < 0 || fstat(cache->fd, &fds) < 0 || !fds.st_size)
+      goto error;
+
+   data = mmap(NULL, fds.st_size, PROT_READ, MAP_SHARED, cache->fd, 0);
+   if (data == MAP_FAILED)
+      goto error;
+
+   cache->data = (const uint8_t*)data;
+   cache->size = fds.st_size;
+   return cache;
+
+error:
+   core_info_cache_free(cache);
+   return NULL;
+}
+#else
+void core_info_cache_free(void *data)
+{
+   struct core_info_cache *cache = (struct core_info_cache*)data;
+   if (!cache)
+      return;
+
+   free((void*)cache->data);
+   free(cache);
+}
+
+static struct core_info_cache *core_info_cache_open(const char *path)
+{
+   void *data = NULL;
+   long size;
+   struct core_info_cache *cache;
+
+   if (!path_file_exists(path))
+      return NULL;
+
+   cache = (struct core_info_cache*)calloc(1, sizeof(*cache));
+   if (!cache)
+      return NULL;
+
+   size = read_file(path, &data);
+   if (size <= 0)
+   {
+      free(data);
+      free(cache);
+      return NULL;
+   }
+
+   cache->data = (const uint8_t*)data;
+   cache->size = size;
+   return cache;
+}
+#endif
+
+static bool core_info_cache_stat(const char *path,
+      int64_t *mtime, int64_t *size)
+{
+   struct stat st;
+   if (stat(path, &st) < 0)
+      return false;
+
+   *mtime = st.st_mtime;
+   *size  = st.st_size;
+   return true;
+}
+
+/* The string block is known to end in a NUL, so every
+ * offset inside it is a terminated string. */
+static const char *core_info_cache_string(
+      const struct core_info_cache_header *header,
+      const char *strings, uint32_t offset, bool *ok)
+{
+   if (offset >= header->strings_size)
+   {
+      *ok = false;
+      return NULL;
+   }
+   return offset ? strings + offset : NULL;
+}
+
+/* Checks the layout and that the cache was built from the
+ * directories, cores and .info files we have now. */
+static bool core_info_cache_validate(const struct core_info_cache *cache,
+      const char *modules_dir, const char *info_dir,
+      const struct string_list *cores)
+{
+   size_t i, remaining;
+   int64_t mtime, size;
+   bool ok = true;
+   const char *dir;
+   const char *strings;
+   const struct core_info_cache_entry *entries;
+   const struct core_info_cache_header *header =
+      (const struct core_info_cache_header*)cache->data;
+
+   if (cache->size < sizeof(*header) ||
+         memcmp(header->magic, CORE_INFO_CACHE_MAGIC,
+            sizeof(CORE_INFO_CACHE_MAGIC)) ||
+         header->version != CORE_INFO_CACHE_VERSION ||
+         header->byte_order != CORE_INFO_CACHE_BYTE_ORDER)
+      return false;
+
+   remaining = cache->size - sizeof(*header);
+   if (header->count > remaining / sizeof(struct core_info_cache_entry))
+      return false;
+   remaining -= header->count * sizeof(struct core_info_cache_entry);
+   if (header->firmware_count >
+         remaining / sizeof(struct core_info_cache_firmware))
+      return false;
+   remaining -= header->firmware_count *
+      sizeof(struct core_info_cache_firmware);
+   if (header->strings_size != remaining || !remaining)
+      return false;
+
+   if (crc32_calculate(cache->data + sizeof(*header),
+            cache->size - sizeof(*header)) != header->checksum)
+      return false;
+
+   entries = (const struct core_info_cache_entry*)(header + 1);
+   strings = (const char*)cache->data + cache->size - header->strings_size;
+   if (strings[0] || strings[header->strings_size - 1])
+      return false;
+
+   dir = core_info_cache_string(header, strings, header->modules_dir, &ok);
+   if (!ok || !dir || strcmp(dir, modules_dir))
+      return false;
+   dir = core_info_cache_string(header, strings, header->info_dir, &ok);
+   if (!ok || !dir || strcmp(dir, info_dir))
+      return false;
+
+   if (!core_info_cache_stat(modules_dir, &mtime, &size) ||
+         mtime != header->modules_mtime || size != header->modules_size)
+      return false;
+   if (!core_info_cache_stat(info_dir, &mtime, &size) ||
+         mtime != header->info_mtime || size != header->info_size)
+      return false;
+
+   /* Directory times are coarse or missing on some file systems,
+    * the core list itself is cheap to compare. */
+   if (header->count != cores->size)
+      return false;
+
+   for (i = 0; i < header->count; i++)
+   {
+      char info_path[PATH_MAX];
+      bool has_stat;
+      const char *path = core_info_cache_string(header, strings,
+            entries[i].path, &ok);
+      if (!ok || !path || strcmp(path, cores->elems[i].data))
+         return false;
+
+      core_info_get_info_path(info_path, sizeof(info_path), path, info_dir);
+      has_stat = core_info_cache_stat(info_path, &mtime, &size);
+      if (has_stat != !!(entries[i].flags & CORE_INFO_CACHE_INFO_STAT) ||
+            (has_stat && (mtime != entries[i].info_mtime ||
+                          size != entries[i].info_size)))
+         return false;
+
+      if (entries[i].firmware > header->firmware_count ||
+            entries[i].firmware_count >
+            header->firmware_count - entries[i].firmware)
+         return false;
+   }
+
+   return true;
+}
+
+core_info_list_t *core_info_cache_load(const char *path,
+      const char *modules_dir, const char *info_dir,
+      const struct string_list *cores)
+{
+   size_t i, j;
+   bool ok = true;
+   const char *strings;
+   const struct core_info_cache_header *header;
+   const struct core_info_cache_entry *entries;
+   const struct core_info_cache_firmware *firmware;
+   core_info_list_t *list = NULL;
+   struct core_info_cache *cache = core_info_cache_open(path);
+
+   if (!cache)
+      return NULL;
+
+   if (!core_info_cache_validate(cache, modules_dir, info_dir, cores))
+   {
+      RARCH_LOG("Core info cache is stale, rebuilding it.\n");
+      goto error;
+   }
+
+   header   = (const struct core_info_cache_header*)cache->data;
+   entries  = (const struct core_info_cache_entry*)(header + 1);
+   firmware = (const struct core_info_cache_firmware*)
+      (entries + header->count);
+   strings  = (const char*)cache->data + cache->size - header->strings_size;
+
+   list = (core_info_list_t*)calloc(1, sizeof(*list));
+   if (!list)
+      goto error;
+
+   list->list = (core_info_t*)calloc(header->count + 1, sizeof(*list->list));
+   if (!list->list)
+      goto error;
+   list->count = header->count;
+   list->cache = cache;
+
+#define CACHE_STRING(offset) \
+   core_info_cache_string(header, strings, (offset), &ok)
+
+   for (i = 0; i < header->count; i++)
+   {
+      const struct core_info_cache_entry *entry = &entries[i];
+      core_info_t *info = &list->list[i];
+
+      info->path                 = (char*)CACHE_STRING(entry->path);
+      info->display_name         = (char*)CACHE_STRING(entry->display_name);
+      info->systemname           = (char*)CACHE_STRING(entry->systemname);
+      info->supported_extensions = (char*)
+         CACHE_STRING(entry->supported_extensions);
+      info->authors              = (char*)CACHE_STRING(entry->authors);
+      info->permissions          = (char*)CACHE_STRING(entry->permissions);
+      info->licenses             = (char*)CACHE_STRING(entry->licenses);
+      info->notes                = (char*)CACHE_STRING(entry->notes);
+      info->has_info             = entry->flags & CORE_INFO_CACHE_HAS_INFO;
+      info->supports_no_game     = entry->flags &
+         CORE_INFO_CACHE_SUPPORTS_NO_GAME;
+
+      if (!entry->firmware_count)
+         continue;
+
+      info->firmware = (core_info_firmware_t*)
+         calloc(entry->firmware_count, sizeof(*info->firmware));
+      if (!info->firmware)
+         goto error;
+      info->firmware_count = entry->firmware_count;
+
+      for (j = 0; j < entry->firmware_count; j++)
+      {
+         const struct core_info_cache_firmware *fw =
+            &firmware[entry->firmware + j];
+
+         info->firmware[j].path     = (char*)CACHE_STRING(fw->path);
+         info->firmware[j].desc     = (char*)CACHE_STRING(fw->desc);
+         info->firmware[j].optional = fw->optional;
+      }
+   }
+
+#undef CACHE_STRING
+
+   if (!ok)
+      goto error;
+
+   return list;
+
+error:
+   /* Owns the cache once it is set. */
+   if (list && list->cache)
+      core_info_list_free(list);
+   else
+   {
+      if (list)
+         free(list->list);
+      free(list);
+      core_info_cache_free(cache);
+   }
+   return NULL;
+}
+
+struct core_info_cache_strings
+{
+   char *data;
+   size_t size;
+   size_t capacity;
+   bool failed;
+};
+
+static uint32_t core_info_cache_add_string(
+      struct core_info_cache_strings *strings, const char *str)
+{
+   size_t len;
+   uint32_t offset;
+
+   if (!str || strings->failed)
+      return 0;
+
+   len = strlen(str) + 1;
+   if (strings->size + len > strings->capacity)
+   {
+      size_t capacity = strings->capacity * 2 + len;
+      char *data      = (char*)realloc(strings->data, capacity);
+      if (!data)
+      {
+         strings->failed = true;
+         return 0;
+      }
+      strings->data     = data;
+      strings->capacity = capacity;
+   }
+
+   offset = strings->size;
+   memcpy(strings->data + offset, str, len);
+   strings->size += len;
+   return offset;
+}
+
+bool core_info_cache_save(const char *path,
+      const core_info_list_t *list,
+      const char *modules_dir, const char *info_dir)
+{
+   size_t i, j, firmware_count = 0, size;
+   bool ret = false;
+   uint8_t *buf = NULL;
+   struct core_info_cache_header header = {{0}};
+   struct core_info_cache_entry *entries = NULL;
+   struct core_info_cache_firmware *firmware = NULL;
+   struct core_info_cache_strings strings = {0};
+
+   if (!list)
+      return false;
+
+   memcpy(header.magic, CORE_INFO_CACHE_MAGIC, sizeof(CORE_INFO_CACHE_MAGIC));
+   header.version    = CORE_INFO_CACHE_VERSION;
+   header.byte_order = CORE_INFO_CACHE_BYTE_ORDER;
+   header.count      = list->count;
+
+   if (!core_info_cache_stat(modules_dir,
+            &header.modules_mtime, &header.modules_size) ||
+         !core_info_cache_stat(info_dir,
+            &header.info_mtime, &header.info_size))
+      return false;
+
+   for (i = 0; i < list->count; i++)
+      if (list->list[i].firmware)
+         firmware_count += list->list[i].firmware_count;
+   header.firmware_count = firmware_count;
+
+   entries  = (struct core_info_cache_entry*)
+      calloc(list->count + 1, sizeof(*entries));
+   firmware = (struct core_info_cache_firmware*)
+      calloc(firmware_count + 1, sizeof(*firmware));
+   if (!entries || !firmware)
+      goto end;
+
+   /* Offset 0 is NULL. */
+   core_info_cache_add_string(&strings, "");
+   header.modules_dir = core_info_cache_add_string(&strings, modules_dir);
+   header.info_dir    = core_info_cache_add_string(&strings, info_dir);
+
+   firmware_count = 0;
+   for (i = 0; i < list->count; i++)
+   {
+      char info_path[PATH_MAX];
+      const core_info_t *info = &list->list[i];
+      struct core_info_cache_entry *entry = &entries[i];
+
+      entry->path                 = core_info_cache_add_string(&strings, info->path);
+      entry->display_name         = core_info_cache_add_string(&strings, info->display_name);
+      entry->systemname           = core_info_cache_add_string(&strings, info->systemname);
+      entry->supported_extensions = core_info_cache_add_string(&strings, info->supported_extensions);
+      entry->authors              = core_info_cache_add_string(&strings, info->authors);
+      entry->permissions          = core_info_cache_add_string(&strings, info->permissions);
+      entry->licenses             = core_info_cache_add_string(&strings, info->licenses);
+      entry->notes                = core_info_cache_add_string(&strings, info->notes);
+      entry->flags                =
+         (info->has_info ? CORE_INFO_CACHE_HAS_INFO : 0) |
+         (info->supports_no_game ? CORE_INFO_CACHE_SUPPORTS_NO_GAME : 0);
+      entry->firmware             = firmware_count;
+
+      core_info_get_info_path(info_path, sizeof(info_path),
+            info->path, info_dir);
+      if (core_info_cache_stat(info_path,
+               &entry->info_mtime, &entry->info_size))
+         entry->flags |= CORE_INFO_CACHE_INFO_STAT;
+
+      if (!info->firmware)
+         continue;
+
+      for (j = 0; j < info->firmware_count; j++, firmware_count++)
+      {
+         firmware[firmware_count].path = core_info_cache_add_string(
+               &strings, info->firmware[j].path);
+         firmware[firmware_count].desc = core_info_cache_add_string(
+               &strings, info->firmware[j].desc);
+         firmware[firmware_count].optional = info->firmware[j].optional;
+      }
+      entry->firmware_count = info->firmware_count;
+   }
+
+   if (strings.failed)
+      goto end;
+   header.strings_size = strings.size;
+
+   size = sizeof(header) + list->count * sizeof(*entries) +
+      firmware_count * sizeof(*firmware) + strings.size;
+   buf = (uint8_t*)malloc(size);
+   if (!buf)
+      goto end;
+
+   memcpy(buf + sizeof(header), entries, list->count * sizeof(*entries));
+   memcpy(buf + sizeof(header) + list->count * sizeof(*entries),
+         firmware, firmware_count * sizeof(*firmware));
+   memcpy(buf + size - strings.size, strings.data, strings.size);
+
+   header.checksum = crc32_calculate(buf + sizeof(header),
+         size - sizeof(header));
+   memcpy(buf, &header, sizeof(header));
+
+   ret = write_file_atomic(path, buf, size);
+   if (!ret)
+      RARCH_WARN("Could not write core info cache to %s.\n", path);
+
+end:
+   free(buf);
+   free(strings.data);
+   free(firmware);
+   free(entries);
+   return ret;
+}
@@ -0,0 +1,113 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORE_INFO_CACHE_H__
+#define CORE_INFO_CACHE_H__
+
+#include <stdint.h>
+#include "core_info.h"
+#include <string/string_list.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The cache holds core_info_t as resolved from the .info files,
+ * so a warm start only has to list the cores directory. It is in
+ * native byte order; a cache from another host is just stale.
+ *
+ * Layout: the header, count entries, firmware_count firmware
+ * records, then strings_size bytes of NUL terminated strings.
+ * Strings are referenced by their offset into that block, with
+ * offset 0 (an empty string) standing for NULL. */
+
+#define CORE_INFO_CACHE_MAGIC "RACINFO"
+#define CORE_INFO_CACHE_VERSION 2
+#define CORE_INFO_CACHE_BYTE_ORDER 0x01020304
+
+#define CORE_INFO_CACHE_HAS_INFO         (1 << 0)
+#define CORE_INFO_CACHE_SUPPORTS_NO_GAME (1 << 1)
+/* The .info file existed, with info_mtime and info_size. */
+#define CORE_INFO_CACHE_INFO_STAT        (1 << 2)
+
+struct core_info_cache_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t byte_order;
+   uint32_t count;
+   uint32_t firmware_count;
+   uint32_t strings_size;
+
+   /* Directories the cache was built from, and their stat()
+    * at the time. Any change makes the cache stale. */
+   uint32_t modules_dir;
+   uint32_t info_dir;
+   /* CRC32 of everything after the header. */
+   uint32_t checksum;
+   int64_t modules_mtime;
+   int64_t modules_size;
+   int64_t info_mtime;
+   int64_t info_size;
+};
+
+struct core_info_cache_entry
+{
+   uint32_t path;
+   uint32_t display_name;
+   uint32_t systemname;
+   uint32_t supported_extensions;
+   uint32_t authors;
+   uint32_t permissions;
+   uint32_t licenses;
+   uint32_t notes;
+   /* Index of the first firmware record. */
+   uint32_t firmware;
+   uint32_t firmware_count;
+   uint32_t flags;
+   /* stat() of the core's .info file. Directory times miss
+    * in-place edits, and on FAT miss added files as well. */
+   int64_t info_mtime;
+   int64_t info_size;
+};
+
+struct core_info_cache_firmware
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+};
+
+/* Fills in a core info list from the cache at path, if it was built
+ * from the same directories, the same list of cores and the same
+ * .info files. The strings
+ * in it point into the cache, which stays mapped until
+ * core_info_cache_free(). The string lists and all_ext are left
+ * for the caller to resolve. Returns NULL if the cache is stale. */
+core_info_list_t *core_info_cache_load(const char *path,
+      const char *modules_dir, const char *info_dir,
+      const struct string_list *cores);
+
+bool core_info_cache_save(const char *path,
+      const core_info_list_t *list,
+      const char *modules_dir, const char *info_dir);
+
+void core_info_cache_free(void *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,8 @@
 #include "gfx/video_thread_wrapper.h"
 #include "audio/audio_thread_wrapper.h"
 #include "gfx/gfx_common.h"
+#include "frame_pacing.h"
+#include "benchmark.h"
 
 #ifdef HAVE_X11
 #include "gfx/context/x11_common.h"
@@ -573,6 +575,13 @@ static void find_video_driver(void)
     //  RARCH_WARN("Frontend supports get_video_driver() but did not specify one.\n");
    } */
 
+   /* The headless benchmark always runs on the null driver. */
+   if (benchmark_enabled())
+   {
+      driver.video = &video_null;
+      return;
+   }
+
    driver.video = &video_gx;
   /* i = find_driver_index("video_driver", g_settings.video.driver);
    if (i >= 0)
@@ -769,14 +778,14 @@ bool driver_update_system_av_info(const struct retro_system_av_info *info)
 
    /* Cannot continue recording with different parameters.
     * Take the easiest route out and just restart the recording. */
-  /* if (driver.recording_data)
+   if (driver.recording_data)
    {
       static const char *msg = "Restarting recording due to driver reinit.";
       msg_queue_push(g_extern.msg_queue, msg, 2, 180);
       RARCH_WARN("%s\n", msg);
       rarch_main_command(RARCH_CMD_RECORD_DEINIT);
       rarch_main_command(RARCH_CMD_RECORD_INIT);
-   } */
+   }
 
    return true;
 }
@@ -891,7 +900,9 @@ static void init_audio(void)
 
    if (!rarch_resampler_realloc(&driver.resampler_data,
             &driver.resampler,
-         g_settings.audio.resampler, g_extern.audio_data.orig_src_ratio))
+         g_settings.audio.resampler,
+         (enum resampler_quality)g_settings.audio.resampler_quality,
+         g_extern.audio_data.orig_src_ratio))
    {
       RARCH_ERR("Failed to initialize resampler \"%s\".\n",
             g_settings.audio.resampler);
@@ -1001,7 +1012,8 @@ static void init_video_filter(enum retro_pixel_format colfmt)
    height  = geom->max_height;
 
    g_extern.filter.filter = rarch_softfilter_new(
-         g_settings.video.softfilter_plugin, colfmt, width, height);
+         g_settings.video.softfilter_plugin,
+         g_settings.video.filter_threads, colfmt, width, height);
 
    if (!g_extern.filter.filter)
    {
@@ -1228,6 +1240,7 @@ static void init_video_input(void)
    rarch_main_command(RARCH_CMD_OVERLAY_INIT);
 
    g_extern.measure_data.frame_time_samples_count = 0;
+   frame_pacing_reset();
 
    // Only do this once, for dummy to not show glowy garbage
    if (g_extern.libretro_dummy) {
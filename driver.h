@@ -105,6 +105,7 @@ enum
    RARCH_STATE_SLOT_PLUS,
    RARCH_STATE_SLOT_MINUS,
    RARCH_REWIND,
+   RARCH_MOVIE_RECORD_TOGGLE,
   // RARCH_PAUSE_TOGGLE,
   // RARCH_FRAMEADVANCE,
    RARCH_RESET,
@@ -412,6 +413,11 @@ typedef struct video_poke_interface
   // void (*grab_mouse_toggle)(void *data);
 
    struct gfx_shader *(*get_current_shader)(void *data);
+
+   /* Hands out a buffer the core can render the next frame into,
+    * for RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER. */
+   bool (*get_current_software_framebuffer)(void *data,
+         struct retro_framebuffer *framebuffer);
 } video_poke_interface_t;
 
 typedef struct video_driver
@@ -1037,6 +1037,14 @@ bool rarch_environment_cb(unsigned cmd, void *data)
          break;
       }
 
+      case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+         /* Can be called every frame, so no logging. */
+         if (!driver.video_poke ||
+               !driver.video_poke->get_current_software_framebuffer)
+            return false;
+         return driver.video_poke->get_current_software_framebuffer(
+               driver.video_data, (struct retro_framebuffer*)data);
+
       /* Private extensions for internal use, not part of libretro API. */
       case RETRO_ENVIRONMENT_SET_LIBRETRO_PATH:
          RARCH_LOG("Environ (Private) SET_LIBRETRO_PATH.\n");
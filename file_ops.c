@@ -74,6 +74,36 @@ bool write_file(const char *path, const void *data, size_t size)
    return ret;
 }
 
+/* Writes to a temporary file next to path and renames it over
+ * path, so a crash or a full disk never leaves a truncated file. */
+bool write_file_atomic(const char *path, const void *data, size_t size)
+{
+   bool ret = false;
+   char tmp_path[PATH_MAX];
+   FILE *file;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   file = fopen(tmp_path, "wb");
+   if (!file)
+      return false;
+
+   ret = fwrite(data, 1, size, file) == size;
+   ret = fflush(file) == 0 && ret;
+   ret = fclose(file) == 0 && ret;
+
+   if (ret && rename(tmp_path, path) != 0)
+   {
+      /* Win32 and libfat on GX refuse to rename over an existing
+       * file. Fall back to removing it first; a crash in between
+       * leaves the new data in tmp_path rather than a torn file. */
+      remove(path);
+      ret = rename(tmp_path, path) == 0;
+   }
+   if (!ret)
+      remove(tmp_path);
+   return ret;
+}
+
 bool write_empty_file(const char *path)
 {
    FILE *file = fopen(path, "w");
@@ -0,0 +1,358 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "frame_pacing.h"
+#include "performance.h"
+#include "general.h"
+#include "driver.h"
+#include "compat/strl.h"
+#ifdef HAVE_THREADS
+#include "gfx/video_thread_wrapper.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+
+/* 50 usec buckets up to ~51 ms, the last one catches the rest. */
+#define PACING_BUCKET_USEC 50
+#define PACING_BUCKETS 1024
+
+/* How often the overlay text is rebuilt, in frames. */
+#define PACING_TEXT_INTERVAL 30
+
+enum pacing_part
+{
+   PACING_CORE = 0,
+   PACING_VIDEO,
+   PACING_AUDIO,
+   PACING_AUDIO_BLOCKING,
+   PACING_INPUT,
+   PACING_OTHER,
+
+   PACING_PARTS
+};
+
+struct pacing_frame
+{
+   retro_time_t delta;
+   retro_time_t part[PACING_PARTS];
+   unsigned missed_refreshes;
+};
+
+static struct
+{
+   retro_time_t last;
+
+   struct pacing_frame window[FRAME_PACING_WINDOW];
+   unsigned ptr;
+   unsigned count;
+
+   /* Kept in step with the window as frames come and go. */
+   uint16_t buckets[PACING_BUCKETS];
+   retro_time_t delta_sum;
+   retro_time_t part_sum[PACING_PARTS];
+   unsigned missed;
+   unsigned missed_refreshes;
+
+   uint64_t total_frames;
+   uint64_t total_missed;
+
+   unsigned text_frames;
+   char text[2][128];
+} pacing;
+
+static unsigned pacing_bucket(retro_time_t delta)
+{
+   retro_time_t index = delta / PACING_BUCKET_USEC;
+   if (index < 0)
+      return 0;
+   return index < PACING_BUCKETS ? (unsigned)index : PACING_BUCKETS - 1;
+}
+
+static retro_time_t pacing_target(void)
+{
+   float refresh = g_settings.video.refresh_rate;
+   return (retro_time_t)(1000000.0f / (refresh > 0.0f ? refresh : 60.0f));
+}
+
+/* Refreshes beyond the first that a frame of this length took,
+ * or 0 if it made its deadline. Up to half a refresh late counts
+ * as jitter, not a miss. */
+static unsigned pacing_missed_refreshes(retro_time_t delta, retro_time_t target)
+{
+   if (delta * 2 <= target * 3)
+      return 0;
+   return (unsigned)((delta + target / 2) / target) - 1;
+}
+
+static void pacing_account(const struct pacing_frame *frame, int sign)
+{
+   unsigned i;
+
+   pacing.buckets[pacing_bucket(frame->delta)] += sign;
+   pacing.delta_sum += sign * frame->delta;
+   for (i = 0; i < PACING_PARTS; i++)
+      pacing.part_sum[i] += sign * frame->part[i];
+
+   if (frame->missed_refreshes)
+   {
+      pacing.missed           += sign;
+      pacing.missed_refreshes += sign * (int)frame->missed_refreshes;
+   }
+}
+
+static retro_time_t pacing_stage(enum rarch_perf_stage stage)
+{
+   const struct rarch_perf_stage_timer *timer =
+      &rarch_perf_stage_timers[stage];
+   return timer->ran ? timer->frame : 0;
+}
+
+void frame_pacing_frame(void)
+{
+   unsigned i;
+   retro_time_t now, accounted;
+   struct pacing_frame *frame;
+
+   /* Fast forward and slow motion aren't paced to the display, and
+    * the stage timers only run when someone is looking. */
+   if (!rarch_perf_stage_enabled() || driver.nonblock_state ||
+         g_extern.is_slowmotion ||
+         !rarch_perf_stage_timers[RARCH_PERF_STAGE_CORE_RUN].ran)
+   {
+      pacing.last = 0;
+      return;
+   }
+
+   now = rarch_get_time_usec();
+   if (!pacing.last)
+   {
+      pacing.last = now;
+      return;
+   }
+
+   frame = &pacing.window[pacing.ptr];
+   if (pacing.count == FRAME_PACING_WINDOW)
+      pacing_account(frame, -1);
+   else
+      pacing.count++;
+
+   frame->delta = now - pacing.last;
+   pacing.last  = now;
+
+   /* Video, audio and input are called from inside retro_run(). */
+   frame->part[PACING_VIDEO]          =
+      pacing_stage(RARCH_PERF_STAGE_VIDEO_FRAME) +
+      pacing_stage(RARCH_PERF_STAGE_SOFTFILTER);
+   frame->part[PACING_AUDIO]          = pacing_stage(RARCH_PERF_STAGE_AUDIO_FLUSH);
+   frame->part[PACING_AUDIO_BLOCKING] = pacing_stage(RARCH_PERF_STAGE_AUDIO_WRITE);
+   frame->part[PACING_INPUT]          = pacing_stage(RARCH_PERF_STAGE_INPUT_POLL);
+   frame->part[PACING_CORE]           = pacing_stage(RARCH_PERF_STAGE_CORE_RUN);
+
+   for (i = PACING_VIDEO; i < PACING_OTHER; i++)
+      frame->part[PACING_CORE] -= frame->part[i];
+   if (frame->part[PACING_CORE] < 0)
+      frame->part[PACING_CORE] = 0;
+
+   accounted = 0;
+   for (i = 0; i < PACING_OTHER; i++)
+      accounted += frame->part[i];
+   frame->part[PACING_OTHER] = frame->delta > accounted ?
+      frame->delta - accounted : 0;
+
+   frame->missed_refreshes = pacing_missed_refreshes(frame->delta,
+         pacing_target());
+
+   pacing_account(frame, 1);
+   pacing.ptr = (pacing.ptr + 1) % FRAME_PACING_WINDOW;
+
+   pacing.total_frames++;
+   if (frame->missed_refreshes)
+      pacing.total_missed++;
+}
+
+static retro_time_t pacing_percentile(unsigned percent, retro_time_t max)
+{
+   unsigned i, seen = 0;
+   unsigned target  = (pacing.count * percent + 99) / 100;
+   retro_time_t value;
+
+   for (i = 0; i < PACING_BUCKETS - 1; i++)
+   {
+      seen += pacing.buckets[i];
+      if (seen && seen >= target)
+         break;
+   }
+
+   /* Middle of the bucket, but never past what was seen. */
+   value = i * PACING_BUCKET_USEC + PACING_BUCKET_USEC / 2;
+   return value < max ? value : max;
+}
+
+void frame_pacing_get_stats(struct frame_pacing_stats *stats)
+{
+   unsigned i;
+
+   memset(stats, 0, sizeof(*stats));
+   stats->target       = pacing_target();
+   stats->total_frames = pacing.total_frames;
+   stats->total_missed = pacing.total_missed;
+
+   if (!pacing.count)
+      return;
+
+   for (i = 0; i < pacing.count; i++)
+      if (pacing.window[i].delta > stats->max)
+         stats->max = pacing.window[i].delta;
+
+   stats->frames           = pacing.count;
+   stats->fps              = pacing.delta_sum ?
+      1000000.0f * pacing.count / pacing.delta_sum : 0.0f;
+   stats->p50              = pacing_percentile(50, stats->max);
+   stats->p99              = pacing_percentile(99, stats->max);
+   stats->missed           = pacing.missed;
+   stats->missed_refreshes = pacing.missed_refreshes;
+
+   stats->core           = pacing.part_sum[PACING_CORE] / pacing.count;
+   stats->video          = pacing.part_sum[PACING_VIDEO] / pacing.count;
+   stats->audio          = pacing.part_sum[PACING_AUDIO] / pacing.count;
+   stats->audio_blocking = pacing.part_sum[PACING_AUDIO_BLOCKING] / pacing.count;
+   stats->input          = pacing.part_sum[PACING_INPUT] / pacing.count;
+   stats->other          = pacing.part_sum[PACING_OTHER] / pacing.count;
+}
+
+#define PACING_MS(usec) ((usec) / 1000.0f)
+
+void frame_pacing_get_text(char *line1, size_t line1_size,
+      char *line2, size_t line2_size)
+{
+   if (pacing.text_frames == 0 || !*pacing.text[0])
+   {
+      struct frame_pacing_stats stats;
+      frame_pacing_get_stats(&stats);
+
+      if (stats.frames)
+      {
+         snprintf(pacing.text[0], sizeof(pacing.text[0]),
+               "Frame: %.1f/%.1f/%.1f ms, missed %u (%u)",
+               PACING_MS(stats.p50), PACING_MS(stats.p99),
+               PACING_MS(stats.max), stats.missed, stats.missed_refreshes);
+         snprintf(pacing.text[1], sizeof(pacing.text[1]),
+               "C %.1f V %.1f A %.1f+%.1f I %.1f O %.1f",
+               PACING_MS(stats.core), PACING_MS(stats.video),
+               PACING_MS(stats.audio), PACING_MS(stats.audio_blocking),
+               PACING_MS(stats.input), PACING_MS(stats.other));
+      }
+      else
+      {
+         strlcpy(pacing.text[0], "Frame: N/A", sizeof(pacing.text[0]));
+         *pacing.text[1] = '\0';
+      }
+   }
+   pacing.text_frames = (pacing.text_frames + 1) % PACING_TEXT_INTERVAL;
+
+   strlcpy(line1, pacing.text[0], line1_size);
+   strlcpy(line2, pacing.text[1], line2_size);
+}
+
+bool frame_pacing_dump(const char *path)
+{
+   unsigned i;
+   char line[256];
+   struct frame_pacing_stats stats;
+   FILE *file = NULL;
+
+   if (path && *path)
+   {
+      file = fopen(path, "w");
+      if (!file)
+      {
+         RARCH_ERR("[Pacing]: Could not open \"%s\" for writing.\n", path);
+         return false;
+      }
+   }
+
+#define PACING_PRINT(...) do { \
+      snprintf(line, sizeof(line), __VA_ARGS__); \
+      if (file) \
+         fputs(line, file); \
+      else \
+         RARCH_LOG("[Pacing]: %s", line); \
+   } while (0)
+
+   frame_pacing_get_stats(&stats);
+
+   PACING_PRINT("Last %u frames, target %.3f ms (%.3f Hz).\n", stats.frames,
+         PACING_MS(stats.target), g_settings.video.refresh_rate);
+   PACING_PRINT("FPS %.3f, frame time p50 %.3f, p99 %.3f, max %.3f ms.\n",
+         stats.fps, PACING_MS(stats.p50), PACING_MS(stats.p99),
+         PACING_MS(stats.max));
+   PACING_PRINT("Missed %u frames, %u refreshes; %llu of %llu frames since reset.\n",
+         stats.missed, stats.missed_refreshes,
+         (unsigned long long)stats.total_missed,
+         (unsigned long long)stats.total_frames);
+   PACING_PRINT("Per frame: core %.3f, video %.3f, audio %.3f, "
+         "audio blocking %.3f, input %.3f, other %.3f ms.\n",
+         PACING_MS(stats.core), PACING_MS(stats.video),
+         PACING_MS(stats.audio), PACING_MS(stats.audio_blocking),
+         PACING_MS(stats.input), PACING_MS(stats.other));
+   PACING_PRINT("Rate control %s, vsync %s, audio sync %s.\n",
+         g_settings.audio.rate_control ? "on" : "off",
+         g_settings.video.vsync ? "on" : "off",
+         g_settings.audio.sync ? "on" : "off");
+
+#ifdef HAVE_THREADS
+   if (g_settings.video.threaded && driver.video_data &&
+         !g_extern.system.hw_render_callback.context_type)
+   {
+      struct thread_video_stats thread_stats;
+      rarch_threaded_video_get_stats(&thread_stats);
+      PACING_PRINT("Threaded video: %u frames, %u dropped, %u zero copy, "
+            "copy %.3f ms max.\n", thread_stats.frames,
+            thread_stats.dropped, thread_stats.zero_copy,
+            PACING_MS(thread_stats.copy_max));
+   }
+#endif
+
+   for (i = 0; i < PACING_BUCKETS; i++)
+   {
+      if (!pacing.buckets[i])
+         continue;
+
+      if (i == PACING_BUCKETS - 1)
+         PACING_PRINT("  >= %6.2f ms: %u\n",
+               PACING_MS((retro_time_t)i * PACING_BUCKET_USEC),
+               pacing.buckets[i]);
+      else
+         PACING_PRINT("  %6.2f - %6.2f ms: %u\n",
+               PACING_MS((retro_time_t)i * PACING_BUCKET_USEC),
+               PACING_MS((retro_time_t)(i + 1) * PACING_BUCKET_USEC),
+               pacing.buckets[i]);
+   }
+
+#undef PACING_PRINT
+
+   if (file)
+   {
+      fclose(file);
+      RARCH_LOG("[Pacing]: Frame pacing written to \"%s\".\n", path);
+   }
+
+   return true;
+}
+
+void frame_pacing_reset(void)
+{
+   memset(&pacing, 0, sizeof(pacing));
+}
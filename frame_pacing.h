@@ -0,0 +1,89 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FRAME_PACING_H
+#define __FRAME_PACING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+#include "libretro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frame pacing analyzer. Keeps the time between consecutive core
+ * frames for the last FRAME_PACING_WINDOW frames, in a histogram
+ * that is updated as frames come and go, counts frames that
+ * missed a refresh, and splits the frame time into core, video,
+ * audio and audio blocking using the perf stage timers.
+ *
+ * Times are in microseconds. */
+
+#define FRAME_PACING_WINDOW 600
+
+struct frame_pacing_stats
+{
+   /* Over the window. */
+   unsigned frames;
+   float fps;
+   retro_time_t target;
+   retro_time_t p50;
+   retro_time_t p99;
+   retro_time_t max;
+
+   /* Frames over 1.5 refreshes, and how many refreshes they
+    * took beyond the one they had. */
+   unsigned missed;
+   unsigned missed_refreshes;
+
+   /* Average per frame. core is the core's own time, without
+    * the callbacks below; other is what's left of the frame. */
+   retro_time_t core;
+   retro_time_t video;
+   retro_time_t audio;
+   retro_time_t audio_blocking;
+   retro_time_t input;
+   retro_time_t other;
+
+   /* Since the last reset. */
+   uint64_t total_frames;
+   uint64_t total_missed;
+};
+
+/* Call once per main loop iteration, before rarch_perf_frame_end().
+ * Only iterations that ran the core count; anything else (menu,
+ * pause) starts the next delta afresh. */
+void frame_pacing_frame(void);
+
+void frame_pacing_get_stats(struct frame_pacing_stats *stats);
+
+/* Two short lines for the on-screen overlay, refreshed every
+ * few frames so drawing it costs next to nothing. */
+void frame_pacing_get_text(char *line1, size_t line1_size,
+      char *line2, size_t line2_size);
+
+/* Writes the stats and the delta histogram to path, or to the
+ * log if path is NULL or empty. */
+bool frame_pacing_dump(const char *path);
+
+void frame_pacing_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,6 +18,10 @@
 #include "../driver.h"
 #include "frontend.h"
 #include "../general.h"
+#include "../content.h"
+#include "../frame_pacing.h"
+#include "../benchmark.h"
+#include "../gfx/rpng/rpng.h"
 #include <file/file_path.h>
 
 #ifdef USE_TITLE
@@ -135,10 +139,19 @@ void main_exit(args_type() args)
       /* Do not want menu context to live any more. */
       driver.menu_data_own = false;
 #endif
+      rarch_bsv_movie_deinit();
       rarch_main_deinit();
    }
 
-  // rarch_main_command(RARCH_CMD_PERFCNT_REPORT_FRONTEND_LOG);
+   /* Let queued savestate and SRAM writes reach the disk. */
+   deinit_save_queue();
+#if defined(HAVE_ZLIB_DEFLATE) && defined(HAVE_THREADS)
+   rpng_save_image_wait();
+#endif
+
+   rarch_main_command(RARCH_CMD_PERFCNT_REPORT_FRONTEND_LOG);
+   if (g_settings.frame_pacing_show)
+      frame_pacing_dump(NULL);
 
 #if defined(HAVE_LOGGER) && !defined(ANDROID)
    logger_shutdown();
@@ -264,7 +277,10 @@ bool main_load_content(int argc, char **argv, args_type() args,
    }
 
    if (g_extern.main_is_init)
+   {
+      rarch_bsv_movie_deinit();
       rarch_main_deinit();
+   }
 
    if ((ret = rarch_main_init(*rarch_argc_ptr, rarch_argv_ptr)))
    {
@@ -272,6 +288,13 @@ bool main_load_content(int argc, char **argv, args_type() args,
       goto error;
    }
 
+   /* Needs the content loaded, and for a seek the drivers. */
+   if (!rarch_bsv_movie_init())
+   {
+      retval = false;
+      goto error;
+   }
+
    rarch_main_command(RARCH_CMD_RESUME);
 
    if (process_args)
@@ -301,12 +324,18 @@ returntype main_entry(signature())
 
    rarch_main_state_new();
 
+   benchmark_parse_args(&argc, argv);
+   bsv_movie_parse_args(&argc, argv);
+
    if (driver.frontend_ctx)
    {
       if (!(ret = (main_load_content(argc, argv, args,
          driver.frontend_ctx->environment_get,
          driver.frontend_ctx->process_args))))
       {
+         /* CI has to see a benchmark that never ran. */
+         if (benchmark_enabled())
+            ret = EXIT_FAILURE;
          return_var(ret);
       }
    }
@@ -325,6 +354,13 @@ returntype main_entry(signature())
    }
 
 #if defined(HAVE_MAIN_LOOP)
+   if (benchmark_enabled())
+   {
+      ret = benchmark_run();
+      main_exit(args);
+      return_var(ret);
+   }
+
    while (main_entry_decide(signature_expand(), args) != -1);
 
    main_exit(args);
@@ -1048,7 +1048,7 @@ static int deferred_push_core_information(void *data, void *userdata,
    info = (core_info_t*)g_extern.core_info_current;
    menu_list_clear(list);
 
-   if (info->data)
+   if (info->has_info)
    {
       char tmp[PATH_MAX];
 
@@ -26,6 +26,7 @@
 #include "rewind.h"
 #include "movie.h"
 #include "autosave.h"
+#include "save_queue.h"
 //#include "cheats.h"
 #include "audio/dsp_filter.h"
 #include <compat/strl.h>
@@ -153,8 +154,8 @@ enum basic_event
    //RARCH_CMD_NETPLAY_INIT,
    //RARCH_CMD_NETPLAY_DEINIT,
    //RARCH_CMD_NETPLAY_FLIP_PLAYERS,
-   //RARCH_CMD_BSV_MOVIE_INIT,
-   //RARCH_CMD_BSV_MOVIE_DEINIT,
+   RARCH_CMD_BSV_MOVIE_INIT,
+   RARCH_CMD_BSV_MOVIE_DEINIT,
    RARCH_CMD_COMMAND_INIT,
    RARCH_CMD_COMMAND_DEINIT,
    RARCH_CMD_DRIVERS_DEINIT,
@@ -292,6 +293,7 @@ struct settings
       bool shader_enable;
 
       char softfilter_plugin[PATH_MAX];
+      unsigned filter_threads;
       float refresh_rate;
       bool threaded;
 
@@ -370,6 +372,7 @@ struct settings
       float rate_control_delta;
       float volume; /* dB scale. */
       char resampler[32];
+      unsigned resampler_quality;
 	  unsigned sinc_taps;
 	  //unsigned mute_frames;
    } audio;
@@ -418,7 +421,7 @@ struct settings
       unsigned device[MAX_PLAYERS];
       char device_names[MAX_PLAYERS][64];
       bool autodetect_enable;
-    //  bool netplay_client_swap_input;
+      bool netplay_client_swap_input;
       bool home_should_exit;
       bool rgui_reset;
       //GameCube Controller switch
@@ -460,6 +463,7 @@ struct settings
    bool single_mode;
 
    char core_options_path[PATH_MAX];
+   char perfcnt_export_path[PATH_MAX];
    char content_history_path[PATH_MAX];
    unsigned content_history_size;
 
@@ -482,6 +486,8 @@ struct settings
    size_t rewind_buffer_size;
    unsigned rewind_granularity;
 
+   unsigned movie_keyframe_interval;
+
    float slowmotion_ratio;
    float fastforward_ratio;
    bool fastforward_ratio_throttle_enable;
@@ -512,6 +518,7 @@ struct settings
    bool menu_show_start_screen;
 #endif
    bool fps_show;
+   bool frame_pacing_show;
    bool load_dummy_on_core_shutdown;
    bool clock_show;
    bool fadein;
@@ -781,6 +788,9 @@ struct global
    autosave_t **autosave;
    unsigned num_autosave;
 
+   /* Background savestate/SRAM writes, created on first save. */
+   save_queue_t *save_queue;
+
 #ifdef HAVE_NETPLAY
    /* Netplay. */
    char netplay_server[PATH_MAX];
@@ -23,6 +23,47 @@
 #include "../performance.h"
 #include <stdlib.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+struct filter_thread_data
+{
+   sthread_t *thread;
+   const struct softfilter_work_packet *packet;
+   scond_t *cond;
+   slock_t *lock;
+   void *userdata;
+   bool done;
+   bool die;
+};
+
+static void filter_thread_loop(void *data)
+{
+   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+
+   for (;;)
+   {
+      bool die;
+
+      slock_lock(thr->lock);
+      while (thr->done && !thr->die)
+         scond_wait(thr->cond, thr->lock);
+      die = thr->die;
+      slock_unlock(thr->lock);
+
+      if (die)
+         break;
+
+      thr->packet->work(thr->userdata, thr->packet->thread_data);
+
+      slock_lock(thr->lock);
+      thr->done = true;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+}
+#endif
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
@@ -31,22 +72,102 @@ struct rarch_soft_plug
    const struct softfilter_implementation *impl;
 };
 
-struct rarch_softfilter
+struct rarch_softfilter_stage
 {
-   config_file_t *conf;
-
    const struct softfilter_implementation *impl;
    void *impl_data;
 
+   enum retro_pixel_format in_pix_fmt, out_pix_fmt;
+   unsigned max_width, max_height; /* Max output size of this stage. */
+
+   struct softfilter_work_packet *packets;
+   unsigned threads;
+};
+
+struct rarch_softfilter
+{
+   config_file_t *conf;
+
    struct rarch_soft_plug *plugs;
    unsigned num_plugs;
 
+   struct rarch_softfilter_stage *stages;
+   unsigned num_stages;
+
    unsigned max_width, max_height;
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
-   struct softfilter_work_packet *packets;
+   /* Intermediate frames ping-pong between these. 
+    * Only allocated for chains with more than one stage. */
+   void *buffer[2];
+   size_t buffer_size;
+
+   unsigned threads;
+#ifdef HAVE_THREADS
+   /* Worker i runs packets[i + 1] of the current stage.
+    * Packet 0 always runs on the calling thread. */
+   struct filter_thread_data *thread_data;
+#endif
 };
 
+/* Intermediate buffers are aligned to this, 
+ * and so is the pitch of every intermediate frame. */
+#define SOFTFILTER_BUFFER_ALIGN 64
+
+static void *softfilter_aligned_alloc__(size_t boundary, size_t size)
+{
+   void **place;
+   uintptr_t addr = 0;
+   void *ptr = malloc(boundary + size + sizeof(uintptr_t));
+
+   if (!ptr)
+      return NULL;
+
+   addr           = ((uintptr_t)ptr + sizeof(uintptr_t) + boundary) 
+                    & ~(boundary - 1);
+   place          = (void**)addr;
+   place[-1]      = ptr;
+
+   return (void*)addr;
+}
+
+static void softfilter_aligned_free__(void *ptr)
+{
+   void **p = (void**)ptr;
+   if (p)
+      free(p[-1]);
+}
+
+static unsigned softfilter_fmt_from_pix_fmt(enum retro_pixel_format fmt)
+{
+   switch (fmt)
+   {
+      case RETRO_PIXEL_FORMAT_XRGB8888:
+         return SOFTFILTER_FMT_XRGB8888;
+      case RETRO_PIXEL_FORMAT_RGB565:
+         return SOFTFILTER_FMT_RGB565;
+      default:
+         break;
+   }
+
+   return SOFTFILTER_FMT_NONE;
+}
+
+static enum retro_pixel_format softfilter_pix_fmt_from_fmt(unsigned fmt)
+{
+   return fmt == SOFTFILTER_FMT_XRGB8888 ?
+      RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+}
+
+static size_t softfilter_stage_pitch(
+      const struct rarch_softfilter_stage *stage, unsigned width)
+{
+   size_t bpp = stage->out_pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888 ?
+      sizeof(uint32_t) : sizeof(uint16_t);
+   return (width * bpp + SOFTFILTER_BUFFER_ALIGN - 1) &
+      ~(size_t)(SOFTFILTER_BUFFER_ALIGN - 1);
+}
+
 static const struct softfilter_implementation *
 softfilter_find_implementation(rarch_softfilter_t *filt, const char *ident)
 {
@@ -69,85 +190,222 @@ static const struct softfilter_config softfilter_config = {
    config_userdata_free,
 };
 
+/* Picks the output format of a stage.
+ * Keeps the input format if possible, otherwise 
+ * prefers a format the next stage can take directly,
+ * so no stage ever has to convert between formats. */
+static unsigned softfilter_negotiate_output(
+      const struct softfilter_implementation *impl,
+      const struct softfilter_implementation *next,
+      unsigned input_fmt)
+{
+   unsigned output_fmts = impl->query_output_formats(input_fmt);
+
+   if (next)
+      output_fmts &= next->query_input_formats();
+
+   if (output_fmts & input_fmt)
+      return input_fmt;
+   if (output_fmts & SOFTFILTER_FMT_XRGB8888)
+      return SOFTFILTER_FMT_XRGB8888;
+   if (output_fmts & SOFTFILTER_FMT_RGB565)
+      return SOFTFILTER_FMT_RGB565;
+
+   return SOFTFILTER_FMT_NONE;
+}
+
 static bool create_softfilter_graph(rarch_softfilter_t *filt,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts;
-   char key[64];
-   struct config_file_userdata userdata;
+   unsigned i, input_fmt, num_stages = 0;
+   unsigned stage_width = max_width, stage_height = max_height;
+   bool chained = config_get_uint(filt->conf, "filters", &num_stages);
 
-   snprintf(key, sizeof(key), "filter");
+   /* Legacy configs name a single filter with "filter". */
+   if (!chained)
+      num_stages = 1;
 
-   char name[64];
-   if (!config_get_array(filt->conf, key, name, sizeof(name)))
+   if (!num_stages)
+   {
+      RARCH_ERR("[SoftFilter]: Filter chain is empty.\n");
       return false;
+   }
 
-   filt->impl = softfilter_find_implementation(filt, name);
-   if (!filt->impl)
+   filt->stages = (struct rarch_softfilter_stage*)
+      calloc(num_stages, sizeof(*filt->stages));
+   if (!filt->stages)
       return false;
+   filt->num_stages = num_stages;
 
-   userdata.conf = filt->conf;
-   /* Index-specific configs take priority over ident-specific. */
-   userdata.prefix[0] = key; 
-   userdata.prefix[1] = filt->impl->short_ident;
+   /* Resolve all stages first, format negotiation needs lookahead. */
+   for (i = 0; i < num_stages; i++)
+   {
+      char key[64], name[64];
 
-   /* Simple assumptions. */
-   filt->pix_fmt = in_pixel_format;
-   input_fmts = filt->impl->query_input_formats();
+      if (chained)
+         snprintf(key, sizeof(key), "filter%u", i);
+      else
+         strlcpy(key, "filter", sizeof(key));
 
-   switch (in_pixel_format)
-   {
-      case RETRO_PIXEL_FORMAT_XRGB8888:
-         input_fmt = SOFTFILTER_FMT_XRGB8888;
-         break;
-      case RETRO_PIXEL_FORMAT_RGB565:
-         input_fmt = SOFTFILTER_FMT_RGB565;
-         break;
-      default:
+      if (!config_get_array(filt->conf, key, name, sizeof(name)))
+      {
+         RARCH_ERR("[SoftFilter]: Missing \"%s\" in config.\n", key);
+         return false;
+      }
+
+      filt->stages[i].impl = softfilter_find_implementation(filt, name);
+      if (!filt->stages[i].impl)
+      {
+         RARCH_ERR("[SoftFilter]: Could not find filter \"%s\".\n", name);
          return false;
+      }
    }
 
-   if (!(input_fmt & input_fmts))
-   {
-      RARCH_ERR("Softfilter does not support input format.\n");
+   filt->pix_fmt    = in_pixel_format;
+   filt->max_width  = max_width;
+   filt->max_height = max_height;
+
+   input_fmt = softfilter_fmt_from_pix_fmt(in_pixel_format);
+   if (input_fmt == SOFTFILTER_FMT_NONE)
       return false;
-   }
 
-   output_fmts = filt->impl->query_output_formats(input_fmt);
-   /* If we have a match of input/output formats, use that. */
-   if (output_fmts & input_fmt)
-      filt->out_pix_fmt = in_pixel_format;
-   else if (output_fmts & SOFTFILTER_FMT_XRGB8888)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_XRGB8888;
-   else if (output_fmts & SOFTFILTER_FMT_RGB565)
-      filt->out_pix_fmt = RETRO_PIXEL_FORMAT_RGB565;
-   else
+   for (i = 0; i < num_stages; i++)
    {
-      RARCH_ERR("Did not find suitable output format for softfilter.\n");
-      return false;
+      char key[64];
+      unsigned output_fmt;
+      struct config_file_userdata userdata;
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+      const struct softfilter_implementation *next = 
+         (i + 1 < num_stages) ? filt->stages[i + 1].impl : NULL;
+
+      if (!(input_fmt & stage->impl->query_input_formats()))
+      {
+         RARCH_ERR("Softfilter does not support input format.\n");
+         return false;
+      }
+
+      output_fmt = softfilter_negotiate_output(stage->impl, next, input_fmt);
+      if (output_fmt == SOFTFILTER_FMT_NONE)
+      {
+         if (next)
+            RARCH_ERR("[SoftFilter]: Stage %u (%s) cannot feed stage %u (%s).\n",
+                  i, stage->impl->short_ident, i + 1, next->short_ident);
+         else
+            RARCH_ERR("Did not find suitable output format for softfilter.\n");
+         return false;
+      }
+
+      stage->in_pix_fmt  = softfilter_pix_fmt_from_fmt(input_fmt);
+      stage->out_pix_fmt = softfilter_pix_fmt_from_fmt(output_fmt);
+
+      if (chained)
+         snprintf(key, sizeof(key), "filter%u", i);
+      else
+         strlcpy(key, "filter", sizeof(key));
+
+      userdata.conf = filt->conf;
+      /* Index-specific configs take priority over ident-specific. */
+      userdata.prefix[0] = key; 
+      userdata.prefix[1] = stage->impl->short_ident;
+
+      stage->impl_data = stage->impl->create(
+            &softfilter_config, input_fmt, output_fmt,
+            stage_width, stage_height,
+            threads, cpu_features, &userdata);
+      if (!stage->impl_data)
+      {
+         RARCH_ERR("Failed to create softfilter state.\n");
+         return false;
+      }
+
+      /* Filters which are not thread-safe clamp this to 1. */
+      stage->threads = stage->impl->query_num_threads(stage->impl_data);
+      if (!stage->threads)
+      {
+         RARCH_ERR("Invalid number of threads.\n");
+         return false;
+      }
+
+      stage->packets = (struct softfilter_work_packet*)
+         calloc(stage->threads, sizeof(*stage->packets));
+      if (!stage->packets)
+      {
+         RARCH_ERR("Failed to allocate softfilter packets.\n");
+         return false;
+      }
+
+      stage->impl->query_output_size(stage->impl_data,
+            &stage->max_width, &stage->max_height,
+            stage_width, stage_height);
+
+      /* The last stage writes straight into the caller's buffer. */
+      if (next)
+      {
+         size_t size = softfilter_stage_pitch(stage, stage->max_width)
+            * stage->max_height;
+         if (size > filt->buffer_size)
+            filt->buffer_size = size;
+      }
+
+      RARCH_LOG("[SoftFilter]: Stage %u: %s, %s -> %s, %u thread(s).\n",
+            i, stage->impl->ident,
+            input_fmt  == SOFTFILTER_FMT_XRGB8888 ? "XRGB8888" : "RGB565",
+            output_fmt == SOFTFILTER_FMT_XRGB8888 ? "XRGB8888" : "RGB565",
+            stage->threads);
+
+      if (stage->threads > filt->threads)
+         filt->threads = stage->threads;
+
+      input_fmt    = output_fmt;
+      stage_width  = stage->max_width;
+      stage_height = stage->max_height;
    }
 
-   filt->max_width = max_width;
-   filt->max_height = max_height;
+   filt->out_pix_fmt = filt->stages[num_stages - 1].out_pix_fmt;
 
-   filt->impl_data = filt->impl->create(
-         &softfilter_config, input_fmt, input_fmt, max_width, max_height, 1, cpu_features, &userdata);
-   //filt->impl_data = filt->impl->create(input_fmt, input_fmt, max_width, max_height, 1, cpu_features);
-   if (!filt->impl_data)
+   if (filt->buffer_size)
    {
-      RARCH_ERR("Failed to create softfilter state.\n");
-      return false;
+      for (i = 0; i < 2; i++)
+      {
+         filt->buffer[i] = softfilter_aligned_alloc__(
+               SOFTFILTER_BUFFER_ALIGN, filt->buffer_size);
+         if (!filt->buffer[i])
+         {
+            RARCH_ERR("Failed to allocate softfilter buffers.\n");
+            return false;
+         }
+      }
    }
 
-   filt->packets = (struct softfilter_work_packet*)calloc(1, sizeof(*filt->packets));
-   if (!filt->packets)
+#ifdef HAVE_THREADS
+   if (filt->threads > 1)
    {
-      RARCH_ERR("Failed to allocate softfilter packets.\n");
-      return false;
+      filt->thread_data = (struct filter_thread_data*)
+         calloc(filt->threads - 1, sizeof(*filt->thread_data));
+      if (!filt->thread_data)
+         return false;
+
+      for (i = 0; i < filt->threads - 1; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i];
+
+         thr->done = true;
+
+         thr->lock = slock_new();
+         if (!thr->lock)
+            return false;
+         thr->cond = scond_new();
+         if (!thr->cond)
+            return false;
+         thr->thread = sthread_create(filter_thread_loop, thr);
+         if (!thr->thread)
+            return false;
+      }
    }
+#endif
 
    return true;
 }
@@ -267,7 +525,7 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt)
 #endif
 
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
-     // unsigned threads,
+      unsigned threads,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height)
 {
@@ -305,8 +563,18 @@ rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
       goto error;
 #endif
 
+#ifdef HAVE_THREADS
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+   {
+      threads = rarch_get_cpu_cores();
+      RARCH_LOG("[SoftFilter]: Automatic threads: %u.\n", threads);
+   }
+#else
+   threads = 1;
+#endif
+
    if (!create_softfilter_graph(filt, in_pixel_format,
-            max_width, max_height, cpu_features, 1))
+            max_width, max_height, cpu_features, threads))
       goto error;
 
    return filt;
@@ -319,15 +587,50 @@ error:
 
 void rarch_softfilter_free(rarch_softfilter_t *filt)
 {
- //  unsigned i = 0;
-//   (void)i;
+   unsigned i = 0;
 
    if (!filt)
       return;
 
-   free(filt->packets);
-   if (filt->impl && filt->impl_data)
-      filt->impl->destroy(filt->impl_data);
+#ifdef HAVE_THREADS
+   if (filt->thread_data)
+   {
+      for (i = 0; i < filt->threads - 1; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i];
+
+         if (thr->thread)
+         {
+            slock_lock(thr->lock);
+            thr->die = true;
+            scond_signal(thr->cond);
+            slock_unlock(thr->lock);
+            sthread_join(thr->thread);
+         }
+         if (thr->lock)
+            slock_free(thr->lock);
+         if (thr->cond)
+            scond_free(thr->cond);
+      }
+      free(filt->thread_data);
+   }
+#endif
+
+   if (filt->stages)
+   {
+      for (i = 0; i < filt->num_stages; i++)
+      {
+         struct rarch_softfilter_stage *stage = &filt->stages[i];
+
+         free(stage->packets);
+         if (stage->impl && stage->impl_data)
+            stage->impl->destroy(stage->impl_data);
+      }
+      free(filt->stages);
+   }
+
+   softfilter_aligned_free__(filt->buffer[0]);
+   softfilter_aligned_free__(filt->buffer[1]);
 
 #ifdef HAVE_DYLIB
    for (i = 0; i < filt->num_plugs; i++)
@@ -335,8 +638,11 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
       if (filt->plugs[i].lib)
          dylib_close(filt->plugs[i].lib);
    }
-   free(filt->plugs);
 #endif
+   free(filt->plugs);
+
+   if (filt->conf)
+      config_file_free(filt->conf);
 
    free(filt);
 }
@@ -352,9 +658,20 @@ void rarch_softfilter_get_output_size(rarch_softfilter_t *filt,
       unsigned *out_width, unsigned *out_height,
       unsigned width, unsigned height)
 {
-   if (filt && filt->impl && filt->impl->query_output_size)
-      filt->impl->query_output_size(filt->impl_data, out_width,
-            out_height, width, height);
+   unsigned i;
+
+   if (!filt || !filt->stages)
+      return;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      const struct rarch_softfilter_stage *stage = &filt->stages[i];
+
+      stage->impl->query_output_size(stage->impl_data,
+            out_width, out_height, width, height);
+      width  = *out_width;
+      height = *out_height;
+   }
 }
 
 enum retro_pixel_format rarch_softfilter_get_output_format(
@@ -363,18 +680,81 @@ enum retro_pixel_format rarch_softfilter_get_output_format(
    return filt->out_pix_fmt;
 }
 
-void rarch_softfilter_process(rarch_softfilter_t *filt,
+static void softfilter_run_stage(rarch_softfilter_t *filt,
+      struct rarch_softfilter_stage *stage,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   //unsigned i;
+   unsigned i;
+
+   /* Each packet covers a horizontal band of the frame. */
+   stage->impl->get_work_packets(stage->impl_data, stage->packets,
+         output, output_stride, input, width, height, input_stride);
+
+#ifdef HAVE_THREADS
+   /* Fire off workers for bands 1..N-1. */
+   for (i = 1; i < stage->threads; i++)
+   {
+      struct filter_thread_data *thr = &filt->thread_data[i - 1];
+
+      slock_lock(thr->lock);
+      thr->packet   = &stage->packets[i];
+      thr->userdata = stage->impl_data;
+      thr->done     = false;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+
+   stage->packets[0].work(stage->impl_data, stage->packets[0].thread_data);
 
-   if (filt && filt->impl && filt->impl->get_work_packets)
+   /* Wait for workers. */
+   for (i = 1; i < stage->threads; i++)
    {
-      filt->impl->get_work_packets(filt->impl_data, filt->packets,
-            output, output_stride, input, width, height, input_stride);
+      struct filter_thread_data *thr = &filt->thread_data[i - 1];
 
-      filt->packets->work(filt->impl_data, filt->packets->thread_data);
+      slock_lock(thr->lock);
+      while (!thr->done)
+         scond_wait(thr->cond, thr->lock);
+      slock_unlock(thr->lock);
    }
+#else
+   for (i = 0; i < stage->threads; i++)
+      stage->packets[i].work(stage->impl_data, stage->packets[i].thread_data);
+#endif
 }
 
+void rarch_softfilter_process(rarch_softfilter_t *filt,
+      void *output, size_t output_stride,
+      const void *input, unsigned width, unsigned height, size_t input_stride)
+{
+   unsigned i;
+
+   if (!filt || !filt->stages)
+      return;
+
+   for (i = 0; i < filt->num_stages; i++)
+   {
+      struct rarch_softfilter_stage *stage = &filt->stages[i];
+      unsigned out_width  = 0;
+      unsigned out_height = 0;
+      void *out_data      = output;
+      size_t out_stride   = output_stride;
+
+      stage->impl->query_output_size(stage->impl_data,
+            &out_width, &out_height, width, height);
+
+      if (i + 1 < filt->num_stages)
+      {
+         out_data   = filt->buffer[i & 1];
+         out_stride = softfilter_stage_pitch(stage, out_width);
+      }
+
+      softfilter_run_stage(filt, stage, out_data, out_stride,
+            input, width, height, input_stride);
+
+      input        = out_data;
+      input_stride = out_stride;
+      width        = out_width;
+      height       = out_height;
+   }
+}
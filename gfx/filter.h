@@ -21,9 +21,19 @@
 
 #include "filters/softfilter.h"
 
+#define RARCH_SOFTFILTER_THREADS_AUTO 0
+
 typedef struct rarch_softfilter rarch_softfilter_t;
 
+/* filter_path: .filt config. Either names a single filter with
+ * "filter = ident", or a chain with "filters = N" followed by
+ * "filter0" .. "filter<N-1>", run in order.
+ *
+ * threads: number of horizontal bands processed in parallel,
+ * or RARCH_SOFTFILTER_THREADS_AUTO to use one per CPU core.
+ * Filters which are not thread-safe may use fewer. */
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_path,
+      unsigned threads,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height);
 
@@ -19,6 +19,13 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation darken_get_implementation
 #define softfilter_thread_data darken_softfilter_thread_data
@@ -43,8 +50,13 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_work_t work_xrgb8888;
+   softfilter_work_t work_rgb565;
 };
 
+#define DARKEN_MASK_XRGB8888 (0x3f * 0x01010101)
+#define DARKEN_MASK_RGB565   ((0x7 << 0) | (0xf << 5) | (0x7 << 11))
+
 static unsigned darken_input_fmts(void)
 {
    return SOFTFILTER_FMT_XRGB8888 | SOFTFILTER_FMT_RGB565;
@@ -61,12 +73,22 @@ static unsigned darken_threads(void *data)
    return filt->threads;
 }
 
+static void darken_work_cb_xrgb8888(void *data, void *thread_data);
+static void darken_work_cb_rgb565(void *data, void *thread_data);
+#if defined(__SSE2__)
+static void darken_work_cb_xrgb8888_sse2(void *data, void *thread_data);
+static void darken_work_cb_rgb565_sse2(void *data, void *thread_data);
+#endif
+#if defined(__AVX2__)
+static void darken_work_cb_xrgb8888_avx2(void *data, void *thread_data);
+static void darken_work_cb_rgb565_avx2(void *data, void *thread_data);
+#endif
+
 static void *darken_create(const struct softfilter_config *config,
       unsigned in_fmt, unsigned out_fmt,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -82,6 +104,24 @@ static void *darken_create(const struct softfilter_config *config,
       free(filt);
       return NULL;
    }
+
+   filt->work_xrgb8888 = darken_work_cb_xrgb8888;
+   filt->work_rgb565   = darken_work_cb_rgb565;
+#if defined(__AVX2__)
+   if (simd & SOFTFILTER_SIMD_AVX2)
+   {
+      filt->work_xrgb8888 = darken_work_cb_xrgb8888_avx2;
+      filt->work_rgb565   = darken_work_cb_rgb565_avx2;
+   }
+   else
+#endif
+#if defined(__SSE2__)
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->work_xrgb8888 = darken_work_cb_xrgb8888_sse2;
+      filt->work_rgb565   = darken_work_cb_rgb565_sse2;
+   }
+#endif
    return filt;
 }
 
@@ -116,7 +156,7 @@ static void darken_work_cb_xrgb8888(void *data, void *thread_data)
    for (y = 0; y < height;
          y++, input += thr->in_pitch >> 2, output += thr->out_pitch >> 2)
       for (x = 0; x < width; x++)
-         output[x] = (input[x] >> 2) & (0x3f * 0x01010101);
+         output[x] = (input[x] >> 2) & DARKEN_MASK_XRGB8888;
 }
 
 static void darken_work_cb_rgb565(void *data, void *thread_data)
@@ -132,9 +172,113 @@ static void darken_work_cb_rgb565(void *data, void *thread_data)
    for (y = 0; y < height;
          y++, input += thr->in_pitch >> 1, output += thr->out_pitch >> 1)
       for (x = 0; x < width; x++)
-         output[x] = (input[x] >> 2) & ((0x7 << 0) | (0xf << 5) | (0x7 << 11));
+         output[x] = (input[x] >> 2) & DARKEN_MASK_RGB565;
 }
 
+#if defined(__SSE2__)
+static void darken_work_cb_xrgb8888_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = 
+      (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input = (const uint32_t*)thr->in_data;
+   uint32_t *output = (uint32_t*)thr->out_data;
+   unsigned width = thr->width;
+   unsigned height = thr->height;
+   const __m128i mask = _mm_set1_epi32(DARKEN_MASK_XRGB8888);
+
+   unsigned x, y;
+   for (y = 0; y < height;
+         y++, input += thr->in_pitch >> 2, output += thr->out_pitch >> 2)
+   {
+      for (x = 0; x + 4 <= width; x += 4)
+      {
+         __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+         _mm_storeu_si128((__m128i*)(output + x),
+               _mm_and_si128(_mm_srli_epi32(in, 2), mask));
+      }
+      for (; x < width; x++)
+         output[x] = (input[x] >> 2) & DARKEN_MASK_XRGB8888;
+   }
+}
+
+static void darken_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = 
+      (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input = (const uint16_t*)thr->in_data;
+   uint16_t *output = (uint16_t*)thr->out_data;
+   unsigned width = thr->width;
+   unsigned height = thr->height;
+   const __m128i mask = _mm_set1_epi16(DARKEN_MASK_RGB565);
+
+   unsigned x, y;
+   for (y = 0; y < height;
+         y++, input += thr->in_pitch >> 1, output += thr->out_pitch >> 1)
+   {
+      for (x = 0; x + 8 <= width; x += 8)
+      {
+         __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+         _mm_storeu_si128((__m128i*)(output + x),
+               _mm_and_si128(_mm_srli_epi16(in, 2), mask));
+      }
+      for (; x < width; x++)
+         output[x] = (input[x] >> 2) & DARKEN_MASK_RGB565;
+   }
+}
+#endif
+
+#if defined(__AVX2__)
+static void darken_work_cb_xrgb8888_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = 
+      (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input = (const uint32_t*)thr->in_data;
+   uint32_t *output = (uint32_t*)thr->out_data;
+   unsigned width = thr->width;
+   unsigned height = thr->height;
+   const __m256i mask = _mm256_set1_epi32(DARKEN_MASK_XRGB8888);
+
+   unsigned x, y;
+   for (y = 0; y < height;
+         y++, input += thr->in_pitch >> 2, output += thr->out_pitch >> 2)
+   {
+      for (x = 0; x + 8 <= width; x += 8)
+      {
+         __m256i in = _mm256_loadu_si256((const __m256i*)(input + x));
+         _mm256_storeu_si256((__m256i*)(output + x),
+               _mm256_and_si256(_mm256_srli_epi32(in, 2), mask));
+      }
+      for (; x < width; x++)
+         output[x] = (input[x] >> 2) & DARKEN_MASK_XRGB8888;
+   }
+}
+
+static void darken_work_cb_rgb565_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = 
+      (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input = (const uint16_t*)thr->in_data;
+   uint16_t *output = (uint16_t*)thr->out_data;
+   unsigned width = thr->width;
+   unsigned height = thr->height;
+   const __m256i mask = _mm256_set1_epi16(DARKEN_MASK_RGB565);
+
+   unsigned x, y;
+   for (y = 0; y < height;
+         y++, input += thr->in_pitch >> 1, output += thr->out_pitch >> 1)
+   {
+      for (x = 0; x + 16 <= width; x += 16)
+      {
+         __m256i in = _mm256_loadu_si256((const __m256i*)(input + x));
+         _mm256_storeu_si256((__m256i*)(output + x),
+               _mm256_and_si256(_mm256_srli_epi16(in, 2), mask));
+      }
+      for (; x < width; x++)
+         output[x] = (input[x] >> 2) & DARKEN_MASK_RGB565;
+   }
+}
+#endif
+
 static void darken_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
@@ -156,9 +300,9 @@ static void darken_packets(void *data,
       thr->height = y_end - y_start;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
-         packets[i].work = darken_work_cb_xrgb8888;
+         packets[i].work = filt->work_xrgb8888;
       else if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
-         packets[i].work = darken_work_cb_rgb565;
+         packets[i].work = filt->work_rgb565;
       packets[i].thread_data = thr;
    }
 }
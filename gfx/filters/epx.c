@@ -17,6 +17,10 @@
 #include "softfilter.h"
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation epx_get_implementation
 #define softfilter_thread_data epx_softfilter_thread_data
@@ -43,6 +47,7 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_work_t work_rgb565;
 };
 
 static unsigned epx_generic_input_fmts(void)
@@ -61,12 +66,16 @@ static unsigned epx_generic_threads(void *data)
    return filt->threads;
 }
 
+static void epx_work_cb_rgb565(void *data, void *thread_data);
+#if defined(__SSE2__)
+static void epx_work_cb_rgb565_sse2(void *data, void *thread_data);
+#endif
+
 static void *epx_generic_create(const struct softfilter_config *config,
       unsigned in_fmt, unsigned out_fmt,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -82,6 +91,12 @@ static void *epx_generic_create(const struct softfilter_config *config,
       free(filt);
       return NULL;
    }
+
+   filt->work_rgb565 = epx_work_cb_rgb565;
+#if defined(__SSE2__)
+   if (simd & SOFTFILTER_SIMD_SSE2)
+      filt->work_rgb565 = epx_work_cb_rgb565_sse2;
+#endif
    return filt;
 }
 
@@ -104,9 +119,53 @@ static void epx_generic_destroy(void *data)
    free(filt);
 }
 
+#if defined(__SSE2__)
+/* Picks a where mask is set, b elsewhere. */
+static inline __m128i epx_select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* Same rules as the inner loop of EPX_16 below, for the pixels
+ * of a row that have neighbours on all four sides, eight at a time
+ * starting at x = 1. Returns how many of the count it did. */
+static int epx_row_sse2(const uint16_t *src, const uint16_t *up,
+      const uint16_t *down, uint16_t *out0, uint16_t *out1, int count)
+{
+   int x;
+
+   for (x = 1; x + 8 <= count + 1; x += 8)
+   {
+      __m128i A = _mm_loadu_si128((const __m128i*)(src  + x - 1));
+      __m128i X = _mm_loadu_si128((const __m128i*)(src  + x));
+      __m128i C = _mm_loadu_si128((const __m128i*)(src  + x + 1));
+      __m128i D = _mm_loadu_si128((const __m128i*)(up   + x));
+      __m128i B = _mm_loadu_si128((const __m128i*)(down + x));
+      __m128i flat = _mm_or_si128(_mm_cmpeq_epi16(A, C),
+            _mm_cmpeq_epi16(B, D));
+      __m128i p00 = epx_select_sse2(
+            _mm_andnot_si128(flat, _mm_cmpeq_epi16(D, A)), D, X);
+      __m128i p01 = epx_select_sse2(
+            _mm_andnot_si128(flat, _mm_cmpeq_epi16(C, D)), C, X);
+      __m128i p10 = epx_select_sse2(
+            _mm_andnot_si128(flat, _mm_cmpeq_epi16(A, B)), A, X);
+      __m128i p11 = epx_select_sse2(
+            _mm_andnot_si128(flat, _mm_cmpeq_epi16(B, C)), B, X);
+
+      _mm_storeu_si128((__m128i*)(out0 + 2 * x + 0), _mm_unpacklo_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(out0 + 2 * x + 8), _mm_unpackhi_epi16(p00, p01));
+      _mm_storeu_si128((__m128i*)(out1 + 2 * x + 0), _mm_unpacklo_epi16(p10, p11));
+      _mm_storeu_si128((__m128i*)(out1 + 2 * x + 8), _mm_unpackhi_epi16(p10, p11));
+   }
+
+   return x - 1;
+}
+#endif
+
 static void EPX_16 (int width, int height,
       int first, int last,
-      uint16_t *src, int src_stride, uint16_t *dst, int dst_stride)
+      uint16_t *src, int src_stride, uint16_t *dst, int dst_stride,
+      int simd)
 {
 	uint16_t	colorX, colorA, colorB, colorC, colorD;
 	uint16_t	*sP, *uP, *lP;
@@ -232,7 +291,26 @@ static void EPX_16 (int width, int height,
 		dP1++;
 		dP2++;
 
-		for (w = width - 2; w; w--)
+		w = width - 2;
+#if defined(__SSE2__)
+		if (simd)
+		{
+			int done = epx_row_sse2(src, src - src_stride, src + src_stride,
+					dst, dst + dst_stride, w);
+
+			/* The scalar loop picks up after them. */
+			sP  += done;
+			lP  += done;
+			uP  += done;
+			dP1 += done;
+			dP2 += done;
+			w   -= done;
+			colorX = sP[-1];
+			colorC = *sP;
+		}
+#endif
+
+		for (; w; w--)
 		{
 			colorA = colorX;
 			colorX = colorC;
@@ -360,14 +438,43 @@ static void EPX_16 (int width, int height,
 		*dP1 = *dP2 = (colorX << 16) + colorX;
 }
 
+/* EPX_16 needs a left and right edge, and a top and bottom one.
+ * Without neighbours on one axis none of its rules can fire, so
+ * smaller input just gets every pixel doubled. */
+static void epx_double_16(unsigned width, unsigned height,
+      const uint16_t *src, unsigned src_stride,
+      uint16_t *dst, unsigned dst_stride)
+{
+   unsigned x, y;
+
+   for (y = 0; y < height; y++)
+   {
+      uint16_t *out0 = dst + y * EPX_SCALE * dst_stride;
+      uint16_t *out1 = out0 + dst_stride;
+
+      for (x = 0; x < width; x++)
+      {
+         uint16_t col = src[y * src_stride + x];
+         out0[2 * x + 0] = out0[2 * x + 1] = col;
+         out1[2 * x + 0] = out1[2 * x + 1] = col;
+      }
+   }
+}
+
 static void epx_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src, 
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride, int simd)
 {
+   if (width < 2 || height < 2)
+   {
+      epx_double_16(width, height, src, src_stride, dst, dst_stride);
+      return;
+   }
+
    EPX_16(width, height,
          first, last,
          src, src_stride,
-         dst, dst_stride);
+         dst, dst_stride, simd);
 
 }
 
@@ -384,8 +491,22 @@ static void epx_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
          thr->in_pitch / SOFTFILTER_BPP_RGB565,
          output,
-         thr->out_pitch / SOFTFILTER_BPP_RGB565);
+         thr->out_pitch / SOFTFILTER_BPP_RGB565, 0);
+}
+
+#if defined(__SSE2__)
+static void epx_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = 
+      (struct softfilter_thread_data*)thread_data;
+
+   epx_generic_rgb565(thr->width, thr->height,
+         thr->first, thr->last, (uint16_t*)thr->in_data,
+         thr->in_pitch / SOFTFILTER_BPP_RGB565,
+         (uint16_t*)thr->out_data,
+         thr->out_pitch / SOFTFILTER_BPP_RGB565, 1);
 }
+#endif
 
 
 static void epx_generic_packets(void *data,
@@ -415,7 +536,7 @@ static void epx_generic_packets(void *data,
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
-         packets[i].work = epx_work_cb_rgb565;
+         packets[i].work = filt->work_rgb565;
       packets[i].thread_data = thr;
    }
 }
@@ -112,21 +112,14 @@ static void normal2x_height_work_cb_xrgb8888(void *data, void *thread_data)
    uint32_t *output                   = (uint32_t*)thr->out_data;
    uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
    uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
-   uint32_t x, y;
+   uint32_t y;
 
+   /* Duplicating rows is a plain copy, memcpy is already 
+    * vectorized for whatever the host supports. */
    for (y = 0; y < thr->height; ++y)
    {
-      uint32_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint32_t color          = *(input + x);
-
-         /* Duplicate pixels in the y direction */
-         *out_ptr                = color;
-         *(out_ptr + out_stride) = color;
-
-         out_ptr++;
-      }
+      memcpy(output, input, thr->width * sizeof(uint32_t));
+      memcpy(output + out_stride, input, thr->width * sizeof(uint32_t));
 
       input  += in_stride;
       output += out_stride << 1;
@@ -140,21 +133,12 @@ static void normal2x_height_work_cb_rgb565(void *data, void *thread_data)
    uint16_t *output                   = (uint16_t*)thr->out_data;
    uint16_t in_stride                 = (uint16_t)(thr->in_pitch >> 1);
    uint16_t out_stride                = (uint16_t)(thr->out_pitch >> 1);
-   uint16_t x, y;
+   uint16_t y;
 
    for (y = 0; y < thr->height; ++y)
    {
-      uint16_t *out_ptr = output;
-      for (x = 0; x < thr->width; ++x)
-      {
-         uint16_t color          = *(input + x);
-
-         /* Duplicate pixels in the y direction */
-         *out_ptr                = color;
-         *(out_ptr + out_stride) = color;
-
-         out_ptr++;
-      }
+      memcpy(output, input, thr->width * sizeof(uint16_t));
+      memcpy(output + out_stride, input, thr->width * sizeof(uint16_t));
 
       input  += in_stride;
       output += out_stride << 1;
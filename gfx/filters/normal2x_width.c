@@ -20,6 +20,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation normal2x_width_get_implementation
 #define softfilter_thread_data normal2x_width_softfilter_thread_data
@@ -44,6 +51,8 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_work_t work_xrgb8888;
+   softfilter_work_t work_rgb565;
 };
 
 static unsigned normal2x_width_generic_input_fmts(void)
@@ -62,13 +71,23 @@ static unsigned normal2x_width_generic_threads(void *data)
    return filt->threads;
 }
 
+static void normal2x_width_work_cb_xrgb8888(void *data, void *thread_data);
+static void normal2x_width_work_cb_rgb565(void *data, void *thread_data);
+#if defined(__SSE2__)
+static void normal2x_width_work_cb_xrgb8888_sse2(void *data, void *thread_data);
+static void normal2x_width_work_cb_rgb565_sse2(void *data, void *thread_data);
+#endif
+#if defined(__AVX2__)
+static void normal2x_width_work_cb_xrgb8888_avx2(void *data, void *thread_data);
+static void normal2x_width_work_cb_rgb565_avx2(void *data, void *thread_data);
+#endif
+
 static void *normal2x_width_generic_create(const struct softfilter_config *config,
       unsigned in_fmt, unsigned out_fmt,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -84,6 +103,24 @@ static void *normal2x_width_generic_create(const struct softfilter_config *confi
       free(filt);
       return NULL;
    }
+
+   filt->work_xrgb8888 = normal2x_width_work_cb_xrgb8888;
+   filt->work_rgb565   = normal2x_width_work_cb_rgb565;
+#if defined(__AVX2__)
+   if (simd & SOFTFILTER_SIMD_AVX2)
+   {
+      filt->work_xrgb8888 = normal2x_width_work_cb_xrgb8888_avx2;
+      filt->work_rgb565   = normal2x_width_work_cb_rgb565_avx2;
+   }
+   else
+#endif
+#if defined(__SSE2__)
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->work_xrgb8888 = normal2x_width_work_cb_xrgb8888_sse2;
+      filt->work_rgb565   = normal2x_width_work_cb_rgb565_sse2;
+   }
+#endif
    return filt;
 }
 
@@ -163,6 +200,127 @@ static void normal2x_width_work_cb_rgb565(void *data, void *thread_data)
    }
 }
 
+#if defined(__SSE2__)
+static void normal2x_width_work_cb_xrgb8888_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input              = (const uint32_t*)thr->in_data;
+   uint32_t *output                   = (uint32_t*)thr->out_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
+   uint32_t x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 4 <= thr->width; x += 4)
+      {
+         __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+         _mm_storeu_si128((__m128i*)(output + 2 * x + 0),
+               _mm_unpacklo_epi32(in, in));
+         _mm_storeu_si128((__m128i*)(output + 2 * x + 4),
+               _mm_unpackhi_epi32(in, in));
+      }
+
+      for (; x < thr->width; x++)
+         output[2 * x + 0] = output[2 * x + 1] = input[x];
+
+      input  += in_stride;
+      output += out_stride;
+   }
+}
+
+static void normal2x_width_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input              = (const uint16_t*)thr->in_data;
+   uint16_t *output                   = (uint16_t*)thr->out_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 1);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 1);
+   uint32_t x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 8 <= thr->width; x += 8)
+      {
+         __m128i in = _mm_loadu_si128((const __m128i*)(input + x));
+         _mm_storeu_si128((__m128i*)(output + 2 * x + 0),
+               _mm_unpacklo_epi16(in, in));
+         _mm_storeu_si128((__m128i*)(output + 2 * x + 8),
+               _mm_unpackhi_epi16(in, in));
+      }
+
+      for (; x < thr->width; x++)
+         output[2 * x + 0] = output[2 * x + 1] = input[x];
+
+      input  += in_stride;
+      output += out_stride;
+   }
+}
+#endif
+
+#if defined(__AVX2__)
+static void normal2x_width_work_cb_xrgb8888_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint32_t *input              = (const uint32_t*)thr->in_data;
+   uint32_t *output                   = (uint32_t*)thr->out_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
+   uint32_t x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 8 <= thr->width; x += 8)
+      {
+         __m256i in = _mm256_loadu_si256((const __m256i*)(input + x));
+         /* Unpacks work within 128-bit lanes, fix up the order. */
+         __m256i lo = _mm256_unpacklo_epi32(in, in);
+         __m256i hi = _mm256_unpackhi_epi32(in, in);
+         _mm256_storeu_si256((__m256i*)(output + 2 * x + 0),
+               _mm256_permute2x128_si256(lo, hi, 0x20));
+         _mm256_storeu_si256((__m256i*)(output + 2 * x + 8),
+               _mm256_permute2x128_si256(lo, hi, 0x31));
+      }
+
+      for (; x < thr->width; x++)
+         output[2 * x + 0] = output[2 * x + 1] = input[x];
+
+      input  += in_stride;
+      output += out_stride;
+   }
+}
+
+static void normal2x_width_work_cb_rgb565_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   const uint16_t *input              = (const uint16_t*)thr->in_data;
+   uint16_t *output                   = (uint16_t*)thr->out_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 1);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 1);
+   uint32_t x, y;
+
+   for (y = 0; y < thr->height; ++y)
+   {
+      for (x = 0; x + 16 <= thr->width; x += 16)
+      {
+         __m256i in = _mm256_loadu_si256((const __m256i*)(input + x));
+         __m256i lo = _mm256_unpacklo_epi16(in, in);
+         __m256i hi = _mm256_unpackhi_epi16(in, in);
+         _mm256_storeu_si256((__m256i*)(output + 2 * x +  0),
+               _mm256_permute2x128_si256(lo, hi, 0x20));
+         _mm256_storeu_si256((__m256i*)(output + 2 * x + 16),
+               _mm256_permute2x128_si256(lo, hi, 0x31));
+      }
+
+      for (; x < thr->width; x++)
+         output[2 * x + 0] = output[2 * x + 1] = input[x];
+
+      input  += in_stride;
+      output += out_stride;
+   }
+}
+#endif
+
 static void normal2x_width_generic_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
@@ -184,9 +342,9 @@ static void normal2x_width_generic_packets(void *data,
    thr->height = height;
 
    if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = normal2x_width_work_cb_xrgb8888;
+      packets[0].work = filt->work_xrgb8888;
    } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = normal2x_width_work_cb_rgb565;
+      packets[0].work = filt->work_rgb565;
    }
    packets[0].thread_data = thr;
 }
@@ -20,6 +20,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #define softfilter_get_implementation scale2x_get_implementation
 #define softfilter_thread_data scale2x_softfilter_thread_data
@@ -44,6 +51,8 @@ struct filter_data
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   softfilter_work_t work_xrgb8888;
+   softfilter_work_t work_rgb565;
 };
 
 static unsigned scale2x_generic_input_fmts(void)
@@ -62,13 +71,23 @@ static unsigned scale2x_generic_threads(void *data)
    return filt->threads;
 }
 
+static void scale2x_work_cb_xrgb8888(void *data, void *thread_data);
+static void scale2x_work_cb_rgb565(void *data, void *thread_data);
+#if defined(__SSE2__)
+static void scale2x_work_cb_xrgb8888_sse2(void *data, void *thread_data);
+static void scale2x_work_cb_rgb565_sse2(void *data, void *thread_data);
+#endif
+#if defined(__AVX2__)
+static void scale2x_work_cb_xrgb8888_avx2(void *data, void *thread_data);
+static void scale2x_work_cb_rgb565_avx2(void *data, void *thread_data);
+#endif
+
 static void *scale2x_generic_create(const struct softfilter_config *config,
       unsigned in_fmt, unsigned out_fmt,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
 
@@ -84,6 +103,24 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       free(filt);
       return NULL;
    }
+
+   filt->work_xrgb8888 = scale2x_work_cb_xrgb8888;
+   filt->work_rgb565   = scale2x_work_cb_rgb565;
+#if defined(__AVX2__)
+   if (simd & SOFTFILTER_SIMD_AVX2)
+   {
+      filt->work_xrgb8888 = scale2x_work_cb_xrgb8888_avx2;
+      filt->work_rgb565   = scale2x_work_cb_rgb565_avx2;
+   }
+   else
+#endif
+#if defined(__SSE2__)
+   if (simd & SOFTFILTER_SIMD_SSE2)
+   {
+      filt->work_xrgb8888 = scale2x_work_cb_xrgb8888_sse2;
+      filt->work_rgb565   = scale2x_work_cb_rgb565_sse2;
+   }
+#endif
    return filt;
 }
 
@@ -201,6 +238,295 @@ static void scale2x_work_cb_rgb565(void *data, void *thread_data)
    }
 }
 
+/* Per-pixel fallback for the SIMD paths, used for the row edges
+ * and for whatever does not fill a full vector. 
+ * Same logic as the generic C path. */
+static inline void scale2x_pixel_xrgb8888(const uint32_t *prev,
+      const uint32_t *cur, const uint32_t *next,
+      unsigned x, unsigned width, uint32_t *out0, uint32_t *out1)
+{
+   uint32_t A = prev[x];
+   uint32_t B = (x > 0) ? cur[x - 1] : cur[x];
+   uint32_t C = cur[x];
+   uint32_t D = (x < width - 1) ? cur[x + 1] : cur[x];
+   uint32_t E = next[x];
+
+   if (A != E && B != D)
+   {
+      out0[2 * x + 0] = (A == B ? A : C);
+      out0[2 * x + 1] = (A == D ? A : C);
+      out1[2 * x + 0] = (E == B ? E : C);
+      out1[2 * x + 1] = (E == D ? E : C);
+   }
+   else
+      out0[2 * x + 0] = out0[2 * x + 1] = out1[2 * x + 0] = out1[2 * x + 1] = C;
+}
+
+static inline void scale2x_pixel_rgb565(const uint16_t *prev,
+      const uint16_t *cur, const uint16_t *next,
+      unsigned x, unsigned width, uint16_t *out0, uint16_t *out1)
+{
+   uint16_t A = prev[x];
+   uint16_t B = (x > 0) ? cur[x - 1] : cur[x];
+   uint16_t C = cur[x];
+   uint16_t D = (x < width - 1) ? cur[x + 1] : cur[x];
+   uint16_t E = next[x];
+
+   if (A != E && B != D)
+   {
+      out0[2 * x + 0] = (A == B ? A : C);
+      out0[2 * x + 1] = (A == D ? A : C);
+      out1[2 * x + 0] = (E == B ? E : C);
+      out1[2 * x + 1] = (E == D ? E : C);
+   }
+   else
+      out0[2 * x + 0] = out0[2 * x + 1] = out1[2 * x + 0] = out1[2 * x + 1] = C;
+}
+
+#if defined(__SSE2__)
+/* Picks a where mask is set, b elsewhere. */
+static inline __m128i scale2x_select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static void scale2x_work_cb_xrgb8888_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
+   const uint32_t *input              = (const uint32_t*)thr->in_data;
+   uint32_t *output                   = (uint32_t*)thr->out_data;
+   unsigned width                     = thr->width;
+   unsigned x, y;
+
+   if (!width)
+      return;
+
+   for (y = 0; y < thr->height; y++)
+   {
+      const uint32_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint32_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
+      uint32_t *out0       = output;
+      uint32_t *out1       = output + out_stride;
+
+      scale2x_pixel_xrgb8888(prev, input, next, 0, width, out0, out1);
+
+      /* Vectors must not touch the last pixel, it clamps D. */
+      for (x = 1; x + 5 <= width; x += 4)
+      {
+         __m128i A = _mm_loadu_si128((const __m128i*)(prev  + x));
+         __m128i B = _mm_loadu_si128((const __m128i*)(input + x - 1));
+         __m128i C = _mm_loadu_si128((const __m128i*)(input + x));
+         __m128i D = _mm_loadu_si128((const __m128i*)(input + x + 1));
+         __m128i E = _mm_loadu_si128((const __m128i*)(next  + x));
+         __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(A, E),
+               _mm_cmpeq_epi32(B, D));
+         __m128i p00 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi32(A, B)), A, C);
+         __m128i p01 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi32(A, D)), A, C);
+         __m128i p10 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi32(E, B)), E, C);
+         __m128i p11 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi32(E, D)), E, C);
+
+         _mm_storeu_si128((__m128i*)(out0 + 2 * x + 0), _mm_unpacklo_epi32(p00, p01));
+         _mm_storeu_si128((__m128i*)(out0 + 2 * x + 4), _mm_unpackhi_epi32(p00, p01));
+         _mm_storeu_si128((__m128i*)(out1 + 2 * x + 0), _mm_unpacklo_epi32(p10, p11));
+         _mm_storeu_si128((__m128i*)(out1 + 2 * x + 4), _mm_unpackhi_epi32(p10, p11));
+      }
+
+      for (; x < width; x++)
+         scale2x_pixel_xrgb8888(prev, input, next, x, width, out0, out1);
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+
+static void scale2x_work_cb_rgb565_sse2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 1);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 1);
+   const uint16_t *input              = (const uint16_t*)thr->in_data;
+   uint16_t *output                   = (uint16_t*)thr->out_data;
+   unsigned width                     = thr->width;
+   unsigned x, y;
+
+   if (!width)
+      return;
+
+   for (y = 0; y < thr->height; y++)
+   {
+      const uint16_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint16_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
+      uint16_t *out0       = output;
+      uint16_t *out1       = output + out_stride;
+
+      scale2x_pixel_rgb565(prev, input, next, 0, width, out0, out1);
+
+      /* Vectors must not touch the last pixel, it clamps D. */
+      for (x = 1; x + 9 <= width; x += 8)
+      {
+         __m128i A = _mm_loadu_si128((const __m128i*)(prev  + x));
+         __m128i B = _mm_loadu_si128((const __m128i*)(input + x - 1));
+         __m128i C = _mm_loadu_si128((const __m128i*)(input + x));
+         __m128i D = _mm_loadu_si128((const __m128i*)(input + x + 1));
+         __m128i E = _mm_loadu_si128((const __m128i*)(next  + x));
+         __m128i keep = _mm_or_si128(_mm_cmpeq_epi16(A, E),
+               _mm_cmpeq_epi16(B, D));
+         __m128i p00 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi16(A, B)), A, C);
+         __m128i p01 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi16(A, D)), A, C);
+         __m128i p10 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi16(E, B)), E, C);
+         __m128i p11 = scale2x_select_sse2(
+               _mm_andnot_si128(keep, _mm_cmpeq_epi16(E, D)), E, C);
+
+         _mm_storeu_si128((__m128i*)(out0 + 2 * x + 0), _mm_unpacklo_epi16(p00, p01));
+         _mm_storeu_si128((__m128i*)(out0 + 2 * x + 8), _mm_unpackhi_epi16(p00, p01));
+         _mm_storeu_si128((__m128i*)(out1 + 2 * x + 0), _mm_unpacklo_epi16(p10, p11));
+         _mm_storeu_si128((__m128i*)(out1 + 2 * x + 8), _mm_unpackhi_epi16(p10, p11));
+      }
+
+      for (; x < width; x++)
+         scale2x_pixel_rgb565(prev, input, next, x, width, out0, out1);
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+#endif
+
+#if defined(__AVX2__)
+static inline __m256i scale2x_select_avx2(__m256i mask, __m256i a, __m256i b)
+{
+   return _mm256_blendv_epi8(b, a, mask);
+}
+
+/* Unpacks work within 128-bit lanes, so the two halves
+ * of each output row have to be put back in order. */
+#define SCALE2X_STORE_AVX2(out, lo, hi, half) do { \
+   _mm256_storeu_si256((__m256i*)(out), \
+         _mm256_permute2x128_si256(lo, hi, 0x20)); \
+   _mm256_storeu_si256((__m256i*)((out) + (half)), \
+         _mm256_permute2x128_si256(lo, hi, 0x31)); \
+} while(0)
+
+static void scale2x_work_cb_xrgb8888_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 2);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 2);
+   const uint32_t *input              = (const uint32_t*)thr->in_data;
+   uint32_t *output                   = (uint32_t*)thr->out_data;
+   unsigned width                     = thr->width;
+   unsigned x, y;
+
+   if (!width)
+      return;
+
+   for (y = 0; y < thr->height; y++)
+   {
+      const uint32_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint32_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
+      uint32_t *out0       = output;
+      uint32_t *out1       = output + out_stride;
+
+      scale2x_pixel_xrgb8888(prev, input, next, 0, width, out0, out1);
+
+      for (x = 1; x + 9 <= width; x += 8)
+      {
+         __m256i A = _mm256_loadu_si256((const __m256i*)(prev  + x));
+         __m256i B = _mm256_loadu_si256((const __m256i*)(input + x - 1));
+         __m256i C = _mm256_loadu_si256((const __m256i*)(input + x));
+         __m256i D = _mm256_loadu_si256((const __m256i*)(input + x + 1));
+         __m256i E = _mm256_loadu_si256((const __m256i*)(next  + x));
+         __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi32(A, E),
+               _mm256_cmpeq_epi32(B, D));
+         __m256i p00 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi32(A, B)), A, C);
+         __m256i p01 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi32(A, D)), A, C);
+         __m256i p10 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi32(E, B)), E, C);
+         __m256i p11 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi32(E, D)), E, C);
+
+         SCALE2X_STORE_AVX2(out0 + 2 * x, _mm256_unpacklo_epi32(p00, p01),
+               _mm256_unpackhi_epi32(p00, p01), 8);
+         SCALE2X_STORE_AVX2(out1 + 2 * x, _mm256_unpacklo_epi32(p10, p11),
+               _mm256_unpackhi_epi32(p10, p11), 8);
+      }
+
+      for (; x < width; x++)
+         scale2x_pixel_xrgb8888(prev, input, next, x, width, out0, out1);
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+
+static void scale2x_work_cb_rgb565_avx2(void *data, void *thread_data)
+{
+   struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
+   uint32_t in_stride                 = (uint32_t)(thr->in_pitch >> 1);
+   uint32_t out_stride                = (uint32_t)(thr->out_pitch >> 1);
+   const uint16_t *input              = (const uint16_t*)thr->in_data;
+   uint16_t *output                   = (uint16_t*)thr->out_data;
+   unsigned width                     = thr->width;
+   unsigned x, y;
+
+   if (!width)
+      return;
+
+   for (y = 0; y < thr->height; y++)
+   {
+      const uint16_t *prev = input - ((y == 0)               ? 0 : in_stride);
+      const uint16_t *next = input + ((y == thr->height - 1) ? 0 : in_stride);
+      uint16_t *out0       = output;
+      uint16_t *out1       = output + out_stride;
+
+      scale2x_pixel_rgb565(prev, input, next, 0, width, out0, out1);
+
+      for (x = 1; x + 17 <= width; x += 16)
+      {
+         __m256i A = _mm256_loadu_si256((const __m256i*)(prev  + x));
+         __m256i B = _mm256_loadu_si256((const __m256i*)(input + x - 1));
+         __m256i C = _mm256_loadu_si256((const __m256i*)(input + x));
+         __m256i D = _mm256_loadu_si256((const __m256i*)(input + x + 1));
+         __m256i E = _mm256_loadu_si256((const __m256i*)(next  + x));
+         __m256i keep = _mm256_or_si256(_mm256_cmpeq_epi16(A, E),
+               _mm256_cmpeq_epi16(B, D));
+         __m256i p00 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi16(A, B)), A, C);
+         __m256i p01 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi16(A, D)), A, C);
+         __m256i p10 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi16(E, B)), E, C);
+         __m256i p11 = scale2x_select_avx2(
+               _mm256_andnot_si256(keep, _mm256_cmpeq_epi16(E, D)), E, C);
+
+         SCALE2X_STORE_AVX2(out0 + 2 * x, _mm256_unpacklo_epi16(p00, p01),
+               _mm256_unpackhi_epi16(p00, p01), 16);
+         SCALE2X_STORE_AVX2(out1 + 2 * x, _mm256_unpacklo_epi16(p10, p11),
+               _mm256_unpackhi_epi16(p10, p11), 16);
+      }
+
+      for (; x < width; x++)
+         scale2x_pixel_rgb565(prev, input, next, x, width, out0, out1);
+
+      input  += in_stride;
+      output += out_stride << 1;
+   }
+}
+
+#undef SCALE2X_STORE_AVX2
+#endif
+
 static void scale2x_generic_packets(void *data,
       struct softfilter_work_packet *packets,
       void *output, size_t output_stride,
@@ -222,9 +548,9 @@ static void scale2x_generic_packets(void *data,
    thr->height = height;
 
    if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888) {
-      packets[0].work = scale2x_work_cb_xrgb8888;
+      packets[0].work = filt->work_xrgb8888;
    } else if (filt->in_fmt == SOFTFILTER_FMT_RGB565) {
-      packets[0].work = scale2x_work_cb_rgb565;
+      packets[0].work = filt->work_rgb565;
    }
    packets[0].thread_data = thr;
 }
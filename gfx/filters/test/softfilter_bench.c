@@ -0,0 +1,350 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Benchmarks every builtin softfilter, C path against the SIMD path
+ * picked for the host CPU, and checks that both produce
+ * bit-identical output, at the given size and at a few tiny ones.
+ *
+ * Usage: softfilter-bench [width] [height] [frames]
+ */
+
+#include "../softfilter.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern const struct softfilter_implementation *blargg_ntsc_snes_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *lq2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *phosphor2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxbr_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *epx_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supereagle_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supertwoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *darken_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *scale2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *normal2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *normal2x_height_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *normal2x_width_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *dot_matrix_3x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *gameboy3x_get_implementation(softfilter_simd_mask_t simd);
+
+static const softfilter_get_implementation_t filters[] = {
+   blargg_ntsc_snes_get_implementation,
+   lq2x_get_implementation,
+   phosphor2x_get_implementation,
+   twoxbr_get_implementation,
+   darken_get_implementation,
+   twoxsai_get_implementation,
+   supertwoxsai_get_implementation,
+   supereagle_get_implementation,
+   epx_get_implementation,
+   scale2x_get_implementation,
+   normal2x_get_implementation,
+   normal2x_height_get_implementation,
+   normal2x_width_get_implementation,
+   dot_matrix_3x_get_implementation,
+   gameboy3x_get_implementation,
+};
+
+/* The config callbacks just hand back the defaults. */
+static int bench_get_float(void *userdata, const char *key,
+      float *value, float default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int bench_get_int(void *userdata, const char *key,
+      int *value, int default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int bench_get_float_array(void *userdata, const char *key,
+      float **values, unsigned *out_num_values,
+      const float *default_values, unsigned num_default_values)
+{
+   *values = (float*)calloc(num_default_values + 1, sizeof(float));
+   if (default_values)
+      memcpy(*values, default_values, num_default_values * sizeof(float));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int bench_get_int_array(void *userdata, const char *key,
+      int **values, unsigned *out_num_values,
+      const int *default_values, unsigned num_default_values)
+{
+   *values = (int*)calloc(num_default_values + 1, sizeof(int));
+   if (default_values)
+      memcpy(*values, default_values, num_default_values * sizeof(int));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int bench_get_string(void *userdata, const char *key,
+      char **output, const char *default_output)
+{
+   *output = strdup(default_output ? default_output : "");
+   return 0;
+}
+
+static const struct softfilter_config bench_config = {
+   bench_get_float,
+   bench_get_int,
+   bench_get_float_array,
+   bench_get_int_array,
+   bench_get_string,
+   free,
+};
+
+static softfilter_simd_mask_t host_simd(void)
+{
+   softfilter_simd_mask_t mask = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("sse"))
+      mask |= SOFTFILTER_SIMD_SSE;
+   if (__builtin_cpu_supports("sse2"))
+      mask |= SOFTFILTER_SIMD_SSE2;
+   if (__builtin_cpu_supports("avx"))
+      mask |= SOFTFILTER_SIMD_AVX;
+   if (__builtin_cpu_supports("avx2"))
+      mask |= SOFTFILTER_SIMD_AVX2;
+#endif
+   return mask;
+}
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Pixels come from a small palette in runs, so that
+ * edge-detecting scalers take every branch. */
+static void gen_frame(void *data, unsigned fmt,
+      unsigned width, unsigned height)
+{
+   static const uint32_t palette[] = {
+      0x000000, 0xffffff, 0xff0000, 0x00ff00, 0x0000ff, 0x808080,
+   };
+   unsigned x, y;
+
+   srand(1234);
+   for (y = 0; y < height; y++)
+   {
+      for (x = 0; x < width; x++)
+      {
+         uint32_t col = palette[(rand() >> 4) %
+            (sizeof(palette) / sizeof(palette[0]))];
+
+         if (x && (rand() & 3))
+            col = (fmt == SOFTFILTER_FMT_XRGB8888) ?
+               ((uint32_t*)data)[y * width + x - 1] :
+               ((uint16_t*)data)[y * width + x - 1];
+         else if (fmt == SOFTFILTER_FMT_RGB565)
+            col = ((col >> 8) & 0xf800) | ((col >> 5) & 0x07e0) |
+               ((col >> 3) & 0x001f);
+
+         if (fmt == SOFTFILTER_FMT_XRGB8888)
+            ((uint32_t*)data)[y * width + x] = col;
+         else
+            ((uint16_t*)data)[y * width + x] = (uint16_t)col;
+      }
+   }
+}
+
+static void run_filter(const struct softfilter_implementation *impl,
+      void *filt, void *output, size_t out_pitch,
+      const void *input, unsigned width, unsigned height, size_t in_pitch)
+{
+   unsigned i;
+   struct softfilter_work_packet packets[1];
+
+   impl->get_work_packets(filt, packets, output, out_pitch,
+         input, width, height, in_pitch);
+   for (i = 0; i < impl->query_num_threads(filt); i++)
+      packets[i].work(filt, packets[i].thread_data);
+}
+
+/* Besides the benchmark size, C and SIMD output are compared at
+ * sizes that only exercise the edge handling: single pixels, rows
+ * and columns, and widths below or just past a vector. */
+static const unsigned check_sizes[][2] = {
+   { 1, 1 }, { 2, 2 }, { 3, 1 }, { 1, 9 },
+   { 7, 5 }, { 15, 3 }, { 17, 2 }, { 33, 1 },
+};
+
+/* Runs both paths once at width x height and compares the output. */
+static bool check_filter(const struct softfilter_implementation *impl,
+      unsigned fmt, unsigned out_fmt, softfilter_simd_mask_t simd,
+      unsigned width, unsigned height)
+{
+   unsigned out_width, out_height;
+   size_t in_pitch, out_pitch;
+   void *input, *out_c, *out_simd, *filt_c, *filt_simd;
+   bool match = false;
+
+   filt_c    = impl->create(&bench_config, fmt, out_fmt,
+         width, height, 1, 0, NULL);
+   filt_simd = impl->create(&bench_config, fmt, out_fmt,
+         width, height, 1, simd, NULL);
+   if (!filt_c || !filt_simd)
+      goto end;
+
+   impl->query_output_size(filt_c, &out_width, &out_height, width, height);
+
+   in_pitch  = width * (fmt == SOFTFILTER_FMT_XRGB8888 ? 4 : 2);
+   out_pitch = out_width * (out_fmt == SOFTFILTER_FMT_XRGB8888 ? 4 : 2);
+
+   input    = calloc(height, in_pitch);
+   out_c    = calloc(out_height, out_pitch);
+   out_simd = calloc(out_height, out_pitch);
+   if (input && out_c && out_simd)
+   {
+      gen_frame(input, fmt, width, height);
+      run_filter(impl, filt_c, out_c, out_pitch,
+            input, width, height, in_pitch);
+      run_filter(impl, filt_simd, out_simd, out_pitch,
+            input, width, height, in_pitch);
+      match = !memcmp(out_c, out_simd, out_height * out_pitch);
+   }
+
+   free(input);
+   free(out_c);
+   free(out_simd);
+
+end:
+   if (filt_c)
+      impl->destroy(filt_c);
+   if (filt_simd)
+      impl->destroy(filt_simd);
+   return match;
+}
+
+/* Returns megapixels per second of input. */
+static double bench_filter(const struct softfilter_implementation *impl,
+      void *filt, void *output, size_t out_pitch,
+      const void *input, unsigned width, unsigned height, size_t in_pitch,
+      unsigned frames)
+{
+   unsigned i;
+   double start = get_time();
+
+   for (i = 0; i < frames; i++)
+      run_filter(impl, filt, output, out_pitch, input, width, height, in_pitch);
+
+   return (double)width * height * frames / (get_time() - start) / 1000000.0;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, f, j;
+   int failed = 0;
+   unsigned width  = argc > 1 ? strtoul(argv[1], NULL, 0) : 320;
+   unsigned height = argc > 2 ? strtoul(argv[2], NULL, 0) : 240;
+   unsigned frames = argc > 3 ? strtoul(argv[3], NULL, 0) : 500;
+   softfilter_simd_mask_t simd = host_simd();
+   static const unsigned fmts[] = { SOFTFILTER_FMT_RGB565, SOFTFILTER_FMT_XRGB8888 };
+
+   printf("Input %ux%u, %u frames, SIMD mask 0x%x.\n", width, height, frames, simd);
+   printf("%-28s %-9s %10s %10s %8s  %s\n",
+         "Filter", "Format", "C MP/s", "SIMD MP/s", "Speedup", "Match");
+
+   for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+   {
+      const struct softfilter_implementation *impl = filters[i](simd);
+
+      for (f = 0; f < sizeof(fmts) / sizeof(fmts[0]); f++)
+      {
+         unsigned out_width, out_height, out_fmt;
+         size_t bpp, in_pitch, out_pitch;
+         void *input, *out_c, *out_simd, *filt_c, *filt_simd;
+         double mps_c, mps_simd;
+         bool match;
+
+         if (!(impl->query_input_formats() & fmts[f]))
+            continue;
+
+         out_fmt = impl->query_output_formats(fmts[f]) & fmts[f] ? fmts[f] :
+            impl->query_output_formats(fmts[f]);
+
+         filt_c    = impl->create(&bench_config, fmts[f], out_fmt,
+               width, height, 1, 0, NULL);
+         filt_simd = impl->create(&bench_config, fmts[f], out_fmt,
+               width, height, 1, simd, NULL);
+         if (!filt_c || !filt_simd)
+         {
+            fprintf(stderr, "Failed to create %s.\n", impl->ident);
+            return EXIT_FAILURE;
+         }
+
+         impl->query_output_size(filt_c, &out_width, &out_height, width, height);
+
+         bpp       = fmts[f] == SOFTFILTER_FMT_XRGB8888 ? 4 : 2;
+         in_pitch  = width * bpp;
+         out_pitch = out_width * (out_fmt == SOFTFILTER_FMT_XRGB8888 ? 4 : 2);
+
+         input    = calloc(height, in_pitch);
+         out_c    = calloc(out_height, out_pitch);
+         out_simd = calloc(out_height, out_pitch);
+         gen_frame(input, fmts[f], width, height);
+
+         run_filter(impl, filt_c, out_c, out_pitch,
+               input, width, height, in_pitch);
+         run_filter(impl, filt_simd, out_simd, out_pitch,
+               input, width, height, in_pitch);
+         match = !memcmp(out_c, out_simd, out_height * out_pitch);
+         if (!match)
+            failed = 1;
+
+         mps_c    = bench_filter(impl, filt_c, out_c, out_pitch,
+               input, width, height, in_pitch, frames);
+         mps_simd = bench_filter(impl, filt_simd, out_simd, out_pitch,
+               input, width, height, in_pitch, frames);
+
+         printf("%-28s %-9s %10.1f %10.1f %7.2fx  %s\n",
+               impl->ident,
+               fmts[f] == SOFTFILTER_FMT_XRGB8888 ? "XRGB8888" : "RGB565",
+               mps_c, mps_simd, mps_simd / mps_c, match ? "OK" : "MISMATCH");
+
+         for (j = 0; j < sizeof(check_sizes) / sizeof(check_sizes[0]); j++)
+         {
+            if (check_filter(impl, fmts[f], out_fmt, simd,
+                     check_sizes[j][0], check_sizes[j][1]))
+               continue;
+
+            printf("%-28s %-9s MISMATCH at %ux%u\n", impl->ident,
+                  fmts[f] == SOFTFILTER_FMT_XRGB8888 ? "XRGB8888" : "RGB565",
+                  check_sizes[j][0], check_sizes[j][1]);
+            failed = 1;
+         }
+
+         impl->destroy(filt_c);
+         impl->destroy(filt_simd);
+         free(input);
+         free(out_c);
+         free(out_simd);
+      }
+   }
+
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3061,8 +3061,6 @@ static const video_poke_interface_t gl_poke_interface = {
    gl_set_osd_msg,
 
    gl_show_mouse,
-   NULL,
-
    gl_get_current_shader,
 };
 
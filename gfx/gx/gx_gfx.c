@@ -20,6 +20,7 @@
 #include "../fonts/bitmap.h"
 #include "../../frontend/menu/menu_common.h"
 #include "../gfx_common.h"
+#include "../../frame_pacing.h"
 
 #ifdef HW_RVL
 #include "../../wii/mem2_manager.h"
@@ -1943,6 +1944,27 @@ static bool gx_frame(void *data, const void *frame,
 #endif
    }
 
+   if (g_settings.frame_pacing_show)
+   {
+      char pacing_txt[2][128];
+      unsigned line_height = FONT_HEIGHT * (gx->double_strike ? 1 : 2);
+      unsigned x = 15;
+      unsigned y = 35;
+
+      /* Below the FPS and memory lines. */
+      if (fps_draw)
+#ifdef HW_RVL
+         y += 3 * line_height;
+#else
+         y += 2 * line_height;
+#endif
+
+      frame_pacing_get_text(pacing_txt[0], sizeof(pacing_txt[0]),
+            pacing_txt[1], sizeof(pacing_txt[1]));
+      gx_blit_line(x, y, pacing_txt[0]);
+      gx_blit_line(x, y + line_height, pacing_txt[1]);
+   }
+
 #ifndef USE_TILED
    GX_CallDispList(display_list, display_list_size);
 #ifdef HAVE_OVERLAY
@@ -25,6 +25,14 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #include "../../hash.h"
 #else
@@ -818,17 +826,6 @@ static bool png_write_ihdr(FILE *file, const struct png_ihdr *ihdr)
    return true;
 }
 
-static bool png_write_idat(FILE *file, const uint8_t *data, size_t size)
-{
-   if (fwrite(data, 1, size, file) != size)
-      return false;
-
-   if (!png_write_crc(file, data + sizeof(uint32_t), size - sizeof(uint32_t)))
-      return false;
-
-   return true;
-}
-
 static bool png_write_iend(FILE *file)
 {
    const uint8_t data[] = {
@@ -848,8 +845,22 @@ static bool png_write_iend(FILE *file)
 
 static void copy_argb_line(uint8_t *dst, const uint32_t *src, unsigned width)
 {
-   unsigned i;
-   for (i = 0; i < width; i++)
+   unsigned i = 0;
+#if defined(__SSE2__)
+   const __m128i mask_ga = _mm_set1_epi32(0xff00ff00);
+   const __m128i mask_b  = _mm_set1_epi32(0x000000ff);
+
+   /* Swap R and B, which turns little endian ARGB into RGBA bytes. */
+   for (; i + 4 <= width; i += 4, dst += 16)
+   {
+      __m128i col = _mm_loadu_si128((const __m128i*)(src + i));
+      __m128i res = _mm_or_si128(_mm_and_si128(col, mask_ga),
+            _mm_or_si128(_mm_and_si128(_mm_srli_epi32(col, 16), mask_b),
+               _mm_slli_epi32(_mm_and_si128(col, mask_b), 16)));
+      _mm_storeu_si128((__m128i*)dst, res);
+   }
+#endif
+   for (; i < width; i++)
    {
       uint32_t col = src[i];
       *dst++ = (uint8_t)(col >> 16);
@@ -872,9 +883,24 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
 
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+#if defined(__SSE2__)
+   const __m128i zero = _mm_setzero_si128();
+   __m128i sum        = zero;
+
+   for (; i + 16 <= size; i += 16)
+   {
+      __m128i val = _mm_loadu_si128((const __m128i*)(data + i));
+      /* |x| of a signed byte is min(x, -x) taken as unsigned. */
+      __m128i mag = _mm_min_epu8(val, _mm_sub_epi8(zero, val));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(mag, zero));
+   }
+
+   cnt = _mm_cvtsi128_si32(sum) +
+      _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum, sum));
+#endif
+   for (; i < size; i++)
       cnt += abs((int8_t)data[i]);
    return cnt;
 }
@@ -882,9 +908,15 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
    width *= bpp;
-   for (i = 0; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i),
+            _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - prev[i];
 
    return count_sad(target, width);
@@ -897,7 +929,13 @@ static unsigned filter_sub(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i];
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i),
+            _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(line + i - bpp))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - line[i - bpp];
 
    return count_sad(target, width);
@@ -910,12 +948,45 @@ static unsigned filter_avg(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+      /* pavgb rounds up, PNG rounds down. */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+      _mm_storeu_si128((__m128i*)(target + i),
+            _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(line + i)), avg));
+   }
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
    return count_sad(target, width);
 }
 
+#if defined(__SSE2__)
+/* Paeth predictor for 8 pixels widened to 16 bits. With p = a + b - c,
+ * |p - a| = |b - c|, |p - b| = |a - c| and |p - c| = |a + b - 2c|. */
+static __m128i paeth_epi16(__m128i a, __m128i b, __m128i c)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i bc  = _mm_sub_epi16(b, c);
+   __m128i ac  = _mm_sub_epi16(a, c);
+   __m128i pc  = _mm_add_epi16(bc, ac);
+   __m128i pa  = _mm_max_epi16(bc, _mm_sub_epi16(zero, bc));
+   __m128i pb  = _mm_max_epi16(ac, _mm_sub_epi16(zero, ac));
+   __m128i not_a, use_c, b_or_c;
+
+   pc     = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+   not_a  = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+   use_c  = _mm_cmpgt_epi16(pb, pc);
+   b_or_c = _mm_or_si128(_mm_and_si128(use_c, c), _mm_andnot_si128(use_c, b));
+   return _mm_or_si128(_mm_and_si128(not_a, b_or_c), _mm_andnot_si128(not_a, a));
+}
+#endif
+
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
@@ -924,12 +995,191 @@ static unsigned filter_paeth(uint8_t *target,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+   {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i a = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+      __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+      __m128i pred = _mm_packus_epi16(
+            paeth_epi16(_mm_unpacklo_epi8(a, zero),
+               _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero)),
+            paeth_epi16(_mm_unpackhi_epi8(a, zero),
+               _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero)));
+      _mm_storeu_si128((__m128i*)(target + i),
+            _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(line + i)), pred));
+   }
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
    return count_sad(target, width);
 }
 
+/* The filtered image is deflated in strips, each on its own thread,
+ * and the strips are joined into a single zlib stream. Each strip
+ * gets the tail of the one before as its dictionary, so very little
+ * is lost to the split. */
+#define RPNG_STRIPS_MAX 4
+/* Smallest amount of filtered data worth a thread of its own. */
+#define RPNG_STRIP_MIN_SIZE (256 * 1024)
+#define RPNG_WINDOW_SIZE (32 * 1024)
+
+struct png_strip
+{
+   const uint8_t *data;
+   size_t size;
+   size_t dict_size;
+   bool last;
+
+   uint8_t *out;
+   size_t out_size;
+   uLong adler;
+   bool ok;
+};
+
+static void png_deflate_strip(void *data)
+{
+   int ret;
+   struct png_strip *strip = (struct png_strip*)data;
+   z_stream stream         = {0};
+
+   if (deflateInit2(&stream, 9, Z_DEFLATED, -15, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+      return;
+
+   if (strip->dict_size)
+      deflateSetDictionary(&stream, strip->data - strip->dict_size,
+            strip->dict_size);
+
+   /* Room for a sync flush on top of the worst case. */
+   strip->out_size = deflateBound(&stream, strip->size) + 16;
+   strip->out      = (uint8_t*)malloc(strip->out_size);
+   if (!strip->out)
+   {
+      deflateEnd(&stream);
+      return;
+   }
+
+   stream.next_in   = (Bytef*)strip->data;
+   stream.avail_in  = strip->size;
+   stream.next_out  = strip->out;
+   stream.avail_out = strip->out_size;
+
+   /* All but the last strip end on a byte boundary with no final
+    * block, so the next one can follow straight on. */
+   ret = deflate(&stream, strip->last ? Z_FINISH : Z_SYNC_FLUSH);
+   if (strip->last)
+      strip->ok = ret == Z_STREAM_END;
+   else
+      strip->ok = ret == Z_OK && !stream.avail_in && stream.avail_out;
+
+   strip->out_size = stream.total_out;
+   strip->adler    = adler32(adler32(0, NULL, 0), strip->data, strip->size);
+   deflateEnd(&stream);
+}
+
+static bool png_write_idat_strips(FILE *file,
+      const uint8_t *data, size_t size, size_t line_size)
+{
+   unsigned i, strips;
+   size_t total, lines;
+   uint32_t crc;
+   uLong adler;
+   bool ret = true;
+   uint8_t chunk[8];
+   uint8_t trailer[4];
+   /* Deflate, 32K window, best compression. */
+   static const uint8_t zlib_header[2] = { 0x78, 0xda };
+   struct png_strip strip[RPNG_STRIPS_MAX] = {{0}};
+#ifdef HAVE_THREADS
+   sthread_t *threads[RPNG_STRIPS_MAX] = {0};
+#endif
+
+   lines  = size / line_size;
+   strips = 1;
+#ifdef HAVE_THREADS
+   strips = size / RPNG_STRIP_MIN_SIZE;
+   if (strips > RPNG_STRIPS_MAX)
+      strips = RPNG_STRIPS_MAX;
+   if (strips > lines)
+      strips = lines;
+   if (strips < 1)
+      strips = 1;
+#endif
+
+   for (i = 0; i < strips; i++)
+   {
+      size_t begin = lines * i / strips * line_size;
+      size_t end   = lines * (i + 1) / strips * line_size;
+
+      strip[i].data      = data + begin;
+      strip[i].size      = end - begin;
+      strip[i].dict_size = begin < RPNG_WINDOW_SIZE ? begin : RPNG_WINDOW_SIZE;
+      strip[i].last      = i == strips - 1;
+   }
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < strips; i++)
+      threads[i] = sthread_create(png_deflate_strip, &strip[i]);
+#endif
+
+   png_deflate_strip(&strip[0]);
+
+   for (i = 1; i < strips; i++)
+   {
+#ifdef HAVE_THREADS
+      if (threads[i])
+      {
+         sthread_join(threads[i]);
+         continue;
+      }
+#endif
+      png_deflate_strip(&strip[i]);
+   }
+
+   total = sizeof(zlib_header) + sizeof(trailer);
+   adler = strip[0].adler;
+   for (i = 0; i < strips; i++)
+   {
+      if (!strip[i].ok)
+         GOTO_END_ERROR();
+      total += strip[i].out_size;
+      if (i)
+         adler = adler32_combine(adler, strip[i].adler, strip[i].size);
+   }
+   dword_write_be(trailer, adler);
+
+   dword_write_be(chunk, total);
+   memcpy(chunk + 4, "IDAT", 4);
+   crc = crc32(crc32(0, chunk + 4, 4), zlib_header, sizeof(zlib_header));
+
+   if (fwrite(chunk, 1, sizeof(chunk), file) != sizeof(chunk) ||
+         fwrite(zlib_header, 1, sizeof(zlib_header), file) != sizeof(zlib_header))
+      GOTO_END_ERROR();
+
+   for (i = 0; i < strips; i++)
+   {
+      if (fwrite(strip[i].out, 1, strip[i].out_size, file) != strip[i].out_size)
+         GOTO_END_ERROR();
+      crc = crc32(crc, strip[i].out, strip[i].out_size);
+   }
+
+   crc = crc32(crc, trailer, sizeof(trailer));
+   if (fwrite(trailer, 1, sizeof(trailer), file) != sizeof(trailer))
+      GOTO_END_ERROR();
+
+   dword_write_be(chunk, crc);
+   if (fwrite(chunk, 1, 4, file) != 4)
+      GOTO_END_ERROR();
+
+end:
+   for (i = 0; i < strips; i++)
+      free(strip[i].out);
+   return ret;
+}
+
 static bool rpng_save_image(const char *path,
       const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch, unsigned bpp)
@@ -940,7 +1190,6 @@ static bool rpng_save_image(const char *path,
 
    size_t encode_buf_size  = 0;
    uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
    uint8_t *rgba_line      = NULL;
    uint8_t *up_filtered    = NULL;
    uint8_t *sub_filtered   = NULL;
@@ -949,8 +1198,6 @@ static bool rpng_save_image(const char *path,
    uint8_t *prev_encoded   = NULL;
    uint8_t *encode_target  = NULL;
 
-   z_stream stream = {0};
-
    FILE *file = fopen(path, "wb");
    if (!file)
       GOTO_END_ERROR();
@@ -1038,29 +1285,17 @@ static bool rpng_save_image(const char *path,
       *encode_target++ = filter;
       memcpy(encode_target, chosen_filtered, width * bpp);
 
-      memcpy(prev_encoded, rgba_line, width * bpp);
-   }
-
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
-      GOTO_END_ERROR();
-
-   stream.next_in   = encode_buf;
-   stream.avail_in  = encode_buf_size;
-   stream.next_out  = deflate_buf + 8;
-   stream.avail_out = encode_buf_size * 2;
-
-   deflateInit(&stream, 9);
-   if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
-   {
-      deflateEnd(&stream);
-      GOTO_END_ERROR();
+      /* This line is the previous one for the next, swap
+       * instead of copying. */
+      {
+         uint8_t *tmp = prev_encoded;
+         prev_encoded = rgba_line;
+         rgba_line    = tmp;
+      }
    }
-   deflateEnd(&stream);
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0, stream.total_out);
-   if (!png_write_idat(file, deflate_buf, stream.total_out + 8))
+   if (!png_write_idat_strips(file, encode_buf, encode_buf_size,
+            width * bpp + 1))
       GOTO_END_ERROR();
 
    if (!png_write_iend(file))
@@ -1070,7 +1305,6 @@ end:
    if (file)
       fclose(file);
    free(encode_buf);
-   free(deflate_buf);
    free(rgba_line);
    free(prev_encoded);
    free(up_filtered);
@@ -1094,5 +1328,117 @@ bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
          width, height, pitch, 3);
 }
 
+#ifdef HAVE_THREADS
+struct rpng_save_job
+{
+   char *path;
+   uint8_t *data;
+   unsigned width;
+   unsigned height;
+   unsigned bpp;
+};
+
+static struct
+{
+   slock_t *lock;
+   scond_t *cond;
+   unsigned pending;
+} save_async;
+
+static void rpng_save_thread(void *data)
+{
+   struct rpng_save_job *job = (struct rpng_save_job*)data;
+
+   if (!rpng_save_image(job->path, job->data,
+            job->width, job->height, job->width * job->bpp, job->bpp))
+      fprintf(stderr, "[RPNG]: Failed to save \"%s\".\n", job->path);
+
+   free(job->path);
+   free(job->data);
+   free(job);
+
+   slock_lock(save_async.lock);
+   save_async.pending--;
+   scond_signal(save_async.cond);
+   slock_unlock(save_async.lock);
+}
+
+static bool rpng_save_image_async(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+{
+   unsigned h;
+   sthread_t *thread;
+   struct rpng_save_job *job;
+
+   if (!save_async.lock)
+   {
+      save_async.lock = slock_new();
+      save_async.cond = scond_new();
+      if (!save_async.lock || !save_async.cond)
+         return false;
+   }
+
+   job = (struct rpng_save_job*)calloc(1, sizeof(*job));
+   if (!job)
+      return false;
+
+   job->path   = strdup(path);
+   job->data   = (uint8_t*)malloc(width * height * bpp);
+   job->width  = width;
+   job->height = height;
+   job->bpp    = bpp;
+   if (!job->path || !job->data)
+      goto error;
+
+   for (h = 0; h < height; h++)
+      memcpy(job->data + h * width * bpp, data + h * pitch, width * bpp);
+
+   slock_lock(save_async.lock);
+   save_async.pending++;
+   slock_unlock(save_async.lock);
+
+   if (!(thread = sthread_create(rpng_save_thread, job)))
+   {
+      slock_lock(save_async.lock);
+      save_async.pending--;
+      slock_unlock(save_async.lock);
+      goto error;
+   }
+
+   sthread_detach(thread);
+   return true;
+
+error:
+   free(job->path);
+   free(job->data);
+   free(job);
+   return false;
+}
+
+bool rpng_save_image_argb_async(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   return rpng_save_image_async(path, (const uint8_t*)data,
+         width, height, pitch, sizeof(uint32_t));
+}
+
+bool rpng_save_image_bgr24_async(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   return rpng_save_image_async(path, data, width, height, pitch, 3);
+}
+
+void rpng_save_image_wait(void)
+{
+   if (!save_async.lock)
+      return;
+
+   slock_lock(save_async.lock);
+   while (save_async.pending)
+      scond_wait(save_async.cond, save_async.lock);
+   slock_unlock(save_async.lock);
+}
+#endif
+
 #endif
 
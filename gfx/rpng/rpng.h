@@ -36,6 +36,19 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch);
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
+
+#ifdef HAVE_THREADS
+/* Copies the image and encodes it on a thread of its own, so these
+ * return right away. Failures are only logged. Not safe to call
+ * from more than one thread. */
+bool rpng_save_image_argb_async(const char *path, const uint32_t *data,
+      unsigned width, unsigned height, unsigned pitch);
+bool rpng_save_image_bgr24_async(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch);
+
+/* Blocks until every async save has been written. */
+void rpng_save_image_wait(void);
+#endif
 #endif
 
 #ifdef __cplusplus
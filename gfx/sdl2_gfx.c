@@ -704,7 +704,7 @@ static video_poke_interface_t sdl2_video_poke_interface = {
 #endif
    sdl2_poke_set_osd_msg,
    sdl2_show_mouse,
-   sdl2_grab_mouse_toggle,
+   NULL,
    NULL,
 };
 
@@ -469,13 +469,6 @@ static void sdl_show_mouse(void *data, bool state)
    SDL_ShowCursor(state);
 }
 
-static void sdl_grab_mouse_toggle(void *data)
-{
-   (void)data;
-   const SDL_GrabMode mode = SDL_WM_GrabInput(SDL_GRAB_QUERY);
-   SDL_WM_GrabInput(mode == SDL_GRAB_ON ? SDL_GRAB_OFF : SDL_GRAB_ON);
-}
-
 static const video_poke_interface_t sdl_poke_interface = {
    sdl_set_filtering,
 #ifdef HAVE_FBO
@@ -490,7 +483,7 @@ static const video_poke_interface_t sdl_poke_interface = {
 #endif
    NULL,
    sdl_show_mouse,
-   sdl_grab_mouse_toggle,
+   NULL,
    NULL
 };
 
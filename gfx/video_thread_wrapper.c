@@ -92,11 +92,28 @@ static void thread_loop(void *data)
    {
       bool ret = false;
       bool updated = false;
+      bool fresh = false;
       slock_lock(thr->lock);
       while (thr->send_cmd == CMD_NONE && !thr->frame.updated)
          scond_wait(thr->cond_thread, thr->lock);
       if (thr->frame.updated)
+      {
+         /* Take the newest frame. The main thread can fill
+          * the other two slots while this one is rendered. */
+         if (thr->frame.ready_new)
+         {
+            unsigned read      = thr->frame.read;
+            thr->frame.read    = thr->frame.ready;
+            thr->frame.ready   = read;
+            thr->frame.ready_new = false;
+            fresh = true;
+         }
+         strlcpy(thr->frame.render_msg, thr->frame.msg,
+               sizeof(thr->frame.render_msg));
+         thr->frame.updated   = false;
+         thr->frame.rendering = true;
          updated = true;
+      }
 
       /* To avoid race condition where send_cmd is updated 
        * right after the switch is checked. */
@@ -295,10 +312,14 @@ static void thread_loop(void *data)
          bool has_windowed = true;
          struct rarch_viewport vp = {0};
 
+         /* Nothing new came in, so it's a dupe. */
          if (thr->driver && thr->driver->frame)
             ret = thr->driver->frame(thr->driver_data,
-               thr->frame.buffer, thr->frame.width, thr->frame.height,
-               thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+               fresh ? thr->frame.slot[thr->frame.read].buffer : NULL,
+               thr->frame.slot[thr->frame.read].width,
+               thr->frame.slot[thr->frame.read].height,
+               thr->frame.slot[thr->frame.read].pitch,
+               *thr->frame.render_msg ? thr->frame.render_msg : NULL);
 
          slock_unlock(thr->frame.lock);
 
@@ -318,7 +339,7 @@ static void thread_loop(void *data)
          thr->alive = alive;
          thr->focus = focus;
          thr->has_windowed = has_windowed;
-         thr->frame.updated = false;
+         thr->frame.rendering = false;
          thr->vp = vp;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
@@ -403,7 +424,6 @@ static bool thread_frame(void *data, const void *frame_,
          sizeof(uint32_t) : sizeof(uint16_t));
 
    const uint8_t *src = (const uint8_t*)frame_;
-   uint8_t *dst = thr->frame.buffer;
 
    slock_lock(thr->lock);
 
@@ -414,7 +434,7 @@ static bool thread_frame(void *data, const void *frame_,
       retro_time_t target = thr->last_time + target_frame_time;
 
       /* Ideally, use absolute time, but that is only a good idea on POSIX. */
-      while (thr->frame.updated)
+      while (thr->frame.updated || thr->frame.rendering)
       {
          retro_time_t current = rarch_get_time_usec();
          retro_time_t delta = target - current;
@@ -427,40 +447,69 @@ static bool thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is 
-    * still working on last frame. */
-   if (!thr->frame.updated)
+   slock_unlock(thr->lock);
+
+   /* slot[write] is ours alone, no need to hold the lock for the copy.
+    * A core which rendered into it through
+    * GET_CURRENT_SOFTWARE_FRAMEBUFFER needs no copy at all. */
+   if (src)
    {
-      if (src)
+      uint8_t *dst = thr->frame.slot[thr->frame.write].buffer;
+
+      if (src == dst)
+         thr->stats.zero_copy++;
+      else
       {
          unsigned h;
+         retro_time_t copy_time = rarch_get_time_usec();
+
          for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
             memcpy(dst, src, copy_stride);
+
+         copy_time = rarch_get_time_usec() - copy_time;
+         thr->stats.copied++;
+         thr->stats.copy_time += copy_time;
+         if (copy_time > thr->stats.copy_max)
+            thr->stats.copy_max = copy_time;
       }
 
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.pitch  = copy_stride;
+      thr->frame.slot[thr->frame.write].width  = width;
+      thr->frame.slot[thr->frame.write].height = height;
+      thr->frame.slot[thr->frame.write].pitch  = copy_stride;
+   }
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   slock_lock(thr->lock);
 
-      scond_signal(thr->cond_thread);
+   /* If the thread still hasn't picked up the last fresh frame,
+    * this one replaces it. Dupes don't replace anything. */
+   if (frame_ && thr->frame.ready_new)
+      thr->stats.dropped++;
 
-#if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
-#endif
-      thr->hit_count++;
+   if (frame_)
+   {
+      unsigned write     = thr->frame.write;
+      thr->frame.write   = thr->frame.ready;
+      thr->frame.ready   = write;
+      thr->frame.ready_new = true;
    }
+
+   thr->frame.updated = true;
+
+   if (msg)
+      strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
    else
-      thr->miss_count++;
+      *thr->frame.msg = '\0';
+
+   scond_signal(thr->cond_thread);
+
+#if defined(HAVE_MENU)
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated || thr->frame.rendering)
+         scond_wait(thr->cond_cmd, thr->lock);
+   }
+#endif
+   thr->stats.frames++;
 
    slock_unlock(thr->lock);
 
@@ -479,6 +528,8 @@ static void thread_set_nonblock_state(void *data, bool state)
 static bool thread_init(thread_video_t *thr, const video_info_t *info,
       const input_driver_t **input, void **input_data)
 {
+   unsigned i;
+
    thr->lock = slock_new();
    thr->alpha_lock = slock_new();
    thr->frame.lock = slock_new();
@@ -494,11 +545,19 @@ static bool thread_init(thread_video_t *thr, const video_info_t *info,
    size_t max_size = info->input_scale * RARCH_SCALE_BASE;
    max_size *= max_size;
    max_size *= info->rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer = (uint8_t*)malloc(max_size);
-   if (!thr->frame.buffer)
-      return false;
+   thr->frame.slot_size = max_size;
 
-   memset(thr->frame.buffer, 0x80, max_size);
+   for (i = 0; i < 3; i++)
+   {
+      thr->frame.slot[i].buffer = (uint8_t*)malloc(max_size);
+      if (!thr->frame.slot[i].buffer)
+         return false;
+
+      memset(thr->frame.slot[i].buffer, 0x80, max_size);
+   }
+   thr->frame.write = 0;
+   thr->frame.ready = 1;
+   thr->frame.read  = 2;
 
    thr->last_time = rarch_get_time_usec();
 
@@ -560,6 +619,7 @@ static bool thread_read_viewport(void *data, uint8_t *buffer)
 
 static void thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    if (!thr)
       return;
@@ -571,7 +631,8 @@ static void thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < 3; i++)
+      free(thr->frame.slot[i].buffer);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -580,8 +641,12 @@ static void thread_free(void *data)
    free(thr->alpha_mod);
    slock_free(thr->alpha_lock);
 
-   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u, "
+         "Zero copy: %u, Copy: %.3f ms avg, %.3f ms max.\n",
+         thr->stats.frames, thr->stats.dropped, thr->stats.zero_copy,
+         thr->stats.copied ?
+         thr->stats.copy_time / (1000.0 * thr->stats.copied) : 0.0,
+         thr->stats.copy_max / 1000.0);
 
    free(thr);
 }
@@ -748,6 +813,31 @@ static void thread_set_osd_msg(void *data, const char *msg, const struct font_pa
 #endif
 }
 
+/* Hands out slot[write], which nothing else touches until the
+ * next frame is pushed. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   thread_video_t *thr = (thread_video_t*)data;
+   unsigned bpp = thr->info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
+
+   /* 0RGB1555 is converted and a softfilter renders into its own
+    * buffer before the frame gets here, so it would be copied anyway. */
+   if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555 ||
+         g_extern.filter.filter)
+      return false;
+
+   if ((size_t)framebuffer->width * framebuffer->height * bpp >
+         thr->frame.slot_size)
+      return false;
+
+   framebuffer->data         = thr->frame.slot[thr->frame.write].buffer;
+   framebuffer->pitch        = framebuffer->width * bpp;
+   framebuffer->format       = g_extern.system.pix_fmt;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+   return true;
+}
+
 static void thread_apply_state_changes(void *data)
 {
    thread_video_t *thr = (thread_video_t*)data;
@@ -782,6 +872,7 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
   // thread_get_current_shader,
+   thread_get_current_software_framebuffer,
 };
 
 static void thread_get_poke_interface(void *data,
@@ -855,6 +946,12 @@ bool rarch_threaded_video_init(const video_driver_t **out_driver,
    return thread_init(thr, info, input, input_data);
 }
 
+void rarch_threaded_video_get_stats(struct thread_video_stats *stats)
+{
+   const thread_video_t *thr = (const thread_video_t*)driver.video_data;
+   *stats = thr->stats;
+}
+
 void *rarch_threaded_video_resolve(const video_driver_t **drv)
 {
    const thread_video_t *thr = (const thread_video_t*)driver.video_data;
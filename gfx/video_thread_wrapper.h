@@ -30,6 +30,23 @@ bool rarch_threaded_video_init(
 
 void *rarch_threaded_video_resolve(const video_driver_t **drv);
 
+struct thread_video_stats
+{
+   /* Frames handed to the video thread. */
+   unsigned frames;
+   /* Frames replaced by a newer one before the thread took them. */
+   unsigned dropped;
+   /* Frames the core rendered straight into a slot. */
+   unsigned zero_copy;
+   /* Frames copied into a slot, and the time that took. */
+   unsigned copied;
+   retro_time_t copy_time;
+   retro_time_t copy_max;
+};
+
+/* Only valid while the threaded wrapper is the active driver. */
+void rarch_threaded_video_get_stats(struct thread_video_stats *stats);
+
 enum thread_cmd
 {
    CMD_NONE = 0,
@@ -101,8 +118,7 @@ typedef struct thread_video
    bool nonblock;
 
    retro_time_t last_time;
-   unsigned hit_count;
-   unsigned miss_count;
+   struct thread_video_stats stats;
 
    float *alpha_mod;
    unsigned alpha_mods;
@@ -164,16 +180,30 @@ typedef struct thread_video
    struct rarch_viewport vp;
    struct rarch_viewport read_vp; /* Last viewport reported to caller. */
 
+   /* Triple buffered. The main thread fills slot[write], then swaps
+    * it with slot[ready]. The video thread swaps slot[ready] with
+    * slot[read] when it starts on a frame, so it always gets the
+    * newest one and neither side waits on the other's copy. */
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      bool updated;
+      struct
+      {
+         uint8_t *buffer;
+         unsigned width;
+         unsigned height;
+         unsigned pitch;
+      } slot[3];
+      size_t slot_size;
+      unsigned write;
+      unsigned ready;
+      unsigned read;
+      bool ready_new;  /* slot[ready] holds a frame not taken yet. */
+      bool updated;    /* A frame is waiting to be rendered. */
+      bool rendering;  /* The video thread is rendering one. */
       bool within_thread;
       char msg[PATH_MAX];
+      char render_msg[PATH_MAX];
    } frame;
 
    video_driver_t video_thread;
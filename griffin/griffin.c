@@ -57,6 +57,8 @@ PERFORMANCE
 #endif
 
 #include "../performance.c"
+#include "../frame_pacing.c"
+#include "../benchmark.c"
 
 /*============================================================
 COMPATIBILITY
@@ -599,6 +601,7 @@ FRONTEND
 #include "../frontend/platform/platform_null.c"
 
 #include "../core_info.c"
+#include "../core_info_cache.c"
 
 /*============================================================
 MAIN
@@ -622,6 +625,9 @@ RECORDING
 ============================================================ */
 #include "../movie.c"
 #include "../record/ffemu.c"
+#ifdef HAVE_THREADS
+#include "../record/lossless.c"
+#endif
 
 /*============================================================
 THREAD
@@ -633,6 +639,8 @@ THREAD
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #include "../autosave.c"
+#include "../save_queue.c"
+#include "../spsc_fifo.c"
 #endif
 
 
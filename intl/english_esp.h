@@ -53,7 +53,7 @@
 #define RETRO_LBL_STATE_SLOT_PLUS "State Slot Plus"
 #define RETRO_LBL_STATE_SLOT_MINUS "State Slot Minus"
 #define RETRO_LBL_REWIND "Rewind"
-//#define RETRO_LBL_MOVIE_RECORD_TOGGLE "Movie Record Toggle"
+#define RETRO_LBL_MOVIE_RECORD_TOGGLE "Movie Record Toggle"
 #define RETRO_LBL_PAUSE_TOGGLE "Pause Toggle"
 #define RETRO_LBL_FRAMEADVANCE "Frame Advance"
 #define RETRO_LBL_RESET "Reset"
@@ -43,10 +43,116 @@
 
 #define MAX_INCLUDE_DEPTH 16
 
+/* Smallest index, and the load factor it is kept under. */
+#define CONFIG_INDEX_MIN_SIZE 64
+#define CONFIG_INDEX_MAX_LOAD(size) ((size) / 4 * 3)
+
+struct config_index_slot
+{
+   uint32_t hash;
+   struct config_entry_list *entry;
+};
 
 static config_file_t *config_file_new_internal(const char *path, unsigned depth);
 void config_file_free(config_file_t *conf);
 
+/* FNV-1a. */
+static uint32_t config_hash(const char *key)
+{
+   uint32_t hash = 2166136261u;
+
+   while (*key)
+   {
+      hash ^= (uint8_t)*key++;
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+/* Returns the slot holding key, or the empty slot it belongs in.
+ * Entries are never removed, so there are no tombstones to skip. */
+static struct config_index_slot *config_index_find(
+      const config_file_t *conf, const char *key, uint32_t hash)
+{
+   size_t mask = conf->index_size - 1;
+   size_t i    = hash & mask;
+
+   for (;; i = (i + 1) & mask)
+   {
+      struct config_index_slot *slot = &conf->index[i];
+
+      if (!slot->entry)
+         return slot;
+      if (slot->hash == hash && strcmp(slot->entry->key, key) == 0)
+         return slot;
+   }
+}
+
+static void config_index_insert(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   uint32_t hash = config_hash(entry->key);
+   struct config_index_slot *slot = config_index_find(conf, entry->key, hash);
+
+   /* Earlier entries take priority. */
+   if (slot->entry)
+      return;
+
+   slot->hash  = hash;
+   slot->entry = entry;
+   conf->index_used++;
+}
+
+/* Indexes the entry list from scratch. If that runs out of memory,
+ * lookups walk the list instead until the next rebuild. */
+static void config_index_rebuild(config_file_t *conf)
+{
+   size_t count = 0, size = CONFIG_INDEX_MIN_SIZE;
+   struct config_entry_list *list;
+
+   for (list = conf->entries; list; list = list->next)
+      count++;
+   while (CONFIG_INDEX_MAX_LOAD(size) < count * 2)
+      size *= 2;
+
+   free(conf->index);
+   conf->index      = (struct config_index_slot*)calloc(size, sizeof(*conf->index));
+   conf->index_size = conf->index ? size : 0;
+   conf->index_used = 0;
+
+   if (!conf->index)
+      return;
+
+   for (list = conf->entries; list; list = list->next)
+      config_index_insert(conf, list);
+}
+
+/* Call after entry has been linked in at the end of the list. */
+static void config_index_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   if (conf->index_used + 1 > CONFIG_INDEX_MAX_LOAD(conf->index_size))
+      config_index_rebuild(conf);
+   else
+      config_index_insert(conf, entry);
+}
+
+static struct config_entry_list *config_get_entry(
+      const config_file_t *conf, const char *key)
+{
+   struct config_entry_list *list;
+
+   if (conf->index)
+      return config_index_find(conf, key, config_hash(key))->entry;
+
+   for (list = conf->entries; list; list = list->next)
+      if (strcmp(key, list->key) == 0)
+         return list;
+
+   return NULL;
+}
+
 static char *getaline(FILE *file)
 {
    char* newline = (char*)malloc(9);
@@ -161,6 +267,8 @@ static void add_child_list(config_file_t *parent, config_file_t *child)
    }
    else
       parent->tail = NULL;
+
+   config_index_rebuild(parent);
 }
 
 static void add_include_list(config_file_t *conf, const char *path)
@@ -347,6 +455,10 @@ bool config_append_file(config_file_t *conf, const char *path)
       new_conf->tail->next = conf->entries;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+
+      if (!conf->tail)
+         conf->tail = new_conf->tail;
+      config_index_rebuild(conf);
    }
 
    config_file_free(new_conf);
@@ -406,6 +518,7 @@ static config_file_t *config_file_new_internal(
                conf->entries = list;
 
             conf->tail = list;
+            config_index_add(conf, list);
          }
 
          free(line);
@@ -460,6 +573,7 @@ config_file_t *config_file_new_from_string(const char *from_string)
                conf->entries = list;
 
             conf->tail = list;
+            config_index_add(conf, list);
          }
       }
 
@@ -505,182 +619,135 @@ void config_file_free(config_file_t *conf)
       free(hold);
    }
 
+   free(conf->index);
    free(conf->path);
    free(conf);
 }
 
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *in = strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   *in = strtod(entry->value, NULL);
+   return true;
 }
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         /* strtof() is C99/POSIX. Just use the more portable kind. */
-         *in = (float)strtod(list->value, NULL);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   /* strtof() is C99/POSIX. Just use the more portable kind. */
+   *in = (float)strtod(entry->value, NULL);
+   return true;
 }
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   struct config_entry_list *list = conf->entries;
+   int val;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         int val;
-         errno = 0;
-         val = strtol(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   errno = 0;
+   val = strtol(entry->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   struct config_entry_list *list = conf->entries;
+   uint64_t val;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         uint64_t val;
-         errno = 0;
-         val = strtoull(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   errno = 0;
+   val = strtoull(entry->value, NULL, 0);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list != NULL)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 0);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
+   if (!entry)
+      return false;
+
+   errno = 0;
+   val = strtoul(entry->value, NULL, 0);
+   if (errno != 0)
+      return false;
 
-   return false;
+   *in = val;
+   return true;
 }
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   struct config_entry_list *list = conf->entries;
+   unsigned val;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         unsigned val;
-         errno = 0;
-         val = strtoul(list->value, NULL, 16);
-         if (errno == 0)
-         {
-            *in = val;
-            return true;
-         }
-         return false;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   errno = 0;
+   val = strtoul(entry->value, NULL, 16);
+   if (errno != 0)
+      return false;
+
+   *in = val;
+   return true;
 }
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (list->value[0] && list->value[1])
-            return false;
-         *in = *list->value;
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+   if (entry->value[0] && entry->value[1])
+      return false;
+
+   *in = *entry->value;
+   return true;
 }
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         *str = strdup(list->value);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   *str = strdup(entry->value);
+   return true;
 }
 
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-         return strlcpy(buf, list->value, size) < size;
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   return strlcpy(buf, entry->value, size) < size;
 }
 
 bool config_get_path(config_file_t *conf, const char *key,
@@ -689,63 +756,52 @@ bool config_get_path(config_file_t *conf, const char *key,
 #if defined(RARCH_CONSOLE)
    return config_get_array(conf, key, buf, size);
 #else
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         fill_pathname_expand_special(buf, list->value, size);
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (!entry)
+      return false;
+
+   fill_pathname_expand_special(buf, entry->value, size);
+   return true;
 #endif
 }
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   struct config_entry_list *list = conf->entries;
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
-   while (list)
-   {
-      if (strcmp(key, list->key) == 0)
-      {
-         if (strcasecmp(list->value, "true") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "1") == 0)
-            *in = true;
-         else if (strcasecmp(list->value, "false") == 0)
-            *in = false;
-         else if (strcasecmp(list->value, "0") == 0)
-            *in = false;
-         else
-            return false;
+   if (!entry)
+      return false;
 
-         return true;
-      }
-      list = list->next;
-   }
-   return false;
+   if (strcasecmp(entry->value, "true") == 0)
+      *in = true;
+   else if (strcasecmp(entry->value, "1") == 0)
+      *in = true;
+   else if (strcasecmp(entry->value, "false") == 0)
+      *in = false;
+   else if (strcasecmp(entry->value, "0") == 0)
+      *in = false;
+   else
+      return false;
+
+   return true;
 }
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
    struct config_entry_list *elem = NULL;
-   struct config_entry_list *list = conf->entries;
-   struct config_entry_list *last = list;
-   while (list)
-   {
-      if (!list->readonly && (strcmp(key, list->key) == 0))
-      {
-         free(list->value);
-         list->value = strdup(val);
-         return;
-      }
+   struct config_entry_list *list = config_get_entry(conf, key);
 
-      last = list;
+   /* Entries from an #include stay as they are, look for
+    * a writable one further down. */
+   while (list && (list->readonly || strcmp(key, list->key) != 0))
       list = list->next;
+
+   if (list)
+   {
+      free(list->value);
+      list->value = strdup(val);
+      return;
    }
 
    elem = (struct config_entry_list*)calloc(1, sizeof(*elem));
@@ -756,10 +812,13 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    elem->key = strdup(key);
    elem->value = strdup(val);
 
-   if (last)
-      last->next = elem;
+   if (conf->tail)
+      conf->tail->next = elem;
    else
       conf->entries = elem;
+
+   conf->tail = elem;
+   config_index_add(conf, elem);
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -870,16 +929,7 @@ void config_file_dump(config_file_t *conf, FILE *file)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (strcmp(entry, list->key) == 0)
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
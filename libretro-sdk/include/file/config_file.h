@@ -49,6 +49,8 @@ struct config_include_list
    struct config_include_list *next;
 };
 
+struct config_index_slot;
+
 struct config_file
 {
    char *path;
@@ -57,6 +59,13 @@ struct config_file
    unsigned include_depth;
 
    struct config_include_list *includes;
+
+   /* Open addressed hash index pointing at the first entry
+    * of every key. index_size is a power of two, or 0 if
+    * lookups have to fall back to walking entries. */
+   struct config_index_slot *index;
+   size_t index_size;
+   size_t index_used;
 };
 
 typedef struct config_file config_file_t;
@@ -35,6 +35,23 @@
 #include "netplay.h"
 #endif
 
+static void recording_dump_frame(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+   struct ffemu_video_data ffemu_data = {0};
+
+   /* Nothing to read back from a HW rendered frame here,
+    * so it goes in as a repeat of the last one. */
+   ffemu_data.data    = data;
+   ffemu_data.width   = width;
+   ffemu_data.height  = height;
+   ffemu_data.pitch   = (int)pitch;
+   ffemu_data.is_dupe = !data || data == RETRO_HW_FRAME_BUFFER_VALID;
+
+   if (driver.recording && driver.recording->push_video)
+      driver.recording->push_video(driver.recording_data, &ffemu_data);
+}
+
 static void video_frame(const void *data, unsigned width,
       unsigned height, size_t pitch)
 {
@@ -63,6 +80,14 @@ static void video_frame(const void *data, unsigned width,
       pitch = driver.scaler.out_stride;
    }
 
+   /* Slightly messy code,
+    * but we really need to do processing before blocking on VSync
+    * for best possible scheduling.
+    */
+   if (driver.recording_data && (!g_extern.filter.filter
+            || !g_settings.video.post_filter_record || !data))
+      recording_dump_frame(data, width, height, pitch);
+
    msg = msg_queue_pull(g_extern.msg_queue);
    driver.current_msg = msg;
 
@@ -76,13 +101,19 @@ static void video_frame(const void *data, unsigned width,
             &owidth, &oheight, width, height);
 
       opitch = owidth * g_extern.filter.out_bpp;
+
+      RARCH_PERFORMANCE_INIT(softfilter_process);
+      RARCH_PERFORMANCE_START(softfilter_process);
+      rarch_perf_stage_begin(RARCH_PERF_STAGE_SOFTFILTER);
       rarch_softfilter_process(g_extern.filter.filter,
             g_extern.filter.buffer, opitch,
             data, width, height, pitch);
+      rarch_perf_stage_end(RARCH_PERF_STAGE_SOFTFILTER);
+      RARCH_PERFORMANCE_STOP(softfilter_process);
 
-    /*  if (driver.recording_data && g_settings.video.post_filter_record)
-         rarch_recording_dump_frame(g_extern.filter.buffer,
-               owidth, oheight, opitch);*/
+      if (driver.recording_data && g_settings.video.post_filter_record)
+         recording_dump_frame(g_extern.filter.buffer,
+               owidth, oheight, opitch);
 
       data = g_extern.filter.buffer;
       width = owidth;
@@ -90,8 +121,10 @@ static void video_frame(const void *data, unsigned width,
       pitch = opitch;
    }
 
+   rarch_perf_stage_begin(RARCH_PERF_STAGE_VIDEO_FRAME);
    if (!driver.video->frame(driver.video_data, data, width, height, pitch, msg))
       driver.video_active = false;
+   rarch_perf_stage_end(RARCH_PERF_STAGE_VIDEO_FRAME);
 }
 
 static void readjust_audio_input_rate(void)
@@ -107,10 +140,22 @@ static void readjust_audio_input_rate(void)
    unsigned write_idx = g_extern.measure_data.buffer_free_samples_count++ &
       (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
    int      half_size   = g_extern.audio_data.driver_buffer_size / 2;
-   int      delta_mid   = avail - half_size;
-   double   direction   = (double)delta_mid / half_size;
-   double   adjust      = 1.0 + g_settings.audio.rate_control_delta *
-      direction;
+   int      free_space  = avail;
+   int      delta_mid;
+   double   direction;
+   double   adjust;
+
+   /* A pipelined DSP chain holds frames back that are on their way
+    * to the driver. Count them as written already, or rate control
+    * sees the buffer that much emptier than it will be. */
+   if (g_extern.audio_data.dsp)
+      free_space -= (int)(rarch_dsp_filter_latency(g_extern.audio_data.dsp) *
+            g_extern.audio_data.src_ratio * 2 *
+            (g_extern.audio_data.use_float ? sizeof(float) : sizeof(int16_t)));
+
+   delta_mid = free_space - half_size;
+   direction = (double)delta_mid / half_size;
+   adjust    = 1.0 + g_settings.audio.rate_control_delta * direction;
 
    g_extern.measure_data.buffer_free_samples[write_idx] = avail;
    g_extern.audio_data.src_ratio = g_extern.audio_data.orig_src_ratio * adjust;
@@ -121,15 +166,21 @@ static void readjust_audio_input_rate(void)
 
 //static vu16* AVE_VOL = (vu16*)0xCC006C06;
 
+/* Frames run through the whole audio chain at a time. Small enough
+ * that the float, DSP and resampled copies of a block stay in L1. */
+#define AUDIO_FLUSH_BLOCK_FRAMES 256
+
 static bool audio_flush(const int16_t *data, size_t samples)
 {
-   const void *output_data        = NULL;
-   unsigned output_frames         = 0;
-   size_t   output_size           = sizeof(float);
-   struct resampler_data src_data = {0};
-   struct rarch_dsp_data dsp_data = {0};
-
- /*  if (driver.recording_data)
+   const void *output_data = NULL;
+   unsigned output_frames  = 0;
+   size_t   output_size    = sizeof(float);
+   size_t   converted      = 0;
+   size_t   in_pos, block_samples = 0;
+   bool     in_place;
+   double   ratio;
+
+   if (driver.recording_data)
    {
       struct ffemu_audio_data ffemu_data = {0};
       ffemu_data.data                    = data;
@@ -137,7 +188,7 @@ static bool audio_flush(const int16_t *data, size_t samples)
 
       if (driver.recording && driver.recording->push_audio)
          driver.recording->push_audio(driver.recording_data, &ffemu_data);
-   }*/
+   }
 
    /* Many cores have audio pops at start. I'm using frame_count to "cut" bad audio. */
    /*if (g_extern.frame_count < g_settings.audio.mute_frames) {
@@ -155,64 +206,118 @@ static bool audio_flush(const int16_t *data, size_t samples)
    if (!driver.audio_active || !g_extern.audio_data.data)
       return false;
 
-  // RARCH_PERFORMANCE_INIT(audio_convert_s16);
-  // RARCH_PERFORMANCE_START(audio_convert_s16);
-   audio_convert_s16_to_float(g_extern.audio_data.data, data, samples,
-         g_extern.audio_data.volume_gain);
-   //RARCH_PERFORMANCE_STOP(audio_convert_s16);
+   RARCH_PERFORMANCE_INIT(audio_flush);
+   RARCH_PERFORMANCE_INIT(audio_convert_s16);
+   RARCH_PERFORMANCE_INIT(audio_dsp);
+   RARCH_PERFORMANCE_INIT(resampler_proc);
+   RARCH_PERFORMANCE_INIT(audio_convert_float);
+   RARCH_PERFORMANCE_START(audio_flush);
+   rarch_perf_stage_begin(RARCH_PERF_STAGE_AUDIO_FLUSH);
 
-   dsp_data.input                 = g_extern.audio_data.data;
-   dsp_data.input_frames          = samples >> 1;
+   if (g_extern.audio_data.rate_control)
+      readjust_audio_input_rate();
 
-   if (g_extern.audio_data.dsp)
+   ratio = g_extern.audio_data.src_ratio;
+   if (g_extern.is_slowmotion)
+      ratio *= g_settings.slowmotion_ratio;
+
+   /* audio_sample() hands us conv_outsamples itself. The s16 output
+    * then may not run ahead of the input we have read so far. */
+   in_place = data == g_extern.audio_data.conv_outsamples;
+
+   /* Run each block through every stage before starting the next,
+    * so the intermediate buffers stay hot in cache instead of
+    * making four passes over the whole chunk. */
+   for (in_pos = 0; in_pos < samples; in_pos += block_samples)
    {
-     // RARCH_PERFORMANCE_INIT(audio_dsp);
-      //RARCH_PERFORMANCE_START(audio_dsp);
-      rarch_dsp_filter_process(g_extern.audio_data.dsp, &dsp_data);
-     // RARCH_PERFORMANCE_STOP(audio_dsp);
-   }
+      struct resampler_data src_data = {0};
+      struct rarch_dsp_data dsp_data = {0};
 
-   src_data.data_in      = dsp_data.output ?
-      dsp_data.output : g_extern.audio_data.data;
-   src_data.input_frames = dsp_data.output ?
-      dsp_data.output_frames : (samples >> 1);
+      block_samples = samples - in_pos;
+      if (block_samples > AUDIO_FLUSH_BLOCK_FRAMES * 2)
+         block_samples = AUDIO_FLUSH_BLOCK_FRAMES * 2;
 
-   src_data.data_out = g_extern.audio_data.outsamples;
+      RARCH_PERFORMANCE_START(audio_convert_s16);
+      audio_convert_s16_to_float(g_extern.audio_data.data, data + in_pos,
+            block_samples, g_extern.audio_data.volume_gain);
+      RARCH_PERFORMANCE_STOP(audio_convert_s16);
 
-   if (g_extern.audio_data.rate_control)
-      readjust_audio_input_rate();
+      dsp_data.input        = g_extern.audio_data.data;
+      dsp_data.input_frames = block_samples >> 1;
 
-   src_data.ratio = g_extern.audio_data.src_ratio;
-   if (g_extern.is_slowmotion)
-      src_data.ratio *= g_settings.slowmotion_ratio;
+      if (g_extern.audio_data.dsp)
+      {
+         RARCH_PERFORMANCE_START(audio_dsp);
+         rarch_dsp_filter_process(g_extern.audio_data.dsp, &dsp_data);
+         RARCH_PERFORMANCE_STOP(audio_dsp);
+      }
+
+      src_data.data_in      = dsp_data.output ?
+         dsp_data.output : g_extern.audio_data.data;
+      src_data.input_frames = dsp_data.output ?
+         dsp_data.output_frames : (block_samples >> 1);
+      src_data.data_out     = g_extern.audio_data.outsamples +
+         output_frames * 2;
+      src_data.ratio        = ratio;
+
+      RARCH_PERFORMANCE_START(resampler_proc);
+      rarch_resampler_process(driver.resampler,
+            driver.resampler_data, &src_data);
+      RARCH_PERFORMANCE_STOP(resampler_proc);
 
- //  RARCH_PERFORMANCE_INIT(resampler_proc);
-  // RARCH_PERFORMANCE_START(resampler_proc);
-   rarch_resampler_process(driver.resampler,
-         driver.resampler_data, &src_data);
-  // RARCH_PERFORMANCE_STOP(resampler_proc);
+      output_frames += src_data.output_frames;
 
-   output_data   = g_extern.audio_data.outsamples;
-   output_frames = src_data.output_frames;
+      if (!g_extern.audio_data.use_float)
+      {
+         size_t out_samples = output_frames * 2;
+         if (in_place && out_samples > in_pos + block_samples)
+            out_samples = in_pos + block_samples;
+
+         if (out_samples > converted)
+         {
+            RARCH_PERFORMANCE_START(audio_convert_float);
+            audio_convert_float_to_s16(
+                  g_extern.audio_data.conv_outsamples + converted,
+                  g_extern.audio_data.outsamples + converted,
+                  out_samples - converted);
+            RARCH_PERFORMANCE_STOP(audio_convert_float);
+            converted = out_samples;
+         }
+      }
+   }
+
+   output_data = g_extern.audio_data.outsamples;
 
    if (!g_extern.audio_data.use_float)
    {
-    //  RARCH_PERFORMANCE_INIT(audio_convert_float);
-     // RARCH_PERFORMANCE_START(audio_convert_float);
-      audio_convert_float_to_s16(g_extern.audio_data.conv_outsamples,
-            (const float*)output_data, output_frames * 2);
-    //  RARCH_PERFORMANCE_STOP(audio_convert_float);
+      /* Whatever had to wait for the input to be read. */
+      if (output_frames * 2 > converted)
+      {
+         RARCH_PERFORMANCE_START(audio_convert_float);
+         audio_convert_float_to_s16(
+               g_extern.audio_data.conv_outsamples + converted,
+               g_extern.audio_data.outsamples + converted,
+               output_frames * 2 - converted);
+         RARCH_PERFORMANCE_STOP(audio_convert_float);
+      }
 
       output_data = g_extern.audio_data.conv_outsamples;
       output_size = sizeof(int16_t);
    }
 
+   RARCH_PERFORMANCE_STOP(audio_flush);
+   rarch_perf_stage_end(RARCH_PERF_STAGE_AUDIO_FLUSH);
+
+   /* Timed on its own, a blocking driver waits in here. */
+   rarch_perf_stage_begin(RARCH_PERF_STAGE_AUDIO_WRITE);
    if (driver.audio->write(driver.audio_data, output_data,
             output_frames * output_size * 2) < 0)
    {
+      rarch_perf_stage_end(RARCH_PERF_STAGE_AUDIO_WRITE);
       RARCH_ERR(RETRO_LOG_AUDIO_WRITE_FAILED);
       return false;
    }
+   rarch_perf_stage_end(RARCH_PERF_STAGE_AUDIO_WRITE);
 
    return true;
 }
@@ -265,22 +370,11 @@ static bool input_apply_turbo(unsigned port, unsigned id, bool res)
    return res;
 }
 
-static int16_t input_state(unsigned port, unsigned device,
+static int16_t input_state_resolve(unsigned port, unsigned device,
       unsigned idx, unsigned id)
 {
    int16_t res = 0;
 
-   device &= RETRO_DEVICE_MASK;
-
-   if (g_extern.bsv.movie && g_extern.bsv.movie_playback)
-   {
-      int16_t ret;
-      if (bsv_movie_get_input(g_extern.bsv.movie, &ret))
-         return ret;
-
-      g_extern.bsv.movie_end = true;
-   }
-
    static const struct retro_keybind *binds[MAX_PLAYERS] = {
       g_settings.input.binds[0],
       g_settings.input.binds[1],
@@ -321,6 +415,106 @@ static int16_t input_state(unsigned port, unsigned device,
    }
 #endif
 
+   return res;
+}
+
+/* What input_state_resolve() returned since the last input_poll().
+ * Driver state only changes on poll, so a core asking for the same
+ * button many times a frame only goes to the driver once. Filled in
+ * on first use, as most cores only look at a port or two. */
+static struct
+{
+   uint32_t joypad_valid[MAX_PLAYERS];
+   uint32_t joypad[MAX_PLAYERS];
+   uint8_t analog_valid[MAX_PLAYERS];
+   int16_t analog[MAX_PLAYERS][4];
+   uint32_t key_valid[(RETROK_LAST + 31) / 32];
+   uint32_t key[(RETROK_LAST + 31) / 32];
+} input_cache;
+
+static inline void input_state_cache_clear(void)
+{
+   memset(input_cache.joypad_valid, 0, sizeof(input_cache.joypad_valid));
+   memset(input_cache.analog_valid, 0, sizeof(input_cache.analog_valid));
+   memset(input_cache.key_valid, 0, sizeof(input_cache.key_valid));
+}
+
+static int16_t input_state_cached(unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   if (port >= MAX_PLAYERS)
+      return input_state_resolve(port, device, idx, id);
+
+   switch (device)
+   {
+      case RETRO_DEVICE_JOYPAD:
+         if (id < RARCH_FIRST_META_KEY)
+         {
+            uint32_t bit = 1u << id;
+            if (!(input_cache.joypad_valid[port] & bit))
+            {
+               input_cache.joypad_valid[port] |= bit;
+               if (input_state_resolve(port, device, idx, id))
+                  input_cache.joypad[port] |= bit;
+               else
+                  input_cache.joypad[port] &= ~bit;
+            }
+            return (input_cache.joypad[port] & bit) ? 1 : 0;
+         }
+         break;
+
+      case RETRO_DEVICE_ANALOG:
+         if (idx < 2 && id < 2)
+         {
+            unsigned slot = idx * 2 + id;
+            if (!(input_cache.analog_valid[port] & (1 << slot)))
+            {
+               input_cache.analog_valid[port] |= 1 << slot;
+               input_cache.analog[port][slot] =
+                  input_state_resolve(port, device, idx, id);
+            }
+            return input_cache.analog[port][slot];
+         }
+         break;
+
+      case RETRO_DEVICE_KEYBOARD:
+         if (port == 0 && id < RETROK_LAST)
+         {
+            uint32_t bit = 1u << (id & 31);
+            if (!(input_cache.key_valid[id >> 5] & bit))
+            {
+               input_cache.key_valid[id >> 5] |= bit;
+               if (input_state_resolve(port, device, idx, id))
+                  input_cache.key[id >> 5] |= bit;
+               else
+                  input_cache.key[id >> 5] &= ~bit;
+            }
+            return (input_cache.key[id >> 5] & bit) ? 1 : 0;
+         }
+         break;
+   }
+
+   return input_state_resolve(port, device, idx, id);
+}
+
+static int16_t input_state(unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   int16_t res;
+
+   device &= RETRO_DEVICE_MASK;
+
+   if (g_extern.bsv.movie && g_extern.bsv.movie_playback)
+   {
+      int16_t ret;
+      if (bsv_movie_get_input(g_extern.bsv.movie, &ret))
+         return ret;
+
+      g_extern.bsv.movie_end = true;
+   }
+
+   res = input_state_cached(port, device, idx, id);
+
    /* flushing_input will be cleared in rarch_main_iterate. */
    if (driver.flushing_input)
       res = 0;
@@ -475,7 +669,9 @@ static inline void input_poll_overlay(void)
 
 static void input_poll(void)
 {
+   rarch_perf_stage_begin(RARCH_PERF_STAGE_INPUT_POLL);
    driver.input->poll(driver.input_data);
+   input_state_cache_clear();
 
 #ifdef HAVE_OVERLAY
    if (driver.overlay)
@@ -486,6 +682,8 @@ static void input_poll(void)
    if (driver.command)
       rarch_cmd_poll(driver.command);
 #endif
+
+   rarch_perf_stage_end(RARCH_PERF_STAGE_INPUT_POLL);
 }
 
 void retro_set_default_callbacks(void *data)
@@ -1,6 +1,6 @@
 /*  RetroArch - A frontend for libretro.
  *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
- * 
+ *
  *  RetroArch is free software: you can redistribute it and/or modify it under the terms
  *  of the GNU General Public License as published by the Free Software Found-
  *  ation, either version 3 of the License, or (at your option) any later version.
@@ -21,29 +21,422 @@
 #include "general.h"
 #include "dynamic.h"
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#define BSV_BUFFER_SIZE (64 * 1024)
+#define BSV_KEY_HEADER_SIZE (4 * sizeof(uint32_t))
+#define BSV_KEY_RECORD_SIZE (3 * sizeof(uint32_t))
+
+struct bsv_keyframe
+{
+   size_t frame;
+   size_t input_pos;
+   long state_pos;
+};
+
 struct bsv_movie
 {
    FILE *file;
 
+   /* Input goes through this buffer instead of one stdio call
+    * per poll. buf_base is the file offset of buf[0].
+    * When recording, buf_ptr bytes are pending.
+    * When playing back, buf_ptr is the read cursor
+    * into buf_size valid bytes. */
+   uint8_t *buf;
+   size_t buf_base;
+   size_t buf_ptr;
+   size_t buf_size;
+
    /* A ring buffer keeping track of positions
     * in the file for each frame. */
    size_t *frame_pos;
    size_t frame_mask;
    size_t frame_ptr;
 
+   /* frame_pos[0] corresponds to frame_base. */
+   size_t frame_count;
+   size_t frame_base;
+
    size_t min_file_pos;
 
+   /* Length of the input stream according to the index,
+    * 0 if unknown. */
+   size_t end_pos;
+
    size_t state_size;
    uint8_t *state;
+   uint8_t *key_state;
+
+   FILE *key_file;
+   struct bsv_keyframe *keys;
+   size_t num_keys;
+   size_t keys_cap;
+   unsigned key_interval;
+
+#ifdef HAVE_THREADS
+   /* While recording, keyframes are written out of key_pending
+    * on a thread of their own, so the frame only pays for
+    * the serialize. key_file belongs to the thread while
+    * key_busy is set. */
+   sthread_t *key_thread;
+   slock_t *key_lock;
+   scond_t *key_cond;
+   uint8_t *key_pending;
+   uint32_t key_record[3];
+   long key_offset;
+   bool key_busy;
+   bool key_failed;
+   bool key_quit;
+#endif
 
    bool playback;
    bool first_rewind;
    bool did_rewind;
 };
 
-#if 0
+static size_t bsv_movie_tell(bsv_movie_t *handle)
+{
+   return handle->buf_base + handle->buf_ptr;
+}
+
+static bool bsv_movie_flush(bsv_movie_t *handle)
+{
+   size_t size = handle->buf_ptr;
+
+   if (handle->playback || !size)
+      return true;
+
+   handle->buf_base += size;
+   handle->buf_ptr = 0;
+   return fwrite(handle->buf, 1, size, handle->file) == size;
+}
+
+static void bsv_movie_seek_input(bsv_movie_t *handle, size_t pos)
+{
+   if (handle->playback)
+   {
+      if (pos >= handle->buf_base &&
+            pos <= handle->buf_base + handle->buf_size)
+      {
+         handle->buf_ptr = pos - handle->buf_base;
+         return;
+      }
+
+      handle->buf_size = 0;
+   }
+   else if (pos >= handle->buf_base &&
+         pos <= handle->buf_base + handle->buf_ptr)
+   {
+      /* Everything pending past pos is stale, drop it. */
+      handle->buf_ptr = pos - handle->buf_base;
+      return;
+   }
+
+   fseek(handle->file, (long)pos, SEEK_SET);
+   handle->buf_base = pos;
+   handle->buf_ptr = 0;
+}
+
+static void key_path(char *path, size_t size, const char *movie_path)
+{
+   snprintf(path, size, "%s%s", movie_path, BSV_KEY_EXT);
+}
+
+static bool push_keyframe(bsv_movie_t *handle, size_t frame,
+      size_t input_pos, long state_pos)
+{
+   struct bsv_keyframe *key;
+
+   if (handle->num_keys == handle->keys_cap)
+   {
+      size_t cap = handle->keys_cap ? handle->keys_cap * 2 : 64;
+      struct bsv_keyframe *keys = (struct bsv_keyframe*)
+         realloc(handle->keys, cap * sizeof(*keys));
+      if (!keys)
+         return false;
+
+      handle->keys = keys;
+      handle->keys_cap = cap;
+   }
+
+   key = &handle->keys[handle->num_keys++];
+   key->frame = frame;
+   key->input_pos = input_pos;
+   key->state_pos = state_pos;
+   return true;
+}
+
+static long keyframe_offset(bsv_movie_t *handle, size_t idx)
+{
+   return BSV_KEY_HEADER_SIZE + idx *
+      (BSV_KEY_RECORD_SIZE + handle->state_size);
+}
+
+static void load_key_index(bsv_movie_t *handle, const char *path)
+{
+   char index_path[PATH_MAX];
+   uint32_t header[4] = {0};
+   long file_size;
+
+   key_path(index_path, sizeof(index_path), path);
+   handle->key_file = fopen(index_path, "rb");
+   if (!handle->key_file)
+   {
+      RARCH_WARN("No keyframe index for movie, seeking is disabled.\n");
+      return;
+   }
+
+   fseek(handle->key_file, 0, SEEK_END);
+   file_size = ftell(handle->key_file);
+   rewind(handle->key_file);
+
+   if (fread(header, sizeof(uint32_t), 4, handle->key_file) != 4 ||
+         swap_if_little32(header[MAGIC_INDEX]) != BSV_KEY_MAGIC ||
+         swap_if_big32(header[STATE_SIZE_INDEX]) != handle->state_size)
+   {
+      RARCH_WARN("Keyframe index does not match movie, ignoring it.\n");
+      fclose(handle->key_file);
+      handle->key_file = NULL;
+      return;
+   }
+
+   for (;;)
+   {
+      uint32_t record[3];
+      size_t frame, input_pos;
+      long state_pos;
+
+      if (fread(record, sizeof(uint32_t), 3, handle->key_file) != 3)
+         break;
+
+      frame = swap_if_big32(record[1]);
+      input_pos = swap_if_big32(record[2]);
+
+      if (swap_if_big32(record[0]) == BSV_KEY_END)
+      {
+         handle->end_pos = input_pos;
+         break;
+      }
+
+      /* A recording that was not closed properly can leave
+       * a torn record or stale data behind, stop there. */
+      state_pos = ftell(handle->key_file);
+      if (swap_if_big32(record[0]) != BSV_KEY_FRAME ||
+            input_pos < handle->min_file_pos ||
+            state_pos + (long)handle->state_size > file_size)
+         break;
+      if (handle->num_keys &&
+            (frame <= handle->keys[handle->num_keys - 1].frame ||
+             input_pos < handle->keys[handle->num_keys - 1].input_pos))
+         break;
+
+      if (!push_keyframe(handle, frame, input_pos, state_pos))
+         break;
+      fseek(handle->key_file, handle->state_size, SEEK_CUR);
+   }
+
+   RARCH_LOG("Loaded movie keyframe index with %u keyframes.\n",
+         (unsigned)handle->num_keys);
+}
+
+static bool write_key_record(bsv_movie_t *handle, long offset,
+      const uint32_t *record, const uint8_t *state)
+{
+   fseek(handle->key_file, offset, SEEK_SET);
+   return fwrite(record, sizeof(uint32_t), 3, handle->key_file) == 3 &&
+      fwrite(state, 1, handle->state_size, handle->key_file)
+      == handle->state_size;
+}
+
+static void disable_key_index(bsv_movie_t *handle)
+{
+   RARCH_ERR("Failed to write movie keyframe, disabling index.\n");
+   fclose(handle->key_file);
+   handle->key_file = NULL;
+}
+
+#ifdef HAVE_THREADS
+static void key_writer_thread(void *data)
+{
+   bsv_movie_t *handle = (bsv_movie_t*)data;
+
+   slock_lock(handle->key_lock);
+   for (;;)
+   {
+      bool ok;
+
+      while (!handle->key_busy && !handle->key_quit)
+         scond_wait(handle->key_cond, handle->key_lock);
+      if (!handle->key_busy)
+         break;
+      slock_unlock(handle->key_lock);
+
+      ok = write_key_record(handle, handle->key_offset,
+            handle->key_record, handle->key_pending);
+
+      slock_lock(handle->key_lock);
+      if (!ok)
+         handle->key_failed = true;
+      handle->key_busy = false;
+      scond_signal(handle->key_cond);
+   }
+   slock_unlock(handle->key_lock);
+}
+
+static bool init_key_writer(bsv_movie_t *handle)
+{
+   handle->key_pending = (uint8_t*)malloc(handle->state_size);
+   handle->key_lock = slock_new();
+   handle->key_cond = scond_new();
+   if (!handle->key_pending || !handle->key_lock || !handle->key_cond)
+      return false;
+
+   handle->key_thread = sthread_create(key_writer_thread, handle);
+   return handle->key_thread != NULL;
+}
+
+static void free_key_writer(bsv_movie_t *handle)
+{
+   if (handle->key_thread)
+   {
+      slock_lock(handle->key_lock);
+      handle->key_quit = true;
+      scond_signal(handle->key_cond);
+      slock_unlock(handle->key_lock);
+      sthread_join(handle->key_thread);
+   }
+
+   if (handle->key_lock)
+      slock_free(handle->key_lock);
+   if (handle->key_cond)
+      scond_free(handle->key_cond);
+   free(handle->key_pending);
+}
+
+/* Waits for the previous keyframe to land and hands
+ * key_file back to the caller. Returns false if the index
+ * was disabled because the write failed. */
+static bool key_writer_wait(bsv_movie_t *handle)
+{
+   bool failed;
+
+   if (!handle->key_thread)
+      return true;
+
+   slock_lock(handle->key_lock);
+   while (handle->key_busy)
+      scond_wait(handle->key_cond, handle->key_lock);
+   failed = handle->key_failed;
+   handle->key_failed = false;
+   slock_unlock(handle->key_lock);
+
+   if (failed)
+      disable_key_index(handle);
+   return !failed;
+}
+#endif
+
+static bool init_key_index(bsv_movie_t *handle, const char *path)
+{
+   char index_path[PATH_MAX];
+   uint32_t header[4] = {0};
+
+   if (!handle->key_interval || !handle->state_size)
+      return true;
+
+   key_path(index_path, sizeof(index_path), path);
+   handle->key_file = fopen(index_path, "wb");
+   if (!handle->key_file)
+   {
+      RARCH_ERR("Couldn't open keyframe index \"%s\".\n", index_path);
+      return false;
+   }
+
+   header[MAGIC_INDEX] = swap_if_little32(BSV_KEY_MAGIC);
+   header[SERIALIZER_INDEX] = swap_if_big32(handle->key_interval);
+   header[CRC_INDEX] = swap_if_big32(g_extern.content_crc);
+   header[STATE_SIZE_INDEX] = swap_if_big32(handle->state_size);
+   if (fwrite(header, sizeof(uint32_t), 4, handle->key_file) != 4)
+      return false;
+
+#ifdef HAVE_THREADS
+   /* Without the thread, keyframes are written inline,
+    * which shows up as a frame time spike every key_interval. */
+   if (!init_key_writer(handle))
+      RARCH_WARN("Couldn't start keyframe writer, writing inline.\n");
+#endif
+   return true;
+}
+
+static void write_keyframe(bsv_movie_t *handle)
+{
+   uint32_t record[3];
+   long offset = keyframe_offset(handle, handle->num_keys);
+   size_t input_pos = bsv_movie_tell(handle);
+
+#ifdef HAVE_THREADS
+   if (!key_writer_wait(handle))
+      return;
+#endif
+
+   if (!pretro_serialize(handle->state, handle->state_size))
+      return;
+
+   /* Make sure input referenced by the keyframe hits the disk
+    * no later than the keyframe itself. */
+   bsv_movie_flush(handle);
+
+   record[0] = swap_if_big32(BSV_KEY_FRAME);
+   record[1] = swap_if_big32(handle->frame_count);
+   record[2] = swap_if_big32(input_pos);
+
+#ifdef HAVE_THREADS
+   if (handle->key_thread)
+   {
+      uint8_t *state = handle->key_pending;
+
+      handle->key_pending = handle->state;
+      handle->state = state;
+      memcpy(handle->key_record, record, sizeof(record));
+      handle->key_offset = offset;
+
+      slock_lock(handle->key_lock);
+      handle->key_busy = true;
+      scond_signal(handle->key_cond);
+      slock_unlock(handle->key_lock);
+   }
+   else
+#endif
+   if (!write_key_record(handle, offset, record, handle->state))
+   {
+      disable_key_index(handle);
+      return;
+   }
+
+   push_keyframe(handle, handle->frame_count, input_pos,
+         offset + (long)BSV_KEY_RECORD_SIZE);
+}
+
+static void finish_key_index(bsv_movie_t *handle)
+{
+   uint32_t record[3];
+
+   record[0] = swap_if_big32(BSV_KEY_END);
+   record[1] = swap_if_big32(handle->frame_count);
+   record[2] = swap_if_big32(bsv_movie_tell(handle));
+
+   fseek(handle->key_file, keyframe_offset(handle, handle->num_keys),
+         SEEK_SET);
+   fwrite(record, sizeof(uint32_t), 3, handle->key_file);
+}
+
 static bool init_playback(bsv_movie_t *handle, const char *path)
 {
+   uint32_t state_size;
+   uint32_t header[4] = {0};
 
    handle->playback = true;
    handle->file = fopen(path, "rb");
@@ -53,7 +446,6 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
       return false;
    }
 
-   uint32_t header[4] = {0};
    if (fread(header, sizeof(uint32_t), 4, handle->file) != 4)
    {
       RARCH_ERR("Couldn't read movie header.\n");
@@ -70,7 +462,7 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
    if (swap_if_big32(header[CRC_INDEX]) != g_extern.content_crc)
       RARCH_WARN("CRC32 checksum mismatch between content file and saved content checksum in replay file header; replay highly likely to desync on playback.\n");
 
-   uint32_t state_size = swap_if_big32(header[STATE_SIZE_INDEX]);
+   state_size = swap_if_big32(header[STATE_SIZE_INDEX]);
 
    if (state_size)
    {
@@ -92,12 +484,18 @@ static bool init_playback(bsv_movie_t *handle, const char *path)
    }
 
    handle->min_file_pos = sizeof(header) + state_size;
+   handle->buf_base = handle->min_file_pos;
+
+   if (state_size)
+      load_key_index(handle, path);
 
    return true;
 }
 
 static bool init_record(bsv_movie_t *handle, const char *path)
 {
+   uint32_t state_size;
+   uint32_t header[4] = {0};
 
    handle->file = fopen(path, "wb");
    if (!handle->file)
@@ -106,18 +504,17 @@ static bool init_record(bsv_movie_t *handle, const char *path)
       return false;
    }
 
-   uint32_t header[4] = {0};
-
    header[MAGIC_INDEX] = swap_if_little32(BSV_MAGIC);
 
    header[CRC_INDEX] = swap_if_big32(g_extern.content_crc);
 
-   uint32_t state_size = pretro_serialize_size();
+   state_size = pretro_serialize_size();
 
    header[STATE_SIZE_INDEX] = swap_if_big32(state_size);
    fwrite(header, 4, sizeof(uint32_t), handle->file);
 
    handle->min_file_pos = sizeof(header) + state_size;
+   handle->buf_base = handle->min_file_pos;
    handle->state_size = state_size;
 
    if (state_size)
@@ -130,44 +527,87 @@ static bool init_record(bsv_movie_t *handle, const char *path)
       fwrite(handle->state, 1, state_size, handle->file);
    }
 
-   return true;
+   handle->key_interval = g_settings.movie_keyframe_interval;
+   return init_key_index(handle, path);
 }
-#endif
 
 void bsv_movie_free(bsv_movie_t *handle)
 {
-/*
-   if (handle)
+   if (!handle)
+      return;
+
+   if (handle->file)
+   {
+      bsv_movie_flush(handle);
+      fclose(handle->file);
+   }
+
+#ifdef HAVE_THREADS
+   key_writer_wait(handle);
+   free_key_writer(handle);
+#endif
+
+   if (handle->key_file)
    {
-      if (handle->file)
-         fclose(handle->file);
-      free(handle->state);
-      free(handle->frame_pos);
-      free(handle);
-   }*/
+      if (!handle->playback)
+         finish_key_index(handle);
+      fclose(handle->key_file);
+   }
+
+   free(handle->buf);
+   free(handle->state);
+   free(handle->key_state);
+   free(handle->keys);
+   free(handle->frame_pos);
+   free(handle);
 }
 
 bool bsv_movie_get_input(bsv_movie_t *handle, int16_t *input)
 {
-  // if (fread(input, sizeof(int16_t), 1, handle->file) != 1)
-    //  return false;
+   uint16_t value;
+   size_t pos = bsv_movie_tell(handle);
+
+   if (handle->end_pos && pos + sizeof(value) > handle->end_pos)
+      return false;
+
+   if (handle->buf_size - handle->buf_ptr < sizeof(value))
+   {
+      fseek(handle->file, (long)pos, SEEK_SET);
+      handle->buf_base = pos;
+      handle->buf_ptr = 0;
+      handle->buf_size = fread(handle->buf, 1,
+            BSV_BUFFER_SIZE, handle->file);
+      if (handle->buf_size < sizeof(value))
+         return false;
+   }
+
+   memcpy(&value, handle->buf + handle->buf_ptr, sizeof(value));
+   handle->buf_ptr += sizeof(value);
 
-   //*input = swap_if_big16(*input);
-return false;
+   *input = swap_if_big16(value);
+   return true;
 }
 
 void bsv_movie_set_input(bsv_movie_t *handle, int16_t input)
 {
-   //input = swap_if_big16(input);
-   //fwrite(&input, sizeof(int16_t), 1, handle->file);
+   uint16_t value = swap_if_big16(input);
+
+   if (handle->buf_ptr + sizeof(value) > BSV_BUFFER_SIZE)
+      bsv_movie_flush(handle);
+
+   memcpy(handle->buf + handle->buf_ptr, &value, sizeof(value));
+   handle->buf_ptr += sizeof(value);
 }
 
 bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
 {
- /*  bsv_movie_t *handle = (bsv_movie_t*)calloc(1, sizeof(*handle));
+   bsv_movie_t *handle = (bsv_movie_t*)calloc(1, sizeof(*handle));
    if (!handle)
       return NULL;
 
+   if (!(handle->buf = (uint8_t*)malloc(BSV_BUFFER_SIZE)))
+      goto error;
+
    if (type == RARCH_MOVIE_PLAYBACK)
    {
       if (!init_playback(handle, path))
@@ -177,7 +617,7 @@ bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
       goto error;
 
    if (!(handle->frame_pos = (size_t*)calloc((1 << 20), sizeof(size_t))))
-      goto error; 
+      goto error;
 
    handle->frame_pos[0] = handle->min_file_pos;
    handle->frame_mask = (1 << 20) - 1;
@@ -185,35 +625,40 @@ bsv_movie_t *bsv_movie_init(const char *path, enum rarch_movie_type type)
    return handle;
 
 error:
-   bsv_movie_free(handle); */
+   bsv_movie_free(handle);
    return NULL;
 }
 
 void bsv_movie_set_frame_start(bsv_movie_t *handle)
 {
-   ;//handle->frame_pos[handle->frame_ptr] = ftell(handle->file);
+   if (handle->key_file && !handle->playback &&
+         handle->frame_count &&
+         (handle->frame_count % handle->key_interval) == 0 &&
+         (!handle->num_keys ||
+          handle->keys[handle->num_keys - 1].frame < handle->frame_count))
+      write_keyframe(handle);
+
+   handle->frame_pos[handle->frame_ptr] = bsv_movie_tell(handle);
 }
 
 void bsv_movie_set_frame_end(bsv_movie_t *handle)
 {
-;
- /*  handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   handle->frame_ptr = (handle->frame_ptr + 1) & handle->frame_mask;
+   handle->frame_count++;
 
    handle->first_rewind = !handle->did_rewind;
    handle->did_rewind = false;
-*/
 }
 
 void bsv_movie_frame_rewind(bsv_movie_t *handle)
 {
-#if 0
    handle->did_rewind = true;
 
-   if ((handle->frame_ptr <= 1) && (handle->frame_pos[0] == handle->min_file_pos))
+   if (handle->frame_count <= handle->frame_base + 1)
    {
       /* If we're at the beginning... */
       handle->frame_ptr = 0;
-      fseek(handle->file, handle->min_file_pos, SEEK_SET);
+      handle->frame_count = handle->frame_base;
    }
    else
    {
@@ -223,14 +668,26 @@ void bsv_movie_frame_rewind(bsv_movie_t *handle)
        *
        * Sucessively rewinding frames, we need to rewind past the read data,
        * plus another. */
-      handle->frame_ptr = (handle->frame_ptr -
-            (handle->first_rewind ? 1 : 2)) & handle->frame_mask;
-      fseek(handle->file, handle->frame_pos[handle->frame_ptr], SEEK_SET);
+      unsigned frames = handle->first_rewind ? 1 : 2;
+
+      handle->frame_ptr = (handle->frame_ptr - frames) & handle->frame_mask;
+      handle->frame_count -= frames;
+   }
+
+   bsv_movie_seek_input(handle, handle->frame_pos[handle->frame_ptr]);
+
+   /* Keyframes past the rewind point will be recorded again. */
+   if (!handle->playback)
+   {
+      while (handle->num_keys &&
+            handle->keys[handle->num_keys - 1].frame > handle->frame_count)
+         handle->num_keys--;
    }
 
-   if (ftell(handle->file) <= (long)handle->min_file_pos)
+   if (bsv_movie_tell(handle) <= handle->min_file_pos)
    {
       /* We rewound past the beginning. */
+      bsv_movie_seek_input(handle, handle->min_file_pos);
 
       if (!handle->playback)
       {
@@ -240,10 +697,196 @@ void bsv_movie_frame_rewind(bsv_movie_t *handle)
          pretro_serialize(handle->state, handle->state_size);
          fwrite(handle->state, 1, handle->state_size, handle->file);
       }
+   }
+}
+
+size_t bsv_movie_get_frame(bsv_movie_t *handle)
+{
+   return handle->frame_count;
+}
+
+bool bsv_movie_seek(bsv_movie_t *handle, size_t frame, size_t *reached)
+{
+   size_t lo = 0, hi = handle->num_keys;
+   size_t input_pos = handle->min_file_pos;
+   size_t key_frame = 0;
+   const uint8_t *state = handle->state;
+
+   if (!handle->playback)
+      return false;
+
+   /* Find the last keyframe at or before frame. */
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      if (handle->keys[mid].frame <= frame)
+         lo = mid + 1;
       else
-         fseek(handle->file, handle->min_file_pos, SEEK_SET);
+         hi = mid;
    }
-#endif
-return;
+
+   if (lo)
+   {
+      const struct bsv_keyframe *key = &handle->keys[lo - 1];
+
+      if (!handle->key_state &&
+            !(handle->key_state = (uint8_t*)malloc(handle->state_size)))
+         return false;
+
+      fseek(handle->key_file, key->state_pos, SEEK_SET);
+      if (fread(handle->key_state, 1, handle->state_size,
+               handle->key_file) != handle->state_size)
+      {
+         RARCH_ERR("Couldn't read movie keyframe for frame %u.\n",
+               (unsigned)key->frame);
+         return false;
+      }
+
+      state = handle->key_state;
+      input_pos = key->input_pos;
+      key_frame = key->frame;
+   }
+
+   if (handle->state_size &&
+         !pretro_unserialize(state, handle->state_size))
+      return false;
+
+   bsv_movie_seek_input(handle, input_pos);
+
+   handle->frame_count = handle->frame_base = key_frame;
+   handle->frame_ptr = 0;
+   handle->frame_pos[0] = input_pos;
+   handle->first_rewind = false;
+   handle->did_rewind = false;
+
+   if (reached)
+      *reached = key_frame;
+   return true;
+}
+
+/* Kept out of g_extern, which is cleared after the
+ * arguments are parsed. */
+static struct
+{
+   size_t frame;
+   bool enable;
+} movie_seek;
+
+void bsv_movie_parse_args(int *argc, char **argv)
+{
+   int i, out = 1;
+
+   for (i = 1; i < *argc; i++)
+   {
+      if (!strcmp(argv[i], "--bsvseek") && i + 1 < *argc)
+      {
+         movie_seek.frame  = strtoul(argv[++i], NULL, 0);
+         movie_seek.enable = true;
+      }
+      else if (!strncmp(argv[i], "--bsvseek=", 10))
+      {
+         movie_seek.frame  = strtoul(argv[i] + 10, NULL, 0);
+         movie_seek.enable = true;
+      }
+      else
+         argv[out++] = argv[i];
+   }
+
+   if (out < *argc)
+   {
+      argv[out] = NULL;
+      *argc     = out;
+   }
+}
+
+/* Jumps playback to frame through the keyframe index and runs
+ * whatever is left from there, without presenting anything
+ * in between on time. */
+static bool movie_seek_to(bsv_movie_t *handle, size_t frame)
+{
+   size_t reached = 0;
+
+   if (!bsv_movie_seek(handle, frame, &reached))
+   {
+      RARCH_ERR("Couldn't seek movie to frame %u.\n", (unsigned)frame);
+      return false;
+   }
+
+   /* Rewind history from before the seek is of another timeline. */
+   rarch_main_command(RARCH_CMD_REWIND_DEINIT);
+   rarch_main_command(RARCH_CMD_REWIND_INIT);
+
+   RARCH_LOG("Movie seek: restored keyframe at frame %u, running %u more.\n",
+         (unsigned)reached, (unsigned)(frame - reached));
+
+   for (; reached < frame && !g_extern.bsv.movie_end; reached++)
+   {
+      bsv_movie_set_frame_start(handle);
+      pretro_run();
+      bsv_movie_set_frame_end(handle);
+   }
+
+   if (g_extern.bsv.movie_end)
+   {
+      RARCH_ERR("Movie ended at frame %u, before frame %u.\n",
+            (unsigned)reached, (unsigned)frame);
+      return false;
+   }
+   return true;
+}
+
+void rarch_bsv_movie_deinit(void)
+{
+   if (g_extern.bsv.movie)
+      bsv_movie_free(g_extern.bsv.movie);
+   g_extern.bsv.movie = NULL;
 }
 
+bool rarch_bsv_movie_init(void)
+{
+   char msg[PATH_MAX];
+
+   rarch_bsv_movie_deinit();
+
+   if (g_extern.bsv.movie_start_playback)
+   {
+      g_extern.bsv.movie = bsv_movie_init(g_extern.bsv.movie_start_path,
+            RARCH_MOVIE_PLAYBACK);
+      if (!g_extern.bsv.movie)
+      {
+         RARCH_ERR("Failed to load movie file: \"%s\".\n",
+               g_extern.bsv.movie_start_path);
+         return false;
+      }
+
+      g_extern.bsv.movie_playback = true;
+      msg_queue_push(g_extern.msg_queue, "Starting movie playback.", 2, 180);
+      RARCH_LOG("Starting movie playback.\n");
+      g_settings.rewind_granularity = 1;
+
+      if (movie_seek.enable)
+         return movie_seek_to(g_extern.bsv.movie, movie_seek.frame);
+   }
+   else if (g_extern.bsv.movie_start_recording)
+   {
+      snprintf(msg, sizeof(msg), "Starting movie record to \"%s\".",
+            g_extern.bsv.movie_start_path);
+
+      g_extern.bsv.movie = bsv_movie_init(g_extern.bsv.movie_start_path,
+            RARCH_MOVIE_RECORD);
+      if (!g_extern.bsv.movie)
+      {
+         msg_queue_push(g_extern.msg_queue,
+               "Failed to start movie record.", 1, 180);
+         RARCH_ERR("Failed to start movie record.\n");
+         return false;
+      }
+
+      msg_queue_push(g_extern.msg_queue, msg, 1, 180);
+      RARCH_LOG("Starting movie record to \"%s\".\n",
+            g_extern.bsv.movie_start_path);
+      g_settings.rewind_granularity = 1;
+   }
+
+   return true;
+}
@@ -27,6 +27,18 @@
 #define CRC_INDEX 2
 #define STATE_SIZE_INDEX 3
 
+/* Keyframe index, written next to the movie as "<movie>.idx".
+ * The header mirrors the BSV header, with the keyframe interval
+ * in place of the serializer field.
+ * It is followed by fixed-size records of type, frame and
+ * input stream offset, each keyframe record carrying a
+ * full savestate. An end record terminates the index. */
+#define BSV_KEY_MAGIC 0x42534b31
+#define BSV_KEY_EXT ".idx"
+
+#define BSV_KEY_FRAME 0
+#define BSV_KEY_END 1
+
 typedef struct bsv_movie bsv_movie_t;
 
 enum rarch_movie_type
@@ -50,7 +62,34 @@ void bsv_movie_set_frame_end(bsv_movie_t *handle);
 
 void bsv_movie_frame_rewind(bsv_movie_t *handle);
 
+/* Frame number of the frame about to be played or recorded. */
+size_t bsv_movie_get_frame(bsv_movie_t *handle);
+
+/* Playback only. Restores the closest keyframe at or before frame
+ * and repositions the input stream there. The frame that was
+ * actually reached is returned in reached; the caller runs the
+ * remaining frames. Rewind history from before the seek
+ * no longer matches the movie and should be discarded. */
+bool bsv_movie_seek(bsv_movie_t *handle, size_t frame, size_t *reached);
+
 void bsv_movie_free(bsv_movie_t *handle);
 
+/* Regression replays start from the middle of a movie with
+ *
+ *    retroarch -P <movie> --bsvseek <frame> [--eof-exit] ...
+ *
+ * The seek goes through the keyframe index, then runs the
+ * frames up to <frame> before handing over to the runloop.
+ * Takes the option out of argv, so the regular parser never
+ * sees it. */
+void bsv_movie_parse_args(int *argc, char **argv);
+
+/* Starts the movie asked for on the command line, if any, once
+ * content is loaded. Returns false if it was asked for but
+ * couldn't be started. */
+bool rarch_bsv_movie_init(void);
+
+void rarch_bsv_movie_deinit(void);
+
 #endif
 
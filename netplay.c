@@ -23,6 +23,7 @@
 #include "autosave.h"
 #include "dynamic.h"
 #include "message_queue.h"
+#include "performance.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -65,6 +66,25 @@ struct delta_frame
 #define UDP_FRAME_PACKETS 16
 #define MAX_SPECTATORS 16
 
+/* Input only uses the low 16 bits of each state word. The high
+ * 16 bits of the newest one echo the newest frame we have from the
+ * other side, as NETPLAY_ECHO_VALID | (frame & NETPLAY_ECHO_MASK),
+ * which times a round trip without a packet format change.
+ * Older versions send zero there and ignore it on receipt. */
+#define NETPLAY_ECHO_VALID 0x8000
+#define NETPLAY_ECHO_MASK 0x7fff
+/* How many of our recent send times are kept to match echoes. */
+#define NETPLAY_SEND_TIMES 64
+/* Both sides send, then read, once per frame. The other side holds
+ * our frame until its next send, one frame, and between its read and
+ * ours the two polls add up to about one more. */
+#define NETPLAY_ECHO_HOLD_FRAMES 2
+
+/* Frames of slack kept on top of the measured latency. */
+#define NETPLAY_WINDOW_MARGIN 1
+/* Frames the window must stay oversized before it shrinks by one. */
+#define NETPLAY_WINDOW_SHRINK_DELAY 120
+
 #define NETPLAY_CMD_ACK 0
 #define NETPLAY_CMD_NAK 1
 #define NETPLAY_CMD_FLIP_PLAYERS 2
@@ -117,6 +137,18 @@ struct netplay
 
    unsigned timeout_cnt;
 
+   /* Adaptive rollback window. We block once we are more than
+    * window frames ahead of the last confirmed frame. It follows
+    * the measured round-trip time between 1 and UDP_FRAME_PACKETS,
+    * or stays at 0 (lockstep) if netplay was started with 0 frames. */
+   unsigned window;
+   bool window_adaptive;
+   uint32_t window_shrink_frame;
+   retro_time_t send_time[NETPLAY_SEND_TIMES];
+
+   struct netplay_stats stats;
+   retro_time_t start_time;
+
    /* Spectating. */
    bool spectate;
    bool spectate_client;
@@ -845,7 +877,13 @@ netplay_t *netplay_new(const char *server, uint16_t port,
             goto error;
       }
 
-      netplay->buffer_size = frames + 1;
+      /* An adaptive window may grow past the initial frames,
+       * so make room for the largest one up front.
+       * Lockstep (frames == 0) never grows. */
+      netplay->buffer_size = frames > 0 ? UDP_FRAME_PACKETS + 1 : frames + 1;
+      netplay->window = frames;
+      netplay->window_adaptive = frames > 0;
+      netplay->start_time = rarch_get_time_usec();
 
       if (!init_buffers(netplay))
          goto error;
@@ -957,6 +995,7 @@ static bool get_self_input_state(netplay_t *netplay)
    struct delta_frame *ptr = &netplay->buffer[netplay->self_ptr];
 
    uint32_t state = 0;
+   uint32_t echo  = 0;
    if (!driver.block_libretro_input && netplay->frame_count > 0)
    {
       /* First frame we always give zero input since relying on 
@@ -971,10 +1010,18 @@ static bool get_self_input_state(netplay_t *netplay)
       }
    }
 
+   /* Frame 0 from the other side is never actually received. */
+   if (netplay->read_frame_count > 1)
+      echo = NETPLAY_ECHO_VALID |
+         ((netplay->read_frame_count - 1) & NETPLAY_ECHO_MASK);
+
    memmove(netplay->packet_buffer, netplay->packet_buffer + 2,
          sizeof (netplay->packet_buffer) - 2 * sizeof(uint32_t));
    netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2] = htonl(netplay->frame_count); 
-   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2 + 1] = htonl(state);
+   netplay->packet_buffer[(UDP_FRAME_PACKETS - 1) * 2 + 1] =
+      htonl(state | (echo << 16));
+   netplay->send_time[netplay->frame_count % NETPLAY_SEND_TIMES] =
+      rarch_get_time_usec();
 
    if (!send_chunk(netplay))
    {
@@ -1000,12 +1047,74 @@ static void simulate_input(netplay_t *netplay)
    netplay->buffer[ptr].used_real = false;
 }
 
+/* Runs on every packet from the other side. The echo names the
+ * newest of our frames it had when sending, so the time since we sent
+ * that frame, less the frames it sat waiting on either side, is a
+ * round trip. We smooth it and size the window so
+ * that input usually lands before we would have to block for it. */
+static void update_window(netplay_t *netplay, uint32_t echo)
+{
+   unsigned target;
+   uint32_t frame;
+   retro_time_t frame_usec, rtt;
+   float fps = g_extern.system.av_info.timing.fps;
+
+   if (!(echo & NETPLAY_ECHO_VALID))
+      return;
+
+   frame = netplay->frame_count -
+      ((netplay->frame_count - echo) & NETPLAY_ECHO_MASK);
+   if (frame > netplay->frame_count ||
+         netplay->frame_count - frame >= NETPLAY_SEND_TIMES)
+      return;
+
+   frame_usec = (retro_time_t)(1000000.0f / (fps > 0.0f ? fps : 60.0f));
+   rtt = rarch_get_time_usec() -
+      netplay->send_time[frame % NETPLAY_SEND_TIMES] -
+      NETPLAY_ECHO_HOLD_FRAMES * frame_usec;
+   if (rtt < 0)
+      rtt = 0;
+
+   if (netplay->stats.rtt_usec)
+      netplay->stats.rtt_usec += (rtt - netplay->stats.rtt_usec) / 8;
+   else
+      netplay->stats.rtt_usec = rtt;
+
+   if (!netplay->window_adaptive)
+      return;
+
+   target = (netplay->stats.rtt_usec / 2 + frame_usec - 1) / frame_usec
+      + NETPLAY_WINDOW_MARGIN;
+   if (target > UDP_FRAME_PACKETS)
+      target = UDP_FRAME_PACKETS;
+
+   /* Grow straight away, shrink one frame at a time so
+    * a single quick packet doesn't make us block. */
+   if (target >= netplay->window)
+   {
+      if (target > netplay->window)
+         RARCH_LOG("Netplay rollback window: %u frames (RTT %u ms).\n",
+               target, (unsigned)(netplay->stats.rtt_usec / 1000));
+      netplay->window = target;
+      netplay->window_shrink_frame = netplay->frame_count
+         + NETPLAY_WINDOW_SHRINK_DELAY;
+   }
+   else if (netplay->frame_count >= netplay->window_shrink_frame)
+   {
+      netplay->window--;
+      netplay->window_shrink_frame = netplay->frame_count
+         + NETPLAY_WINDOW_SHRINK_DELAY;
+   }
+}
+
 static void parse_packet(netplay_t *netplay, uint32_t *buffer, unsigned size)
 {
    unsigned i;
    for (i = 0; i < size * 2; i++)
       buffer[i] = ntohl(buffer[i]);
 
+   update_window(netplay, buffer[(size - 1) * 2 + 1] >> 16);
+
    for (i = 0; i < size && netplay->read_frame_count <= netplay->frame_count; i++)
    {
       uint32_t frame = buffer[2 * i + 0];
@@ -1032,8 +1141,16 @@ static bool receive_data(netplay_t *netplay, uint32_t *buffer, size_t size)
    return true;
 }
 
+/* Are we as far ahead of the last confirmed frame as the
+ * rollback window allows? */
+static bool netplay_must_block(netplay_t *netplay)
+{
+   return netplay->other_ptr == netplay->self_ptr ||
+      netplay->frame_count + 1 - netplay->other_frame_count > netplay->window;
+}
+
 /* Poll network to see if we have anything new. If our 
- * network buffer is full, we simply have to block for new input data. */
+ * rollback window is full, we simply have to block for new input data. */
 
 static bool netplay_poll(netplay_t *netplay)
 {
@@ -1059,7 +1176,7 @@ static bool netplay_poll(netplay_t *netplay)
 
    /* We might have reached the end of the buffer, where we 
     * simply have to block. */
-   int res = poll_input(netplay, netplay->other_ptr == netplay->self_ptr);
+   int res = poll_input(netplay, netplay_must_block(netplay));
    if (res == -1)
    {
       netplay->has_connection = false;
@@ -1082,7 +1199,7 @@ static bool netplay_poll(netplay_t *netplay)
          parse_packet(netplay, buffer, UDP_FRAME_PACKETS);
 
       } while ((netplay->read_frame_count <= netplay->frame_count) && 
-            poll_input(netplay, (netplay->other_ptr == netplay->self_ptr) && 
+            poll_input(netplay, netplay_must_block(netplay) && 
                (first_read == netplay->read_frame_count)) == 1);
    }
    else
@@ -1268,6 +1385,37 @@ int16_t netplay_input_state(netplay_t *netplay, bool port, unsigned device,
    return ((1 << id) & curr_input_state) ? 1 : 0;
 }
 
+void netplay_get_stats(netplay_t *netplay, struct netplay_stats *stats)
+{
+   *stats = netplay->stats;
+   stats->window = netplay->window;
+}
+
+static void log_stats(netplay_t *netplay)
+{
+   const struct netplay_stats *stats = &netplay->stats;
+   float secs = (rarch_get_time_usec() - netplay->start_time) / 1000000.0f;
+
+   if (!stats->rollbacks && !stats->serializes)
+      return;
+
+   RARCH_LOG("Netplay: %u rollbacks, depth avg %.1f max %u, "
+         "%.1f replayed frames/s (%.0f/s while replaying).\n",
+         (unsigned)stats->rollbacks,
+         stats->rollbacks ?
+         (float)stats->replayed_frames / stats->rollbacks : 0.0f,
+         stats->max_rollback_depth,
+         secs > 0.0f ? stats->replayed_frames / secs : 0.0f,
+         stats->replay_usec ?
+         stats->replayed_frames * 1000000.0f / stats->replay_usec : 0.0f);
+   RARCH_LOG("Netplay: %u serializes, %u skipped, %.1f us each. "
+         "Window %u frames, RTT %u ms.\n",
+         (unsigned)stats->serializes, (unsigned)stats->serializes_skipped,
+         stats->serializes ?
+         (float)stats->serialize_usec / stats->serializes : 0.0f,
+         netplay->window, (unsigned)(stats->rtt_usec / 1000));
+}
+
 void netplay_free(netplay_t *netplay)
 {
    unsigned i;
@@ -1283,6 +1431,7 @@ void netplay_free(netplay_t *netplay)
    }
    else
    {
+      log_stats(netplay);
       close(netplay->udp_fd);
 
       for (i = 0; i < netplay->buffer_size; i++)
@@ -1304,10 +1453,19 @@ static bool netplay_should_skip(netplay_t *netplay)
    return false;
 }
 
+static void netplay_serialize(netplay_t *netplay, size_t ptr)
+{
+   retro_time_t start = rarch_get_time_usec();
+
+   pretro_serialize(netplay->buffer[ptr].state, netplay->state_size);
+
+   netplay->stats.serialize_usec += rarch_get_time_usec() - start;
+   netplay->stats.serializes++;
+}
+
 static void netplay_pre_frame_net(netplay_t *netplay)
 {
-   pretro_serialize(netplay->buffer[netplay->self_ptr].state,
-         netplay->state_size);
+   netplay_serialize(netplay, netplay->self_ptr);
    netplay->can_poll = true;
 
    input_poll_net();
@@ -1479,6 +1637,10 @@ static void netplay_post_frame_net(netplay_t *netplay)
 
    if (netplay->other_frame_count < netplay->read_frame_count)
    {
+      bool first = true;
+      unsigned depth = netplay->frame_count - netplay->other_frame_count;
+      retro_time_t start = rarch_get_time_usec();
+
       /* Replay frames. */
       netplay->is_replay = true;
       netplay->tmp_ptr = netplay->other_ptr;
@@ -1486,11 +1648,15 @@ static void netplay_post_frame_net(netplay_t *netplay)
 
       pretro_unserialize(netplay->buffer[netplay->other_ptr].state,
             netplay->state_size);
-      bool first = true;
       while (first || (netplay->tmp_ptr != netplay->self_ptr))
       {
-         pretro_serialize(netplay->buffer[netplay->tmp_ptr].state,
-               netplay->state_size);
+         /* Once this replay is done, other_ptr moves up to read_ptr,
+          * so frames before that can never be rolled back to again.
+          * The first frame's slot also still holds what we just loaded. */
+         if (!first && netplay->tmp_frame_count >= netplay->read_frame_count)
+            netplay_serialize(netplay, netplay->tmp_ptr);
+         else
+            netplay->stats.serializes_skipped++;
 #if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
          lock_autosave();
 #endif
@@ -1506,6 +1672,12 @@ static void netplay_post_frame_net(netplay_t *netplay)
       netplay->other_ptr = netplay->read_ptr;
       netplay->other_frame_count = netplay->read_frame_count;
       netplay->is_replay = false;
+
+      netplay->stats.rollbacks++;
+      netplay->stats.replayed_frames += depth;
+      netplay->stats.replay_usec += rarch_get_time_usec() - start;
+      if (depth > netplay->stats.max_rollback_depth)
+         netplay->stats.max_rollback_depth = depth;
    }
 }
 
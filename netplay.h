@@ -43,6 +43,27 @@ int16_t input_state_spectate_client(unsigned port, unsigned device,
 
 typedef struct netplay netplay_t;
 
+struct netplay_stats
+{
+   /* Mispredicted stretches that were rolled back and replayed,
+    * and how many frames that cost in total. */
+   uint64_t rollbacks;
+   uint64_t replayed_frames;
+   unsigned max_rollback_depth;
+
+   /* pretro_serialize() calls made, and calls a replay could skip
+    * because no later rollback can land on that frame. */
+   uint64_t serializes;
+   uint64_t serializes_skipped;
+   retro_time_t serialize_usec;
+   retro_time_t replay_usec;
+
+   /* Frames we may run ahead of the peer before blocking,
+    * and the smoothed round-trip time it is derived from. */
+   unsigned window;
+   retro_time_t rtt_usec;
+};
+
 bool netplay_init_network(void);
 
 /* Creates a new netplay handle. A NULL host means we're 
@@ -54,6 +75,8 @@ netplay_t *netplay_new(const char *server,
 
 void netplay_free(netplay_t *handle);
 
+void netplay_get_stats(netplay_t *handle, struct netplay_stats *stats);
+
 /* On regular netplay, flip who controls player 1 and 2. */
 void netplay_flip_players(netplay_t *handle);
 
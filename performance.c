@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "libretro.h"
 #include "performance.h"
 #include "general.h"
@@ -126,6 +127,255 @@ static void log_counters(
    }
 }
 
+/* Below 16 usec every value gets its own bucket, above that
+ * there are 8 per octave, up to 2^26 usec. */
+#define PERF_STAGE_BUCKETS 192
+
+struct rarch_perf_stage_timer rarch_perf_stage_timers[RARCH_PERF_STAGE_LAST];
+
+static struct
+{
+   uint64_t frames;
+   retro_time_t total;
+   retro_time_t max;
+   uint32_t buckets[PERF_STAGE_BUCKETS];
+} perf_stage_stats[RARCH_PERF_STAGE_LAST];
+
+static retro_time_t perf_stage_history[RARCH_PERF_HISTORY_SIZE][RARCH_PERF_STAGE_LAST];
+static uint64_t perf_stage_history_frames;
+
+static const char *perf_stage_idents[RARCH_PERF_STAGE_LAST] = {
+   "core_run",
+   "video_frame",
+   "audio_flush",
+   "audio_write",
+   "input_poll",
+   "rewind_push",
+   "softfilter",
+};
+
+static unsigned perf_stage_bucket(retro_time_t usec)
+{
+   unsigned msb = 4;
+   unsigned index;
+
+   if (usec < 16)
+      return usec < 0 ? 0 : (unsigned)usec;
+
+   while (msb < 63 && (usec >> (msb + 1)))
+      msb++;
+
+   index = (msb - 2) * 8 + ((usec >> (msb - 3)) & 7);
+   return index < PERF_STAGE_BUCKETS ? index : PERF_STAGE_BUCKETS - 1;
+}
+
+/* Largest value that lands in the bucket. */
+static retro_time_t perf_stage_bucket_max(unsigned index)
+{
+   unsigned msb, sub;
+
+   if (index < 16)
+      return index;
+
+   msb = index / 8 + 2;
+   sub = index % 8;
+   return ((retro_time_t)(9 + sub) << (msb - 3)) - 1;
+}
+
+void rarch_perf_frame_end(void)
+{
+   unsigned i;
+   retro_time_t *history;
+
+   if (!rarch_perf_stage_enabled())
+      return;
+
+   /* Menu and pause iterations don't run the core; what they
+    * spent in the other stages isn't a frame of the game. */
+   if (!rarch_perf_stage_timers[RARCH_PERF_STAGE_CORE_RUN].ran)
+   {
+      memset(rarch_perf_stage_timers, 0, sizeof(rarch_perf_stage_timers));
+      return;
+   }
+
+   history = perf_stage_history[
+      perf_stage_history_frames++ % RARCH_PERF_HISTORY_SIZE];
+
+   for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+   {
+      struct rarch_perf_stage_timer *timer = &rarch_perf_stage_timers[i];
+
+      history[i] = -1;
+      if (!timer->ran)
+         continue;
+
+      history[i] = timer->frame;
+      perf_stage_stats[i].frames++;
+      perf_stage_stats[i].total += timer->frame;
+      if (timer->frame > perf_stage_stats[i].max)
+         perf_stage_stats[i].max = timer->frame;
+      perf_stage_stats[i].buckets[perf_stage_bucket(timer->frame)]++;
+
+      timer->frame = 0;
+      timer->ran   = false;
+   }
+}
+
+static retro_time_t perf_stage_percentile(unsigned stage, unsigned percent)
+{
+   unsigned i;
+   uint64_t seen   = 0;
+   uint64_t target = (perf_stage_stats[stage].frames * percent + 99) / 100;
+
+   for (i = 0; i < PERF_STAGE_BUCKETS; i++)
+   {
+      seen += perf_stage_stats[stage].buckets[i];
+      if (seen && seen >= target)
+         break;
+   }
+
+   if (i == PERF_STAGE_BUCKETS)
+      return 0;
+
+   /* The top bucket is clamped, and none should read past max. */
+   if (perf_stage_bucket_max(i) > perf_stage_stats[stage].max)
+      return perf_stage_stats[stage].max;
+   return perf_stage_bucket_max(i);
+}
+
+void rarch_perf_stage_get_summary(enum rarch_perf_stage stage,
+      struct rarch_perf_stage_summary *summary)
+{
+   memset(summary, 0, sizeof(*summary));
+   summary->ident  = perf_stage_idents[stage];
+   summary->frames = perf_stage_stats[stage].frames;
+   if (!summary->frames)
+      return;
+
+   summary->avg = perf_stage_stats[stage].total / summary->frames;
+   summary->p50 = perf_stage_percentile(stage, 50);
+   summary->p99 = perf_stage_percentile(stage, 99);
+   summary->max = perf_stage_stats[stage].max;
+}
+
+unsigned rarch_perf_stage_history(retro_time_t *out, unsigned max_frames)
+{
+   unsigned i;
+   uint64_t frames = perf_stage_history_frames;
+
+   if (frames > RARCH_PERF_HISTORY_SIZE)
+      frames = RARCH_PERF_HISTORY_SIZE;
+   if (frames > max_frames)
+      frames = max_frames;
+
+   for (i = 0; i < frames; i++)
+      memcpy(out + i * RARCH_PERF_STAGE_LAST,
+            perf_stage_history[(perf_stage_history_frames - frames + i)
+            % RARCH_PERF_HISTORY_SIZE],
+            sizeof(perf_stage_history[0]));
+
+   return (unsigned)frames;
+}
+
+bool rarch_perf_stage_write(const char *path)
+{
+   unsigned i, j, frames;
+   const char *ext = strrchr(path, '.');
+   bool json       = ext && !strcmp(ext, ".json");
+   retro_time_t *history;
+   FILE *file;
+
+   history = (retro_time_t*)malloc(sizeof(perf_stage_history));
+   if (!history)
+      return false;
+
+   file = fopen(path, "w");
+   if (!file)
+   {
+      RARCH_ERR("[PERF]: Could not open \"%s\" for writing.\n", path);
+      free(history);
+      return false;
+   }
+
+   frames = rarch_perf_stage_history(history, RARCH_PERF_HISTORY_SIZE);
+
+   fprintf(file, json ? "{\n  \"stages\": [\n" :
+         "stage,frames,avg_usec,p50_usec,p99_usec,max_usec\n");
+   for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+   {
+      struct rarch_perf_stage_summary summary;
+      rarch_perf_stage_get_summary((enum rarch_perf_stage)i, &summary);
+
+      fprintf(file, json ?
+            "    { \"stage\": \"%s\", \"frames\": %llu, \"avg_usec\": %lld, "
+            "\"p50_usec\": %lld, \"p99_usec\": %lld, \"max_usec\": %lld }%s\n" :
+            "%s,%llu,%lld,%lld,%lld,%lld%s\n",
+            summary.ident, (unsigned long long)summary.frames,
+            (long long)summary.avg, (long long)summary.p50,
+            (long long)summary.p99, (long long)summary.max,
+            json && i + 1 < RARCH_PERF_STAGE_LAST ? "," : "");
+   }
+
+   /* Then the last frames, one row each, -1 where a stage didn't run. */
+   if (json)
+      fprintf(file, "  ],\n  \"history\": [\n");
+   else
+   {
+      fprintf(file, "\nframe");
+      for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+         fprintf(file, ",%s", perf_stage_idents[i]);
+      fprintf(file, "\n");
+   }
+
+   for (j = 0; j < frames; j++)
+   {
+      const retro_time_t *row = history + j * RARCH_PERF_STAGE_LAST;
+
+      if (json)
+         fprintf(file, "    [");
+      else
+         fprintf(file, "%llu,", (unsigned long long)
+               (perf_stage_history_frames - frames + j));
+
+      for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+         fprintf(file, "%s%lld", i ? "," : "", (long long)row[i]);
+
+      fprintf(file, json ? "]%s\n" : "%s\n",
+            json && j + 1 < frames ? "," : "");
+   }
+
+   if (json)
+      fprintf(file, "  ]\n}\n");
+
+   fclose(file);
+   free(history);
+   return true;
+}
+
+void rarch_perf_stage_clear(void)
+{
+   memset(rarch_perf_stage_timers, 0, sizeof(rarch_perf_stage_timers));
+   memset(perf_stage_stats, 0, sizeof(perf_stage_stats));
+   memset(perf_stage_history, 0, sizeof(perf_stage_history));
+   perf_stage_history_frames = 0;
+}
+
+static void log_stages(void)
+{
+   unsigned i;
+   for (i = 0; i < RARCH_PERF_STAGE_LAST; i++)
+   {
+      struct rarch_perf_stage_summary summary;
+      rarch_perf_stage_get_summary((enum rarch_perf_stage)i, &summary);
+      if (!summary.frames)
+         continue;
+
+      RARCH_LOG("[PERF]: Frame (%s): p50 %lld, p99 %lld, max %lld usec, %llu frames.\n",
+            summary.ident, (long long)summary.p50, (long long)summary.p99,
+            (long long)summary.max, (unsigned long long)summary.frames);
+   }
+}
+
 void rarch_perf_log(void)
 {
    if (!g_extern.perfcnt_enable)
@@ -133,6 +383,12 @@ void rarch_perf_log(void)
 
    RARCH_LOG("[PERF]: Performance counters (RetroArch):\n");
    log_counters(perf_counters_rarch, perf_ptr_rarch);
+   log_stages();
+
+   if (*g_settings.perfcnt_export_path &&
+         rarch_perf_stage_write(g_settings.perfcnt_export_path))
+      RARCH_LOG("[PERF]: Frame timings written to \"%s\".\n",
+            g_settings.perfcnt_export_path);
 }
 
 void retro_perf_log(void)
@@ -311,6 +567,46 @@ static void arm_enable_runfast_mode(void)
 }
 #endif
 
+unsigned rarch_get_cpu_cores(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   SYSTEM_INFO sysinfo;
+   GetSystemInfo(&sysinfo);
+   return sysinfo.dwNumberOfProcessors;
+#elif defined(ANDROID)
+   return android_getCpuCount();
+#elif defined(GEKKO) || defined(PSP) || defined(__CELLOS_LV2__)
+   return 1;
+#elif defined(_XBOX360)
+   return 3;
+#elif defined(_SC_NPROCESSORS_ONLN)
+   /* Linux, most UNIX-likes. */
+   long ret = sysconf(_SC_NPROCESSORS_ONLN);
+   if (ret <= 0)
+      return 1;
+   return (unsigned)ret;
+#elif defined(BSD) || defined(__APPLE__)
+   int num_cpu = 0;
+   int mib[2];
+   size_t len = sizeof(num_cpu);
+
+   mib[0] = CTL_HW;
+   mib[1] = HW_AVAILCPU;
+   sysctl(mib, 2, &num_cpu, &len, NULL, 0);
+   if (num_cpu < 1)
+   {
+      mib[1] = HW_NCPU;
+      sysctl(mib, 2, &num_cpu, &len, NULL, 0);
+      if (num_cpu < 1)
+         num_cpu = 1;
+   }
+   return num_cpu;
+#else
+   /* No idea, assume single core. */
+   return 1;
+#endif
+}
+
 uint64_t rarch_get_cpu_features(void)
 {
    uint64_t cpu = 0;
@@ -66,8 +66,94 @@ static inline void rarch_perf_stop(struct retro_perf_counter *perf)
       perf->total += rarch_get_perf_counter() - perf->start;
 }
 
+/* Per-frame stage timing, on top of the counters above.
+ *
+ * A stage may be entered several times in one frame (e.g. audio
+ * flushes); the time adds up, and rarch_perf_frame_end() files
+ * each stage that ran into a histogram and a short history ring.
+ * Always compiled in; like the counters it costs a branch unless
+ * perfcnt_enable (or the frame pacing overlay) is on.
+ * Times are in microseconds. */
+enum rarch_perf_stage
+{
+   RARCH_PERF_STAGE_CORE_RUN = 0,
+   RARCH_PERF_STAGE_VIDEO_FRAME,
+   RARCH_PERF_STAGE_AUDIO_FLUSH,
+   RARCH_PERF_STAGE_AUDIO_WRITE,
+   RARCH_PERF_STAGE_INPUT_POLL,
+   RARCH_PERF_STAGE_REWIND_PUSH,
+   RARCH_PERF_STAGE_SOFTFILTER,
+
+   RARCH_PERF_STAGE_LAST
+};
+
+/* Frames kept for rarch_perf_stage_history(). */
+#define RARCH_PERF_HISTORY_SIZE 256
+
+struct rarch_perf_stage_timer
+{
+   retro_time_t start;
+   retro_time_t frame;
+   bool ran;
+};
+
+struct rarch_perf_stage_summary
+{
+   const char *ident;
+   uint64_t frames;
+   retro_time_t avg;
+   retro_time_t p50;
+   retro_time_t p99;
+   retro_time_t max;
+};
+
+extern struct rarch_perf_stage_timer
+   rarch_perf_stage_timers[RARCH_PERF_STAGE_LAST];
+
+/* The frame pacing overlay reads the stages too. */
+static inline bool rarch_perf_stage_enabled(void)
+{
+   return g_extern.perfcnt_enable || g_settings.frame_pacing_show;
+}
+
+static inline void rarch_perf_stage_begin(enum rarch_perf_stage stage)
+{
+   if (rarch_perf_stage_enabled())
+      rarch_perf_stage_timers[stage].start = rarch_get_time_usec();
+}
+
+static inline void rarch_perf_stage_end(enum rarch_perf_stage stage)
+{
+   if (rarch_perf_stage_enabled())
+   {
+      struct rarch_perf_stage_timer *timer = &rarch_perf_stage_timers[stage];
+      timer->frame += rarch_get_time_usec() - timer->start;
+      timer->ran    = true;
+   }
+}
+
+/* Call once per main loop iteration, after everything above has
+ * run. Iterations that didn't run the core are not recorded. */
+void rarch_perf_frame_end(void);
+
+/* Percentiles come from log buckets (8 per octave), so they are
+ * accurate to about 12%; avg and max are exact. */
+void rarch_perf_stage_get_summary(enum rarch_perf_stage stage,
+      struct rarch_perf_stage_summary *summary);
+
+/* Copies the last frames, oldest first, RARCH_PERF_STAGE_LAST
+ * times per frame. A stage that didn't run that frame reads -1.
+ * Returns the number of frames copied, at most max_frames. */
+unsigned rarch_perf_stage_history(retro_time_t *out, unsigned max_frames);
+
+/* Writes the summaries and history out, as JSON when path ends
+ * in .json and CSV otherwise. */
+bool rarch_perf_stage_write(const char *path);
+
+void rarch_perf_stage_clear(void);
+
 uint64_t rarch_get_cpu_features(void);
-//unsigned rarch_get_cpu_cores(void);
+unsigned rarch_get_cpu_cores(void);
 
 /* Used internally by RetroArch. */
 #define RARCH_PERFORMANCE_INIT(X) \
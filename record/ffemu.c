@@ -23,6 +23,9 @@
 #endif
 
 static const ffemu_backend_t *ffemu_backends[] = {
+#ifdef HAVE_THREADS
+   &ffemu_lossless,
+#endif
 #ifdef HAVE_FFMPEG
    &ffemu_ffmpeg,
 #endif
@@ -304,6 +304,7 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
       rarch_resampler_realloc(&audio->resampler_data,
             &audio->resampler,
             g_settings.audio.resampler,
+            (enum resampler_quality)g_settings.audio.resampler_quality,
             audio->ratio);
    }
    else
@@ -0,0 +1,615 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Lossless recording without FFmpeg. The main thread only copies
+ * frames and audio into pooled buffers and queues them; a thread
+ * delta codes them and does all the writing. When the pool runs
+ * dry the frame or audio is dropped instead of waiting for the
+ * disk. See lossless.h for the stream format. */
+
+#include "ffemu.h"
+#include "lossless.h"
+#include <rthreads/rthreads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../general.h"
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+/* About 8 frames and half a second of audio of slack for the
+ * encoder to fall behind by before anything is dropped. */
+#define LOSSLESS_VIDEO_SLOTS 8
+#define LOSSLESS_AUDIO_SLOTS 16
+#define LOSSLESS_AUDIO_SLOT_FRAMES 2048
+
+/* Frames between keyframes, so the converter can start anywhere
+ * after a damaged or cut-off stretch. */
+#define LOSSLESS_KEYFRAME_INTERVAL 600
+
+#define LOSSLESS_FILE_BUFFER (256 * 1024)
+
+enum lossless_packet_type
+{
+   LOSSLESS_PACKET_VIDEO = 0,
+   LOSSLESS_PACKET_AUDIO,
+   /* Only carries repeats and silence. */
+   LOSSLESS_PACKET_GAP
+};
+
+struct lossless_slot
+{
+   uint8_t *data;
+   unsigned width;
+   unsigned height;
+   size_t size;
+};
+
+struct lossless_packet
+{
+   enum lossless_packet_type type;
+   struct lossless_slot *slot;
+   /* Repeats of the last frame and frames of silence for dropped
+    * audio that came in after this packet. */
+   unsigned dupes;
+   unsigned silence;
+};
+
+/* Gaps ride along on the packet before them, so only a packet
+ * with a slot, or a lone gap on an empty queue, takes up room. */
+#define LOSSLESS_QUEUE_SIZE (LOSSLESS_VIDEO_SLOTS + LOSSLESS_AUDIO_SLOTS + 1)
+
+typedef struct lossless
+{
+   struct ffemu_params params;
+   FILE *file;
+   size_t max_stride;
+
+   struct lossless_slot video_slots[LOSSLESS_VIDEO_SLOTS];
+   struct lossless_slot audio_slots[LOSSLESS_AUDIO_SLOTS];
+   struct lossless_slot *free_video[LOSSLESS_VIDEO_SLOTS];
+   struct lossless_slot *free_audio[LOSSLESS_AUDIO_SLOTS];
+   unsigned free_video_count;
+   unsigned free_audio_count;
+
+   struct lossless_packet queue[LOSSLESS_QUEUE_SIZE];
+   unsigned queue_read;
+   unsigned queue_count;
+
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *thread;
+   bool quit;
+
+   /* Encoder thread only. */
+   uint8_t *prev;
+   uint8_t *coded;
+   uint8_t *silence;
+   unsigned prev_width;
+   unsigned prev_height;
+   unsigned since_keyframe;
+   uint64_t video_frames;
+   uint64_t audio_frames;
+   bool write_error;
+
+   /* Main thread only. */
+   unsigned dropped_video;
+   unsigned dropped_audio;
+} lossless_t;
+
+static bool lossless_is_big_endian(void)
+{
+   const uint16_t one = 1;
+   return *(const uint8_t*)&one == 0;
+}
+
+static bool lossless_write_chunk(lossless_t *handle, uint32_t tag,
+      const void *head, size_t head_size, const void *data, size_t size)
+{
+   uint8_t chunk[8];
+
+   lossless_write_le32(chunk + 0, tag);
+   lossless_write_le32(chunk + 4, (uint32_t)(head_size + size));
+
+   /* Chunks without a head or a payload pass NULL for it. */
+   if (fwrite(chunk, 1, sizeof(chunk), handle->file) != sizeof(chunk) ||
+         (head_size &&
+          fwrite(head, 1, head_size, handle->file) != head_size) ||
+         (size && fwrite(data, 1, size, handle->file) != size))
+   {
+      if (!handle->write_error)
+         RARCH_ERR("[Lossless]: Failed to write to \"%s\".\n",
+               handle->params.filename);
+      handle->write_error = true;
+      return false;
+   }
+
+   return true;
+}
+
+static uint8_t *lossless_put_varint(uint8_t *out, size_t val)
+{
+   while (val >= 0x80)
+   {
+      *out++ = (uint8_t)(val | 0x80);
+      val >>= 7;
+   }
+   *out++ = (uint8_t)val;
+   return out;
+}
+
+/* XORs frame against prev word by word and codes the result as
+ * runs of unchanged and changed words. prev ends up as frame. */
+static size_t lossless_code_frame(uint8_t *out, uint8_t *prev,
+      const uint8_t *frame, size_t words)
+{
+   size_t i = 0;
+   uint8_t *start = out;
+
+   while (i < words)
+   {
+      uint32_t a, b;
+      size_t skip = 0, literal = 0;
+
+      for (; i < words; i++, skip++)
+      {
+         memcpy(&a, prev + i * 4, 4);
+         memcpy(&b, frame + i * 4, 4);
+         if (a != b)
+            break;
+      }
+
+      out = lossless_put_varint(out, skip);
+
+      for (; i + literal < words; literal++)
+      {
+         memcpy(&a, prev + (i + literal) * 4, 4);
+         memcpy(&b, frame + (i + literal) * 4, 4);
+         if (a == b)
+            break;
+      }
+
+      out = lossless_put_varint(out, literal);
+      for (; literal; literal--, i++)
+      {
+         memcpy(&a, prev + i * 4, 4);
+         memcpy(&b, frame + i * 4, 4);
+         a ^= b;
+         memcpy(out, &a, 4);
+         memcpy(prev + i * 4, &b, 4);
+         out += 4;
+      }
+   }
+
+   return out - start;
+}
+
+static void lossless_encode_video(lossless_t *handle,
+      const struct lossless_slot *slot)
+{
+   uint8_t head[12];
+   uint32_t tag   = LOSSLESS_TAG_VDLT;
+   size_t stride  = lossless_stride(slot->width, handle->params.pix_fmt);
+   size_t words   = stride * slot->height / 4;
+   size_t coded;
+
+   if (slot->width != handle->prev_width ||
+         slot->height != handle->prev_height ||
+         handle->since_keyframe >= LOSSLESS_KEYFRAME_INTERVAL)
+   {
+      tag = LOSSLESS_TAG_VKEY;
+      memset(handle->prev, 0, stride * slot->height);
+      handle->prev_width     = slot->width;
+      handle->prev_height    = slot->height;
+      handle->since_keyframe = 0;
+   }
+
+   coded = lossless_code_frame(handle->coded, handle->prev, slot->data, words);
+
+   lossless_write_le32(head + 0, slot->width);
+   lossless_write_le32(head + 4, slot->height);
+   lossless_write_le32(head + 8, (uint32_t)stride);
+   lossless_write_chunk(handle, tag, head, sizeof(head), handle->coded, coded);
+
+   handle->since_keyframe++;
+   handle->video_frames++;
+}
+
+static void lossless_encode_audio(lossless_t *handle,
+      struct lossless_slot *slot)
+{
+   /* The samples go out little endian. */
+   if (lossless_is_big_endian())
+   {
+      size_t i;
+      for (i = 0; i + 1 < slot->size; i += 2)
+      {
+         uint8_t tmp       = slot->data[i];
+         slot->data[i]     = slot->data[i + 1];
+         slot->data[i + 1] = tmp;
+      }
+   }
+
+   lossless_write_chunk(handle, LOSSLESS_TAG_AUDI, NULL, 0,
+         slot->data, slot->size);
+   handle->audio_frames += slot->size / (2 * handle->params.channels);
+}
+
+static void lossless_encode_silence(lossless_t *handle, size_t frames)
+{
+   struct lossless_slot silence = {0};
+
+   silence.data = handle->silence;
+   while (frames)
+   {
+      size_t chunk = frames < LOSSLESS_AUDIO_SLOT_FRAMES ?
+         frames : LOSSLESS_AUDIO_SLOT_FRAMES;
+      silence.size = chunk * handle->params.channels * sizeof(int16_t);
+      lossless_encode_audio(handle, &silence);
+      frames -= chunk;
+   }
+}
+
+static void lossless_thread(void *data)
+{
+   lossless_t *handle = (lossless_t*)data;
+
+   for (;;)
+   {
+      struct lossless_packet packet;
+
+      slock_lock(handle->lock);
+      while (!handle->queue_count && !handle->quit)
+         scond_wait(handle->cond, handle->lock);
+
+      /* Drain everything before quitting. */
+      if (!handle->queue_count)
+      {
+         slock_unlock(handle->lock);
+         break;
+      }
+
+      packet = handle->queue[handle->queue_read];
+      handle->queue_read = (handle->queue_read + 1) % LOSSLESS_QUEUE_SIZE;
+      handle->queue_count--;
+      slock_unlock(handle->lock);
+
+      switch (packet.type)
+      {
+         case LOSSLESS_PACKET_VIDEO:
+            lossless_encode_video(handle, packet.slot);
+            break;
+         case LOSSLESS_PACKET_AUDIO:
+            lossless_encode_audio(handle, packet.slot);
+            break;
+         case LOSSLESS_PACKET_GAP:
+            break;
+      }
+
+      for (; packet.dupes; packet.dupes--)
+      {
+         lossless_write_chunk(handle, LOSSLESS_TAG_VDUP, NULL, 0, NULL, 0);
+         handle->video_frames++;
+      }
+
+      if (packet.silence)
+         lossless_encode_silence(handle, packet.silence);
+
+      if (!packet.slot)
+         continue;
+
+      slock_lock(handle->lock);
+      if (packet.type == LOSSLESS_PACKET_VIDEO)
+         handle->free_video[handle->free_video_count++] = packet.slot;
+      else
+         handle->free_audio[handle->free_audio_count++] = packet.slot;
+      slock_unlock(handle->lock);
+   }
+}
+
+static bool lossless_write_header(lossless_t *handle)
+{
+   uint8_t header[LOSSLESS_HEADER_SIZE];
+   const struct ffemu_params *params = &handle->params;
+
+   memcpy(header, LOSSLESS_MAGIC, 8);
+   lossless_write_le32(header +  8, LOSSLESS_VERSION);
+   lossless_write_le32(header + 12,
+         lossless_is_big_endian() ? LOSSLESS_FLAG_BIG_ENDIAN : 0);
+   lossless_write_le32(header + 16, params->pix_fmt);
+   lossless_write_le32(header + 20, params->fb_width);
+   lossless_write_le32(header + 24, params->fb_height);
+   lossless_write_le32(header + 28, params->channels);
+   lossless_write_le64(header + 32, (uint64_t)(params->fps * 1000000.0 + 0.5));
+   lossless_write_le64(header + 40,
+         (uint64_t)(params->samplerate * 1000000.0 + 0.5));
+
+   return fwrite(header, 1, sizeof(header), handle->file) == sizeof(header);
+}
+
+static void lossless_free(void *data)
+{
+   unsigned i;
+   lossless_t *handle = (lossless_t*)data;
+
+   if (!handle)
+      return;
+
+   if (handle->thread)
+   {
+      slock_lock(handle->lock);
+      handle->quit = true;
+      scond_signal(handle->cond);
+      slock_unlock(handle->lock);
+      sthread_join(handle->thread);
+   }
+
+   if (handle->lock)
+      slock_free(handle->lock);
+   if (handle->cond)
+      scond_free(handle->cond);
+
+   for (i = 0; i < LOSSLESS_VIDEO_SLOTS; i++)
+      free(handle->video_slots[i].data);
+   for (i = 0; i < LOSSLESS_AUDIO_SLOTS; i++)
+      free(handle->audio_slots[i].data);
+
+   if (handle->file)
+      fclose(handle->file);
+
+   free(handle->prev);
+   free(handle->coded);
+   free(handle->silence);
+   free(handle);
+}
+
+static void *lossless_new(const struct ffemu_params *params)
+{
+   unsigned i;
+   size_t frame_size;
+   const char *ext;
+   lossless_t *handle;
+
+   if (!lossless_pixel_size(params->pix_fmt) || !params->channels)
+      return NULL;
+
+#ifdef HAVE_FFMPEG
+   /* FFmpeg takes everything else. */
+   ext = strrchr(params->filename, '.');
+   if (!ext || strcmp(ext, ".rrec"))
+      return NULL;
+#else
+   (void)ext;
+#endif
+
+   handle = (lossless_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      return NULL;
+
+   handle->params     = *params;
+   handle->max_stride = lossless_stride(params->fb_width, params->pix_fmt);
+   frame_size         = handle->max_stride * params->fb_height;
+
+   handle->prev    = (uint8_t*)calloc(1, frame_size);
+   handle->coded   = (uint8_t*)malloc(lossless_max_coded_size(frame_size / 4));
+   handle->silence = (uint8_t*)calloc(LOSSLESS_AUDIO_SLOT_FRAMES,
+         params->channels * sizeof(int16_t));
+   if (!handle->prev || !handle->coded || !handle->silence)
+      goto error;
+
+   for (i = 0; i < LOSSLESS_VIDEO_SLOTS; i++)
+   {
+      handle->video_slots[i].data = (uint8_t*)calloc(1, frame_size);
+      if (!handle->video_slots[i].data)
+         goto error;
+      handle->free_video[handle->free_video_count++] = &handle->video_slots[i];
+   }
+
+   for (i = 0; i < LOSSLESS_AUDIO_SLOTS; i++)
+   {
+      handle->audio_slots[i].data = (uint8_t*)malloc(
+            LOSSLESS_AUDIO_SLOT_FRAMES * params->channels * sizeof(int16_t));
+      if (!handle->audio_slots[i].data)
+         goto error;
+      handle->free_audio[handle->free_audio_count++] = &handle->audio_slots[i];
+   }
+
+   handle->file = fopen(params->filename, "wb");
+   if (!handle->file)
+   {
+      RARCH_ERR("[Lossless]: Could not open \"%s\".\n", params->filename);
+      goto error;
+   }
+   setvbuf(handle->file, NULL, _IOFBF, LOSSLESS_FILE_BUFFER);
+
+   if (!lossless_write_header(handle))
+      goto error;
+
+   handle->lock   = slock_new();
+   handle->cond   = scond_new();
+   if (!handle->lock || !handle->cond)
+      goto error;
+
+   handle->thread = sthread_create(lossless_thread, handle);
+   if (!handle->thread)
+      goto error;
+
+   RARCH_LOG("[Lossless]: Recording %ux%u to \"%s\".\n",
+         params->fb_width, params->fb_height, params->filename);
+   return handle;
+
+error:
+   lossless_free(handle);
+   return NULL;
+}
+
+static struct lossless_slot *lossless_get_slot(lossless_t *handle,
+      bool video)
+{
+   struct lossless_slot *slot = NULL;
+
+   slock_lock(handle->lock);
+   if (video && handle->free_video_count)
+      slot = handle->free_video[--handle->free_video_count];
+   else if (!video && handle->free_audio_count)
+      slot = handle->free_audio[--handle->free_audio_count];
+   slock_unlock(handle->lock);
+
+   return slot;
+}
+
+/* Hands a packet to the encoder. There is always room, every
+ * packet either holds a slot or is a gap on an empty queue. */
+static void lossless_queue(lossless_t *handle,
+      enum lossless_packet_type type, struct lossless_slot *slot,
+      unsigned dupes, unsigned silence)
+{
+   struct lossless_packet *packet;
+
+   slock_lock(handle->lock);
+   if (type == LOSSLESS_PACKET_GAP && handle->queue_count)
+      packet = &handle->queue[(handle->queue_read + handle->queue_count - 1)
+         % LOSSLESS_QUEUE_SIZE];
+   else
+   {
+      packet = &handle->queue[
+         (handle->queue_read + handle->queue_count++) % LOSSLESS_QUEUE_SIZE];
+      packet->type    = type;
+      packet->slot    = slot;
+      packet->dupes   = 0;
+      packet->silence = 0;
+      scond_signal(handle->cond);
+   }
+   packet->dupes   += dupes;
+   packet->silence += silence;
+   slock_unlock(handle->lock);
+}
+
+static bool lossless_push_video(void *data,
+      const struct ffemu_video_data *video_data)
+{
+   unsigned y;
+   size_t row, stride;
+   struct lossless_slot *slot;
+   lossless_t *handle = (lossless_t*)data;
+
+   if (video_data->is_dupe || !video_data->data)
+   {
+      lossless_queue(handle, LOSSLESS_PACKET_GAP, NULL, 1, 0);
+      return true;
+   }
+
+   if (video_data->width > handle->params.fb_width ||
+         video_data->height > handle->params.fb_height)
+      return false;
+
+   /* Out of slots: the encoder is behind, so repeat the last frame
+    * rather than wait on it. */
+   if (!(slot = lossless_get_slot(handle, true)))
+   {
+      handle->dropped_video++;
+      lossless_queue(handle, LOSSLESS_PACKET_GAP, NULL, 1, 0);
+      return true;
+   }
+
+   row    = video_data->width * lossless_pixel_size(handle->params.pix_fmt);
+   stride = lossless_stride(video_data->width, handle->params.pix_fmt);
+
+   for (y = 0; y < video_data->height; y++)
+   {
+      uint8_t *dst = slot->data + y * stride;
+      memcpy(dst, (const uint8_t*)video_data->data + y * video_data->pitch, row);
+      memset(dst + row, 0, stride - row);
+   }
+
+   slot->width  = video_data->width;
+   slot->height = video_data->height;
+   lossless_queue(handle, LOSSLESS_PACKET_VIDEO, slot, 0, 0);
+   return true;
+}
+
+static bool lossless_push_audio(void *data,
+      const struct ffemu_audio_data *audio_data)
+{
+   lossless_t *handle = (lossless_t*)data;
+   const int16_t *samples = (const int16_t*)audio_data->data;
+   size_t frames          = audio_data->frames;
+
+   while (frames)
+   {
+      size_t chunk = frames < LOSSLESS_AUDIO_SLOT_FRAMES ?
+         frames : LOSSLESS_AUDIO_SLOT_FRAMES;
+      size_t size  = chunk * handle->params.channels * sizeof(int16_t);
+      struct lossless_slot *slot = lossless_get_slot(handle, false);
+
+      /* Out of slots, so the encoder writes silence in its place. */
+      if (!slot)
+      {
+         handle->dropped_audio += chunk;
+         lossless_queue(handle, LOSSLESS_PACKET_GAP, NULL, 0, chunk);
+      }
+      else
+      {
+         memcpy(slot->data, samples, size);
+         slot->size = size;
+         lossless_queue(handle, LOSSLESS_PACKET_AUDIO, slot, 0, 0);
+      }
+
+      samples += chunk * handle->params.channels;
+      frames  -= chunk;
+   }
+
+   return true;
+}
+
+static bool lossless_finalize(void *data)
+{
+   uint8_t end[24];
+   lossless_t *handle = (lossless_t*)data;
+
+   if (!handle->thread)
+      return false;
+
+   /* Let the encoder drain the queue, then close the stream off. */
+   slock_lock(handle->lock);
+   handle->quit = true;
+   scond_signal(handle->cond);
+   slock_unlock(handle->lock);
+   sthread_join(handle->thread);
+   handle->thread = NULL;
+
+   lossless_write_le64(end +  0, handle->video_frames);
+   lossless_write_le64(end +  8, handle->audio_frames);
+   lossless_write_le32(end + 16, handle->dropped_video);
+   lossless_write_le32(end + 20, handle->dropped_audio);
+   lossless_write_chunk(handle, LOSSLESS_TAG_REND, end, sizeof(end), NULL, 0);
+
+   if (handle->dropped_video || handle->dropped_audio)
+      RARCH_WARN("[Lossless]: Encoder fell behind, dropped %u frames and %u audio frames.\n",
+            handle->dropped_video, handle->dropped_audio);
+
+   return fflush(handle->file) == 0 && !handle->write_error;
+}
+
+const ffemu_backend_t ffemu_lossless = {
+   lossless_new,
+   lossless_free,
+   lossless_push_video,
+   lossless_push_audio,
+   lossless_finalize,
+   "lossless",
+};
@@ -0,0 +1,113 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FFEMU_LOSSLESS_H
+#define __FFEMU_LOSSLESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* The .rrec stream written by the lossless recording backend.
+ * All integers are little endian.
+ *
+ * Header:
+ *    char     magic[8]       "RARCHREC"
+ *    uint32_t version        LOSSLESS_VERSION
+ *    uint32_t flags          LOSSLESS_FLAG_*
+ *    uint32_t pix_fmt        enum ffemu_pix_format
+ *    uint32_t fb_width       Largest frame that can follow.
+ *    uint32_t fb_height
+ *    uint32_t channels
+ *    uint64_t fps            In millionths.
+ *    uint64_t samplerate     In millionths.
+ *
+ * Then chunks of uint32_t tag, uint32_t payload size, payload:
+ *
+ * VKEY, VDLT: uint32_t width, height, stride, then the frame XORed
+ *    with the previous one (an all zero frame for VKEY) as 32-bit
+ *    words, coded as repeating (varint zero words to skip, varint
+ *    words that follow verbatim, the words). stride is width times
+ *    the pixel size rounded up to 4 bytes, the padding is zero.
+ * VDUP: Empty, the previous frame again.
+ * AUDI: Interleaved int16_t samples.
+ * REND: uint64_t video frames, uint64_t audio frames, uint32_t
+ *    video frames and uint32_t audio frames dropped because the
+ *    encoder fell behind. Dropped video frames are written as VDUP
+ *    and dropped audio as silence, so the two stay in sync.
+ *
+ * Pixels are stored as they were in memory; with
+ * LOSSLESS_FLAG_BIG_ENDIAN set, RGB565 and ARGB8888 pixels
+ * are in big endian byte order. */
+
+#define LOSSLESS_MAGIC "RARCHREC"
+#define LOSSLESS_VERSION 1
+#define LOSSLESS_HEADER_SIZE 48
+
+#define LOSSLESS_FLAG_BIG_ENDIAN (1 << 0)
+
+#define LOSSLESS_TAG(a, b, c, d) \
+   ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+#define LOSSLESS_TAG_VKEY LOSSLESS_TAG('V', 'K', 'E', 'Y')
+#define LOSSLESS_TAG_VDLT LOSSLESS_TAG('V', 'D', 'L', 'T')
+#define LOSSLESS_TAG_VDUP LOSSLESS_TAG('V', 'D', 'U', 'P')
+#define LOSSLESS_TAG_AUDI LOSSLESS_TAG('A', 'U', 'D', 'I')
+#define LOSSLESS_TAG_REND LOSSLESS_TAG('R', 'E', 'N', 'D')
+
+static inline void lossless_write_le32(uint8_t *buf, uint32_t val)
+{
+   buf[0] = (uint8_t)(val >>  0);
+   buf[1] = (uint8_t)(val >>  8);
+   buf[2] = (uint8_t)(val >> 16);
+   buf[3] = (uint8_t)(val >> 24);
+}
+
+static inline void lossless_write_le64(uint8_t *buf, uint64_t val)
+{
+   lossless_write_le32(buf, (uint32_t)val);
+   lossless_write_le32(buf + 4, (uint32_t)(val >> 32));
+}
+
+static inline uint32_t lossless_read_le32(const uint8_t *buf)
+{
+   return (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) |
+      ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static inline uint64_t lossless_read_le64(const uint8_t *buf)
+{
+   return lossless_read_le32(buf) |
+      ((uint64_t)lossless_read_le32(buf + 4) << 32);
+}
+
+static inline unsigned lossless_pixel_size(unsigned pix_fmt)
+{
+   /* FFEMU_PIX_RGB565, FFEMU_PIX_BGR24, FFEMU_PIX_ARGB8888 */
+   static const unsigned sizes[] = { 2, 3, 4 };
+   return pix_fmt < 3 ? sizes[pix_fmt] : 0;
+}
+
+static inline size_t lossless_stride(unsigned width, unsigned pix_fmt)
+{
+   return (width * lossless_pixel_size(pix_fmt) + 3) & ~3;
+}
+
+/* Worst case size of a coded frame of the given number of words. */
+static inline size_t lossless_max_coded_size(size_t words)
+{
+   return words * 4 + (words / 2 + 1) * 10;
+}
+
+#endif
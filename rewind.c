@@ -28,6 +28,20 @@
 #define UINT32_MAX 0xffffffffu
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+/* States smaller than this compress faster than a thread handoff. */
+#define REWIND_ASYNC_MIN_STATE_SIZE (256 << 10)
+#endif
+
+/* Pushes between keyframes in the sparse tier. */
+#define REWIND_KEYFRAME_INTERVAL 60
+
+/* Bytes past the end of each block buffer. Covers the terminator
+ * words plus the widest vector load that can start before them. */
+#define REWIND_BLOCK_PADDING (sizeof(uint16_t) * 4 + 32)
+
 #undef CPU_X86
 #if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__)
 #define CPU_X86
@@ -93,7 +107,7 @@ static inline size_t read_size_t(const void *ptr)
    return ret;
 }
 
-struct state_manager
+struct rewind_ring
 {
    uint8_t *data;
    size_t capacity;
@@ -101,10 +115,26 @@ struct state_manager
    uint8_t *head;
    /* If head comes close to this, discard a frame. */
    uint8_t *tail;
+   /* Compressed entries currently held. */
+   unsigned entries;
+};
+
+/* History is kept in two tiers sharing one budget. The dense ring
+ * holds a delta for every push. The sparse ring holds a delta between
+ * consecutive keyframes, taken every sparse_interval pushes, and takes
+ * over once the dense ring runs dry. */
+struct state_manager
+{
+   struct rewind_ring dense;
+   struct rewind_ring sparse;
 
    uint8_t *thisblock;
    uint8_t *nextblock;
 
+   /* Newest keyframe, uncompressed. */
+   uint8_t *sparse_block;
+   unsigned sparse_interval;
+
    /* This one is rounded up from reset::blocksize. */
    size_t blocksize;
 
@@ -113,12 +143,55 @@ struct state_manager
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
 
-   unsigned entries;
+   /* Push index of the state in thisblock, and of the state in
+    * sparse_block (0 if there is none). Keyframes are always taken
+    * at multiples of sparse_interval. */
+   size_t top;
+   size_t sparse_top;
+
    bool thisblock_valid;
+
+#ifdef HAVE_THREADS
+   /* Async mode: the caller serializes into stage[0] while the worker
+    * compresses an earlier push out of nextblock. If the worker is
+    * still busy at push time, the state waits in stage[1] and the
+    * caller only blocks once a second push comes in behind it.
+    * busy stays set until both are done. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *stage[2];
+   bool queued;
+   bool busy;
+   bool alive;
+#endif
 };
 
+static struct retro_perf_counter gen_deltas = {"gen_deltas"};
+/* Time the caller spends blocked on the async worker. */
+static struct retro_perf_counter rewind_wait = {"rewind_wait"};
+
+static void state_manager_push_frame(state_manager_t *state);
+
+static bool ring_init(struct rewind_ring *ring, size_t size)
+{
+   ring->data = (uint8_t*)malloc(size);
+   ring->capacity = size;
+   ring->head = ring->data + sizeof(size_t);
+   ring->tail = ring->data + sizeof(size_t);
+   return ring->data != NULL;
+}
+
 state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 {
+   return state_manager_new_tiered(state_size, buffer_size,
+         REWIND_KEYFRAME_INTERVAL);
+}
+
+state_manager_t *state_manager_new_tiered(size_t state_size,
+      size_t buffer_size, unsigned keyframe_interval)
+{
+   size_t sparse_size = 0;
    state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
    if (!state)
       return NULL;
@@ -131,13 +204,25 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    state->maxcompsize = state->blocksize + maxcblks * sizeof(uint16_t) * 2 +
       sizeof(uint16_t) + sizeof(uint32_t) + sizeof(size_t) * 2;
 
-   state->data = (uint8_t*)malloc(buffer_size);
+   /* Keyframes only pay off if both rings can hold a fair number
+    * of worst-case entries. */
+   if (keyframe_interval > 1 &&
+         buffer_size / 2 >= (sizeof(size_t) + state->maxcompsize) * 8)
+   {
+      sparse_size = buffer_size / 2;
+      state->sparse_interval = keyframe_interval;
+      state->sparse_block = (uint8_t*)
+         calloc(state->blocksize + REWIND_BLOCK_PADDING, 1);
+      if (!state->sparse_block || !ring_init(&state->sparse, sparse_size))
+         goto error;
+   }
 
    state->thisblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
+      calloc(state->blocksize + REWIND_BLOCK_PADDING, 1);
    state->nextblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
-   if (!state->data || !state->thisblock || !state->nextblock)
+      calloc(state->blocksize + REWIND_BLOCK_PADDING, 1);
+   if (!ring_init(&state->dense, buffer_size - sparse_size) ||
+         !state->thisblock || !state->nextblock)
       goto error;
 
    /* Force in a different byte at the end, so we don't need to check 
@@ -149,17 +234,22 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
     * There is also some padding at the end. This is so we don't 
     * read outside the buffer end if we're reading in large blocks;
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get 
-    * Valgrind happy is worth it. */
-   *(uint16_t*)(state->thisblock + state->blocksize + sizeof(uint16_t) * 3) =
-      0xFFFF;
-   *(uint16_t*)(state->nextblock + state->blocksize + sizeof(uint16_t) * 3) =
-      0x0000;
-
-   state->capacity = buffer_size;
-
-   state->head = state->data + sizeof(size_t);
-   state->tail = state->data + sizeof(size_t);
+    * It doesn't make any difference to us, but sacrificing 32 bytes to get 
+    * Valgrind happy is worth it.
+    *
+    * The terminators themselves are rewritten before every compression,
+    * as buffers rotate through the staging slot in async mode. */
+
+   if (!gen_deltas.registered)
+      rarch_perf_register(&gen_deltas);
+   if (!rewind_wait.registered)
+      rarch_perf_register(&rewind_wait);
+
+#ifdef HAVE_THREADS
+   if (state_size >= REWIND_ASYNC_MIN_STATE_SIZE &&
+         rarch_get_cpu_cores() > 1)
+      state_manager_set_async(state, true);
+#endif
 
    return state;
 
@@ -173,32 +263,143 @@ void state_manager_free(state_manager_t *state)
    if (!state)
       return;
 
-   free(state->data);
+   state_manager_set_async(state, false);
+#ifdef HAVE_THREADS
+   free(state->stage[0]);
+   free(state->stage[1]);
+#endif
+   free(state->dense.data);
+   free(state->sparse.data);
+   free(state->sparse_block);
    free(state->thisblock);
    free(state->nextblock);
    free(state);
 }
 
-bool state_manager_pop(state_manager_t *state, const void **data)
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data)
 {
-   *data = NULL;
+   state_manager_t *state = (state_manager_t*)data;
 
-   if (state->thisblock_valid)
+   slock_lock(state->lock);
+   for (;;)
    {
-      state->thisblock_valid = false;
-      state->entries--;
-      *data = state->thisblock;
+      while (!state->busy && state->alive)
+         scond_wait(state->cond, state->lock);
+      if (!state->alive)
+         break;
+
+      slock_unlock(state->lock);
+      state_manager_push_frame(state);
+      slock_lock(state->lock);
+
+      if (state->queued)
+      {
+         uint8_t *swap = state->stage[1];
+         state->stage[1] = state->nextblock;
+         state->nextblock = swap;
+         state->queued = false;
+      }
+      else
+         state->busy = false;
+      scond_signal(state->cond);
+   }
+   slock_unlock(state->lock);
+}
+
+/* Returns with the worker idle and the lock held. */
+static void state_manager_lock_idle(state_manager_t *state)
+{
+   slock_lock(state->lock);
+   if (!state->busy)
+      return;
+
+   RARCH_PERFORMANCE_START(rewind_wait);
+   while (state->busy)
+      scond_wait(state->cond, state->lock);
+   RARCH_PERFORMANCE_STOP(rewind_wait);
+}
+#endif
+
+static void state_manager_wait(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (!state->thread)
+      return;
+
+   state_manager_lock_idle(state);
+   slock_unlock(state->lock);
+#endif
+}
+
+bool state_manager_set_async(state_manager_t *state, bool enable)
+{
+#ifdef HAVE_THREADS
+   if (!enable)
+   {
+      if (!state->thread)
+         return true;
+
+      state_manager_lock_idle(state);
+      state->alive = false;
+      scond_signal(state->cond);
+      slock_unlock(state->lock);
+
+      sthread_join(state->thread);
+      slock_free(state->lock);
+      scond_free(state->cond);
+      state->thread = NULL;
+      state->lock = NULL;
+      state->cond = NULL;
+      return true;
+   }
+
+   if (state->thread)
       return true;
+
+   if (!state->stage[0])
+      state->stage[0] = (uint8_t*)
+         calloc(state->blocksize + REWIND_BLOCK_PADDING, 1);
+   if (!state->stage[1])
+      state->stage[1] = (uint8_t*)
+         calloc(state->blocksize + REWIND_BLOCK_PADDING, 1);
+
+   state->lock = slock_new();
+   state->cond = scond_new();
+   state->alive = true;
+   state->busy = false;
+   state->queued = false;
+
+   if (state->stage[0] && state->stage[1] && state->lock && state->cond)
+      state->thread = sthread_create(state_manager_thread, state);
+
+   if (!state->thread)
+   {
+      slock_free(state->lock);
+      scond_free(state->cond);
+      state->lock = NULL;
+      state->cond = NULL;
+      return false;
    }
 
-   if (state->head == state->tail)
+   return true;
+#else
+   return !enable;
+#endif
+}
+
+/* Applies the newest entry of ring to block, turning it
+ * into the state pushed before it. */
+static bool ring_pop(struct rewind_ring *ring, uint8_t *block)
+{
+   if (ring->head == ring->tail)
       return false;
 
-   size_t start = read_size_t(state->head - sizeof(size_t));
-   state->head = state->data + start;
+   size_t start = read_size_t(ring->head - sizeof(size_t));
+   ring->head = ring->data + start;
 
-   const uint8_t *compressed = state->data + start + sizeof(size_t);
-   uint8_t *out = state->thisblock;
+   const uint8_t *compressed = ring->data + start + sizeof(size_t);
+   uint8_t *out = block;
 
    /* Begin decompression code
     * out is the last pushed (or returned) state */
@@ -235,31 +436,99 @@ bool state_manager_pop(state_manager_t *state, const void **data)
    }
    /* End decompression code */
 
-   state->entries--;
+   ring->entries--;
+   return true;
+}
+
+/* Drops keyframes at or after push index limit, leaving the newest
+ * older one in sparse_block. Returns false if there is none. */
+static bool sparse_seek(state_manager_t *state, size_t limit)
+{
+   while (state->sparse_top && state->sparse_top >= limit)
+   {
+      if (ring_pop(&state->sparse, state->sparse_block))
+         state->sparse_top -= state->sparse_interval;
+      else
+         state->sparse_top = 0;
+   }
+
+   return state->sparse_top != 0;
+}
+
+bool state_manager_pop(state_manager_t *state, const void **data)
+{
+   *data = NULL;
+
+   state_manager_wait(state);
+
+   if (state->thisblock_valid)
+   {
+      state->thisblock_valid = false;
+      *data = state->thisblock;
+      return true;
+   }
+
+   if (ring_pop(&state->dense, state->thisblock))
+      state->top--;
+   else
+   {
+      /* Dense history is used up, continue from the keyframes. */
+      if (!sparse_seek(state, state->top))
+         return false;
+
+      memcpy(state->thisblock, state->sparse_block, state->blocksize);
+      state->top = state->sparse_top;
+   }
+
    *data = state->thisblock;
    return true;
 }
 
-void state_manager_push_where(state_manager_t *state, void **data)
+/* We need to ensure we have an uncompressed copy of the last
+ * pushed state, or we could end up applying a 'patch' to wrong 
+ * savestate, and that'd blow up rather quickly. */
+static void state_manager_revalidate(state_manager_t *state)
 {
-   /* We need to ensure we have an uncompressed copy of the last
-    * pushed state, or we could end up applying a 'patch' to wrong 
-    * savestate, and that'd blow up rather quickly. */
+   const void *ignored;
+
+   if (state->thisblock_valid)
+      return;
+
+   /* With no deltas left, thisblock still holds the state
+    * last returned by pop, which is what the next push follows. */
+   if (state->dense.head == state->dense.tail)
+      state->thisblock_valid = state->top != 0;
+   else if (state_manager_pop(state, &ignored))
+      state->thisblock_valid = true;
+}
 
-   if (!state->thisblock_valid) 
+void state_manager_push_where(state_manager_t *state, void **data)
+{
+#ifdef HAVE_THREADS
+   if (state->thread)
    {
-      const void *ignored;
-      if (state_manager_pop(state, &ignored))
-      {
-         state->thisblock_valid = true;
-         state->entries++;
-      }
+      bool busy;
+
+      /* A push in flight always leaves an uncompressed copy behind,
+       * and the worker never touches stage[0],
+       * so there is no need to wait for it here. */
+      slock_lock(state->lock);
+      busy = state->busy;
+      slock_unlock(state->lock);
+
+      if (!busy)
+         state_manager_revalidate(state);
+
+      *data = state->stage[0];
+      return;
    }
-   
+#endif
+
+   state_manager_revalidate(state);
    *data = state->nextblock;
 }
 
-#if __SSE2__
+#if __SSE2__ || __AVX2__
 #if defined(__GNUC__)
 static inline int compat_ctz(unsigned x)
 {
@@ -272,18 +541,42 @@ static inline int compat_ctz(unsigned x)
 
 static inline int compat_ctz(unsigned x)
 {
-   if (x & 0x000f)
-      return 0;
-   if (x & 0x00f0)
-      return 4;
-   if (x & 0x0f00)
-      return 8;
-   if (x & 0xf000)
-      return 12;
-   return 16;
+   int ret = 0;
+   for (; ret < 32; ret += 4)
+      if (x & (0xfu << ret))
+         break;
+   return ret;
 }
 #endif
+#endif
+
+#if __AVX2__
+#include <immintrin.h>
+
+static inline size_t find_change(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0 = _mm256_loadu_si256(a256);
+      __m256i v1 = _mm256_loadu_si256(b256);
+      __m256i c = _mm256_cmpeq_epi32(v0, v1);
+
+      uint32_t mask = _mm256_movemask_epi8(c);
+      if (mask != 0xffffffffu)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
 
+      a256++;
+      b256++;
+   }
+}
+#elif __SSE2__
 #include <emmintrin.h>
 /* There's no equivalent in libc, you'd think so ...
  * std::mismatch exists, but it's not optimized at all. */
@@ -345,6 +638,37 @@ static inline size_t find_change(const uint16_t *a, const uint16_t *b)
 }
 #endif
 
+#if __AVX2__
+/* Same rules as the scalar version below, eight 32-bit words at a time. */
+static inline size_t find_same(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0 = _mm256_loadu_si256(a256);
+      __m256i v1 = _mm256_loadu_si256(b256);
+      uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(v0, v1));
+
+      if (mask)
+      {
+         size_t off = ((uint8_t*)a256 - (uint8_t*)a_org) + compat_ctz(mask);
+         a = (const uint16_t*)((const uint8_t*)a_org + off);
+         b = (const uint16_t*)((const uint8_t*)b + off);
+         break;
+      }
+
+      a256++;
+      b256++;
+   }
+
+   if (a != a_org && a[-1] == b[-1])
+      a--;
+   return a - a_org;
+}
+#else
 static inline size_t find_same(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
@@ -384,34 +708,37 @@ static inline size_t find_same(const uint16_t *a, const uint16_t *b)
    }
    return a - a_org;
 }
+#endif
 
-void state_manager_push_do(state_manager_t *state)
+/* Stores the delta turning newb back into oldb as ring's newest entry,
+ * discarding the oldest entries as needed. */
+static void ring_push(state_manager_t *state, struct rewind_ring *ring,
+      uint8_t *oldb, uint8_t *newb)
 {
-   if (state->thisblock_valid)
    {
-      if (state->capacity < sizeof(size_t) + state->maxcompsize)
+      if (ring->capacity < sizeof(size_t) + state->maxcompsize)
          return;
 
 recheckcapacity:;
 
-      size_t headpos = state->head - state->data;
-      size_t tailpos = state->tail - state->data;
-      size_t remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+      size_t headpos = ring->head - ring->data;
+      size_t tailpos = ring->tail - ring->data;
+      size_t remaining = (tailpos + ring->capacity -
+            sizeof(size_t) - headpos - 1) % ring->capacity + 1;
 
       if (remaining <= state->maxcompsize)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
+         ring->tail = ring->data + read_size_t(ring->tail);
+         ring->entries--;
          goto recheckcapacity;
       }
 
-      RARCH_PERFORMANCE_INIT(gen_deltas);
       RARCH_PERFORMANCE_START(gen_deltas);
 
-      const uint8_t *oldb = state->thisblock;
-      const uint8_t *newb = state->nextblock;
-      uint8_t *compressed = state->head + sizeof(size_t);
+      *(uint16_t*)(oldb + state->blocksize + sizeof(uint16_t) * 3) = 0xFFFF;
+      *(uint16_t*)(newb + state->blocksize + sizeof(uint16_t) * 3) = 0x0000;
+
+      uint8_t *compressed = ring->head + sizeof(size_t);
 
       /* Begin compression code; 'compressed' will point to 
        * the end of the compressed data (excluding the prev pointer). */
@@ -470,19 +797,29 @@ recheckcapacity:;
       compressed = (uint8_t*)(compressed16 + 3);
       /* End compression code. */
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
+      if (compressed - ring->data + state->maxcompsize > ring->capacity)
       {
-         compressed = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         compressed = ring->data;
+         if (ring->tail == ring->data + sizeof(size_t))
+         {
+            ring->tail = ring->data + read_size_t(ring->tail);
+            ring->entries--;
+         }
       }
-      write_size_t(compressed, state->head-state->data);
+      write_size_t(compressed, ring->head - ring->data);
       compressed += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head = compressed;
+      write_size_t(ring->head, compressed - ring->data);
+      ring->head = compressed;
+      ring->entries++;
 
       RARCH_PERFORMANCE_STOP(gen_deltas);
    }
+}
+
+static void state_manager_push_frame(state_manager_t *state)
+{
+   if (state->thisblock_valid)
+      ring_push(state, &state->dense, state->thisblock, state->nextblock);
    else
       state->thisblock_valid = true;
 
@@ -490,22 +827,98 @@ recheckcapacity:;
    state->thisblock = state->nextblock;
    state->nextblock = swap;
 
-   state->entries++;
-   return;
+   state->top++;
+
+   if (state->sparse_interval &&
+         (state->top % state->sparse_interval) == 0)
+   {
+      /* Anything at or past this point belongs to a
+       * future that was rewound away. */
+      if (sparse_seek(state, state->top))
+         ring_push(state, &state->sparse,
+               state->sparse_block, state->thisblock);
+
+      memcpy(state->sparse_block, state->thisblock, state->blocksize);
+      state->sparse_top = state->top;
+   }
+}
+
+void state_manager_push_do(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (state->thread)
+   {
+      uint8_t *swap;
+
+      slock_lock(state->lock);
+      if (state->queued)
+      {
+         RARCH_PERFORMANCE_START(rewind_wait);
+         while (state->queued)
+            scond_wait(state->cond, state->lock);
+         RARCH_PERFORMANCE_STOP(rewind_wait);
+      }
+
+      swap = state->stage[0];
+      if (state->busy)
+      {
+         /* Picked up by the worker once it is done with nextblock. */
+         state->stage[0] = state->stage[1];
+         state->stage[1] = swap;
+         state->queued = true;
+      }
+      else
+      {
+         state->stage[0] = state->nextblock;
+         state->nextblock = swap;
+         state->busy = true;
+         scond_signal(state->cond);
+      }
+      slock_unlock(state->lock);
+      return;
+   }
+#endif
+
+   state_manager_push_frame(state);
+}
+
+static size_t ring_used(const struct rewind_ring *ring)
+{
+   size_t headpos, tailpos;
+
+   if (!ring->data)
+      return 0;
+
+   headpos = ring->head - ring->data;
+   tailpos = ring->tail - ring->data;
+   return ring->capacity - ((tailpos + ring->capacity -
+         sizeof(size_t) - headpos - 1) % ring->capacity + 1);
 }
 
 void state_manager_capacity(state_manager_t *state,
-      unsigned *entries, size_t *bytes, bool *full)
+      unsigned *entries, size_t *bytes, bool *full, size_t *horizon)
 {
-   size_t headpos = state->head - state->data;
-   size_t tailpos = state->tail - state->data;
-   size_t remaining = (tailpos + state->capacity -
-         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+   size_t oldest;
+
+   state_manager_wait(state);
+
+   /* Oldest push index still reachable from either tier. */
+   oldest = state->top - state->dense.entries;
+   if (state->sparse_top)
+   {
+      size_t sparse_oldest = state->sparse_top -
+         (size_t)state->sparse.entries * state->sparse_interval;
+      if (sparse_oldest < oldest)
+         oldest = sparse_oldest;
+   }
 
    if (entries)
-      *entries = state->entries;
+      *entries = state->dense.entries + state->thisblock_valid;
    if (bytes)
-      *bytes = state->capacity-remaining;
+      *bytes = ring_used(&state->dense) + ring_used(&state->sparse);
    if (full)
-      *full = remaining <= state->maxcompsize * 2;
+      *full = state->dense.capacity - ring_used(&state->dense) <=
+         state->maxcompsize * 2;
+   if (horizon)
+      *horizon = state->top ? state->top - oldest : 0;
 }
@@ -21,8 +21,16 @@
 
 typedef struct state_manager state_manager_t;
 
+/* Uses the default keyframe interval. */
 state_manager_t *state_manager_new(size_t state_size, size_t buffer_size);
 
+/* Half of buffer_size keeps a delta for every push, the other half
+ * a delta for every keyframe_interval pushes, which is used once
+ * the dense history runs out. A keyframe_interval of 0 or 1, or a
+ * buffer too small to split, keeps all history dense. */
+state_manager_t *state_manager_new_tiered(size_t state_size,
+      size_t buffer_size, unsigned keyframe_interval);
+
 void state_manager_free(state_manager_t *state);
 
 bool state_manager_pop(state_manager_t *state, const void **data);
@@ -31,7 +39,18 @@ void state_manager_push_where(state_manager_t *state, void **data);
 
 void state_manager_push_do(state_manager_t *state);
 
+/* In async mode, state_manager_push_do() only hands the state to
+ * a worker thread, which compresses it while the next frame runs.
+ * One more push can be staged behind it before push_do() blocks;
+ * pop and capacity wait for both. Time spent blocked shows up in
+ * the rewind_wait perf counter.
+ * Enabled by default for large states on multi-core hosts.
+ * Returns false if the worker could not be started. */
+bool state_manager_set_async(state_manager_t *state, bool enable);
+
+/* horizon is how many pushes back the oldest reachable state is.
+ * Multiply by the push interval to get it in frames. */
 void state_manager_capacity(state_manager_t *state,
-      unsigned int *entries, size_t *bytes, bool *full);
+      unsigned int *entries, size_t *bytes, bool *full, size_t *horizon);
 
 #endif
@@ -18,6 +18,7 @@
 #include <file/file_path.h>
 #include "dynamic.h"
 #include "performance.h"
+#include "frame_pacing.h"
 #include "retroarch_logger.h"
 #include "intl/intl.h"
 
@@ -201,10 +202,14 @@ static void check_rewind(bool pressed)
 
          RARCH_PERFORMANCE_INIT(rewind_serialize);
          RARCH_PERFORMANCE_START(rewind_serialize);
+         rarch_perf_stage_begin(RARCH_PERF_STAGE_REWIND_PUSH);
          pretro_serialize(state, g_extern.state_size);
          RARCH_PERFORMANCE_STOP(rewind_serialize);
 
+         /* Only the handoff when compressing on a worker thread,
+          * any blocking on it is counted in rewind_wait. */
          state_manager_push_do(g_extern.state_manager);
+         rarch_perf_stage_end(RARCH_PERF_STAGE_REWIND_PUSH);
       }
    }
 
@@ -225,7 +230,6 @@ static void check_slowmotion(bool pressed)
    msg_queue_push(g_extern.msg_queue, g_extern.frame_is_reverse ?
          "Slow motion rewind." : "Slow motion.", 0, 30);
 }
-/*
 static bool check_movie_init(void)
 {
    char path[PATH_MAX], msg[PATH_MAX];
@@ -276,7 +280,7 @@ static bool check_movie_record(void)
          RETRO_MSG_MOVIE_RECORD_STOPPING, 2, 180);
    RARCH_LOG(RETRO_LOG_MOVIE_RECORD_STOPPING);
 
-   rarch_main_command(RARCH_CMD_BSV_MOVIE_DEINIT);
+   rarch_bsv_movie_deinit();
 
    return true;
 }
@@ -290,7 +294,7 @@ static bool check_movie_playback(void)
          RETRO_MSG_MOVIE_PLAYBACK_ENDED, 1, 180);
    RARCH_LOG(RETRO_LOG_MOVIE_PLAYBACK_ENDED);
 
-   rarch_main_command(RARCH_CMD_BSV_MOVIE_DEINIT);
+   rarch_bsv_movie_deinit();
 
    g_extern.bsv.movie_end = false;
    g_extern.bsv.movie_playback = false;
@@ -305,7 +309,8 @@ static bool check_movie(void)
    if (!g_extern.bsv.movie)
       return check_movie_init();
    return check_movie_record();
-}*/
+}
+
 /*
 static void check_shader_dir(bool pressed_next, bool pressed_prev)
 {
@@ -426,8 +431,8 @@ static int do_state_checks(
 
    check_slowmotion_func(input);
 
-  // if (BIT64_GET(trigger_input, RARCH_MOVIE_RECORD_TOGGLE))
-    //  check_movie();
+   if (BIT64_GET(trigger_input, RARCH_MOVIE_RECORD_TOGGLE))
+      check_movie();
 
    //check_shader_dir_func(trigger_input);
 
@@ -669,6 +674,11 @@ int rarch_main_iterate(void)
    if (time_to_exit(input))
       return -1;
 
+#if defined(HAVE_THREADS)
+   if (g_extern.save_queue)
+      save_queue_poll(g_extern.save_queue);
+#endif
+
    if (g_extern.system.frame_time.callback)
       update_frame_time();
 
@@ -697,6 +707,8 @@ int rarch_main_iterate(void)
    {
       /* RetroArch has been paused */
       driver.retro_ctx.poll_cb();
+      frame_pacing_frame();
+      rarch_perf_frame_end();
       rarch_sleep(10);
 
       return 1;
@@ -711,10 +723,10 @@ int rarch_main_iterate(void)
       netplay_pre_frame((netplay_t*)driver.netplay_data);
 #endif
 
-  /* if (g_extern.bsv.movie)
+   if (g_extern.bsv.movie)
       bsv_movie_set_frame_start(g_extern.bsv.movie);
 
-   if (g_extern.system.camera_callback.caps)
+  /* if (g_extern.system.camera_callback.caps)
       driver_camera_poll(); */
 
    /* Update binds for analog dpad modes. */
@@ -733,8 +745,11 @@ int rarch_main_iterate(void)
       rarch_sleep(g_settings.video.frame_delay);
 
 
-   /* Run libretro for one frame. */
+   /* Run libretro for one frame. The core's own video, audio and
+    * input callbacks are timed on their own as well. */
+   rarch_perf_stage_begin(RARCH_PERF_STAGE_CORE_RUN);
    pretro_run();
+   rarch_perf_stage_end(RARCH_PERF_STAGE_CORE_RUN);
    /* Optionally boot to the menu when loading states. */
    if ((g_settings.autoload_safe && g_settings.stateload_pause && g_settings.savestate_auto_load) ||
           (g_settings.regular_load_safe && g_settings.regular_state_pause)) {
@@ -766,6 +781,9 @@ int rarch_main_iterate(void)
 #endif
 
 success:
+   frame_pacing_frame();
+   rarch_perf_frame_end();
+
    if (g_settings.fastforward_ratio_throttle_enable)
       limit_frame_time();
 
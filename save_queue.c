@@ -0,0 +1,308 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "save_queue.h"
+#include "file_ops.h"
+#include <rthreads/rthreads.h>
+#include <compat/strl.h>
+#include <retro_miscellaneous.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Enough for a quick-save and every SRAM type in flight at once.
+ * Buffers are kept around between saves, so a quick-save doesn't
+ * have to fault in a fresh state-sized allocation each time. */
+#define SAVE_QUEUE_SLOTS 4
+
+enum save_job_state
+{
+   SAVE_JOB_FREE = 0,
+   SAVE_JOB_RESERVED,
+   SAVE_JOB_PENDING,
+   SAVE_JOB_WRITING,
+   SAVE_JOB_DONE
+};
+
+struct save_job
+{
+   enum save_job_state state;
+   unsigned seq;
+   bool success;
+
+   char path[PATH_MAX];
+   void *buf;
+   size_t capacity;
+   size_t size;
+
+   save_queue_cb_t cb;
+   void *userdata;
+};
+
+struct save_queue
+{
+   struct save_job jobs[SAVE_QUEUE_SLOTS];
+   unsigned seq;
+
+   slock_t *lock;
+   /* Signalled when a job is pushed, and when one finishes. */
+   scond_t *work_cond;
+   scond_t *done_cond;
+   sthread_t *thread;
+   bool quit;
+};
+
+/* Oldest job in the given state, or NULL. Call with the lock held. */
+static struct save_job *save_queue_oldest(save_queue_t *queue,
+      enum save_job_state state)
+{
+   unsigned i;
+   struct save_job *ret = NULL;
+
+   for (i = 0; i < SAVE_QUEUE_SLOTS; i++)
+   {
+      struct save_job *job = &queue->jobs[i];
+      if (job->state == state &&
+            (!ret || (int)(job->seq - ret->seq) < 0))
+         ret = job;
+   }
+
+   return ret;
+}
+
+static bool save_queue_busy(save_queue_t *queue)
+{
+   unsigned i;
+   for (i = 0; i < SAVE_QUEUE_SLOTS; i++)
+      if (queue->jobs[i].state == SAVE_JOB_PENDING ||
+            queue->jobs[i].state == SAVE_JOB_WRITING)
+         return true;
+   return false;
+}
+
+static void save_queue_thread(void *data)
+{
+   save_queue_t *queue = (save_queue_t*)data;
+
+   slock_lock(queue->lock);
+   for (;;)
+   {
+      bool success;
+      struct save_job *job = save_queue_oldest(queue, SAVE_JOB_PENDING);
+
+      if (!job)
+      {
+         if (queue->quit)
+            break;
+         scond_wait(queue->work_cond, queue->lock);
+         continue;
+      }
+
+      /* The main thread leaves path and buf alone while we write. */
+      job->state = SAVE_JOB_WRITING;
+      slock_unlock(queue->lock);
+
+      success = write_file_atomic(job->path, job->buf, job->size);
+
+      slock_lock(queue->lock);
+      job->success = success;
+      job->state = SAVE_JOB_DONE;
+      scond_signal(queue->done_cond);
+   }
+   slock_unlock(queue->lock);
+}
+
+save_queue_t *save_queue_new(void)
+{
+   save_queue_t *queue = (save_queue_t*)calloc(1, sizeof(*queue));
+   if (!queue)
+      return NULL;
+
+   queue->lock      = slock_new();
+   queue->work_cond = scond_new();
+   queue->done_cond = scond_new();
+   if (!queue->lock || !queue->work_cond || !queue->done_cond)
+      goto error;
+
+   queue->thread = sthread_create(save_queue_thread, queue);
+   if (!queue->thread)
+      goto error;
+
+   return queue;
+
+error:
+   if (queue->lock)
+      slock_free(queue->lock);
+   if (queue->work_cond)
+      scond_free(queue->work_cond);
+   if (queue->done_cond)
+      scond_free(queue->done_cond);
+   free(queue);
+   return NULL;
+}
+
+void save_queue_free(save_queue_t *queue)
+{
+   unsigned i;
+
+   if (!queue)
+      return;
+
+   save_queue_flush(queue);
+
+   slock_lock(queue->lock);
+   queue->quit = true;
+   scond_signal(queue->work_cond);
+   slock_unlock(queue->lock);
+   sthread_join(queue->thread);
+
+   slock_free(queue->lock);
+   scond_free(queue->work_cond);
+   scond_free(queue->done_cond);
+
+   for (i = 0; i < SAVE_QUEUE_SLOTS; i++)
+      free(queue->jobs[i].buf);
+   free(queue);
+}
+
+void save_queue_poll(save_queue_t *queue)
+{
+   for (;;)
+   {
+      struct save_job *job;
+
+      slock_lock(queue->lock);
+      job = save_queue_oldest(queue, SAVE_JOB_DONE);
+      slock_unlock(queue->lock);
+
+      if (!job)
+         break;
+
+      /* Done jobs belong to the main thread again. */
+      if (job->cb)
+         job->cb(job->path, job->buf, job->size,
+               job->success, job->userdata);
+
+      slock_lock(queue->lock);
+      job->state = SAVE_JOB_FREE;
+      slock_unlock(queue->lock);
+   }
+}
+
+void save_queue_flush(save_queue_t *queue)
+{
+   slock_lock(queue->lock);
+   while (save_queue_busy(queue))
+      scond_wait(queue->done_cond, queue->lock);
+   slock_unlock(queue->lock);
+
+   save_queue_poll(queue);
+}
+
+void *save_queue_get_buffer(save_queue_t *queue, size_t size)
+{
+   struct save_job *job;
+
+   for (;;)
+   {
+      save_queue_poll(queue);
+
+      slock_lock(queue->lock);
+      job = save_queue_oldest(queue, SAVE_JOB_FREE);
+      if (job)
+         break;
+
+      /* Everything is in flight. Wait for one, then
+       * run its callback so the slot frees up. If nothing is
+       * being written, every slot is reserved by the caller and
+       * none would ever come back. */
+      while (!save_queue_oldest(queue, SAVE_JOB_DONE) &&
+            save_queue_busy(queue))
+         scond_wait(queue->done_cond, queue->lock);
+
+      if (!save_queue_oldest(queue, SAVE_JOB_DONE))
+      {
+         slock_unlock(queue->lock);
+         return NULL;
+      }
+      slock_unlock(queue->lock);
+   }
+
+   job->state = SAVE_JOB_RESERVED;
+   slock_unlock(queue->lock);
+
+   if (job->capacity < size)
+   {
+      free(job->buf);
+      job->buf      = malloc(size);
+      job->capacity = job->buf ? size : 0;
+   }
+
+   if (!job->buf)
+   {
+      slock_lock(queue->lock);
+      job->state = SAVE_JOB_FREE;
+      slock_unlock(queue->lock);
+      return NULL;
+   }
+
+   return job->buf;
+}
+
+static struct save_job *save_queue_find(save_queue_t *queue, void *buf)
+{
+   unsigned i;
+   for (i = 0; i < SAVE_QUEUE_SLOTS; i++)
+      if (queue->jobs[i].state == SAVE_JOB_RESERVED &&
+            queue->jobs[i].buf == buf)
+         return &queue->jobs[i];
+   return NULL;
+}
+
+void save_queue_release(save_queue_t *queue, void *buf)
+{
+   struct save_job *job;
+
+   slock_lock(queue->lock);
+   job = save_queue_find(queue, buf);
+   if (job)
+      job->state = SAVE_JOB_FREE;
+   slock_unlock(queue->lock);
+}
+
+bool save_queue_push(save_queue_t *queue, void *buf, size_t size,
+      const char *path, save_queue_cb_t cb, void *userdata)
+{
+   struct save_job *job;
+
+   slock_lock(queue->lock);
+   job = save_queue_find(queue, buf);
+   if (!job || size > job->capacity)
+   {
+      slock_unlock(queue->lock);
+      return false;
+   }
+
+   strlcpy(job->path, path, sizeof(job->path));
+   job->size     = size;
+   job->cb       = cb;
+   job->userdata = userdata;
+   job->success  = false;
+   job->seq      = queue->seq++;
+   job->state    = SAVE_JOB_PENDING;
+
+   scond_signal(queue->work_cond);
+   slock_unlock(queue->lock);
+   return true;
+}
@@ -0,0 +1,59 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __RARCH_SAVE_QUEUE_H
+#define __RARCH_SAVE_QUEUE_H
+
+#include <stddef.h>
+#include <boolean.h>
+
+/* Writes savestates and SRAM on a background thread, so slow
+ * storage doesn't stall the main loop. Files are written next to
+ * their destination and renamed into place once complete. */
+
+typedef struct save_queue save_queue_t;
+
+/* Called from save_queue_poll() on the main thread once a write
+ * has finished. data stays valid until the callback returns. */
+typedef void (*save_queue_cb_t)(const char *path, const void *data,
+      size_t size, bool success, void *userdata);
+
+save_queue_t *save_queue_new(void);
+
+/* Finishes every pending write before returning. */
+void save_queue_free(save_queue_t *queue);
+
+/* Hands out a pooled buffer of at least size bytes to fill,
+ * waiting for a write to finish if all of them are in flight.
+ * It must go back through save_queue_push() or
+ * save_queue_release(). Returns NULL if allocation fails, or if
+ * every buffer is already handed out and none is being written;
+ * write synchronously instead. */
+void *save_queue_get_buffer(save_queue_t *queue, size_t size);
+
+void save_queue_release(save_queue_t *queue, void *buf);
+
+/* Queues the first size bytes of buf to be written to path.
+ * Writes happen in the order they were pushed. */
+bool save_queue_push(save_queue_t *queue, void *buf, size_t size,
+      const char *path, save_queue_cb_t cb, void *userdata);
+
+/* Runs callbacks for finished writes. Call once per frame. */
+void save_queue_poll(save_queue_t *queue);
+
+/* Blocks until every pending write has finished, then polls. */
+void save_queue_flush(save_queue_t *queue);
+
+#endif
@@ -197,8 +197,14 @@ bool screenshot_dump(const char *folder, const void *frame,
    scaler_ctx_gen_reset(&scaler);
 
    RARCH_LOG("Using RPNG for PNG screenshots.\n");
+#ifdef HAVE_THREADS
+   /* Compressing can take longer than a frame, leave it to a thread. */
+   bool ret = rpng_save_image_bgr24_async(filename,
+         out_buffer, width, height, width * 3);
+#else
    bool ret = rpng_save_image_bgr24(filename,
          out_buffer, width, height, width * 3);
+#endif
    if (!ret)
       RARCH_ERR("Failed to take screenshot.\n");
    free(out_buffer);
@@ -20,6 +20,7 @@
 #include "config.def.h"
 #include <file/file_path.h>
 #include "input/input_common.h"
+#include "benchmark.h"
 
 #ifdef USE_TITLE
 #include "wii/utils/playlog.h"
@@ -217,12 +218,13 @@ static void config_set_defaults(void)
   // g_settings.video.hard_sync = hard_sync;
   // g_settings.video.hard_sync_frames = hard_sync_frames;
    g_settings.video.frame_delay = frame_delay;
+   g_settings.video.filter_threads = video_filter_threads;
  //  g_settings.video.black_frame_insertion = black_frame_insertion;
   // g_settings.video.swap_interval = swap_interval;
-  // g_settings.video.threaded = video_threaded;
+   g_settings.video.threaded = video_threaded;
 
-   //if (g_defaults.settings.video_threaded_enable != video_threaded)
-     // g_settings.video.threaded = g_defaults.settings.video_threaded_enable;
+   if (g_defaults.settings.video_threaded_enable != video_threaded)
+      g_settings.video.threaded = g_defaults.settings.video_threaded_enable;
 
    //g_settings.video.shared_context = video_shared_context;
   // g_settings.video.force_srgb_disable = false;
@@ -287,6 +289,7 @@ static void config_set_defaults(void)
    g_settings.item_posx = item_posx;
    g_settings.item_posy = item_posy;
    g_settings.clock_show = clock_show;
+   g_settings.frame_pacing_show = frame_pacing_show;
    g_settings.clock_posx = clock_posx;
   // g_settings.single_mode = false; // No point setting this here
   
@@ -315,6 +318,7 @@ static void config_set_defaults(void)
    g_settings.video.rotation = ORIENTATION_NORMAL;
 
    g_settings.audio.sinc_taps = sinc_taps;
+   g_settings.audio.resampler_quality = audio_resampler_quality;
    g_settings.audio.enable = audio_enable;
    //g_settings.audio.mute_frames = mute_frames;
    g_settings.audio.out_rate = out_rate;
@@ -337,6 +341,7 @@ static void config_set_defaults(void)
    g_settings.rewind_enable = rewind_enable;
    g_settings.rewind_buffer_size = rewind_buffer_size;
    g_settings.rewind_granularity = rewind_granularity;
+   g_settings.movie_keyframe_interval = movie_keyframe_interval;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
    g_settings.fastforward_ratio_throttle_enable = fastforward_ratio_throttle_enable;
@@ -484,6 +489,7 @@ static void config_set_defaults(void)
     //  *g_settings.libretro_directory = '\0';
 
    *g_settings.core_options_path = '\0';
+   *g_settings.perfcnt_export_path = '\0';
    //*g_settings.content_history_path = '\0';
   // *g_settings.cheat_database = '\0';
   // *g_settings.cheat_settings_path = '\0';
@@ -1203,7 +1209,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    //CONFIG_GET_INT(video.swap_interval, "video_swap_interval");
  //  g_settings.video.swap_interval = max(g_settings.video.swap_interval, 1);
    //g_settings.video.swap_interval = min(g_settings.video.swap_interval, 4);
-   //CONFIG_GET_BOOL(video.threaded, "video_threaded");
+   CONFIG_GET_BOOL(video.threaded, "video_threaded");
   // CONFIG_GET_BOOL(video.shared_context, "video_shared_context");
 #ifdef GEKKO
    CONFIG_GET_BOOL(video.drawdone, "video_drawdone");
@@ -1420,6 +1426,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_FLOAT(audio.volume, "audio_volume");
    CONFIG_GET_STRING(audio.resampler, "audio_resampler");
    CONFIG_GET_INT(audio.sinc_taps, "audio_sinc_taps");
+   CONFIG_GET_INT(audio.resampler_quality, "audio_resampler_quality");
   // CONFIG_GET_INT(audio.mute_frames, "audio_mute_frames");
    g_extern.audio_data.volume_gain = db_to_gain(g_settings.audio.volume);
 
@@ -1434,6 +1441,7 @@ static bool config_load_file(const char *path, bool set_defaults)
   // CONFIG_GET_STRING(video.context_driver, "video_context_driver");
    CONFIG_GET_STRING(audio.driver, "audio_driver");
    CONFIG_GET_PATH(video.softfilter_plugin, "video_filter");
+   CONFIG_GET_INT(video.filter_threads, "video_filter_threads");
    CONFIG_GET_PATH(audio.dsp_plugin, "audio_dsp_plugin");
    CONFIG_GET_STRING(input.driver, "input_driver");
    CONFIG_GET_STRING(input.joypad_driver, "input_joypad_driver");
@@ -1456,6 +1464,7 @@ static bool config_load_file(const char *path, bool set_defaults)
    g_extern.config_type = CONFIG_PER_CORE;
 
    CONFIG_GET_BOOL(fps_show, "fps_show");
+   CONFIG_GET_BOOL(frame_pacing_show, "frame_pacing_show");
   // CONFIG_GET_BOOL(load_dummy_on_core_shutdown, "load_dummy_on_core_shutdown");
    CONFIG_GET_BOOL(clock_show, "clock_show");
    CONFIG_GET_BOOL(fadein, "fadein");
@@ -1505,7 +1514,8 @@ static bool config_load_file(const char *path, bool set_defaults)
   // if (!g_extern.has_set_verbosity)
   //    CONFIG_GET_BOOL_EXTERN(verbosity, "log_verbosity");
 
-  // CONFIG_GET_BOOL_EXTERN(perfcnt_enable, "perfcnt_enable");
+   CONFIG_GET_BOOL_EXTERN(perfcnt_enable, "perfcnt_enable");
+   CONFIG_GET_PATH(perfcnt_export_path, "perfcnt_export_path");
 
 #ifdef HAVE_OVERLAY
    CONFIG_GET_PATH_EXTERN(overlay_dir, "overlay_directory");
@@ -1524,6 +1534,7 @@ static bool config_load_file(const char *path, bool set_defaults)
       g_settings.rewind_buffer_size = buffer_size * UINT64_C(1000000);
 
    CONFIG_GET_INT(rewind_granularity, "rewind_granularity");
+   CONFIG_GET_INT(movie_keyframe_interval, "movie_keyframe_interval");
    CONFIG_GET_FLOAT(slowmotion_ratio, "slowmotion_ratio");
    if (g_settings.slowmotion_ratio < 1.0f)
       g_settings.slowmotion_ratio = 1.0f;
@@ -1988,6 +1999,8 @@ void config_load(void)
    
    /* if reached this point and no config was loaded, defaults are used. 
     * also the per-core setup is left so next time it gets saved as is. */
+
+   benchmark_apply_settings();
 }
 
 bool config_save_file(const char *path)
@@ -2061,6 +2074,7 @@ bool config_save_file(const char *path)
   // config_set_bool(conf,  "load_dummy_on_core_shutdown",
     //     g_settings.load_dummy_on_core_shutdown);
    config_set_bool(conf,  "fps_show", g_settings.fps_show);
+   config_set_bool(conf,  "frame_pacing_show", g_settings.frame_pacing_show);
    config_set_bool(conf,  "clock_show", g_settings.clock_show);
    config_set_bool(conf,  "fadein", g_settings.fadein);
    config_set_int(conf,  "reset_fade", g_settings.reset_fade);
@@ -2079,6 +2093,8 @@ bool config_save_file(const char *path)
    config_set_bool(conf,  "audio_sync",    g_settings.audio.sync);
   // config_set_int(conf,   "audio_block_frames", g_settings.audio.block_frames);
    config_set_int(conf,   "rewind_granularity", g_settings.rewind_granularity);
+   config_set_int(conf,   "movie_keyframe_interval",
+         g_settings.movie_keyframe_interval);
   // config_set_path(conf,  "video_shader", g_settings.video.shader_path);
    //config_set_bool(conf,  "video_shader_enable",
      //    g_settings.video.shader_enable);
@@ -2124,7 +2140,7 @@ bool config_save_file(const char *path)
    else
 #endif
      config_set_int(conf, "aspect_ratio_index", g_settings.video.aspect_ratio_idx);
-  // config_set_bool(conf,  "video_threaded", g_settings.video.threaded);
+   config_set_bool(conf,  "video_threaded", g_settings.video.threaded);
    //config_set_bool(conf,  "video_shared_context",
      //    g_settings.video.shared_context);
   // config_set_bool(conf,  "video_force_srgb_disable",
@@ -2159,6 +2175,7 @@ bool config_save_file(const char *path)
          g_settings.screenshot_directory : "default");
   // config_set_string(conf, "audio_device", g_settings.audio.device);
    config_set_string(conf, "video_filter", g_settings.video.softfilter_plugin);
+   config_set_int(conf, "video_filter_threads", g_settings.video.filter_threads);
    config_set_string(conf, "audio_dsp_plugin", g_settings.audio.dsp_plugin);
   // config_set_string(conf, "camera_device", g_settings.camera.device);
   // config_set_bool(conf, "camera_allow", g_settings.camera.allow);
@@ -2185,6 +2202,8 @@ bool config_save_file(const char *path)
     //     g_settings.resampler_directory);
    config_set_string(conf, "audio_resampler", g_settings.audio.resampler);
    config_set_int(conf, "audio_sinc_taps", g_settings.audio.sinc_taps);
+   config_set_int(conf, "audio_resampler_quality",
+         g_settings.audio.resampler_quality);
    //config_set_int(conf, "audio_mute_frames", g_settings.audio.mute_frames);
    config_set_path(conf, "savefile_directory",
          *g_extern.savefile_dir ? g_extern.savefile_dir : "default");
@@ -2387,7 +2406,8 @@ bool config_save_file(const char *path)
          g_settings.core_specific_config);
   // config_set_int(conf, "libretro_log_level", g_settings.libretro_log_level);
   // config_set_bool(conf, "log_verbosity", g_extern.verbosity);
-  // config_set_bool(conf, "perfcnt_enable", g_extern.perfcnt_enable);
+   config_set_bool(conf, "perfcnt_enable", g_extern.perfcnt_enable);
+   config_set_path(conf, "perfcnt_export_path", g_settings.perfcnt_export_path);
 
    ret = config_file_write(conf, path);
    config_file_free(conf);
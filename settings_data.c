@@ -2903,7 +2903,8 @@ static void general_write_handler(void *data)
    }
    else if (!strcmp(setting->name, "audio_volume"))
       g_extern.audio_data.volume_gain = db_to_gain(*setting->value.fraction);
-   else if (!strcmp(setting->name, "audio_latency"))
+   else if (!strcmp(setting->name, "audio_latency") ||
+         !strcmp(setting->name, "audio_resampler_quality"))
       rarch_cmd = RARCH_CMD_AUDIO_REINIT;
    else if (!strcmp(setting->name, "audio_rate_control_delta"))
    {
@@ -3933,6 +3934,18 @@ static bool setting_data_append_list_general_options(
             &subgroup_info,
             general_write_handler,
             general_read_handler);
+
+      CONFIG_BOOL(list, list_info,
+            &g_settings.frame_pacing_show,
+            "frame_pacing_show",
+            "Show Frame Pacing",
+            frame_pacing_show,
+            "OFF",
+            "ON",
+            &group_info,
+            &subgroup_info,
+            general_write_handler,
+            general_read_handler);
    }
 
   /* CONFIG_BOOL(
@@ -4867,15 +4880,15 @@ static bool setting_data_append_list_video_options(
          subgroup_info);
 
 #if defined(HAVE_THREADS) && !defined(RARCH_CONSOLE)
-   CONFIG_BOOL(
-         g_settings.video.threaded,
+   CONFIG_BOOL(list, list_info,
+         &g_settings.video.threaded,
          "video_threaded",
          "Threaded Video",
          video_threaded,
          "OFF",
          "ON",
-         group_info.name,
-         subgroup_info.name,
+         &group_info,
+         &subgroup_info,
          general_write_handler,
          general_read_handler);
    settings_list_current_add_cmd(list, list_info, RARCH_CMD_REINIT);
@@ -5259,6 +5272,18 @@ static bool setting_data_append_list_audio_options(
          general_read_handler);
 	settings_list_current_add_range(list, list_info, 2, 64, 2, true, true);
 
+   CONFIG_UINT(list, list_info,
+         &g_settings.audio.resampler_quality,
+         "audio_resampler_quality",
+         "Resampler Quality",
+         audio_resampler_quality,
+         &group_info,
+         &subgroup_info,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info,
+         RESAMPLER_QUALITY_DONTCARE, RESAMPLER_QUALITY_HIGHEST, 1, true, true);
+
    CONFIG_BOOL(list, list_info,
          &g_extern.audio_data.mute,
          "audio_mute_enable",
@@ -0,0 +1,249 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "spsc_fifo.h"
+#include <rthreads/rthreads.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+
+#define SPSC_CACHE_LINE 64
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define SPSC_LOAD_ACQUIRE(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define SPSC_STORE_RELEASE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#define SPSC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(__GNUC__)
+#define SPSC_LOAD_ACQUIRE(ptr) ({ size_t v_ = *(volatile size_t*)(ptr); \
+      __sync_synchronize(); v_; })
+#define SPSC_STORE_RELEASE(ptr, val) do { __sync_synchronize(); \
+      *(volatile size_t*)(ptr) = (val); } while (0)
+#define SPSC_FENCE() __sync_synchronize()
+#else
+/* MSVC gives volatile accesses acquire/release semantics. */
+#define SPSC_LOAD_ACQUIRE(ptr) (*(volatile size_t*)(ptr))
+#define SPSC_STORE_RELEASE(ptr, val) (*(volatile size_t*)(ptr) = (val))
+#define SPSC_FENCE() MemoryBarrier()
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define SPSC_PAUSE() __builtin_ia32_pause()
+#elif defined(_MSC_VER)
+#define SPSC_PAUSE() YieldProcessor()
+#else
+#define SPSC_PAUSE() ((void)0)
+#endif
+
+struct spsc_fifo
+{
+   uint8_t *buffer;
+   size_t size;
+   unsigned spin;
+
+   slock_t *lock;
+   scond_t *cond;
+   /* Sides sleeping in a wait. Changed under lock, but read
+    * without it after every read or write. */
+   size_t waiting;
+   bool woken;
+
+   /* Positions run from 0 to 2 * size, so a full ring can be told
+    * apart from an empty one. Each is written by one side only and
+    * sits on its own cache line, so the producer and consumer don't
+    * keep stealing one line from each other. */
+   uint8_t pad0[SPSC_CACHE_LINE];
+   size_t write_pos;
+   uint8_t pad1[SPSC_CACHE_LINE - sizeof(size_t)];
+   size_t read_pos;
+   uint8_t pad2[SPSC_CACHE_LINE - sizeof(size_t)];
+};
+
+spsc_fifo_t *spsc_fifo_new(size_t size, unsigned spin)
+{
+   spsc_fifo_t *fifo = (spsc_fifo_t*)calloc(1, sizeof(*fifo));
+   if (!fifo)
+      return NULL;
+
+   fifo->size   = size;
+   fifo->spin   = spin;
+   fifo->buffer = (uint8_t*)malloc(size);
+   fifo->lock   = slock_new();
+   fifo->cond   = scond_new();
+
+   if (!fifo->buffer || !fifo->lock || !fifo->cond)
+   {
+      spsc_fifo_free(fifo);
+      return NULL;
+   }
+
+   return fifo;
+}
+
+void spsc_fifo_free(spsc_fifo_t *fifo)
+{
+   if (!fifo)
+      return;
+
+   if (fifo->lock)
+      slock_free(fifo->lock);
+   if (fifo->cond)
+      scond_free(fifo->cond);
+   free(fifo->buffer);
+   free(fifo);
+}
+
+static size_t spsc_fifo_used(const spsc_fifo_t *fifo,
+      size_t write_pos, size_t read_pos)
+{
+   if (write_pos >= read_pos)
+      return write_pos - read_pos;
+   return write_pos + 2 * fifo->size - read_pos;
+}
+
+static size_t spsc_fifo_advance(const spsc_fifo_t *fifo,
+      size_t pos, size_t size)
+{
+   pos += size;
+   if (pos >= 2 * fifo->size)
+      pos -= 2 * fifo->size;
+   return pos;
+}
+
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo)
+{
+   return spsc_fifo_used(fifo,
+         SPSC_LOAD_ACQUIRE(&fifo->write_pos), fifo->read_pos);
+}
+
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo)
+{
+   return fifo->size - spsc_fifo_used(fifo,
+         fifo->write_pos, SPSC_LOAD_ACQUIRE(&fifo->read_pos));
+}
+
+/* Wakes the other side if it went to sleep. The fence orders our
+ * position store before the load of waiting, pairing with the
+ * one in spsc_fifo_wait(), so a wakeup can't slip between its
+ * check and its sleep. */
+static void spsc_fifo_notify(spsc_fifo_t *fifo)
+{
+   SPSC_FENCE();
+   if (!SPSC_LOAD_ACQUIRE(&fifo->waiting))
+      return;
+
+   slock_lock(fifo->lock);
+   scond_broadcast(fifo->cond);
+   slock_unlock(fifo->lock);
+}
+
+size_t spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size)
+{
+   size_t first, offset;
+   size_t write_pos = fifo->write_pos;
+   size_t avail     = spsc_fifo_write_avail(fifo);
+
+   if (size > avail)
+      size = avail;
+   if (!size)
+      return 0;
+
+   offset = write_pos >= fifo->size ? write_pos - fifo->size : write_pos;
+   first  = fifo->size - offset;
+   if (first > size)
+      first = size;
+
+   memcpy(fifo->buffer + offset, in_buf, first);
+   memcpy(fifo->buffer, (const uint8_t*)in_buf + first, size - first);
+
+   SPSC_STORE_RELEASE(&fifo->write_pos,
+         spsc_fifo_advance(fifo, write_pos, size));
+   spsc_fifo_notify(fifo);
+   return size;
+}
+
+size_t spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size)
+{
+   size_t first, offset;
+   size_t read_pos = fifo->read_pos;
+   size_t avail    = spsc_fifo_read_avail(fifo);
+
+   if (size > avail)
+      size = avail;
+   if (!size)
+      return 0;
+
+   offset = read_pos >= fifo->size ? read_pos - fifo->size : read_pos;
+   first  = fifo->size - offset;
+   if (first > size)
+      first = size;
+
+   memcpy(out_buf, fifo->buffer + offset, first);
+   memcpy((uint8_t*)out_buf + first, fifo->buffer, size - first);
+
+   SPSC_STORE_RELEASE(&fifo->read_pos,
+         spsc_fifo_advance(fifo, read_pos, size));
+   spsc_fifo_notify(fifo);
+   return size;
+}
+
+static size_t spsc_fifo_wait(spsc_fifo_t *fifo, size_t size,
+      size_t (*avail)(spsc_fifo_t*))
+{
+   unsigned i;
+   size_t ret;
+
+   if (size > fifo->size)
+      size = fifo->size;
+
+   for (i = 0; i < fifo->spin; i++)
+   {
+      if ((ret = avail(fifo)) >= size)
+         return ret;
+      SPSC_PAUSE();
+   }
+
+   slock_lock(fifo->lock);
+   SPSC_STORE_RELEASE(&fifo->waiting, fifo->waiting + 1);
+   SPSC_FENCE();
+   if (avail(fifo) < size && !fifo->woken)
+      scond_wait(fifo->cond, fifo->lock);
+   SPSC_STORE_RELEASE(&fifo->waiting, fifo->waiting - 1);
+   fifo->woken = false;
+   slock_unlock(fifo->lock);
+
+   return avail(fifo);
+}
+
+size_t spsc_fifo_wait_write(spsc_fifo_t *fifo, size_t size)
+{
+   return spsc_fifo_wait(fifo, size, spsc_fifo_write_avail);
+}
+
+size_t spsc_fifo_wait_read(spsc_fifo_t *fifo, size_t size)
+{
+   return spsc_fifo_wait(fifo, size, spsc_fifo_read_avail);
+}
+
+void spsc_fifo_wake(spsc_fifo_t *fifo)
+{
+   slock_lock(fifo->lock);
+   fifo->woken = true;
+   scond_broadcast(fifo->cond);
+   slock_unlock(fifo->lock);
+}
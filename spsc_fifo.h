@@ -0,0 +1,65 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SPSC_FIFO_H
+#define __SPSC_FIFO_H
+
+#include <stddef.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Byte ring for exactly one producer thread and one consumer
+ * thread. Reads and writes never take a lock; only a side that
+ * has to wait for the other sleeps on a condition variable.
+ *
+ * write/write_avail/wait_write belong to the producer,
+ * read/read_avail/wait_read to the consumer. */
+
+typedef struct spsc_fifo spsc_fifo_t;
+
+/* spin is how many times a wait polls the other side before going
+ * to sleep. Only worth it when both threads have a core each. */
+spsc_fifo_t *spsc_fifo_new(size_t size, unsigned spin);
+
+void spsc_fifo_free(spsc_fifo_t *fifo);
+
+size_t spsc_fifo_read_avail(spsc_fifo_t *fifo);
+
+size_t spsc_fifo_write_avail(spsc_fifo_t *fifo);
+
+/* Copy as much as fits or is available, up to size,
+ * and return how much that was. */
+size_t spsc_fifo_write(spsc_fifo_t *fifo, const void *in_buf, size_t size);
+
+size_t spsc_fifo_read(spsc_fifo_t *fifo, void *out_buf, size_t size);
+
+/* Wait until at least size bytes can be written or read, or
+ * spsc_fifo_wake() is called. May also return early, so callers
+ * loop. Returns what is available now. */
+size_t spsc_fifo_wait_write(spsc_fifo_t *fifo, size_t size);
+
+size_t spsc_fifo_wait_read(spsc_fifo_t *fifo, size_t size);
+
+/* Kicks a waiting side out of its wait, e.g. on shutdown. */
+void spsc_fifo_wake(spsc_fifo_t *fifo);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,276 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures config_file parse time and lookup rate on a retroarch.cfg
+ * and a directory of core .info files, and checks every lookup
+ * against a walk of the entry list, which is how the getters found
+ * keys before they were indexed.
+ *
+ * Without a config, a synthetic one with as many keys as a full
+ * retroarch.cfg is written to a temporary file.
+ *
+ * Usage: config-bench [retroarch.cfg] [info_dir] [rounds]
+ */
+
+#include <file/config_file.h>
+#include <file/dir_list.h>
+#include <file/file_path.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SYNTHETIC_KEYS 900
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static bool write_synthetic(const char *path)
+{
+   unsigned i;
+   FILE *file = fopen(path, "w");
+   if (!file)
+      return false;
+
+   for (i = 0; i < SYNTHETIC_KEYS; i++)
+      fprintf(file, "input_player%u_setting_%u = \"value %u\"\n",
+            i % 16 + 1, i, i);
+
+   fclose(file);
+   return true;
+}
+
+static const char *find_linear(config_file_t *conf, const char *key)
+{
+   struct config_file_entry entry;
+   bool ok;
+
+   for (ok = config_get_entry_list_head(conf, &entry); ok;
+         ok = config_get_entry_list_next(&entry))
+      if (strcmp(key, entry.key) == 0)
+         return entry.value;
+
+   return NULL;
+}
+
+/* Every key once, then as many keys that are not there,
+ * the way settings.c asks for options a config leaves out. */
+static char **collect_keys(config_file_t *conf, size_t *count)
+{
+   struct config_file_entry entry;
+   size_t i, n = 0, cap = 64;
+   char **keys = (char**)malloc(cap * sizeof(*keys));
+   bool ok;
+
+   for (ok = config_get_entry_list_head(conf, &entry); ok;
+         ok = config_get_entry_list_next(&entry))
+   {
+      if (n == cap)
+         keys = (char**)realloc(keys, (cap *= 2) * sizeof(*keys));
+      keys[n++] = strdup(entry.key);
+   }
+
+   keys = (char**)realloc(keys, (n * 2 + 1) * sizeof(*keys));
+   for (i = 0; i < n; i++)
+   {
+      char buf[256];
+      snprintf(buf, sizeof(buf), "%s_missing", keys[i]);
+      keys[n + i] = strdup(buf);
+   }
+
+   *count = n * 2;
+   return keys;
+}
+
+static void free_keys(char **keys, size_t count)
+{
+   size_t i;
+   for (i = 0; i < count; i++)
+      free(keys[i]);
+   free(keys);
+}
+
+/* Returns false if an indexed lookup disagrees with the list. */
+static bool verify(config_file_t *conf, char **keys, size_t count)
+{
+   size_t i;
+   char buf[4096];
+
+   for (i = 0; i < count; i++)
+   {
+      const char *expected = find_linear(conf, keys[i]);
+      bool found = config_get_array(conf, keys[i], buf, sizeof(buf));
+
+      if (found != (expected != NULL) ||
+            (expected && strlen(expected) < sizeof(buf) &&
+             strcmp(buf, expected)))
+      {
+         fprintf(stderr, "Lookup mismatch for \"%s\".\n", keys[i]);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static bool bench_config(const char *path, unsigned rounds)
+{
+   unsigned r;
+   size_t i, count, found = 0;
+   double start, parse = 0.0, indexed, linear;
+   char **keys;
+   config_file_t *conf = NULL;
+   char buf[4096];
+
+   for (r = 0; r < rounds; r++)
+   {
+      config_file_free(conf);
+      start = get_time();
+      conf = config_file_new(path);
+      parse += get_time() - start;
+      if (!conf)
+      {
+         fprintf(stderr, "Could not load %s.\n", path);
+         return false;
+      }
+   }
+
+   keys = collect_keys(conf, &count);
+   if (!verify(conf, keys, count))
+   {
+      free_keys(keys, count);
+      config_file_free(conf);
+      return false;
+   }
+
+   start = get_time();
+   for (r = 0; r < rounds; r++)
+      for (i = 0; i < count; i++)
+         found += config_get_array(conf, keys[i], buf, sizeof(buf));
+   indexed = get_time() - start;
+
+   start = get_time();
+   for (r = 0; r < rounds; r++)
+      for (i = 0; i < count; i++)
+         found += find_linear(conf, keys[i]) != NULL;
+   linear = get_time() - start;
+
+   printf("%s: %u keys, parse %.1f us\n", path_basename(path),
+         (unsigned)(count / 2), parse * 1000000.0 / rounds);
+   printf("   %-10s %14.0f lookups/s\n", "indexed",
+         count * rounds / indexed);
+   printf("   %-10s %14.0f lookups/s (%lu hits)\n", "list walk",
+         count * rounds / linear, (unsigned long)found);
+
+   free_keys(keys, count);
+   config_file_free(conf);
+   return true;
+}
+
+static bool bench_info(const char *dir, unsigned rounds)
+{
+   unsigned r;
+   size_t i, keys = 0;
+   double start, parse = 0.0;
+   struct string_list *list = dir_list_new(dir, "info", false);
+
+   if (!list || !list->size)
+   {
+      fprintf(stderr, "No .info files in %s.\n", dir);
+      dir_list_free(list);
+      return false;
+   }
+
+   for (r = 0; r < rounds; r++)
+   {
+      for (i = 0; i < list->size; i++)
+      {
+         config_file_t *conf;
+         size_t count;
+         char **names;
+
+         start = get_time();
+         conf = config_file_new(list->elems[i].data);
+         parse += get_time() - start;
+         if (!conf)
+            continue;
+
+         /* Only verified once, it isn't part of the timing. */
+         if (r == 0)
+         {
+            bool ok;
+
+            names = collect_keys(conf, &count);
+            ok = verify(conf, names, count);
+            free_keys(names, count);
+            keys += count / 2;
+
+            if (!ok)
+            {
+               config_file_free(conf);
+               dir_list_free(list);
+               return false;
+            }
+         }
+         config_file_free(conf);
+      }
+   }
+
+   printf("%u .info files, %lu keys, parse %.1f us for all of them\n",
+         (unsigned)list->size, (unsigned long)keys,
+         parse * 1000000.0 / rounds);
+
+   dir_list_free(list);
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   char tmp[] = "/tmp/config-bench-XXXXXX";
+   const char *cfg = argc > 1 ? argv[1] : NULL;
+   const char *info_dir = argc > 2 ? argv[2] : NULL;
+   unsigned rounds = argc > 3 ? strtoul(argv[3], NULL, 0) : 100;
+   int failed = 0;
+
+   if (!rounds)
+      rounds = 1;
+
+   if (!cfg || !*cfg)
+   {
+      int fd = mkstemp(tmp);
+      if (fd < 0 || !write_synthetic(tmp))
+      {
+         fprintf(stderr, "Could not write a synthetic config.\n");
+         return EXIT_FAILURE;
+      }
+      close(fd);
+      cfg = tmp;
+   }
+
+   if (!bench_config(cfg, rounds))
+      failed = 1;
+   if (info_dir && !bench_info(info_dir, rounds))
+      failed = 1;
+
+   if (cfg == tmp)
+      remove(tmp);
+
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
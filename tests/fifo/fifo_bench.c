@@ -0,0 +1,362 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Stress test and latency bench for spsc_fifo.
+ *
+ * The stress pass streams a counting pattern through rings of
+ * awkward sizes with random chunk sizes on both sides, and checks
+ * every byte that comes out, sleeping and spinning.
+ *
+ * The bench pushes audio-sized chunks with a timestamp in front
+ * and measures how long each sat in the ring, against the
+ * fifo_buffer + lock + condition pattern the threaded audio
+ * drivers used before.
+ *
+ * Usage: fifo-bench [megabytes] [chunk_bytes]
+ */
+
+#include "../../spsc_fifo.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "../../fifo_buffer.h"
+#include <rthreads/rthreads.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static uint8_t pattern(size_t i)
+{
+   return (uint8_t)(i * 7 + (i >> 11));
+}
+
+/* Small xorshift so both threads get their own sequence. */
+static unsigned next_rand(uint32_t *state)
+{
+   *state ^= *state << 13;
+   *state ^= *state >> 17;
+   *state ^= *state << 5;
+   return *state;
+}
+
+struct stress
+{
+   spsc_fifo_t *fifo;
+   size_t fifo_size;
+   size_t total;
+   size_t errors;
+};
+
+static void stress_producer(void *data)
+{
+   struct stress *s = (struct stress*)data;
+   uint8_t *buf     = (uint8_t*)malloc(2 * s->fifo_size);
+   uint32_t seed    = 0x1234567;
+   size_t pos       = 0;
+
+   while (pos < s->total)
+   {
+      size_t i, written;
+      size_t chunk = 1 + next_rand(&seed) % (2 * s->fifo_size);
+      if (chunk > s->total - pos)
+         chunk = s->total - pos;
+
+      for (i = 0; i < chunk; i++)
+         buf[i] = pattern(pos + i);
+
+      written = 0;
+      while (written < chunk)
+      {
+         size_t ret = spsc_fifo_write(s->fifo, buf + written, chunk - written);
+         if (!ret)
+            spsc_fifo_wait_write(s->fifo, 1 + next_rand(&seed) % chunk);
+         written += ret;
+      }
+      pos += chunk;
+   }
+
+   free(buf);
+}
+
+static bool run_stress(size_t fifo_size, unsigned spin, size_t total)
+{
+   struct stress s;
+   sthread_t *thread;
+   uint8_t *buf  = (uint8_t*)malloc(2 * fifo_size);
+   uint32_t seed = 0x89abcdef;
+   size_t pos    = 0;
+   double start  = get_time();
+
+   s.fifo      = spsc_fifo_new(fifo_size, spin);
+   s.fifo_size = fifo_size;
+   s.total     = total;
+   s.errors    = 0;
+
+   thread = sthread_create(stress_producer, &s);
+
+   while (pos < total)
+   {
+      size_t i, ret;
+      size_t chunk = 1 + next_rand(&seed) % (2 * fifo_size);
+      if (chunk > total - pos)
+         chunk = total - pos;
+
+      ret = spsc_fifo_read(s.fifo, buf, chunk);
+      if (!ret)
+      {
+         spsc_fifo_wait_read(s.fifo, 1 + next_rand(&seed) % chunk);
+         continue;
+      }
+
+      for (i = 0; i < ret; i++)
+         if (buf[i] != pattern(pos + i))
+            s.errors++;
+      pos += ret;
+   }
+
+   sthread_join(thread);
+
+   printf("%8u %8u %10.1f %10lu\n", (unsigned)fifo_size, spin,
+         total / (get_time() - start) / (1024.0 * 1024.0),
+         (unsigned long)s.errors);
+
+   if (spsc_fifo_read_avail(s.fifo))
+      s.errors++;
+
+   spsc_fifo_free(s.fifo);
+   free(buf);
+   return s.errors == 0;
+}
+
+/* The bench proper. Each chunk starts with the time it was
+ * written; the consumer reads whole chunks and records the age. */
+
+struct bench
+{
+   /* Lock-free side. */
+   spsc_fifo_t *fifo;
+
+   /* Old driver side. */
+   fifo_buffer_t *locked;
+   slock_t *lock;
+   scond_t *cond;
+
+   size_t chunk;
+   size_t chunks;
+   double *latency;
+};
+
+static void bench_spsc_consumer(void *data)
+{
+   struct bench *b = (struct bench*)data;
+   uint8_t *buf    = (uint8_t*)malloc(b->chunk);
+   size_t i;
+
+   for (i = 0; i < b->chunks; i++)
+   {
+      double stamp;
+      size_t got = 0;
+      while (got < b->chunk)
+      {
+         size_t ret = spsc_fifo_read(b->fifo, buf + got, b->chunk - got);
+         if (!ret)
+            spsc_fifo_wait_read(b->fifo, b->chunk - got);
+         got += ret;
+      }
+
+      memcpy(&stamp, buf, sizeof(stamp));
+      b->latency[i] = get_time() - stamp;
+   }
+
+   free(buf);
+}
+
+static void bench_spsc_producer(struct bench *b, uint8_t *buf)
+{
+   size_t i;
+
+   for (i = 0; i < b->chunks; i++)
+   {
+      size_t written = 0;
+      double stamp   = get_time();
+      memcpy(buf, &stamp, sizeof(stamp));
+
+      while (written < b->chunk)
+      {
+         size_t ret = spsc_fifo_write(b->fifo, buf + written, b->chunk - written);
+         if (!ret)
+            spsc_fifo_wait_write(b->fifo, 1);
+         written += ret;
+      }
+   }
+}
+
+static void bench_locked_consumer(void *data)
+{
+   struct bench *b = (struct bench*)data;
+   uint8_t *buf    = (uint8_t*)malloc(b->chunk);
+   size_t i;
+
+   for (i = 0; i < b->chunks; i++)
+   {
+      double stamp;
+
+      slock_lock(b->lock);
+      while (fifo_read_avail(b->locked) < b->chunk)
+         scond_wait(b->cond, b->lock);
+      fifo_read(b->locked, buf, b->chunk);
+      scond_signal(b->cond);
+      slock_unlock(b->lock);
+
+      memcpy(&stamp, buf, sizeof(stamp));
+      b->latency[i] = get_time() - stamp;
+   }
+
+   free(buf);
+}
+
+static void bench_locked_producer(struct bench *b, uint8_t *buf)
+{
+   size_t i;
+
+   for (i = 0; i < b->chunks; i++)
+   {
+      size_t written = 0;
+      double stamp   = get_time();
+      memcpy(buf, &stamp, sizeof(stamp));
+
+      while (written < b->chunk)
+      {
+         size_t avail, write_amt;
+
+         slock_lock(b->lock);
+         while (!(avail = fifo_write_avail(b->locked)))
+            scond_wait(b->cond, b->lock);
+         write_amt = b->chunk - written < avail ? b->chunk - written : avail;
+         fifo_write(b->locked, buf + written, write_amt);
+         scond_signal(b->cond);
+         slock_unlock(b->lock);
+
+         written += write_amt;
+      }
+   }
+}
+
+static int compare_double(const void *a, const void *b)
+{
+   double x = *(const double*)a;
+   double y = *(const double*)b;
+   return x < y ? -1 : x > y;
+}
+
+static void run_bench(const char *name, size_t chunk, size_t total,
+      unsigned spin, bool use_spsc)
+{
+   struct bench b;
+   sthread_t *thread;
+   double start, elapsed;
+   uint8_t *buf = (uint8_t*)calloc(1, chunk);
+
+   memset(&b, 0, sizeof(b));
+   b.chunk   = chunk;
+   b.chunks  = total / chunk;
+   b.latency = (double*)calloc(b.chunks, sizeof(double));
+
+   /* Four chunks of slack, about what the drivers run with. */
+   if (use_spsc)
+      b.fifo = spsc_fifo_new(4 * chunk, spin);
+   else
+   {
+      b.locked = fifo_new(4 * chunk);
+      b.lock   = slock_new();
+      b.cond   = scond_new();
+   }
+
+   start  = get_time();
+   thread = sthread_create(use_spsc ?
+         bench_spsc_consumer : bench_locked_consumer, &b);
+
+   if (use_spsc)
+      bench_spsc_producer(&b, buf);
+   else
+      bench_locked_producer(&b, buf);
+
+   sthread_join(thread);
+   elapsed = get_time() - start;
+
+   qsort(b.latency, b.chunks, sizeof(double), compare_double);
+   printf("%-12s %6u %10.1f %10.2f %10.2f %10.2f\n", name, spin,
+         b.chunks * chunk / elapsed / (1024.0 * 1024.0),
+         b.latency[b.chunks / 2] * 1000000.0,
+         b.latency[b.chunks * 99 / 100] * 1000000.0,
+         b.latency[b.chunks - 1] * 1000000.0);
+
+   if (use_spsc)
+      spsc_fifo_free(b.fifo);
+   else
+   {
+      fifo_free(b.locked);
+      slock_free(b.lock);
+      scond_free(b.cond);
+   }
+   free(b.latency);
+   free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+   static const size_t sizes[] = { 1, 61, 4096, 65537 };
+   unsigned i;
+   bool failed      = false;
+   size_t megabytes = argc > 1 ? strtoul(argv[1], NULL, 0) : 64;
+   size_t chunk     = argc > 2 ? strtoul(argv[2], NULL, 0) : 2048;
+   size_t total     = megabytes << 20;
+
+   if (!megabytes || chunk < sizeof(double))
+   {
+      fprintf(stderr, "Usage: %s [megabytes] [chunk_bytes]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   printf("Stress, %u MiB through each ring\n", (unsigned)megabytes);
+   printf("%8s %8s %10s %10s\n", "size", "spin", "MiB/s", "errors");
+   for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+   {
+      /* A one byte ring is all wakeups, so keep that one short. */
+      size_t bytes = sizes[i] < 64 ? total / 64 : total;
+      if (!run_stress(sizes[i], 0, bytes))
+         failed = true;
+      if (!run_stress(sizes[i], 1000, bytes))
+         failed = true;
+   }
+
+   printf("\nLatency, %u byte chunks, ring of four chunks\n", (unsigned)chunk);
+   printf("%-12s %6s %10s %10s %10s %10s\n",
+         "fifo", "spin", "MiB/s", "p50 us", "p99 us", "max us");
+   run_bench("locked", chunk, total, 0, false);
+   run_bench("spsc", chunk, total, 0, true);
+   run_bench("spsc", chunk, total, 1000, true);
+
+   if (failed)
+      fprintf(stderr, "Stress test FAILED.\n");
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
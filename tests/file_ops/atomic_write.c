@@ -0,0 +1,102 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks that write_file_atomic() can replace an existing file,
+ * both with a POSIX rename() and with one that refuses to
+ * overwrite its destination like Win32 and libfat on GX.
+ * The latter is emulated by wrapping rename() at link time.
+ *
+ * Usage: atomic-write [dir]
+ */
+
+#include "../../file_ops.h"
+#include <retro_miscellaneous.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int __real_rename(const char *old_path, const char *new_path);
+
+static int no_replace;
+
+int __wrap_rename(const char *old_path, const char *new_path)
+{
+   if (no_replace && access(new_path, F_OK) == 0)
+   {
+      errno = EEXIST;
+      return -1;
+   }
+   return __real_rename(old_path, new_path);
+}
+
+static bool check_contents(const char *path, const char *expect)
+{
+   char buf[64] = {0};
+   FILE *file = fopen(path, "rb");
+   size_t len;
+
+   if (!file)
+      return false;
+   len = fread(buf, 1, sizeof(buf) - 1, file);
+   fclose(file);
+   return len == strlen(expect) && !memcmp(buf, expect, len);
+}
+
+static bool write_twice(const char *path)
+{
+   static const char first[] = "first save";
+   static const char second[] = "second";
+   char tmp_path[PATH_MAX + 4];
+
+   remove(path);
+
+   if (!write_file_atomic(path, first, strlen(first)) ||
+         !check_contents(path, first))
+      return false;
+
+   if (!write_file_atomic(path, second, strlen(second)) ||
+         !check_contents(path, second))
+      return false;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+   if (access(tmp_path, F_OK) == 0)
+      return false;
+
+   remove(path);
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   char path[PATH_MAX];
+   int failed = 0;
+
+   snprintf(path, sizeof(path), "%s/atomic-write-%d.srm",
+         argc > 1 ? argv[1] : ".", (int)getpid());
+
+   for (no_replace = 0; no_replace < 2; no_replace++)
+   {
+      bool ok = write_twice(path);
+      printf("%-26s %s\n", no_replace ?
+            "rename() without replace:" : "POSIX rename():",
+            ok ? "OK" : "FAILED");
+      if (!ok)
+         failed = 1;
+   }
+
+   return failed;
+}
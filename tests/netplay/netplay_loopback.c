@@ -0,0 +1,650 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs a netplay host and client against each other on localhost,
+ * once per injected delay, and reports desyncs, rollbacks and the
+ * CPU time each side spends per frame.
+ *
+ * netplay.c is built with sendto() redirected to a shim here, which
+ * holds every UDP input packet back by the delay plus some jitter
+ * and drops a share of them. TCP setup is left alone.
+ *
+ * Both sides run the dummy core from dynamic_dummy.c, plus a block
+ * of state folded from both players' input every frame. Each frame's
+ * hash is recorded and rewritten on replay, so a misprediction that
+ * isn't rolled back properly shows up as a hash mismatch.
+ *
+ * Usage: netplay-loopback [frames] [jitter_ms] [drop_percent] [delay_ms ...]
+ */
+
+#include "../../netplay.h"
+#include "../../general.h"
+#include "../../dynamic.h"
+#include "../../dynamic_dummy.h"
+#include "../../performance.h"
+#include <rthreads/rthreads.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LOOPBACK_PORT 55435
+#define LOOPBACK_FPS 60
+
+/* A frame is only settled once it falls out of the rollback
+ * window, so this many trailing frames aren't compared. */
+#define LOOPBACK_UNSETTLED 18
+
+#define SHIM_QUEUE_SIZE 1024
+#define SHIM_PACKET_MAX 512
+
+struct global g_extern;
+struct settings g_settings;
+driver_t driver;
+
+void (*pretro_run)(void);
+unsigned (*pretro_api_version)(void);
+size_t (*pretro_serialize_size)(void);
+bool (*pretro_serialize)(void*, size_t);
+bool (*pretro_unserialize)(const void*, size_t);
+void (*pretro_set_input_state)(retro_input_state_t);
+void *(*pretro_get_memory_data)(unsigned);
+size_t (*pretro_get_memory_size)(unsigned);
+
+retro_time_t rarch_get_time_usec(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return (retro_time_t)tv.tv_sec * 1000000 + tv.tv_nsec / 1000;
+}
+
+/* UDP shim. */
+
+struct shim_packet
+{
+   retro_time_t due;
+   int fd;
+   struct sockaddr_storage addr;
+   socklen_t addrlen;
+   size_t size;
+   uint8_t data[SHIM_PACKET_MAX];
+};
+
+static struct
+{
+   retro_time_t delay_usec;
+   retro_time_t jitter_usec;
+   unsigned drop_percent;
+
+   struct shim_packet queue[SHIM_QUEUE_SIZE];
+   unsigned count;
+   unsigned sent;
+   unsigned dropped;
+
+   slock_t *lock;
+   sthread_t *thread;
+   bool alive;
+} shim;
+
+ssize_t netplay_shim_sendto(int fd, const void *data, size_t size,
+      int flags, const struct sockaddr *addr, socklen_t addrlen)
+{
+   struct shim_packet *pkt;
+
+   if (size > SHIM_PACKET_MAX || addrlen > sizeof(pkt->addr))
+      return sendto(fd, data, size, flags, addr, addrlen);
+
+   slock_lock(shim.lock);
+   shim.sent++;
+
+   if ((unsigned)(rand() % 100) < shim.drop_percent
+         || shim.count >= SHIM_QUEUE_SIZE)
+   {
+      shim.dropped++;
+      slock_unlock(shim.lock);
+      return size;
+   }
+
+   pkt = &shim.queue[shim.count++];
+   pkt->due = rarch_get_time_usec() + shim.delay_usec;
+   if (shim.jitter_usec)
+      pkt->due += rand() % shim.jitter_usec;
+   pkt->fd = fd;
+   memcpy(&pkt->addr, addr, addrlen);
+   pkt->addrlen = addrlen;
+   pkt->size = size;
+   memcpy(pkt->data, data, size);
+
+   slock_unlock(shim.lock);
+   return size;
+}
+
+/* Sends whatever has come due. Jitter can let a later
+ * packet overtake an earlier one, as on a real link. */
+static void shim_thread(void *data)
+{
+   (void)data;
+
+   for (;;)
+   {
+      unsigned i;
+      retro_time_t now = rarch_get_time_usec();
+
+      slock_lock(shim.lock);
+      if (!shim.alive)
+      {
+         slock_unlock(shim.lock);
+         break;
+      }
+
+      for (i = 0; i < shim.count; )
+      {
+         struct shim_packet *pkt = &shim.queue[i];
+         if (pkt->due > now)
+         {
+            i++;
+            continue;
+         }
+
+         sendto(pkt->fd, pkt->data, pkt->size, 0,
+               (const struct sockaddr*)&pkt->addr, pkt->addrlen);
+         *pkt = shim.queue[--shim.count];
+      }
+      slock_unlock(shim.lock);
+
+      usleep(250);
+   }
+}
+
+/* Test core. */
+
+#define CORE_RAM_SIZE (128 << 10)
+#define CORE_TOUCH_SIZE (4 << 10)
+
+static struct
+{
+   uint32_t frame;
+   uint32_t hash;
+   uint8_t ram[CORE_RAM_SIZE];
+} core;
+
+static uint32_t *history;
+static unsigned history_frames;
+
+static uint32_t mix(uint32_t x)
+{
+   x ^= x >> 16;
+   x *= 0x7feb352dU;
+   x ^= x >> 15;
+   x *= 0x846ca68bU;
+   x ^= x >> 16;
+   return x;
+}
+
+static void core_run(void)
+{
+   unsigned i, port;
+   uint32_t pos, input = 0;
+
+   /* Polls input and presents a frame through netplay. */
+   libretro_dummy_retro_run();
+
+   for (port = 0; port < 2; port++)
+      for (i = 0; i < RARCH_FIRST_META_KEY; i++)
+         if (input_state_net(port, RETRO_DEVICE_JOYPAD, 0, i))
+            input |= 1 << (i + 16 * port);
+
+   /* Scribble over a stretch of RAM picked by the hash and fold
+    * it back in, so the result depends on a correct unserialize. */
+   core.hash = mix(core.hash ^ input ^ core.frame);
+   pos = core.hash % (CORE_RAM_SIZE - CORE_TOUCH_SIZE);
+   for (i = 0; i < CORE_TOUCH_SIZE; i++)
+      core.ram[pos + i] += (uint8_t)(core.hash >> (i & 24)) + i;
+   core.hash ^= core.ram[(core.hash >> 8) % CORE_RAM_SIZE];
+
+   if (core.frame < history_frames)
+      history[core.frame] = core.hash;
+   core.frame++;
+}
+
+static unsigned core_api_version(void)
+{
+   return RETRO_API_VERSION;
+}
+
+static size_t core_serialize_size(void)
+{
+   return sizeof(core);
+}
+
+static bool core_serialize(void *data, size_t size)
+{
+   memcpy(data, &core, sizeof(core));
+   return true;
+}
+
+static bool core_unserialize(const void *data, size_t size)
+{
+   memcpy(&core, data, sizeof(core));
+   return true;
+}
+
+static void core_set_input_state(retro_input_state_t cb)
+{
+}
+
+static void *core_get_memory_data(unsigned id)
+{
+   return NULL;
+}
+
+static size_t core_get_memory_size(unsigned id)
+{
+   return 0;
+}
+
+static bool core_environment(unsigned cmd, void *data)
+{
+   return false;
+}
+
+/* Frontend callbacks handed to netplay. */
+
+static uint32_t input_seed;
+static unsigned input_frame;
+
+static void frontend_video(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+}
+
+static void frontend_sample(int16_t left, int16_t right)
+{
+}
+
+static size_t frontend_sample_batch(const int16_t *data, size_t frames)
+{
+   return frames;
+}
+
+static void frontend_poll(void)
+{
+}
+
+/* Holds a random set of buttons for 1-8 frames at a time,
+ * which is about how often a player changes what they press. */
+static int16_t frontend_input_state(unsigned port, unsigned device,
+      unsigned idx, unsigned id)
+{
+   static unsigned until;
+   static uint32_t held;
+
+   if (input_frame >= until)
+   {
+      uint32_t r = mix(input_seed ^ input_frame);
+      held  = r & 0xfff;
+      until = input_frame + 1 + ((r >> 16) & 7);
+   }
+
+   return (held >> id) & 1;
+}
+
+/* One side of a run. */
+
+struct loopback_params
+{
+   unsigned frames;
+   unsigned delay_ms;
+   unsigned jitter_ms;
+   unsigned drop_percent;
+   uint16_t port;
+};
+
+struct peer_result
+{
+   bool connected;
+   unsigned frames;
+   double cpu_usec;
+   double cpu_max_usec;
+   unsigned packets_sent;
+   unsigned packets_dropped;
+   struct netplay_stats stats;
+};
+
+static double thread_cpu_usec(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &tv);
+   return tv.tv_sec * 1000000.0 + tv.tv_nsec / 1000.0;
+}
+
+static bool write_all(int fd, const void *data_, size_t size)
+{
+   const uint8_t *data = (const uint8_t*)data_;
+   while (size)
+   {
+      ssize_t ret = write(fd, data, size);
+      if (ret <= 0)
+         return false;
+      data += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+static bool read_all(int fd, void *data_, size_t size)
+{
+   uint8_t *data = (uint8_t*)data_;
+   while (size)
+   {
+      ssize_t ret = read(fd, data, size);
+      if (ret <= 0)
+         return false;
+      data += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+/* Runs in a child process. Sends the result and frame hashes to out_fd
+ * once params->frames have run, then keeps playing so the other side
+ * can finish too, until ctl_fd is closed. */
+static int run_peer(bool host, const struct loopback_params *params,
+      int out_fd, int ctl_fd)
+{
+   unsigned i;
+   struct retro_callbacks cbs = {0};
+   struct peer_result result  = {0};
+   netplay_t *netplay         = NULL;
+   retro_time_t frame_usec    = 1000000 / LOOPBACK_FPS;
+   retro_time_t next;
+
+   pretro_run              = core_run;
+   pretro_api_version      = core_api_version;
+   pretro_serialize_size   = core_serialize_size;
+   pretro_serialize        = core_serialize;
+   pretro_unserialize      = core_unserialize;
+   pretro_set_input_state  = core_set_input_state;
+   pretro_get_memory_data  = core_get_memory_data;
+   pretro_get_memory_size  = core_get_memory_size;
+
+   libretro_dummy_retro_set_environment(core_environment);
+   libretro_dummy_retro_set_input_poll(input_poll_net);
+   libretro_dummy_retro_set_video_refresh(video_frame_net);
+   libretro_dummy_retro_init();
+   libretro_dummy_retro_get_system_info(&g_extern.system.info);
+   libretro_dummy_retro_get_system_av_info(&g_extern.system.av_info);
+   g_extern.msg_queue = msg_queue_new(8);
+
+   history_frames = params->frames;
+   history = (uint32_t*)calloc(history_frames, sizeof(*history));
+   input_seed = host ? 0x1234 : 0x5678;
+   srand(host ? 1 : 2);
+
+   cbs.frame_cb        = frontend_video;
+   cbs.sample_cb       = frontend_sample;
+   cbs.sample_batch_cb = frontend_sample_batch;
+   cbs.state_cb        = frontend_input_state;
+   cbs.poll_cb         = frontend_poll;
+
+   shim.delay_usec   = params->delay_ms * 1000;
+   shim.jitter_usec  = params->jitter_ms * 1000;
+   shim.drop_percent = params->drop_percent;
+   shim.lock         = slock_new();
+   shim.alive        = true;
+   shim.thread       = sthread_create(shim_thread, NULL);
+
+   if (!netplay_init_network())
+      return EXIT_FAILURE;
+
+   /* The host blocks in accept(); give it a head start. */
+   for (i = 0; i < 50 && !netplay; i++)
+   {
+      if (!host)
+         usleep(100000);
+      netplay = netplay_new(host ? NULL : "127.0.0.1", params->port, 2,
+            &cbs, false, host ? "host" : "client");
+      if (host)
+         break;
+   }
+
+   if (!netplay)
+   {
+      write_all(out_fd, &result, sizeof(result));
+      return EXIT_FAILURE;
+   }
+   driver.netplay_data = netplay;
+   result.connected = true;
+
+   next = rarch_get_time_usec();
+   for (input_frame = 0; ; input_frame++)
+   {
+      retro_time_t now;
+      double cpu;
+
+      if (input_frame == params->frames)
+      {
+         netplay_get_stats(netplay, &result.stats);
+         result.frames = params->frames;
+         result.cpu_usec /= params->frames;
+         slock_lock(shim.lock);
+         result.packets_sent    = shim.sent;
+         result.packets_dropped = shim.dropped;
+         slock_unlock(shim.lock);
+
+         write_all(out_fd, &result, sizeof(result));
+         write_all(out_fd, history, history_frames * sizeof(*history));
+      }
+
+      if (input_frame >= params->frames)
+      {
+         struct pollfd fds = { ctl_fd, POLLIN, 0 };
+         if (poll(&fds, 1, 0) != 0)
+            break;
+      }
+
+      cpu = thread_cpu_usec();
+      netplay_pre_frame(netplay);
+      pretro_run();
+      netplay_post_frame(netplay);
+      cpu = thread_cpu_usec() - cpu;
+
+      if (input_frame < params->frames)
+      {
+         result.cpu_usec += cpu;
+         if (cpu > result.cpu_max_usec)
+            result.cpu_max_usec = cpu;
+      }
+
+      /* Pace to the core's frame rate, without trying
+       * to catch up on time lost while blocked. */
+      next += frame_usec;
+      now = rarch_get_time_usec();
+      if (next > now)
+         usleep(next - now);
+      else
+         next = now;
+   }
+
+   slock_lock(shim.lock);
+   shim.alive = false;
+   slock_unlock(shim.lock);
+   sthread_join(shim.thread);
+   slock_free(shim.lock);
+
+   netplay_free(netplay);
+   libretro_dummy_retro_deinit();
+   msg_queue_free(g_extern.msg_queue);
+   free(history);
+   return EXIT_SUCCESS;
+}
+
+/* inherited lists pipe ends of the other peer, or -1. The child
+ * must not keep those open or the other side never sees EOF. */
+static pid_t spawn_peer(bool host, const struct loopback_params *params,
+      int *out_fd, int *ctl_fd, const int *inherited)
+{
+   pid_t pid;
+   int out[2], ctl[2];
+
+   if (pipe(out) < 0 || pipe(ctl) < 0)
+      return -1;
+
+   /* Or the children flush our buffered output a second time. */
+   fflush(stdout);
+
+   pid = fork();
+   if (pid == 0)
+   {
+      close(out[0]);
+      close(ctl[1]);
+      if (inherited[0] >= 0)
+         close(inherited[0]);
+      if (inherited[1] >= 0)
+         close(inherited[1]);
+      exit(run_peer(host, params, out[1], ctl[0]));
+   }
+
+   close(out[1]);
+   close(ctl[0]);
+   *out_fd = out[0];
+   *ctl_fd = ctl[1];
+   return pid;
+}
+
+/* Returns the number of frames that differ, or -1 on failure. */
+static int run_loopback(const struct loopback_params *params,
+      struct peer_result *results)
+{
+   unsigned i;
+   int out_fd[2] = {-1, -1}, ctl_fd[2] = {-1, -1};
+   pid_t pid[2];
+   uint32_t *hashes[2];
+   int desyncs = 0;
+
+   for (i = 0; i < 2; i++)
+   {
+      int inherited[2] = { out_fd[0], ctl_fd[0] };
+
+      hashes[i] = (uint32_t*)calloc(params->frames, sizeof(uint32_t));
+      pid[i] = spawn_peer(i == 0, params, &out_fd[i], &ctl_fd[i], inherited);
+      if (pid[i] < 0)
+         return -1;
+   }
+
+   for (i = 0; i < 2; i++)
+   {
+      if (!read_all(out_fd[i], &results[i], sizeof(results[i])) ||
+            !results[i].connected ||
+            !read_all(out_fd[i], hashes[i], params->frames * sizeof(uint32_t)))
+         desyncs = -1;
+   }
+
+   for (i = 0; i < 2; i++)
+   {
+      close(ctl_fd[i]);
+      close(out_fd[i]);
+      waitpid(pid[i], NULL, 0);
+   }
+
+   for (i = 0; desyncs >= 0 && i + LOOPBACK_UNSETTLED < params->frames; i++)
+   {
+      if (hashes[0][i] == hashes[1][i])
+         continue;
+      if (!desyncs)
+         fprintf(stderr, "Delay %u ms: first desync at frame %u.\n",
+               params->delay_ms, i);
+      desyncs++;
+   }
+
+   free(hashes[0]);
+   free(hashes[1]);
+   return desyncs;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   int failed = 0;
+   unsigned frames       = argc > 1 ? strtoul(argv[1], NULL, 0) : 600;
+   unsigned jitter_ms    = argc > 2 ? strtoul(argv[2], NULL, 0) : 4;
+   unsigned drop_percent = argc > 3 ? strtoul(argv[3], NULL, 0) : 2;
+   static const unsigned default_delays[] = { 0, 16, 50, 100 };
+   unsigned num_delays = argc > 4 ? argc - 4 :
+      sizeof(default_delays) / sizeof(default_delays[0]);
+
+   printf("%u frames at %u fps, %u ms jitter, %u%% of input packets dropped.\n",
+         frames, LOOPBACK_FPS, jitter_ms, drop_percent);
+   printf("%-7s %6s %9s %9s %6s %7s %7s %8s %8s %8s\n",
+         "Delay", "Desync", "Rollbacks", "Replayed", "Depth",
+         "Window", "RTT ms", "Ser us", "Host us", "Cli us");
+
+   for (i = 0; i < (int)num_delays; i++)
+   {
+      struct peer_result results[2];
+      struct loopback_params params;
+      int desyncs;
+      unsigned p, depth = 0, window = 0;
+      uint64_t rollbacks = 0, replayed = 0, serializes = 0;
+      retro_time_t rtt = 0, serialize_usec = 0;
+
+      params.frames       = frames;
+      params.delay_ms     = argc > 4 ? strtoul(argv[4 + i], NULL, 0) :
+         default_delays[i];
+      params.jitter_ms    = jitter_ms;
+      params.drop_percent = drop_percent;
+      params.port         = LOOPBACK_PORT + i;
+
+      memset(results, 0, sizeof(results));
+      desyncs = run_loopback(&params, results);
+      if (desyncs < 0)
+      {
+         fprintf(stderr, "Delay %u ms: peers failed to connect.\n",
+               params.delay_ms);
+         failed = 1;
+         continue;
+      }
+      if (desyncs)
+         failed = 1;
+
+      for (p = 0; p < 2; p++)
+      {
+         const struct netplay_stats *stats = &results[p].stats;
+         rollbacks      += stats->rollbacks;
+         replayed       += stats->replayed_frames;
+         serializes     += stats->serializes;
+         serialize_usec += stats->serialize_usec;
+         rtt            += stats->rtt_usec / 2;
+         if (stats->max_rollback_depth > depth)
+            depth = stats->max_rollback_depth;
+         if (stats->window > window)
+            window = stats->window;
+      }
+
+      printf("%4u ms %6d %9u %9u %6u %7u %7.1f %8.1f %8.1f %8.1f\n",
+            params.delay_ms, desyncs,
+            (unsigned)rollbacks, (unsigned)replayed, depth, window,
+            rtt / 1000.0,
+            serializes ? (double)serialize_usec / serializes : 0.0,
+            results[0].cpu_usec, results[1].cpu_usec);
+   }
+
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Measures state_manager push throughput for a range of state sizes
+ * and change ratios, synchronous and async, and checks that every
+ * state pops back out intact.
+ *
+ * Only the time spent inside state_manager_push_where() and
+ * state_manager_push_do() is counted, not the serialize stand-in.
+ * Between pushes the bench spins for frame_us to stand in for
+ * pretro_run(), which is what the async worker overlaps with.
+ * The overlap needs a second core. On a single-core host the
+ * worker only runs when the scheduler preempts the spin, so
+ * async pushes mostly wait on it and land between the sync
+ * numbers and a fraction of them.
+ *
+ * A second table shows how far back a fixed budget reaches with
+ * dense-only history and with keyframe tiers.
+ *
+ * Usage: rewind-bench [frames] [frame_us]
+ */
+
+#include "../../rewind.h"
+#include "../../general.h"
+#include "../../performance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct global g_extern;
+
+void rarch_perf_register(struct retro_perf_counter *perf)
+{
+   perf->registered = true;
+}
+
+retro_perf_tick_t rarch_get_perf_counter(void)
+{
+   return 0;
+}
+
+unsigned rarch_get_cpu_cores(void)
+{
+   return 2;
+}
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Scribbles over about ratio of the state in short runs, the way
+ * RAM of an emulated system tends to change: most writes hit the
+ * same small working set frame after frame. */
+static void mutate(uint8_t *state, size_t size, double ratio)
+{
+   size_t i;
+   size_t runs = (size_t)(size * ratio / 16) + 1;
+
+   for (i = 0; i < runs; i++)
+   {
+      size_t span = (rand() % 10) ? size / 16 : size;
+      size_t pos = ((size_t)rand() * 65599u + rand()) % span;
+      size_t len = 1 + rand() % 32;
+      if (pos + len > size)
+         len = size - pos;
+      while (len--)
+         state[pos++] = rand();
+   }
+}
+
+static void spin(double usec)
+{
+   double end = get_time() + usec / 1000000.0;
+   while (get_time() < end);
+}
+
+/* Returns the foreground push cost in seconds, 0 on error. */
+static double bench(size_t size, double ratio, unsigned frames,
+      double frame_us, bool async)
+{
+   unsigned i, verify;
+   double fg = 0.0;
+   uint8_t *cur = (uint8_t*)calloc(1, size);
+   uint8_t *history;
+   state_manager_t *state;
+
+   /* Ring large enough to hold every delta. */
+   state = state_manager_new_tiered(size,
+         size * 2 + (size_t)(size * ratio * 4 + 64) * frames, 0);
+   if (!state || !cur || !state_manager_set_async(state, async))
+      return 0.0;
+
+   verify = frames < 16 ? frames : 16;
+   history = (uint8_t*)malloc(size * verify);
+
+   srand(size);
+   for (i = 0; i < size; i++)
+      cur[i] = rand();
+
+   for (i = 0; i < frames; i++)
+   {
+      void *where;
+      double start;
+
+      spin(frame_us);
+      mutate(cur, size, ratio);
+      if (i >= frames - verify)
+         memcpy(history + (i - (frames - verify)) * size, cur, size);
+
+      start = get_time();
+      state_manager_push_where(state, &where);
+      fg += get_time() - start;
+
+      /* Stands in for pretro_serialize(). */
+      memcpy(where, cur, size);
+
+      start = get_time();
+      state_manager_push_do(state);
+      fg += get_time() - start;
+   }
+
+   for (i = 0; i < verify; i++)
+   {
+      const void *data;
+      const uint8_t *expected = history + (verify - 1 - i) * size;
+
+      if (!state_manager_pop(state, &data) || memcmp(data, expected, size))
+      {
+         fprintf(stderr, "State mismatch %u frames back.\n", i);
+         fg = 0.0;
+         break;
+      }
+   }
+
+   state_manager_free(state);
+   free(history);
+   free(cur);
+   return fg;
+}
+
+/* Fills a budget-sized history and returns how many pushes back
+ * it reaches. */
+static size_t horizon(size_t size, double ratio, size_t budget,
+      unsigned interval, unsigned frames)
+{
+   unsigned i;
+   size_t ret = 0;
+   uint8_t *cur = (uint8_t*)calloc(1, size);
+   state_manager_t *state = state_manager_new_tiered(size, budget, interval);
+
+   if (!state || !cur)
+      return 0;
+
+   srand(size);
+   for (i = 0; i < frames; i++)
+   {
+      void *where;
+
+      mutate(cur, size, ratio);
+      state_manager_push_where(state, &where);
+      memcpy(where, cur, size);
+      state_manager_push_do(state);
+   }
+
+   state_manager_capacity(state, NULL, NULL, NULL, &ret);
+   state_manager_free(state);
+   free(cur);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned s, r;
+   int failed = 0;
+   unsigned frames = argc > 1 ? strtoul(argv[1], NULL, 0) : 200;
+   double frame_us = argc > 2 ? strtod(argv[2], NULL) : 4000.0;
+   static const size_t sizes[] = { 64 << 10, 512 << 10, 2 << 20, 8 << 20 };
+   static const double ratios[] = { 0.001, 0.01, 0.1 };
+
+#if __AVX2__
+   puts("Delta scan: AVX2");
+#elif __SSE2__
+   puts("Delta scan: SSE2");
+#else
+   puts("Delta scan: C");
+#endif
+   printf("%u frames, %.0f us of emulation between pushes.\n",
+         frames, frame_us);
+   printf("%-10s %8s %12s %12s %12s\n",
+         "State", "Changed", "Delta MB/s", "Sync us/f", "Async us/f");
+
+   for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+   {
+      for (r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++)
+      {
+         double mb = (double)sizes[s] * frames / (1024.0 * 1024.0);
+         double t_sync  = bench(sizes[s], ratios[r], frames, frame_us, false);
+         double t_async = bench(sizes[s], ratios[r], frames, frame_us, true);
+
+         if (t_sync == 0.0 || t_async == 0.0)
+         {
+            failed = 1;
+            continue;
+         }
+
+         printf("%7u KiB %7.1f%% %12.1f %12.1f %12.1f\n",
+               (unsigned)(sizes[s] >> 10), ratios[r] * 100.0,
+               mb / t_sync, t_sync * 1000000.0 / frames,
+               t_async * 1000000.0 / frames);
+      }
+   }
+
+   printf("\n%-10s %8s %10s %14s %14s\n",
+         "State", "Changed", "Budget", "Dense secs", "Tiered secs");
+   for (r = 0; r < sizeof(ratios) / sizeof(ratios[0]) - 1; r++)
+   {
+      size_t size   = 256 << 10;
+      size_t budget = 16 << 20;
+      unsigned n    = 60 * 60 * 5;
+
+      printf("%7u KiB %7.1f%% %6u MiB %14.1f %14.1f\n",
+            (unsigned)(size >> 10), ratios[r] * 100.0,
+            (unsigned)(budget >> 20),
+            horizon(size, ratios[r], budget, 0, n) / 60.0,
+            horizon(size, ratios[r], budget, 60, n) / 60.0);
+   }
+
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,363 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Turns a .rrec stream from the lossless recording backend into
+ * a numbered PNG per video frame and a WAV of the audio, for an
+ * encoder of your choice to pick up from there. */
+
+#include "../../record/lossless.h"
+#include "../../gfx/rpng/rpng.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct rrec
+{
+   FILE *file;
+   uint32_t flags;
+   uint32_t pix_fmt;
+   uint32_t fb_width;
+   uint32_t fb_height;
+   uint32_t channels;
+   uint32_t samplerate;
+
+   uint8_t *payload;
+   size_t payload_size;
+
+   /* Last decoded frame, as stored. */
+   uint8_t *frame;
+   unsigned width;
+   unsigned height;
+   size_t stride;
+   uint32_t *argb;
+};
+
+static const uint8_t *get_varint(const uint8_t *in, const uint8_t *end,
+      size_t *val)
+{
+   unsigned shift = 0;
+
+   *val = 0;
+   while (in < end && shift < 35)
+   {
+      uint8_t byte = *in++;
+      *val |= (size_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return in;
+      shift += 7;
+   }
+
+   return NULL;
+}
+
+static bool decode_frame(struct rrec *rrec, bool key,
+      const uint8_t *in, size_t size)
+{
+   size_t i = 0, words;
+   const uint8_t *end = in + size;
+   unsigned width, height;
+   size_t stride;
+
+   if (size < 12)
+      return false;
+
+   width  = lossless_read_le32(in + 0);
+   height = lossless_read_le32(in + 4);
+   stride = lossless_read_le32(in + 8);
+   in    += 12;
+
+   if (width > rrec->fb_width || height > rrec->fb_height ||
+         stride != lossless_stride(width, rrec->pix_fmt))
+      return false;
+
+   /* Deltas are only valid against a frame of the same size. */
+   if (!key && (width != rrec->width || height != rrec->height))
+      return false;
+
+   words = stride * height / 4;
+   if (key)
+      memset(rrec->frame, 0, stride * height);
+
+   while (i < words)
+   {
+      size_t skip, literal;
+
+      if (!(in = get_varint(in, end, &skip)) ||
+            !(in = get_varint(in, end, &literal)))
+         return false;
+
+      if (skip > words - i || literal > words - i - skip ||
+            literal * 4 > (size_t)(end - in))
+         return false;
+
+      for (i += skip; literal; literal--, i++, in += 4)
+      {
+         uint32_t a, b;
+         memcpy(&a, rrec->frame + i * 4, 4);
+         memcpy(&b, in, 4);
+         a ^= b;
+         memcpy(rrec->frame + i * 4, &a, 4);
+      }
+   }
+
+   rrec->width  = width;
+   rrec->height = height;
+   rrec->stride = stride;
+   return true;
+}
+
+static void convert_frame(struct rrec *rrec)
+{
+   unsigned x, y;
+   bool big = rrec->flags & LOSSLESS_FLAG_BIG_ENDIAN;
+
+   for (y = 0; y < rrec->height; y++)
+   {
+      const uint8_t *src = rrec->frame + y * rrec->stride;
+      uint32_t *dst      = rrec->argb + y * rrec->width;
+
+      for (x = 0; x < rrec->width; x++)
+      {
+         uint32_t r, g, b;
+
+         switch (rrec->pix_fmt)
+         {
+            case 0: /* RGB565 */
+            {
+               const uint8_t *p = src + x * 2;
+               uint32_t col = big ? (p[0] << 8) | p[1] : (p[1] << 8) | p[0];
+               r = (col >> 11) & 0x1f;
+               g = (col >>  5) & 0x3f;
+               b = (col >>  0) & 0x1f;
+               r = (r << 3) | (r >> 2);
+               g = (g << 2) | (g >> 4);
+               b = (b << 3) | (b >> 2);
+               break;
+            }
+
+            case 1: /* BGR24 */
+            {
+               const uint8_t *p = src + x * 3;
+               b = p[0];
+               g = p[1];
+               r = p[2];
+               break;
+            }
+
+            default: /* ARGB8888 */
+            {
+               const uint8_t *p = src + x * 4;
+               r = big ? p[1] : p[2];
+               g = big ? p[2] : p[1];
+               b = big ? p[3] : p[0];
+               break;
+            }
+         }
+
+         dst[x] = 0xff000000u | (r << 16) | (g << 8) | b;
+      }
+   }
+}
+
+static bool write_wav_header(FILE *file, const struct rrec *rrec,
+      uint32_t data_size)
+{
+   uint8_t header[44];
+
+   memcpy(header +  0, "RIFF", 4);
+   lossless_write_le32(header +  4, 36 + data_size);
+   memcpy(header +  8, "WAVEfmt ", 8);
+   lossless_write_le32(header + 16, 16);
+   lossless_write_le32(header + 20, 1 | (rrec->channels << 16));
+   lossless_write_le32(header + 24, rrec->samplerate);
+   lossless_write_le32(header + 28, rrec->samplerate * rrec->channels * 2);
+   lossless_write_le32(header + 32, (rrec->channels * 2) | (16 << 16));
+   memcpy(header + 36, "data", 4);
+   lossless_write_le32(header + 40, data_size);
+
+   rewind(file);
+   return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+static bool read_header(struct rrec *rrec)
+{
+   uint8_t header[LOSSLESS_HEADER_SIZE];
+
+   if (fread(header, 1, sizeof(header), rrec->file) != sizeof(header) ||
+         memcmp(header, LOSSLESS_MAGIC, 8))
+   {
+      fprintf(stderr, "Not a lossless recording.\n");
+      return false;
+   }
+
+   if (lossless_read_le32(header + 8) != LOSSLESS_VERSION)
+   {
+      fprintf(stderr, "Unsupported version %u.\n",
+            (unsigned)lossless_read_le32(header + 8));
+      return false;
+   }
+
+   rrec->flags      = lossless_read_le32(header + 12);
+   rrec->pix_fmt    = lossless_read_le32(header + 16);
+   rrec->fb_width   = lossless_read_le32(header + 20);
+   rrec->fb_height  = lossless_read_le32(header + 24);
+   rrec->channels   = lossless_read_le32(header + 28);
+   rrec->samplerate = (uint32_t)
+      ((lossless_read_le64(header + 40) + 500000) / 1000000);
+
+   if (!lossless_pixel_size(rrec->pix_fmt) || !rrec->channels ||
+         !rrec->fb_width || !rrec->fb_height)
+   {
+      fprintf(stderr, "Bad header.\n");
+      return false;
+   }
+
+   fprintf(stderr, "%ux%u, format %u, %.3f fps, %u Hz, %u channels.\n",
+         rrec->fb_width, rrec->fb_height, rrec->pix_fmt,
+         lossless_read_le64(header + 32) / 1000000.0,
+         rrec->samplerate, rrec->channels);
+
+   rrec->frame = (uint8_t*)calloc(1,
+         lossless_stride(rrec->fb_width, rrec->pix_fmt) * rrec->fb_height);
+   rrec->argb  = (uint32_t*)calloc(rrec->fb_width * rrec->fb_height,
+         sizeof(uint32_t));
+   return rrec->frame && rrec->argb;
+}
+
+int main(int argc, char *argv[])
+{
+   struct rrec rrec = {0};
+   FILE *wav = NULL;
+   uint32_t wav_size = 0;
+   unsigned frames = 0;
+   bool have_frame = false, ended = false;
+   int ret = EXIT_FAILURE;
+
+   if (argc < 3)
+   {
+      fprintf(stderr, "Usage: %s <in.rrec> <png prefix> [out.wav]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   if (!(rrec.file = fopen(argv[1], "rb")))
+   {
+      fprintf(stderr, "Could not open \"%s\".\n", argv[1]);
+      return EXIT_FAILURE;
+   }
+
+   if (!read_header(&rrec))
+      goto end;
+
+   if (argc > 3)
+   {
+      if (!(wav = fopen(argv[3], "wb")) || !write_wav_header(wav, &rrec, 0))
+      {
+         fprintf(stderr, "Could not open \"%s\".\n", argv[3]);
+         goto end;
+      }
+   }
+
+   for (;;)
+   {
+      uint8_t chunk[8];
+      uint32_t tag, size;
+
+      if (fread(chunk, 1, sizeof(chunk), rrec.file) != sizeof(chunk))
+         break;
+
+      tag  = lossless_read_le32(chunk + 0);
+      size = lossless_read_le32(chunk + 4);
+
+      if (size > rrec.payload_size)
+      {
+         uint8_t *payload = (uint8_t*)realloc(rrec.payload, size);
+         if (!payload)
+            goto end;
+         rrec.payload      = payload;
+         rrec.payload_size = size;
+      }
+
+      if (fread(rrec.payload, 1, size, rrec.file) != size)
+         break;
+
+      if (tag == LOSSLESS_TAG_VKEY || tag == LOSSLESS_TAG_VDLT ||
+            tag == LOSSLESS_TAG_VDUP)
+      {
+         char path[1024];
+
+         if (tag != LOSSLESS_TAG_VDUP)
+         {
+            have_frame = decode_frame(&rrec, tag == LOSSLESS_TAG_VKEY,
+                  rrec.payload, size);
+            if (!have_frame)
+            {
+               /* Deltas need a keyframe first. */
+               rrec.width = rrec.height = 0;
+               fprintf(stderr, "Bad frame %u, skipping to the next keyframe.\n",
+                     frames);
+            }
+            else
+               convert_frame(&rrec);
+         }
+
+         /* Frames before the first good one have nothing to show. */
+         if (have_frame)
+         {
+            snprintf(path, sizeof(path), "%s%06u.png", argv[2], frames);
+            if (!rpng_save_image_argb(path, rrec.argb, rrec.width,
+                     rrec.height, rrec.width * sizeof(uint32_t)))
+            {
+               fprintf(stderr, "Could not write \"%s\".\n", path);
+               goto end;
+            }
+         }
+         frames++;
+      }
+      else if (tag == LOSSLESS_TAG_AUDI)
+      {
+         if (wav && fwrite(rrec.payload, 1, size, wav) != size)
+            goto end;
+         wav_size += size;
+      }
+      else if (tag == LOSSLESS_TAG_REND && size >= 24)
+      {
+         fprintf(stderr, "Recorded %llu frames, %llu audio frames, "
+               "dropped %u frames, %u audio frames.\n",
+               (unsigned long long)lossless_read_le64(rrec.payload + 0),
+               (unsigned long long)lossless_read_le64(rrec.payload + 8),
+               (unsigned)lossless_read_le32(rrec.payload + 16),
+               (unsigned)lossless_read_le32(rrec.payload + 20));
+         ended = true;
+      }
+   }
+
+   if (!ended)
+      fprintf(stderr, "Recording was cut off.\n");
+
+   if (wav && !write_wav_header(wav, &rrec, wav_size))
+      goto end;
+
+   fprintf(stderr, "Wrote %u frames.\n", frames);
+   ret = EXIT_SUCCESS;
+
+end:
+   if (wav)
+      fclose(wav);
+   fclose(rrec.file);
+   free(rrec.payload);
+   free(rrec.frame);
+   free(rrec.argb);
+   return ret;
+}